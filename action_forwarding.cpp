@@ -0,0 +1,163 @@
+#include "./action_forwarding.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+
+#include "./actions.h"
+#include "./shared_memory.h"
+#include "./types.h"
+
+namespace apm {
+
+using sbat::SharedMemory;
+using std::string;
+using std::unique_ptr;
+
+namespace {
+
+uint32 RecordSize(uint32 length) {
+  return (sizeof(ActionRecordHeader) + length + ACTION_RECORD_ALIGN - 1) &
+      ~(ACTION_RECORD_ALIGN - 1);
+}
+
+}  // namespace
+
+unique_ptr<ActionForwardReader> ActionForwardReader::Create(const string& name, uint32 capacity) {
+  if (capacity < RecordSize(255) || (capacity & (capacity - 1)) != 0) {
+    return unique_ptr<ActionForwardReader>();
+  }
+  const size_t size = sizeof(ActionForwardHeader) + capacity;
+  unique_ptr<SharedMemory> memory(new SharedMemory(name, size, SharedMemory::Mode::Create));
+  if (memory->hasErrors()) {
+    return unique_ptr<ActionForwardReader>();
+  }
+
+  return unique_ptr<ActionForwardReader>(new ActionForwardReader(std::move(memory), capacity));
+}
+
+ActionForwardReader::ActionForwardReader(unique_ptr<SharedMemory> memory, uint32 capacity)
+  : memory_(std::move(memory)),
+    header_(nullptr),
+    ring_(nullptr),
+    capacity_(capacity),
+    readPosition_(0) {
+  byte* base = reinterpret_cast<byte*>(memory_->data());
+  ring_ = base + sizeof(ActionForwardHeader);
+
+  header_ = new (base) ActionForwardHeader();
+  header_->version = ACTION_FORWARD_VERSION;
+  header_->headerSize = sizeof(ActionForwardHeader);
+  header_->capacity = capacity_;
+  header_->writerModuleBase = 0;
+  header_->writerBwVersion = 0;
+  header_->writerProcessId.store(0, std::memory_order_relaxed);
+  header_->droppedActions.store(0, std::memory_order_relaxed);
+  header_->writePosition.store(0, std::memory_order_relaxed);
+  header_->readPosition.store(0, std::memory_order_relaxed);
+  header_->magic.store(ACTION_FORWARD_MAGIC, std::memory_order_release);
+}
+
+bool ActionForwardReader::Next(ForwardedAction* action) {
+  const uint32 writePosition = header_->writePosition.load(std::memory_order_acquire);
+  if (readPosition_ == writePosition) {
+    return false;
+  }
+
+  ActionRecordHeader record;
+  std::memcpy(&record, ring_ + readPosition_ % capacity_, sizeof(record));
+  if (record.length == 0) {
+    // Padding, the writer wrapped around to the start of the ring (and wrote the padding and the
+    // next record together, so the record is there)
+    readPosition_ += capacity_ - readPosition_ % capacity_;
+    std::memcpy(&record, ring_, sizeof(record));
+  }
+
+  action->tick = record.tick;
+  action->player = record.player;
+  action->length = record.length;
+  std::memcpy(action->data.data(), ring_ + readPosition_ % capacity_ + sizeof(record),
+      record.length);
+  readPosition_ += RecordSize(record.length);
+  header_->readPosition.store(readPosition_, std::memory_order_release);
+  return true;
+}
+
+uint32 ActionForwardReader::writerProcessId() const {
+  return header_->writerProcessId.load(std::memory_order_acquire);
+}
+
+uint32 ActionForwardReader::droppedActions() const {
+  return header_->droppedActions.load(std::memory_order_relaxed);
+}
+
+unique_ptr<ActionForwardWriter> ActionForwardWriter::Open(uint32 processId, uint64 moduleBase,
+    uint32 bwVersion, const string& name) {
+  unique_ptr<SharedMemory> memory(new SharedMemory(name, 0, SharedMemory::Mode::Open));
+  if (memory->hasErrors() || memory->size() < sizeof(ActionForwardHeader)) {
+    return unique_ptr<ActionForwardWriter>();
+  }
+
+  ActionForwardHeader* header = reinterpret_cast<ActionForwardHeader*>(memory->data());
+  if (header->magic.load(std::memory_order_acquire) != ACTION_FORWARD_MAGIC ||
+      header->version != ACTION_FORWARD_VERSION ||
+      header->headerSize != sizeof(ActionForwardHeader) ||
+      header->capacity == 0 || (header->capacity & (header->capacity - 1)) != 0 ||
+      memory->size() < sizeof(ActionForwardHeader) + header->capacity) {
+    return unique_ptr<ActionForwardWriter>();
+  }
+
+  header->writerModuleBase = moduleBase;
+  header->writerBwVersion = bwVersion;
+  header->writerProcessId.store(processId, std::memory_order_release);
+  return unique_ptr<ActionForwardWriter>(new ActionForwardWriter(std::move(memory)));
+}
+
+ActionForwardWriter::ActionForwardWriter(unique_ptr<SharedMemory> memory)
+  : memory_(std::move(memory)),
+    header_(nullptr),
+    ring_(nullptr),
+    capacity_(0),
+    writePosition_(0) {
+  byte* base = reinterpret_cast<byte*>(memory_->data());
+  header_ = reinterpret_cast<ActionForwardHeader*>(base);
+  ring_ = base + sizeof(ActionForwardHeader);
+  capacity_ = header_->capacity;
+  // Carry on from a previous writer (e.g. if the game was restarted while the reader kept running)
+  writePosition_ = header_->writePosition.load(std::memory_order_relaxed);
+}
+
+bool ActionForwardWriter::Forward(uint32 tick, uint8 player, const byte* action) {
+  const uint32 length = std::min(std::max(GetActionLength(action), 1u), 255u);
+  const uint32 recordSize = RecordSize(length);
+  const uint32 offset = writePosition_ % capacity_;
+  // Records are never split, so one that doesn't fit before the end of the ring needs the rest of
+  // it padded out
+  const uint32 padding = capacity_ - offset < recordSize ? capacity_ - offset : 0;
+  const uint32 readPosition = header_->readPosition.load(std::memory_order_acquire);
+  if (capacity_ - (writePosition_ - readPosition) < padding + recordSize) {
+    header_->droppedActions.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  ActionRecordHeader record = ActionRecordHeader();
+  if (padding != 0) {
+    // Records are aligned, so there's always room for at least the header
+    std::memcpy(ring_ + offset, &record, sizeof(record));
+    writePosition_ += padding;
+  }
+  record.tick = tick;
+  record.player = player;
+  record.length = static_cast<uint8>(length);
+  byte* dest = ring_ + writePosition_ % capacity_;
+  std::memcpy(dest, &record, sizeof(record));
+  std::memcpy(dest + sizeof(record), action, length);
+  writePosition_ += recordSize;
+  header_->writePosition.store(writePosition_, std::memory_order_release);
+  return true;
+}
+
+}  // namespace apm
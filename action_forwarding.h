@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "./shared_memory.h"
+#include "./types.h"
+
+namespace apm {
+
+// Raw actions forwarded out of the game by the action hook, for a GameMonitor running in another
+// process (see RemoteBroodWar). The region starts with an ActionForwardHeader, followed by a ring
+// of capacity bytes holding records: an ActionRecordHeader, then the action's bytes, padded to
+// ACTION_RECORD_ALIGN. Unlike telemetry, there's exactly one reader and it owns the region: the
+// monitor process creates it, and the plugin only forwards (instead of running its own monitor) if
+// it exists when the plugin is injected. Forwarding never blocks the game, so if the reader falls a
+// whole ring behind, actions are dropped (and counted) rather than overwriting unread ones.
+
+const char ACTION_FORWARD_MAPPING_NAME[] = "APMDisplayActions";
+const uint32 ACTION_FORWARD_MAGIC = 0x46415041;  // 'APAF'
+const uint32 ACTION_FORWARD_VERSION = 2;
+const uint32 ACTION_FORWARD_CAPACITY = 64 * 1024;
+const uint32 ACTION_RECORD_ALIGN = 8;
+
+// Fixed layout, shared between processes. Changing it requires bumping ACTION_FORWARD_VERSION.
+struct ActionRecordHeader {
+  uint32 tick;
+  uint8 player;
+  // Length of the action data that follows. 0 marks padding, meaning the next record is at the
+  // start of the ring.
+  uint8 length;
+  uint16 reserved;
+};
+
+struct ActionForwardHeader {
+  // Written last by the creator, writers must not trust anything else until it's set
+  std::atomic<uint32> magic;
+  uint32 version;
+  uint32 headerSize;
+  // Bytes in the ring, a power of 2
+  uint32 capacity;
+  // Where BW's module is loaded in the writer's process, so the reader can find the game's data
+  // (whose location depends on it for some versions)
+  uint64 writerModuleBase;
+  // Which BW the writer is in (one of the BW_VERSION constants), so the reader knows what data it
+  // has and where
+  uint32 writerBwVersion;
+  // Written last by each writer that attaches, 0 until one has
+  std::atomic<uint32> writerProcessId;
+  // Actions the writer couldn't fit in the ring
+  std::atomic<uint32> droppedActions;
+  // Total bytes written to/read from the ring (wrapping), written only by the writer/reader
+  // respectively. Kept on separate cache lines so the two sides don't contend.
+  alignas(64) std::atomic<uint32> writePosition;
+  alignas(64) std::atomic<uint32> readPosition;
+};
+
+struct ForwardedAction {
+  uint32 tick;
+  uint8 player;
+  uint8 length;
+  std::array<byte, 255> data;
+};
+
+// Creates the region and reads actions from it, in the monitor process
+class ActionForwardReader {
+public:
+  // Returns nullptr if the shared memory couldn't be created (including when another monitor
+  // already has the name) or capacity isn't a power of 2
+  static std::unique_ptr<ActionForwardReader> Create(
+      const std::string& name = ACTION_FORWARD_MAPPING_NAME,
+      uint32 capacity = ACTION_FORWARD_CAPACITY);
+
+  // Copies the next unread action into action, returning false if there isn't one
+  bool Next(ForwardedAction* action);
+
+  // 0 if no writer has attached yet
+  uint32 writerProcessId() const;
+  uint64 writerModuleBase() const { return header_->writerModuleBase; }
+  uint32 writerBwVersion() const { return header_->writerBwVersion; }
+  uint32 droppedActions() const;
+
+private:
+  ActionForwardReader(std::unique_ptr<sbat::SharedMemory> memory, uint32 capacity);
+  // Disable copying
+  ActionForwardReader(const ActionForwardReader&) = delete;
+  ActionForwardReader& operator=(const ActionForwardReader&) = delete;
+
+  std::unique_ptr<sbat::SharedMemory> memory_;
+  ActionForwardHeader* header_;
+  const byte* ring_;
+  uint32 capacity_;
+  uint32 readPosition_;
+};
+
+// Attaches to an existing region and forwards actions into it, on BW's game loop thread
+class ActionForwardWriter {
+public:
+  // Returns nullptr if no reader has created the region (or it doesn't match this version's
+  // layout). The process ID, module base and BW version are published for the reader.
+  static std::unique_ptr<ActionForwardWriter> Open(uint32 processId, uint64 moduleBase,
+      uint32 bwVersion, const std::string& name = ACTION_FORWARD_MAPPING_NAME);
+
+  // Takes an action as passed to BW's action handler (type byte first). Returns false if it was
+  // dropped because the ring is full.
+  bool Forward(uint32 tick, uint8 player, const byte* action);
+
+private:
+  ActionForwardWriter(std::unique_ptr<sbat::SharedMemory> memory);
+  // Disable copying
+  ActionForwardWriter(const ActionForwardWriter&) = delete;
+  ActionForwardWriter& operator=(const ActionForwardWriter&) = delete;
+
+  std::unique_ptr<sbat::SharedMemory> memory_;
+  ActionForwardHeader* header_;
+  byte* ring_;
+  uint32 capacity_;
+  uint32 writePosition_;
+};
+
+}  // namespace apm
@@ -0,0 +1,76 @@
+#include "./actions.h"
+
+#include <array>
+
+#include "./types.h"
+
+namespace apm {
+
+namespace {
+
+// Lengths of fixed size actions, 0 for variable or unknown ones
+std::array<uint8, 256> CreateActionLengths() {
+  std::array<uint8, 256> lengths = std::array<uint8, 256>();
+  lengths[action::KEEP_ALIVE] = 1;
+  lengths[action::RESTART_GAME] = 1;
+  lengths[action::BUILD] = 8;
+  lengths[action::VISION] = 3;
+  lengths[action::ALLIANCE] = 5;
+  lengths[action::GAME_SPEED] = 2;
+  lengths[action::PAUSE] = 1;
+  lengths[action::RESUME] = 1;
+  lengths[action::CHEAT] = 5;
+  lengths[action::HOTKEY] = 3;
+  lengths[action::RIGHT_CLICK] = 10;
+  lengths[action::TARGETED_ORDER] = 11;
+  lengths[action::CANCEL_BUILD] = 1;
+  lengths[action::CANCEL_MORPH] = 1;
+  lengths[action::STOP] = 2;
+  lengths[action::CARRIER_STOP] = 1;
+  lengths[action::REAVER_STOP] = 1;
+  lengths[action::ORDER_NOTHING] = 1;
+  lengths[action::RETURN_CARGO] = 2;
+  lengths[action::TRAIN] = 3;
+  lengths[action::CANCEL_TRAIN] = 3;
+  lengths[action::CLOAK] = 2;
+  lengths[action::DECLOAK] = 2;
+  lengths[action::UNIT_MORPH] = 3;
+  lengths[action::UNSIEGE] = 2;
+  lengths[action::SIEGE] = 2;
+  lengths[action::TRAIN_FIGHTER] = 1;
+  lengths[action::UNLOAD_ALL] = 2;
+  lengths[action::UNLOAD] = 3;
+  lengths[action::MERGE_ARCHON] = 1;
+  lengths[action::HOLD_POSITION] = 2;
+  lengths[action::BURROW] = 2;
+  lengths[action::UNBURROW] = 2;
+  lengths[action::CANCEL_NUKE] = 1;
+  lengths[action::LIFT_OFF] = 5;
+  lengths[action::TECH] = 2;
+  lengths[action::CANCEL_TECH] = 1;
+  lengths[action::UPGRADE] = 2;
+  lengths[action::CANCEL_UPGRADE] = 1;
+  lengths[action::CANCEL_ADDON] = 1;
+  lengths[action::BUILDING_MORPH] = 3;
+  lengths[action::STIM] = 1;
+  lengths[action::SYNC] = 7;
+  lengths[action::LEAVE_GAME] = 2;
+  lengths[action::MINIMAP_PING] = 5;
+  lengths[action::MERGE_DARK_ARCHON] = 1;
+  lengths[action::CHAT] = 82;
+  return lengths;
+}
+
+const std::array<uint8, 256> ACTION_LENGTHS = CreateActionLengths();
+
+}  // namespace
+
+uint32 GetActionLength(const byte* data) {
+  if (IsSelectionAction(data[0])) {
+    // type, unit count, then a 2 byte id per unit
+    return 2 + data[1] * 2;
+  }
+  return ACTION_LENGTHS[data[0]];
+}
+
+}  // namespace apm
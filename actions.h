@@ -0,0 +1,77 @@
+#pragma once
+
+#include "./types.h"
+
+namespace apm {
+
+// Command (action) types, as found in the first byte of the data BW passes to its action handler
+namespace action {
+const byte KEEP_ALIVE = 0x05;
+const byte SAVE_GAME = 0x06;
+const byte LOAD_GAME = 0x07;
+const byte RESTART_GAME = 0x08;
+const byte SELECT = 0x09;
+const byte SHIFT_SELECT = 0x0A;
+const byte SHIFT_DESELECT = 0x0B;
+const byte BUILD = 0x0C;
+const byte VISION = 0x0D;
+const byte ALLIANCE = 0x0E;
+const byte GAME_SPEED = 0x0F;
+const byte PAUSE = 0x10;
+const byte RESUME = 0x11;
+const byte CHEAT = 0x12;
+const byte HOTKEY = 0x13;
+const byte RIGHT_CLICK = 0x14;
+const byte TARGETED_ORDER = 0x15;
+const byte CANCEL_BUILD = 0x18;
+const byte CANCEL_MORPH = 0x19;
+const byte STOP = 0x1A;
+const byte CARRIER_STOP = 0x1B;
+const byte REAVER_STOP = 0x1C;
+const byte ORDER_NOTHING = 0x1D;
+const byte RETURN_CARGO = 0x1E;
+const byte TRAIN = 0x1F;
+const byte CANCEL_TRAIN = 0x20;
+const byte CLOAK = 0x21;
+const byte DECLOAK = 0x22;
+const byte UNIT_MORPH = 0x23;
+const byte UNSIEGE = 0x25;
+const byte SIEGE = 0x26;
+const byte TRAIN_FIGHTER = 0x27;
+const byte UNLOAD_ALL = 0x28;
+const byte UNLOAD = 0x29;
+const byte MERGE_ARCHON = 0x2A;
+const byte HOLD_POSITION = 0x2B;
+const byte BURROW = 0x2C;
+const byte UNBURROW = 0x2D;
+const byte CANCEL_NUKE = 0x2E;
+const byte LIFT_OFF = 0x2F;
+const byte TECH = 0x30;
+const byte CANCEL_TECH = 0x31;
+const byte UPGRADE = 0x32;
+const byte CANCEL_UPGRADE = 0x33;
+const byte CANCEL_ADDON = 0x34;
+const byte BUILDING_MORPH = 0x35;
+const byte STIM = 0x36;
+const byte SYNC = 0x37;
+const byte LEAVE_GAME = 0x57;
+const byte MINIMAP_PING = 0x58;
+const byte MERGE_DARK_ARCHON = 0x5A;
+const byte CHAT = 0x5C;
+
+// Sub-types of HOTKEY actions
+const byte HOTKEY_ASSIGN = 0x00;
+const byte HOTKEY_SELECT = 0x01;
+const byte HOTKEY_ADD = 0x02;
+}  // namespace action
+
+inline bool IsSelectionAction(byte type) {
+  return type == action::SELECT || type == action::SHIFT_SELECT || type == action::SHIFT_DESELECT;
+}
+
+// Returns the total length (including the type byte) of the action starting at data, or 0 if the
+// type's length isn't known. Selection actions are variable length, so their unit count is read
+// from data as well.
+uint32 GetActionLength(const byte* data);
+
+}  // namespace apm
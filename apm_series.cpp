@@ -0,0 +1,145 @@
+#include "./apm_series.h"
+
+#include <algorithm>
+#include <array>
+
+#include "./types.h"
+
+namespace apm {
+
+const uint32 NO_BUCKET = 0xFFFFFFFF;
+
+ApmSeries::ApmSeries()
+  : levels_() {
+  Reset();
+}
+
+void ApmSeries::Reset() {
+  for (Level& level : levels_) {
+    level.newest = NO_BUCKET;
+    for (auto& slot : level.buckets) {
+      slot.fill(Bucket());
+    }
+  }
+}
+
+uint32 ApmSeries::BucketMillis(size_t level) {
+  uint32 millis = BASE_BUCKET_MILLIS;
+  for (size_t i = 0; i < level; i++) {
+    millis *= LEVEL_FACTOR;
+  }
+  return millis;
+}
+
+void ApmSeries::Add(uint32 timeMillis, const std::array<int32, 12>& apm) {
+  for (size_t i = 0; i < levels_.size(); i++) {
+    Level& level = levels_[i];
+    const uint32 index = timeMillis / BucketMillis(i);
+    if (level.newest == NO_BUCKET || index > level.newest) {
+      // Clear out the buckets being moved into, which still hold whatever the ring last had there
+      const uint32 first = level.newest == NO_BUCKET ? index : level.newest + 1;
+      const uint32 count =
+          std::min(index - first + 1, static_cast<uint32>(BUCKETS_PER_LEVEL));
+      for (uint32 j = 0; j < count; j++) {
+        level.buckets[(index - j) % BUCKETS_PER_LEVEL].fill(Bucket());
+      }
+      level.newest = index;
+    } else if (index < level.newest) {
+      continue;
+    }
+
+    std::array<Bucket, 12>& slot = level.buckets[index % BUCKETS_PER_LEVEL];
+    for (size_t player = 0; player < slot.size(); player++) {
+      Bucket& bucket = slot[player];
+      const int16 value = static_cast<int16>(std::min(std::max(apm[player], 0), 32767));
+      if (bucket.samples == 0) {
+        bucket.min = value;
+        bucket.max = value;
+      } else {
+        bucket.min = std::min(bucket.min, value);
+        bucket.max = std::max(bucket.max, value);
+      }
+      bucket.sum += value;
+      if (bucket.samples < 0xFFFF) {
+        bucket.samples++;
+      }
+    }
+  }
+}
+
+void ApmSeries::Rewind(uint32 timeMillis) {
+  for (size_t i = 0; i < levels_.size(); i++) {
+    Level& level = levels_[i];
+    const uint32 index = timeMillis / BucketMillis(i);
+    if (level.newest == NO_BUCKET || index >= level.newest) {
+      continue;
+    }
+    const uint32 count = std::min(level.newest - index, static_cast<uint32>(BUCKETS_PER_LEVEL));
+    for (uint32 j = 0; j < count; j++) {
+      level.buckets[(level.newest - j) % BUCKETS_PER_LEVEL].fill(Bucket());
+    }
+    level.newest = index;
+  }
+}
+
+void ApmSeries::AddToPoint(const Bucket& bucket, ApmGraphPoint* point) {
+  if (bucket.samples == 0) {
+    return;
+  }
+  if (point->samples == 0) {
+    point->min = bucket.min;
+    point->max = bucket.max;
+  } else {
+    point->min = std::min<int32>(point->min, bucket.min);
+    point->max = std::max<int32>(point->max, bucket.max);
+  }
+  // mean holds the sum until all the buckets have been added
+  point->mean += bucket.sum;
+  point->samples += bucket.samples;
+}
+
+void ApmSeries::Query(size_t player, uint32 startMillis, uint32 endMillis, size_t numPoints,
+    ApmGraphPoint* points) const {
+  std::fill(points, points + numPoints, ApmGraphPoint());
+  if (player >= 12 || numPoints == 0 || endMillis <= startMillis) {
+    return;
+  }
+
+  // The finest level that has at most LEVEL_FACTOR buckets per point, or a coarser one if that
+  // doesn't reach back to startMillis anymore
+  const uint64 span = endMillis - startMillis;
+  size_t levelNum = 0;
+  while (levelNum + 1 < levels_.size() &&
+      span > static_cast<uint64>(BucketMillis(levelNum)) * numPoints * LEVEL_FACTOR) {
+    levelNum++;
+  }
+  while (levelNum + 1 < levels_.size() && levels_[levelNum].newest != NO_BUCKET &&
+      startMillis / BucketMillis(levelNum) + BUCKETS_PER_LEVEL <= levels_[levelNum].newest) {
+    levelNum++;
+  }
+
+  const Level& level = levels_[levelNum];
+  if (level.newest == NO_BUCKET) {
+    return;
+  }
+  const uint32 bucketMillis = BucketMillis(levelNum);
+  const uint32 oldest =
+      level.newest >= BUCKETS_PER_LEVEL ? level.newest - (BUCKETS_PER_LEVEL - 1) : 0;
+  for (size_t i = 0; i < numPoints; i++) {
+    const uint32 pointStart = startMillis + static_cast<uint32>(span * i / numPoints);
+    const uint32 pointEnd = startMillis + static_cast<uint32>(span * (i + 1) / numPoints);
+    // Points narrower than a bucket share it with their neighbors
+    const uint32 first = std::max(pointStart / bucketMillis, oldest);
+    const uint32 last = std::min((std::max(pointEnd, pointStart + 1) - 1) / bucketMillis,
+        level.newest);
+    ApmGraphPoint& point = points[i];
+    for (uint32 index = first; index <= last; index++) {
+      AddToPoint(level.buckets[index % BUCKETS_PER_LEVEL][player], &point);
+    }
+    if (point.samples != 0) {
+      point.mean = static_cast<int32>(point.mean / static_cast<int32>(point.samples));
+    }
+  }
+}
+
+}  // namespace apm
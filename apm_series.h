@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "./types.h"
+
+namespace apm {
+
+// A point of a graph, summarizing the APM samples in its time span
+struct ApmGraphPoint {
+  // 0 if no samples fell into the span, in which case the other fields are meaningless
+  uint32 samples;
+  int32 min;
+  int32 max;
+  int32 mean;
+};
+
+// Multi-resolution store of each player's APM over time, for graphing. Every sample is merged
+// into a bucket at each of a few levels, with each level's buckets covering LEVEL_FACTOR times as
+// much game time as the previous level's, and each level keeping only its most recent
+// BUCKETS_PER_LEVEL buckets in a ring. Memory use is fixed, adding a sample is O(levels), and
+// fetching any number of points is O(points) regardless of how long the game has gone on, since
+// a level whose buckets are at most LEVEL_FACTOR to a point can always be picked.
+class ApmSeries {
+public:
+  static const size_t NUM_LEVELS = 4;
+  static const size_t LEVEL_FACTOR = 4;
+  static const size_t BUCKETS_PER_LEVEL = 256;
+  // Span of each bucket at the finest level
+  static const uint32 BASE_BUCKET_MILLIS = 1000;
+
+  ApmSeries();
+
+  void Reset();
+  // Adds a sample of every player's APM at game time timeMillis. Samples have to be added in time
+  // order.
+  void Add(uint32 timeMillis, const std::array<int32, 12>& apm);
+  // Drops the samples after timeMillis (approximately, since the buckets it falls in are kept), so
+  // that adding can continue from there
+  void Rewind(uint32 timeMillis);
+
+  // Fills points with numPoints evenly spaced summaries of player's APM over
+  // [startMillis, endMillis). Parts of the range that are older than the coarsest level keeps, or
+  // that haven't happened yet, come out empty.
+  void Query(size_t player, uint32 startMillis, uint32 endMillis, size_t numPoints,
+      ApmGraphPoint* points) const;
+
+  // The game time covered by each level before it starts to overwrite its oldest buckets
+  static uint32 LevelSpanMillis(size_t level) {
+    return BucketMillis(level) * static_cast<uint32>(BUCKETS_PER_LEVEL);
+  }
+
+private:
+  struct Bucket {
+    int32 sum;
+    uint16 samples;
+    int16 min;
+    int16 max;
+  };
+
+  struct Level {
+    // Index (in bucket spans since the start of the game) of the newest bucket, 0xFFFFFFFF if
+    // nothing has been added yet
+    uint32 newest;
+    std::array<std::array<Bucket, 12>, BUCKETS_PER_LEVEL> buckets;
+  };
+
+  static uint32 BucketMillis(size_t level);
+  static void AddToPoint(const Bucket& bucket, ApmGraphPoint* point);
+
+  std::array<Level, NUM_LEVELS> levels_;
+};
+
+}  // namespace apm
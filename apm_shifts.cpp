@@ -0,0 +1,117 @@
+#include "./apm_shifts.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "./types.h"
+
+namespace apm {
+
+// Window the baseline rate is averaged over
+const uint32 BASELINE_MILLIS = 30000;
+// Time the baseline is estimated for before detection starts, at game start and after each shift
+const uint32 START_WARMUP_MILLIS = 20000;
+const uint32 SHIFT_WARMUP_MILLIS = 10000;
+// Actions come in bursts (spammed clicks, hotkey cycling), so counts vary more than a Poisson
+// process' would. The variance to mean ratio is estimated along with the baseline, and the
+// likelihood ratios are scaled down by it (within these bounds) to keep false alarms down.
+const double MIN_DISPERSION = 1.0;
+const double MAX_DISPERSION = 8.0;
+// Expected actions per update are floored at this, so a player that has been idle (and has a
+// baseline near 0) doesn't trigger a burst with a few actions
+const double MIN_EXPECTED_ACTIONS = 0.1;
+// Rate ratios that the upper and lower CUSUMs are tuned to detect, and the log likelihood ratio
+// they have to accumulate to report a shift
+const double BURST_RATIO = 2.0;
+const double COLLAPSE_RATIO = 0.4;
+const double THRESHOLD = 6.0;
+// Shifts smaller than this are swallowed rather than reported
+const int32 MIN_SHIFT_APM = 40;
+
+ApmShiftDetector::ApmShiftDetector()
+  : states_(),
+    lastShifts_() {
+  Reset();
+}
+
+void ApmShiftDetector::Reset() {
+  PlayerState initial = PlayerState();
+  initial.dispersion = MIN_DISPERSION;
+  initial.warmupMillis = START_WARMUP_MILLIS;
+  states_.fill(initial);
+  ApmShift none = ApmShift();
+  none.kind = ApmShiftKind::None;
+  lastShifts_.fill(none);
+}
+
+void ApmShiftDetector::AddToCusum(double step, uint32 elapsedMillis, uint32 actions,
+    Cusum* cusum) {
+  cusum->sum += step;
+  if (cusum->sum <= 0) {
+    *cusum = Cusum();
+  } else {
+    cusum->actions += actions;
+    cusum->millis += elapsedMillis;
+  }
+}
+
+int32 ToApm(double actionsPerMilli) {
+  return static_cast<int32>(actionsPerMilli * 60000 + 0.5);
+}
+
+bool ApmShiftDetector::Update(uint32 player, uint32 timeMillis, uint32 elapsedMillis,
+    uint32 actions) {
+  if (player >= states_.size() || elapsedMillis == 0) {
+    return false;
+  }
+
+  PlayerState& state = states_[player];
+  const double expected = std::max(state.baseline * elapsedMillis, MIN_EXPECTED_ACTIONS);
+  if (state.warmupMillis == 0) {
+    // Poisson log likelihood ratios of the shifted rates against the baseline
+    const double burstRatio = actions * std::log(BURST_RATIO) - (BURST_RATIO - 1) * expected;
+    const double collapseRatio =
+        actions * std::log(COLLAPSE_RATIO) - (COLLAPSE_RATIO - 1) * expected;
+    const double dispersion =
+        std::min(std::max(state.dispersion, MIN_DISPERSION), MAX_DISPERSION);
+    AddToCusum(burstRatio / dispersion, elapsedMillis, actions, &state.upper);
+    AddToCusum(collapseRatio / dispersion, elapsedMillis, actions, &state.lower);
+
+    const bool burst = state.upper.sum > THRESHOLD;
+    if (burst || state.lower.sum > THRESHOLD) {
+      const Cusum& side = burst ? state.upper : state.lower;
+      // The rate since the CUSUM started climbing is the estimate of the new level
+      const double rate = static_cast<double>(side.actions) / side.millis;
+      const int32 fromApm = ToApm(state.baseline);
+      const int32 toApm = ToApm(rate);
+
+      state.baseline = rate;
+      state.baselineMillis = side.millis;
+      state.warmupMillis = SHIFT_WARMUP_MILLIS;
+      state.upper = Cusum();
+      state.lower = Cusum();
+      if (std::abs(toApm - fromApm) < MIN_SHIFT_APM) {
+        return false;
+      }
+
+      ApmShift& shift = lastShifts_[player];
+      shift.kind = burst ? ApmShiftKind::Burst : ApmShiftKind::Collapse;
+      shift.timeMillis = timeMillis;
+      shift.fromApm = fromApm;
+      shift.toApm = toApm;
+      return true;
+    }
+  } else {
+    state.warmupMillis -= std::min(state.warmupMillis, elapsedMillis);
+  }
+
+  // Cumulative average until the window is filled, exponential moving average after that
+  state.baselineMillis = std::min(state.baselineMillis + elapsedMillis, BASELINE_MILLIS);
+  const double weight = static_cast<double>(elapsedMillis) / state.baselineMillis;
+  state.baseline += (static_cast<double>(actions) / elapsedMillis - state.baseline) * weight;
+  const double deviation = actions - expected;
+  state.dispersion += (deviation * deviation / expected - state.dispersion) * weight;
+  return false;
+}
+
+}  // namespace apm
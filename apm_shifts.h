@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "./types.h"
+
+namespace apm {
+
+enum class ApmShiftKind : uint8 {
+  None = 0,
+  // APM jumped above the player's recent baseline (e.g. a fight started)
+  Burst,
+  // APM dropped below it (e.g. the player tabbed out)
+  Collapse,
+};
+
+struct ApmShift {
+  ApmShiftKind kind;
+  // Game time at which the shift was detected (which is a few seconds after it happened)
+  uint32 timeMillis;
+  int32 fromApm;
+  int32 toApm;
+};
+
+// Streaming change-point detector over each player's action counts. Runs a two-sided CUSUM of
+// Poisson log likelihood ratios for a higher and a lower rate against a slowly adapting baseline,
+// scaled down by how much burstier than a Poisson process the player's actions have been. Each
+// update is a handful of floating point operations on fixed per-player state, so it can run on
+// every APM calculation.
+class ApmShiftDetector {
+public:
+  ApmShiftDetector();
+
+  void Reset();
+  // Feeds the number of actions player made in the elapsedMillis of game time leading up to
+  // timeMillis. Returns true if that completed a shift, which is then available from lastShift.
+  bool Update(uint32 player, uint32 timeMillis, uint32 elapsedMillis, uint32 actions);
+
+  // The most recent shift detected for player, with kind None if there hasn't been one
+  const ApmShift& lastShift(size_t player) const { return lastShifts_[player]; }
+
+private:
+  // One side of the CUSUM, along with what went into it since it was last at 0 (which is the
+  // best estimate of when the shift started)
+  struct Cusum {
+    double sum;
+    uint32 actions;
+    uint32 millis;
+  };
+
+  struct PlayerState {
+    // In actions per millisecond
+    double baseline;
+    // Game time the baseline has been estimated over, capped at the averaging window
+    uint32 baselineMillis;
+    // Variance to mean ratio of the action counts, averaged over the same window as the baseline
+    double dispersion;
+    // Detection is held off until the baseline has settled
+    uint32 warmupMillis;
+    Cusum upper;
+    Cusum lower;
+  };
+
+  static void AddToCusum(double step, uint32 elapsedMillis, uint32 actions, Cusum* cusum);
+
+  std::array<PlayerState, 12> states_;
+  std::array<ApmShift, 12> lastShifts_;
+};
+
+}  // namespace apm
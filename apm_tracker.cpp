@@ -0,0 +1,145 @@
+#include "./apm_tracker.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "./apm_shifts.h"
+#include "./game_arena.h"
+#include "./types.h"
+#include "./varint.h"
+
+namespace apm {
+
+const double ApmTracker::APM_INTERVAL = 0.95;
+
+ApmTracker::ApmTracker(GameArena* arena)
+  : state_(),
+    checkpointing_(false),
+    journal_(ArenaAllocator<byte>(arena)),
+    checkpoints_(ArenaAllocator<Checkpoint>(arena)),
+    checkpointMillis_(BASE_CHECKPOINT_MILLIS) {
+}
+
+void ApmTracker::Reset(bool checkpointing) {
+  state_ = State();
+  checkpointing_ = checkpointing;
+  ResetArenaVector(&journal_);
+  ResetArenaVector(&checkpoints_);
+  checkpointMillis_ = BASE_CHECKPOINT_MILLIS;
+  if (checkpointing_) {
+    // Room for the extra one that triggers thinning, so the snapshots never have to move
+    checkpoints_.reserve(MAX_CHECKPOINTS + 1);
+    Checkpoint start = { state_, 0 };
+    checkpoints_.push_back(start);
+  }
+}
+
+void ApmTracker::Apply(uint32 timeMillis, const std::array<uint32, 12>& actions, State* state) {
+  const uint32 elapsedMillis = timeMillis - state->timeMillis;
+  const double decay = std::exp(-static_cast<double>(elapsedMillis) / (APM_INTERVAL * 60000));
+  for (size_t i = 0; i < actions.size(); i++) {
+    state->counters[i] = state->counters[i] * decay + actions[i];
+    state->actions[i] += actions[i];
+    state->shifts.Update(i, timeMillis, elapsedMillis, actions[i]);
+  }
+  state->timeMillis = timeMillis;
+}
+
+void ApmTracker::AppendToJournal(uint32 elapsedMillis, const std::array<uint32, 12>& actions) {
+  uint32 mask = 0;
+  for (size_t i = 0; i < actions.size(); i++) {
+    if (actions[i] != 0) {
+      mask |= 1 << i;
+    }
+  }
+  WriteVarint(elapsedMillis, &journal_);
+  WriteVarint(mask, &journal_);
+  for (size_t i = 0; i < actions.size(); i++) {
+    if (actions[i] != 0) {
+      WriteVarint(actions[i], &journal_);
+    }
+  }
+}
+
+bool ReadJournalEntry(const ArenaVector<byte>& journal, size_t* pos, uint32* elapsedMillis,
+    std::array<uint32, 12>* actions) {
+  const byte* cursor = journal.data() + *pos;
+  const byte* end = journal.data() + journal.size();
+  uint32 mask;
+  if (!ReadVarint(&cursor, end, elapsedMillis) || !ReadVarint(&cursor, end, &mask)) {
+    return false;
+  }
+  for (size_t i = 0; i < actions->size(); i++) {
+    (*actions)[i] = 0;
+    if ((mask & (1 << i)) != 0 && !ReadVarint(&cursor, end, &(*actions)[i])) {
+      return false;
+    }
+  }
+  *pos = static_cast<size_t>(cursor - journal.data());
+  return true;
+}
+
+void ApmTracker::Advance(uint32 timeMillis, const std::array<uint32, 12>& actions) {
+  const uint32 elapsedMillis = timeMillis - state_.timeMillis;
+  Apply(timeMillis, actions, &state_);
+  if (!checkpointing_) {
+    return;
+  }
+
+  AppendToJournal(elapsedMillis, actions);
+  if (timeMillis - checkpoints_.back().state.timeMillis >= checkpointMillis_) {
+    Checkpoint checkpoint = { state_, journal_.size() };
+    checkpoints_.push_back(checkpoint);
+    if (checkpoints_.size() > MAX_CHECKPOINTS) {
+      // Keep every other one (including the one at the start of the game)
+      for (size_t i = 1; i * 2 < checkpoints_.size(); i++) {
+        checkpoints_[i] = checkpoints_[i * 2];
+      }
+      checkpoints_.resize((checkpoints_.size() + 1) / 2);
+      checkpointMillis_ *= 2;
+    }
+  }
+}
+
+void ApmTracker::Seek(uint32 timeMillis) {
+  if (!checkpointing_ || timeMillis >= state_.timeMillis) {
+    return;
+  }
+
+  // The first checkpoint is at the start of the game, so there's always one at or before the target
+  auto checkpoint = std::upper_bound(checkpoints_.begin(), checkpoints_.end(), timeMillis,
+      [](uint32 time, const Checkpoint& c) { return time < c.state.timeMillis; }) - 1;
+  state_ = checkpoint->state;
+  size_t pos = checkpoint->journalOffset;
+  checkpoints_.erase(checkpoint + 1, checkpoints_.end());
+
+  // Fast forward through the journal up to the target, and drop everything after that, since it
+  // will get recorded again as the replay plays on
+  std::array<uint32, 12> actions;
+  for (;;) {
+    size_t next = pos;
+    uint32 elapsedMillis;
+    if (!ReadJournalEntry(journal_, &next, &elapsedMillis, &actions) ||
+        state_.timeMillis + elapsedMillis > timeMillis) {
+      break;
+    }
+    Apply(state_.timeMillis + elapsedMillis, actions, &state_);
+    pos = next;
+  }
+  journal_.resize(pos);
+}
+
+void ApmTracker::GetApm(std::array<int32, 12>* apm) const {
+  // Early in the game, the counters haven't had the time to fill up to a full interval's worth
+  double gameDurationFactor =
+      1 - std::exp(-static_cast<double>(state_.timeMillis) / (APM_INTERVAL * 60000));
+  if (gameDurationFactor < 0.01) {
+    gameDurationFactor = 0.01;
+  }
+  for (size_t i = 0; i < apm->size(); i++) {
+    (*apm)[i] = static_cast<int32>(state_.counters[i] / (APM_INTERVAL * gameDurationFactor));
+  }
+}
+
+}  // namespace apm
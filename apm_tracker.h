@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "./apm_shifts.h"
+#include "./game_arena.h"
+#include "./types.h"
+
+namespace apm {
+
+// Each player's exponentially decaying action counter, which the displayed APM is derived from,
+// along with the shift detector that runs over the same counts.
+//
+// If checkpointing is enabled (for replays, which can be rewound), every update is also appended
+// to a compact journal of per-interval action counts, and the full state is snapshotted every so
+// often. Seeking backwards then restores the closest snapshot before the target and replays the
+// journal from there, rather than having to start over from the beginning of the game.
+class ApmTracker {
+public:
+  // Time after which actions are worth 1/e, in minutes
+  static const double APM_INTERVAL;
+  // At most this many snapshots are kept. When they fill up, every other one is dropped and the
+  // interval between them is doubled, so they cover games of any length.
+  static const size_t MAX_CHECKPOINTS = 64;
+  static const uint32 BASE_CHECKPOINT_MILLIS = 10000;
+
+  // The journal and snapshots come from arena, if there is one (see ArenaAllocator)
+  explicit ApmTracker(GameArena* arena = nullptr);
+
+  void Reset(bool checkpointing);
+  // Counts actions made by each player since the last update, up to timeMillis of game time
+  void Advance(uint32 timeMillis, const std::array<uint32, 12>& actions);
+  // Moves back to the state at timeMillis (which must be before the current time), or as close
+  // as the journal allows. Does nothing if checkpointing isn't enabled.
+  void Seek(uint32 timeMillis);
+
+  uint32 timeMillis() const { return state_.timeMillis; }
+  // Total actions of player up to the current time
+  uint32 actions(size_t player) const { return state_.actions[player]; }
+  void GetApm(std::array<int32, 12>* apm) const;
+  const ApmShiftDetector& shifts() const { return state_.shifts; }
+
+  size_t journalSize() const { return journal_.size(); }
+  size_t numCheckpoints() const { return checkpoints_.size(); }
+
+private:
+  struct State {
+    uint32 timeMillis;
+    std::array<double, 12> counters;
+    std::array<uint32, 12> actions;
+    ApmShiftDetector shifts;
+  };
+
+  struct Checkpoint {
+    State state;
+    // Where the journal continues from this state
+    size_t journalOffset;
+  };
+
+  static void Apply(uint32 timeMillis, const std::array<uint32, 12>& actions, State* state);
+  void AppendToJournal(uint32 elapsedMillis, const std::array<uint32, 12>& actions);
+
+  State state_;
+  bool checkpointing_;
+  // Each entry is the elapsed time, a mask of the players that had actions, and the action count
+  // of each of them, all as LEB128 varints
+  ArenaVector<byte> journal_;
+  ArenaVector<Checkpoint> checkpoints_;
+  uint32 checkpointMillis_;
+};
+
+}  // namespace apm
@@ -3,15 +3,25 @@
 namespace apm {
 
 void BroodWar::InjectHooks() {
+#ifdef _WIN32
   drawDetour.Inject();
   refreshScreenDetour.Inject();
-  onActionDetour.Inject();
+  onActionDispatcher.Inject();
+#endif
+  if (OnHooksChanged) {
+    OnHooksChanged(true);
+  }
 }
 
 void BroodWar::RestoreHooks() {
+#ifdef _WIN32
   drawDetour.Restore();
   refreshScreenDetour.Restore();
-  onActionDetour.Restore();
+  onActionDispatcher.Restore();
+#endif
+  if (OnHooksChanged) {
+    OnHooksChanged(false);
+  }
 }
 
 }  // namespace apm
\ No newline at end of file
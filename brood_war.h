@@ -5,8 +5,11 @@
 #include <functional>
 #include <string>
 
+#ifdef _WIN32
 #include "./func_hook.h"
+#endif
 #include "./types.h"
+#include "./unit_types.h"
 
 namespace apm {
 #pragma pack(1)
@@ -20,6 +23,9 @@ struct PlayerInfo {
 };
 #pragma pack()
 
+// Storm ID of slots that aren't a human player
+const uint32 INVALID_STORM_ID = 0xFFFFFFFF;
+
 template <typename T>
 class DataOffset {
 public:
@@ -28,6 +34,8 @@ public:
   ~DataOffset() {}
 
   inline void reset(uintptr_t offset) { offset_ = offset; }
+  // Whether this has been pointed at anything (not every offset is known for every version)
+  inline bool valid() const { return offset_ != 0xDEADDEAD; }
 
   inline T* get() const { return reinterpret_cast<T*>(offset_); }
   inline operator T() const { return *reinterpret_cast<T*>(offset_); }
@@ -55,7 +63,7 @@ struct BroodWar {
   inline std::string GetPlayerName(int index) {
     assert(index >= 0 && index < 12);
     PlayerInfo* player = &firstPlayerInfo.get()[index];
-    return std::move(std::string(player->name));
+    return std::string(player->name);
   }
   inline uint32 GetPlayerStormId(int index) {
     assert(index >= 0 && index < 12);
@@ -83,9 +91,13 @@ struct BroodWar {
     return firstPlayerColor.get()[index];
   }
 
+#ifdef _WIN32
+  // Only BW itself is hooked, so other backends (which are driven directly) have no hooks at all
   sbat::Detour drawDetour;
   sbat::Detour refreshScreenDetour;
-  sbat::Detour onActionDetour;
+  // Dispatches to every registered OnActionFn, so multiple consumers can share a single hook
+  sbat::DetourDispatcher<const byte*> onActionDispatcher;
+#endif
 
   DataOffset<bool> isInGame;
   DataOffset<bool> isInReplay;
@@ -101,6 +113,8 @@ struct BroodWar {
   DataOffset<uint32> minerals;
   DataOffset<uint32> vespene;
   DataOffset<uint8> firstPlayerColor;
+  // MAX_UNIT_NODES nodes of UNIT_NODE_SIZE bytes each
+  DataOffset<byte> unitNodes;
 
   DataOffset<BwFont> curFont;
   DataOffset<BwFont> fontUltraLarge;
@@ -110,29 +124,26 @@ struct BroodWar {
   std::function<void(BwFont)> SetFont;
 
   #undef DrawText // BILL GATES WHY
-  std::function<void(uint32 x, uint32 y, const std::string& text)> DrawText;
+  std::function<void(uint32 x, uint32 y, const char* text)> DrawText;
   std::function<bool()> RefreshGameLayer;
   std::function<uint32(const BroodWar& bw, const std::string& text)> GetTextWidth;
+  // Called after InjectHooks (with true) and RestoreHooks (with false) if set, so backends without
+  // real hooks can see when they would have been changed
+  std::function<void(bool injected)> OnHooksChanged;
 };
 
-using DrawFn = void(__stdcall*)();
-using RefreshFn = void(__stdcall*)();
-using OnActionFn = void(__stdcall*)(const byte* actionType);
+// BW versions whose data is known, as published to a monitor in another process (see
+// ActionForwardWriter)
+const uint32 BW_VERSION_UNKNOWN = 0;
+const uint32 BW_VERSION_1161 = 1161;
+const uint32 BW_VERSION_1170 = 1170;
 
-inline BroodWar CreateV1161(
-  DrawFn drawFunction, RefreshFn refreshFunction, OnActionFn onActionFunction) {
+// Where each version keeps its data, without any of the hooks or functions (which only work inside
+// BW's process). CreateV1161/CreateV1170 start from these, and a monitor in another process points
+// RemoteBroodWar at them.
+inline BroodWar CreateV1161Data() {
   BroodWar bw;
 
-  bw.drawDetour = std::move(sbat::Detour(sbat::Detour::Builder()
-    .At(0x004BD614).To(drawFunction).RunningOriginalCodeBefore()));
-  bw.refreshScreenDetour = std::move(sbat::Detour(sbat::Detour::Builder()
-    .At(0x004D98DE).To(refreshFunction).RunningOriginalCodeBefore()));
-  bw.onActionDetour = std::move(sbat::Detour(sbat::Detour::Builder()
-    .At(0x00486D8B)
-    .To(onActionFunction)
-    .WithArgument(sbat::RegisterArgument::Ebx) // action type
-    .RunningOriginalCodeAfter()));
-
   bw.isInGame.reset(0x006D11EC);
   bw.isInReplay.reset(0x006D0F14);
   bw.gameTimeTicks.reset(0x0057F23C);
@@ -145,6 +156,7 @@ inline BroodWar CreateV1161(
   bw.minerals.reset(0x0057F0F0);
   bw.vespene.reset(0x0057F120);
   bw.firstPlayerColor.reset(0x00581DD6);
+  bw.unitNodes.reset(0x0059CCA8);
 
   bw.curFont.reset(0x006D5DDC);
   bw.fontUltraLarge.reset(0x006CE100);
@@ -152,15 +164,74 @@ inline BroodWar CreateV1161(
   bw.fontNormal.reset(0x006CE0F8);
   bw.fontMini.reset(0x006CE0F4);
 
+  return bw;
+}
+
+inline BroodWar CreateV1170Data(uintptr_t baseAddress) {
+  BroodWar bw;
+
+  bw.isInGame.reset(0x0066743D - 0x00400000 + baseAddress);
+  bw.isInReplay.reset(0x0067DCF0 - 0x00400000 + baseAddress);
+  bw.gameTimeTicks.reset(0x0052755C - 0x00400000 + baseAddress);
+  bw.lastTextWidth.reset(0x006D4170 - 0x00400000 + baseAddress);
+  bw.activePlayerId.reset(0x00509D58 - 0x00400000 + baseAddress);
+  bw.myPlayerId.reset(0x00509D64 - 0x00400000 + baseAddress);
+  bw.firstPlayerInfo.reset(0x00673728 - 0x00400000 + baseAddress);
+  bw.buildingsControlled.reset(0x006C5DC0 - 0x00400000 + baseAddress);
+  bw.population.reset(0x0012A134 + baseAddress);
+  bw.minerals.reset(0x00527410 - 0x00400000 + baseAddress);
+  bw.vespene.reset(0x00527440 - 0x00400000 + baseAddress);
+  bw.firstPlayerColor.reset(0x0052A0F6 - 0x00400000 + baseAddress);
+  // unit table not located for this version yet, so unit stats aren't shown
+
+  bw.curFont.reset(0x006D4148 - 0x00400000 + baseAddress);
+  bw.fontUltraLarge.reset(0x006D4158 - 0x00400000 + baseAddress);
+  bw.fontLarge.reset(0x006D4154 - 0x00400000 + baseAddress);
+  bw.fontNormal.reset(0x006D4150 - 0x00400000 + baseAddress);
+  bw.fontMini.reset(0x006D414C - 0x00400000 + baseAddress);
+
+  return bw;
+}
+
+// baseAddress is where BW's module is loaded, which only matters for 1.17.0. Returns a BroodWar
+// without any valid DataOffsets if version isn't known.
+inline BroodWar CreateDataForVersion(uint32 version, uintptr_t baseAddress) {
+  switch (version) {
+    case BW_VERSION_1161: return CreateV1161Data();
+    case BW_VERSION_1170: return CreateV1170Data(baseAddress);
+    default: return BroodWar();
+  }
+}
+
+#ifdef _WIN32
+using DrawFn = void(__stdcall*)();
+using RefreshFn = void(__stdcall*)();
+using OnActionFn = void(__stdcall*)(const byte* action);
+
+inline BroodWar CreateV1161(
+  DrawFn drawFunction, RefreshFn refreshFunction, OnActionFn onActionFunction) {
+  BroodWar bw = CreateV1161Data();
+
+  bw.drawDetour = std::move(sbat::Detour(sbat::Detour::Builder()
+    .At(0x004BD614).To(drawFunction).RunningOriginalCodeBefore().PreferringHotPatch()));
+  bw.refreshScreenDetour = std::move(sbat::Detour(sbat::Detour::Builder()
+    .At(0x004D98DE).To(refreshFunction).RunningOriginalCodeBefore().PreferringHotPatch()));
+  bw.onActionDispatcher = sbat::DetourDispatcher<const byte*>(sbat::Detour::Builder()
+    .At(0x00486D8B)
+    .WithArgument(sbat::RegisterArgument::Ebx) // action type
+    .RunningOriginalCodeAfter()
+    .PreferringHotPatch());
+  bw.onActionDispatcher.Add(onActionFunction);
+
   using SetFontFunc = void(__thiscall*)(BwFont font);
   bw.SetFont = [](BwFont font) {
     const auto BwSetFont = reinterpret_cast<SetFontFunc>(0x0041FB30);
     BwSetFont(font);
   };
   using DrawTextFunc = bool(__stdcall*)(uint32 y);
-  bw.DrawText = [](uint32 x, uint32 y, const std::string& text) {
+  bw.DrawText = [](uint32 x, uint32 y, const char* text) {
     const auto BwDrawText = reinterpret_cast<DrawTextFunc>(0x004202B0);
-    const char* textPtr = text.c_str();
+    const char* textPtr = text;
     __asm {
       pushad
       mov eax, [textPtr]
@@ -194,36 +265,24 @@ inline BroodWar CreateV1161(
 
 inline BroodWar CreateV1170(uint32 baseAddress,
   DrawFn drawFunction, RefreshFn refreshFunction, OnActionFn onActionFunction) {
-  BroodWar bw;
+  BroodWar bw = CreateV1170Data(baseAddress);
 
   bw.drawDetour = std::move(sbat::Detour(sbat::Detour::Builder()
-    .At(0x0044641D - 0x00400000 + baseAddress).To(drawFunction).RunningOriginalCodeBefore()));
+    .At(0x0044641D - 0x00400000 + baseAddress)
+    .To(drawFunction)
+    .RunningOriginalCodeBefore()
+    .PreferringHotPatch()));
   bw.refreshScreenDetour = std::move(sbat::Detour(sbat::Detour::Builder()
-    .At(0x00445701 - 0x00400000 + baseAddress).To(refreshFunction).RunningOriginalCodeBefore()));
-  bw.onActionDetour = std::move(sbat::Detour(sbat::Detour::Builder()
+    .At(0x00445701 - 0x00400000 + baseAddress)
+    .To(refreshFunction)
+    .RunningOriginalCodeBefore()
+    .PreferringHotPatch()));
+  bw.onActionDispatcher = sbat::DetourDispatcher<const byte*>(sbat::Detour::Builder()
     .At(0x00479068 -  0x00400000 + baseAddress)
-    .To(onActionFunction)
     .WithArgument(sbat::RegisterArgument::Ecx) // action type
-    .RunningOriginalCodeAfter()));
-
-  bw.isInGame.reset(0x0066743D - 0x00400000 + baseAddress);
-  bw.isInReplay.reset(0x0067DCF0 - 0x00400000 + baseAddress);
-  bw.gameTimeTicks.reset(0x0052755C - 0x00400000 + baseAddress);
-  bw.lastTextWidth.reset(0x006D4170 - 0x00400000 + baseAddress);
-  bw.activePlayerId.reset(0x00509D58 - 0x00400000 + baseAddress);
-  bw.myPlayerId.reset(0x00509D64 - 0x00400000 + baseAddress);
-  bw.firstPlayerInfo.reset(0x00673728 - 0x00400000 + baseAddress);
-  bw.buildingsControlled.reset(0x006C5DC0 - 0x00400000 + baseAddress);
-  bw.population.reset(0x0012A134 + baseAddress);
-  bw.minerals.reset(0x00527410 - 0x00400000 + baseAddress);
-  bw.vespene.reset(0x00527440 - 0x00400000 + baseAddress);
-  bw.firstPlayerColor.reset(0x0052A0F6 - 0x00400000 + baseAddress);
-
-  bw.curFont.reset(0x006D4148 - 0x00400000 + baseAddress);
-  bw.fontUltraLarge.reset(0x006D4158 - 0x00400000 + baseAddress);
-  bw.fontLarge.reset(0x006D4154 - 0x00400000 + baseAddress);
-  bw.fontNormal.reset(0x006D4150 - 0x00400000 + baseAddress);
-  bw.fontMini.reset(0x006D414C - 0x00400000 + baseAddress);
+    .RunningOriginalCodeAfter()
+    .PreferringHotPatch());
+  bw.onActionDispatcher.Add(onActionFunction);
 
   using SetFontFunc = void(__thiscall*)(BwFont font);
   bw.SetFont = [baseAddress](BwFont font) {
@@ -231,9 +290,9 @@ inline BroodWar CreateV1170(uint32 baseAddress,
     BwSetFont(font);
   };
   using DrawTextFunc = bool(__fastcall*)(uint32 x, uint32 y, const char* text);
-  bw.DrawText = [baseAddress](uint32 x, uint32 y, const std::string& text) {
+  bw.DrawText = [baseAddress](uint32 x, uint32 y, const char* text) {
     const auto BwDrawText = reinterpret_cast<DrawTextFunc>(0x004CF2B0 - 0x00400000 + baseAddress);
-    BwDrawText(x, y, text.c_str());
+    BwDrawText(x, y, text);
   };
   using RefreshGameLayerFunc = bool(__cdecl*)();
   bw.RefreshGameLayer =
@@ -250,5 +309,6 @@ inline BroodWar CreateV1170(uint32 baseAddress,
 
   return bw;
 }
+#endif  // _WIN32
 
 }  // namespace apm
\ No newline at end of file
@@ -0,0 +1,172 @@
+#include "./build_order.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <array>
+#include <string>
+
+#include "./actions.h"
+#include "./game_arena.h"
+#include "./game_log.h"
+#include "./types.h"
+#include "./unit_types.h"
+
+namespace apm {
+
+using std::string;
+
+BuildOrderExtractor::BuildOrderExtractor(size_t expectedEntries, GameArena* arena)
+  : entries_(ArenaAllocator<BuildOrderEntry>(arena)),
+    expectedEntries_(expectedEntries),
+    lastBuild_() {
+  entries_.reserve(expectedEntries_);
+}
+
+void BuildOrderExtractor::Reset() {
+  ResetArenaVector(&entries_);
+  entries_.reserve(expectedEntries_);
+  lastBuild_.fill(LastBuild());
+}
+
+void BuildOrderExtractor::Rewind(uint32 tick) {
+  // Entries are appended in the order they were issued, so the ones to drop are all at the end
+  while (!entries_.empty() && entries_.back().tick >= tick) {
+    entries_.pop_back();
+  }
+  for (auto& lastBuild : lastBuild_) {
+    if (lastBuild.valid && lastBuild.tick >= tick) {
+      lastBuild = LastBuild();
+    }
+  }
+}
+
+uint16 ReadUint16(const byte* data) {
+  return static_cast<uint16>(data[0] | (data[1] << 8));
+}
+
+bool BuildOrderExtractor::Consume(uint32 tick, uint8 player, const byte* action) {
+  if (player >= lastBuild_.size()) {
+    return false;
+  }
+
+  BuildOrderEntry entry = { tick, 0, player, BuildOrderKind::Train };
+  switch (action[0]) {
+    case action::TRAIN:
+      entry.id = ReadUint16(&action[1]);
+      break;
+    case action::BUILD:
+      // order, x, y, then the unit type
+      entry.kind = BuildOrderKind::Build;
+      entry.id = ReadUint16(&action[6]);
+      break;
+    case action::UNIT_MORPH:
+      entry.kind = BuildOrderKind::UnitMorph;
+      entry.id = ReadUint16(&action[1]);
+      break;
+    case action::BUILDING_MORPH:
+      entry.kind = BuildOrderKind::BuildingMorph;
+      entry.id = ReadUint16(&action[1]);
+      break;
+    case action::TECH:
+      entry.kind = BuildOrderKind::Research;
+      entry.id = action[1];
+      break;
+    case action::UPGRADE:
+      entry.kind = BuildOrderKind::Upgrade;
+      entry.id = action[1];
+      break;
+    default:
+      return false;
+  }
+
+  if (entry.kind == BuildOrderKind::Build) {
+    // Only one of several identical placements in the same tick can succeed, so count them once
+    LastBuild& last = lastBuild_[player];
+    const uint32 position = ReadUint16(&action[2]) | (ReadUint16(&action[4]) << 16);
+    if (last.valid && last.tick == tick && last.unitType == entry.id &&
+        last.position == position) {
+      return false;
+    }
+    last.valid = true;
+    last.tick = tick;
+    last.unitType = entry.id;
+    last.position = position;
+  }
+
+  entries_.push_back(entry);
+  return true;
+}
+
+namespace {
+
+const char* KindVerb(BuildOrderKind kind) {
+  switch (kind) {
+    case BuildOrderKind::Train: return "Train";
+    case BuildOrderKind::Build: return "Build";
+    case BuildOrderKind::UnitMorph: return "Morph";
+    case BuildOrderKind::BuildingMorph: return "Morph";
+    case BuildOrderKind::Research: return "Research";
+    case BuildOrderKind::Upgrade: return "Upgrade";
+    default: return "?";
+  }
+}
+
+}  // namespace
+
+string FormatBuildOrder(const ArenaVector<BuildOrderEntry>& entries,
+    const std::array<string, 12>& playerNames) {
+  string result;
+  result.reserve(entries.size() * 32);
+  char line[128];
+  for (const BuildOrderEntry& entry : entries) {
+    if (entry.player >= playerNames.size() || playerNames[entry.player].empty()) {
+      continue;
+    }
+
+    const uint32 seconds = entry.tick * 42 / 1000;
+    const bool isUnit = entry.kind != BuildOrderKind::Research &&
+        entry.kind != BuildOrderKind::Upgrade;
+    const char* name = isUnit ? GetUnitTypeName(entry.id) : nullptr;
+    int length;
+    if (name != nullptr) {
+      length = snprintf(line, sizeof(line), "%02u:%02u %s: %s %s\n", seconds / 60, seconds % 60,
+          playerNames[entry.player].c_str(), KindVerb(entry.kind), name);
+    } else {
+      length = snprintf(line, sizeof(line), "%02u:%02u %s: %s #%u\n", seconds / 60, seconds % 60,
+          playerNames[entry.player].c_str(), KindVerb(entry.kind), entry.id);
+    }
+    if (length > 0) {
+      result.append(line, std::min(static_cast<size_t>(length), sizeof(line) - 1));
+    }
+  }
+  return result;
+}
+
+bool ExtractBuildOrder(const byte* log, size_t size, BuildOrderExtractor* extractor,
+    std::array<string, 12>* playerNames) {
+  extractor->Reset();
+  GameLogDecoder decoder(log, size);
+  GameLogHeader header;
+  if (decoder.ReadHeader(&header) != GameLogDecoder::Result::Ok) {
+    return false;
+  }
+  if (playerNames != nullptr) {
+    *playerNames = header.playerNames;
+  }
+
+  GameLogEvent event;
+  GameLogDecoder::Result result;
+  while ((result = decoder.Next(&event)) == GameLogDecoder::Result::Ok) {
+    // Truncated actions (logged as just their type) can't be interpreted
+    if (event.type == GameLogEvent::Type::Action &&
+        event.actionLength == GetActionLength(event.actionData)) {
+      extractor->Consume(event.tick, event.player, event.actionData);
+    } else if (event.type == GameLogEvent::Type::Seek) {
+      extractor->Rewind(event.tick);
+    }
+  }
+
+  return result == GameLogDecoder::Result::Done;
+}
+
+}  // namespace apm
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "./game_arena.h"
+#include "./types.h"
+
+namespace apm {
+
+enum class BuildOrderKind : uint8 {
+  Train = 0,
+  Build,
+  // Zerg unit morphs (e.g. Lurkers, Guardians)
+  UnitMorph,
+  // Building upgrades/morphs (e.g. Lair, Sunken Colony)
+  BuildingMorph,
+  Research,
+  Upgrade
+};
+
+// 8 bytes, so even long games stay small
+struct BuildOrderEntry {
+  uint32 tick;
+  // A unit type for Train/Build/morphs, a tech type for Research, an upgrade type for Upgrade
+  uint16 id;
+  uint8 player;
+  BuildOrderKind kind;
+};
+
+// Picks the production commands (train, build, morph, research, upgrade) out of a stream of
+// actions, in the order they were issued. These are commands rather than completions, so commands
+// that later failed or got cancelled are included. Consuming an action is a switch on its type and
+// at most an append, so this easily keeps up with replays at max speed.
+class BuildOrderExtractor {
+public:
+  static const size_t DEFAULT_EXPECTED_ENTRIES = 2048;
+
+  // Preallocates room for expectedEntries, so consuming actions doesn't allocate in typical games.
+  // Entries come from arena, if there is one (see ArenaAllocator).
+  explicit BuildOrderExtractor(size_t expectedEntries = DEFAULT_EXPECTED_ENTRIES,
+      GameArena* arena = nullptr);
+
+  void Reset();
+  // Drops the entries issued at or after tick, for when a replay is rewound. Doesn't allocate.
+  void Rewind(uint32 tick);
+  // Takes an action as passed to BW's action handler (type byte first). Returns true if it was a
+  // production command.
+  bool Consume(uint32 tick, uint8 player, const byte* action);
+
+  const ArenaVector<BuildOrderEntry>& entries() const { return entries_; }
+
+private:
+  struct LastBuild {
+    bool valid;
+    uint16 unitType;
+    uint32 tick;
+    uint32 position;
+  };
+
+  ArenaVector<BuildOrderEntry> entries_;
+  size_t expectedEntries_;
+  std::array<LastBuild, 12> lastBuild_;
+};
+
+// Renders entries as text, one per line: "mm:ss name: item". playerNames are used to label each
+// line, entries for players without a name are skipped.
+std::string FormatBuildOrder(const ArenaVector<BuildOrderEntry>& entries,
+    const std::array<std::string, 12>& playerNames);
+
+// Runs extractor over the actions of a recorded game log (see game_log.h), filling in playerNames
+// from its header if non-null. Returns false if the log is corrupt or truncated (entries before the
+// problem are kept).
+bool ExtractBuildOrder(const byte* log, size_t size, BuildOrderExtractor* extractor,
+    std::array<std::string, 12>* playerNames);
+
+}  // namespace apm
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "./types.h"
+
+namespace sbat {
+
+// List of callbacks that can be called from one thread while others add and remove entries,
+// without the caller ever taking a lock. Published lists are immutable: writers copy the current
+// list, modify the copy and swap the pointer (RCU style). Replaced lists are kept alive until this
+// is destroyed, since a calling thread may still be walking one (callbacks change a handful of
+// times per game, so this is not worth tracking readers for). Callback is a function pointer type.
+template <typename Callback>
+class CallbackList {
+public:
+  CallbackList()
+    : current_(nullptr),
+      lists_(),
+      write_mutex_() {
+    lists_.emplace_back(new List());
+    current_.store(lists_.back().get(), std::memory_order_release);
+  }
+
+  // Returns false if callback was already registered
+  bool Add(Callback callback) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    const List& current = *current_.load(std::memory_order_relaxed);
+    if (std::find(current.begin(), current.end(), callback) != current.end()) {
+      return false;
+    }
+
+    std::unique_ptr<List> updated(new List(current));
+    updated->push_back(callback);
+    Publish(std::move(updated));
+    return true;
+  }
+
+  // Returns false if callback was not registered. It may still be called by a Call that was
+  // already underway.
+  bool Remove(Callback callback) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    const List& current = *current_.load(std::memory_order_relaxed);
+    auto it = std::find(current.begin(), current.end(), callback);
+    if (it == current.end()) {
+      return false;
+    }
+
+    std::unique_ptr<List> updated(new List(current.begin(), it));
+    updated->insert(updated->end(), it + 1, current.end());
+    Publish(std::move(updated));
+    return true;
+  }
+
+  // Calls every callback in the currently published list, in the order they were added
+  template <typename... Args>
+  void Call(Args... args) const {
+    const List* list = current_.load(std::memory_order_acquire);
+    for (Callback callback : *list) {
+      callback(args...);
+    }
+  }
+
+  size_t size() const { return current_.load(std::memory_order_acquire)->size(); }
+  // Number of lists published so far, all of which are still held
+  size_t numPublished() const {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    return lists_.size();
+  }
+
+private:
+  typedef std::vector<Callback> List;
+
+  // Disable copying
+  CallbackList(const CallbackList&) = delete;
+  CallbackList& operator=(const CallbackList&) = delete;
+
+  // must be called with write_mutex_ held
+  void Publish(std::unique_ptr<List> list) {
+    const List* published = list.get();
+    lists_.emplace_back(std::move(list));
+    current_.store(published, std::memory_order_release);
+  }
+
+  std::atomic<const List*> current_;
+  // every list ever published, including the current one
+  std::vector<std::unique_ptr<const List>> lists_;
+  mutable std::mutex write_mutex_;
+};
+
+}  // namespace sbat
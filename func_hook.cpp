@@ -5,10 +5,13 @@
 #include <algorithm>
 #include <iterator>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
-#include "./deps/udis86/udis86.h"
+#include "./hot_patch_caves.h"
+#include "./inline_hook.h"
+#include "./pe_imports.h"
 #include "./types.h"
 #include "./win_helpers.h"
 
@@ -21,7 +24,9 @@ Detour::Builder::Builder()
   : hook_location_(nullptr),
     target_(nullptr),
     arguments_(),
-    run_original_(RunOriginalCodeType::After) {
+    context_(nullptr),
+    run_original_(RunOriginalCodeType::After),
+    hot_patch_(false) {
 }
 
 Detour::Builder& Detour::Builder::At(byte* hook_location) {
@@ -51,6 +56,11 @@ Detour::Builder& Detour::Builder::WithArgument(RegisterArgument argument) {
   return *this;
 }
 
+Detour::Builder& Detour::Builder::WithContext(void* context) {
+  context_ = context;
+  return *this;
+}
+
 Detour::Builder& Detour::Builder::RunningOriginalCodeAfter() {
   run_original_ = RunOriginalCodeType::After;
   return *this;
@@ -66,6 +76,11 @@ Detour::Builder& Detour::Builder::NotRunningOriginalCode() {
   return *this;
 }
 
+Detour::Builder& Detour::Builder::PreferringHotPatch() {
+  hot_patch_ = true;
+  return *this;
+}
+
 const byte Detour::TRAMPOLINE_PREAMBLE[] = {
   0x60  // PUSHAD
 };
@@ -73,146 +88,9 @@ const byte Detour::TRAMPOLINE_POSTSCRIPT[] = {
   0x61  // POPAD
 };
 
-int32 GetRewrittenInstructionLength(ud_mnemonic_code code, uint32 current_len) {
-  switch (code) {
-    case UD_Ijo:
-    case UD_Ijno:
-    case UD_Ijb:
-    case UD_Ijae:
-    case UD_Ijz:
-    case UD_Ijnz:
-    case UD_Ijbe:
-    case UD_Ija:
-    case UD_Ijs:
-    case UD_Ijns:
-    case UD_Ijp:
-    case UD_Ijnp:
-    case UD_Ijl:
-    case UD_Ijge:
-    case UD_Ijle:
-    case UD_Ijg:
-      return 6;  // 0F XX YY YY YY YY
-    case UD_Ijmp:
-    case UD_Icall:
-      return 5;  // XX YY YY YY YY
-    default:
-      return current_len;
-  }
-}
-
-uint32 ConstructRelativeOpcode(ud_mnemonic_code code, uint32 pc, uint32 instruction_len,
-    const ud_operand_t* operand, byte* output) {
-  int32 orig_offset;
-  switch (operand->size) {
-  case 8:
-    orig_offset = static_cast<int32>(operand->lval.sbyte);
-    break;
-  case 16:
-    orig_offset = static_cast<int32>(operand->lval.sword);
-    break;
-  case 32:
-    orig_offset = operand->lval.sdword;
-    break;
-  default:
-    // a jump/call relative offset should never exceed 32 bits
-    assert(false);
-    return -1;
-  }
-
-  int64 orig_target = static_cast<int64>(
-    static_cast<int32>(pc + instruction_len) + orig_offset);
-  int32 new_instruction_len = GetRewrittenInstructionLength(code, instruction_len);
-  int32 new_offset = static_cast<int32>(orig_target -
-      static_cast<int64>(reinterpret_cast<uint32>(output) + new_instruction_len));
-
-  uint32 pos = 0;
-  // write the new opcode
-  switch (code) {
-    case UD_Ijo: output[pos++] = 0x0F; output[pos++] = 0x80; break;
-    case UD_Ijno: output[pos++] = 0x0F; output[pos++] = 0x81; break;
-    case UD_Ijb: output[pos++] = 0x0F; output[pos++] = 0x82; break;
-    case UD_Ijae: output[pos++] = 0x0F; output[pos++] = 0x83; break;
-    case UD_Ijz: output[pos++] = 0x0F; output[pos++] = 0x84; break;
-    case UD_Ijnz: output[pos++] = 0x0F; output[pos++] = 0x85; break;
-    case UD_Ijbe: output[pos++] = 0x0F; output[pos++] = 0x86; break;
-    case UD_Ija: output[pos++] = 0x0F; output[pos++] = 0x87; break;
-    case UD_Ijs: output[pos++] = 0x0F; output[pos++] = 0x88; break;
-    case UD_Ijns: output[pos++] = 0x0F; output[pos++] = 0x89; break;
-    case UD_Ijp: output[pos++] = 0x0F; output[pos++] = 0x8A; break;
-    case UD_Ijnp: output[pos++] = 0x0F; output[pos++] = 0x8B; break;
-    case UD_Ijl: output[pos++] = 0x0F; output[pos++] = 0x8C; break;
-    case UD_Ijge: output[pos++] = 0x0F; output[pos++] = 0x8D; break;
-    case UD_Ijle: output[pos++] = 0x0F; output[pos++] = 0x8E; break;
-    case UD_Ijg: output[pos++] = 0x0F; output[pos++] = 0x8F; break;
-    case UD_Ijmp: output[pos++] = 0xE9; break;
-    case UD_Icall: output[pos++] = 0xE8; break;
-    default:
-      assert(false);  // no other opcodes should be found in calls to this
-      return -1;
-  }
-
-  *(reinterpret_cast<int32*>(&output[pos])) = new_offset;
-  pos += 4;
-  assert(pos == new_instruction_len);
-  return new_instruction_len;
-}
-
-void ReplaceRelativeOffsets(byte* hook_location, uint32 hook_size, byte* output,
-    uint32 output_size) {
-  ud_t udis;
-  ud_init(&udis);
-  ud_set_mode(&udis, 32);
-  ud_set_syntax(&udis, NULL);
-  ud_set_input_buffer(&udis, hook_location, 20);
-  ud_set_pc(&udis, static_cast<uint64_t>(reinterpret_cast<uint32>(hook_location)));
-
-  const ud_operand_t* operand;
-  uint32 i = 0;
-  uint32 pos = 0;
-  do {
-    i += ud_disassemble(&udis);
-    switch (udis.mnemonic) {
-    case UD_Ijo:
-    case UD_Ijno:
-    case UD_Ijb:
-    case UD_Ijae:
-    case UD_Ijz:
-    case UD_Ijnz:
-    case UD_Ijbe:
-    case UD_Ija:
-    case UD_Ijs:
-    case UD_Ijns:
-    case UD_Ijp:
-    case UD_Ijnp:
-    case UD_Ijl:
-    case UD_Ijge:
-    case UD_Ijle:
-    case UD_Ijg:
-    case UD_Ijmp:
-    case UD_Icall:
-      operand = ud_insn_opr(&udis, 0);
-      if (operand != nullptr && operand->type == UD_OP_JIMM) {
-        pos += ConstructRelativeOpcode(udis.mnemonic, static_cast<uint32>(ud_insn_off(&udis)),
-            ud_insn_len(&udis), operand, &output[pos]);
-        break;
-      }
-      // haven't implemented register handling yet, so better to crash in these cases instead of
-      // failing in weird ways later on
-      assert(operand == nullptr || operand->type != UD_OP_REG);
-
-      // if it wasn't relative/register, continue on and just copy it over as any other opcode
-    default:  // not a relative instruction, no correction needed
-      byte* instruction_ptr = reinterpret_cast<byte*>(ud_insn_off(&udis));
-      std::copy(instruction_ptr, instruction_ptr + ud_insn_len(&udis),
-          stdext::checked_array_iterator<byte*>(&output[pos], output_size - pos));
-      pos += ud_insn_len(&udis);
-      break;
-    }
-  } while (i < hook_size);
-  assert(pos == output_size);
-}
-
 uint32 Detour::page_size_ = 0;
+std::mutex Detour::cave_mutex_;
+HotPatchCaves Detour::caves_;
 shared_ptr<Detour::AllocBlock> Detour::current_block_ = shared_ptr<Detour::AllocBlock>();
 
 Detour::AllocBlock::AllocBlock()
@@ -248,7 +126,10 @@ Detour::Detour()
     trampoline_block_(nullptr),
     original_(nullptr),
     hooked_(nullptr),
-    injected_(false) {
+    injected_(false),
+    cave_(nullptr),
+    cave_jump_(),
+    cave_written_(false) {
 }
 
 Detour::Detour(const Detour::Builder& builder)
@@ -257,32 +138,34 @@ Detour::Detour(const Detour::Builder& builder)
     trampoline_block_(nullptr),
     original_(nullptr),
     hooked_(nullptr),
-    injected_(false) {
+    injected_(false),
+    cave_(nullptr),
+    cave_jump_(),
+    cave_written_(false) {
   assert(builder.hook_location_ != nullptr);
   assert(builder.target_ != nullptr);
 
-  ud_t udis;
-  ud_init(&udis);
-  ud_set_mode(&udis, 32);
-  ud_set_syntax(&udis, NULL);  // we don't care about readable output!
-  // According to http://blog.onlinedisassembler.com/blog/?p=23, modern day implementations throw a
-  // general protection fault at any instructions > 15 bytes, so 20 bytes (4 byte instruction
-  // followed by at 15 byte instruction = 19 bytes) should be safe here
-  ud_set_input_buffer(&udis, hook_location_, 20);
-  ud_set_pc(&udis, static_cast<uint64_t>(reinterpret_cast<uint32>(hook_location_)));
-  size_t replaced_size = 0;
-
-  // we do 2 passes:
-  // first we figure out how big the trampoline needs to be, then iterate back over the opcodes
-  // we're replacing and rewrite any relative offsets. The second pass happens only if we want to
-  // run the original code, and only when we go to write it into the trampoline
-  uint32 instruction_size;
-  do {
-    instruction_size = ud_disassemble(&udis);
-    hook_size_ += instruction_size;
-    replaced_size += GetRewrittenInstructionLength(udis.mnemonic, instruction_size);
-  } while (hook_size_ < 5 && instruction_size != 0);
-  assert(hook_size_ >= 5);
+  // The original code gets relocated into the trampoline (with any relative offsets rewritten) only
+  // if we want to run it, but the space it replaces is always measured so the jump covers whole
+  // instructions
+  uint32 replaced_size = 0;
+  if (builder.hot_patch_) {
+    // the short jump has to replace exactly one instruction
+    uint32 first_instruction_size = 0;
+    if (MeasureInstructions(hook_location_, 1, &first_instruction_size, &replaced_size) &&
+        CanHotPatch(hook_location_, first_instruction_size)) {
+      std::lock_guard<std::mutex> lock(cave_mutex_);
+      cave_ = caves_.Claim(hook_location_, first_instruction_size);
+      if (cave_ != nullptr) {
+        hook_size_ = first_instruction_size;
+      }
+    }
+  }
+  // not hot patchable, replace enough instructions for a regular jump instead
+  if (cave_ == nullptr) {
+    MeasureInstructions(hook_location_, 5, &hook_size_, &replaced_size);
+  }
+  assert(hook_size_ >= 5 || cave_ != nullptr);
 
   // Allocate our trampoline
   size_t trampoline_size = sizeof(Detour::TRAMPOLINE_PREAMBLE) +
@@ -290,6 +173,7 @@ Detour::Detour(const Detour::Builder& builder)
       1 + sizeof(int32) +  // jmp <after_hook>  NOLINT
       1 + sizeof(int32) +  // call <target>  NOLINT
       builder.arguments_.size() +  // push for each register
+      (builder.context_ != nullptr ? 1 + sizeof(int32) : 0) +  // push <context>  NOLINT
       (builder.run_original_ != RunOriginalCodeType::Never ? replaced_size : 0);
   trampoline_block_ = AllocSpace(trampoline_size);
   byte* trampoline = reinterpret_cast<byte*>(trampoline_block_->pos_);
@@ -298,17 +182,28 @@ Detour::Detour(const Detour::Builder& builder)
   original_.reset(new byte[hook_size_]);
   hooked_.reset(new byte[hook_size_]);
   memcpy_s(original_.get(), hook_size_, hook_location_, hook_size_);
-  if (hook_size_ > 5) {
-    memset(hooked_.get() + 5, 0x90, hook_size_ - 5);  // fill with NOPs to account for extra bytes
+  if (cave_ != nullptr) {
+    // only the short jump gets written, the rest of the replaced instruction is left as is (it will
+    // never be executed while the hook is in place, since the trampoline jumps past it)
+    memcpy_s(hooked_.get(), hook_size_, original_.get(), hook_size_);
+    hooked_.get()[0] = 0xEB;  // short relative jump
+    hooked_.get()[1] = static_cast<byte>(cave_ - (hook_location_ + 2));
+    cave_jump_[0] = 0xE9;  // relative jump
+    *(reinterpret_cast<int32*>(&cave_jump_[1])) =
+        reinterpret_cast<int32>(trampoline) - (reinterpret_cast<int32>(cave_) + 5);
+  } else {
+    if (hook_size_ > 5) {
+      memset(hooked_.get() + 5, 0x90, hook_size_ - 5);  // fill with NOPs to account for extra bytes
+    }
+    hooked_.get()[0] = 0xE9;  // relative jump
+    *(reinterpret_cast<int32*>(&hooked_.get()[1])) =  // offset from end of command
+        reinterpret_cast<int32>(trampoline) - (reinterpret_cast<int32>(hook_location_) + 5);
   }
-  hooked_.get()[0] = 0xE9;  // relative jump
-  *(reinterpret_cast<int32*>(&hooked_.get()[1])) =  // offset from end of command
-      reinterpret_cast<int32>(trampoline) - (reinterpret_cast<int32>(hook_location_) + 5);
 
   uint32 pos = 0;
   // add the original code if we are meant to run it before
   if (builder.run_original_ == RunOriginalCodeType::Before) {
-    ReplaceRelativeOffsets(hook_location_, hook_size_, &trampoline[pos], replaced_size);
+    RelocateInstructions(hook_location_, hook_size_, &trampoline[pos], replaced_size);
     pos += replaced_size;
   }
 
@@ -322,6 +217,12 @@ Detour::Detour(const Detour::Builder& builder)
   for (auto it = builder.arguments_.rbegin(); it != builder.arguments_.rend(); ++it) {
     trampoline[pos++] = static_cast<byte>(*it);
   }
+  // the context is pushed last so that it ends up as the first argument
+  if (builder.context_ != nullptr) {
+    trampoline[pos] = 0x68;  // push imm32
+    *(reinterpret_cast<uint32*>(&trampoline[pos+1])) = reinterpret_cast<uint32>(builder.context_);
+    pos += 5;
+  }
 
   // generate the call code
 #pragma warning(suppress: 6386)
@@ -337,7 +238,7 @@ Detour::Detour(const Detour::Builder& builder)
 
   // add the original code if we are meant to run it after
   if (builder.run_original_ == RunOriginalCodeType::After) {
-    ReplaceRelativeOffsets(hook_location_, hook_size_, &trampoline[pos], replaced_size);
+    RelocateInstructions(hook_location_, hook_size_, &trampoline[pos], replaced_size);
     pos += replaced_size;
   }
 
@@ -365,10 +266,15 @@ Detour::Detour(Detour&& d)
   trampoline_block_(std::move(d.trampoline_block_)),
   original_(std::move(d.original_)),
   hooked_(std::move(d.hooked_)),
-  injected_(d.injected_) {
+  injected_(d.injected_),
+  cave_(d.cave_),
+  cave_jump_(d.cave_jump_),
+  cave_written_(d.cave_written_) {
   d.hook_location_ = nullptr;
   d.hook_size_ = 0;
   d.injected_ = false;
+  d.cave_ = nullptr;
+  d.cave_written_ = false;
 }
 
 Detour& Detour::operator=(Detour&& d) {
@@ -378,6 +284,9 @@ Detour& Detour::operator=(Detour&& d) {
   std::swap(original_, d.original_);
   std::swap(hooked_, d.hooked_);
   std::swap(injected_, d.injected_);
+  std::swap(cave_, d.cave_);
+  std::swap(cave_jump_, d.cave_jump_);
+  std::swap(cave_written_, d.cave_written_);
 
   return *this;
 }
@@ -387,6 +296,14 @@ bool Detour::Inject() {
     return false;
   }
 
+  if (cave_ != nullptr) {
+    if (!WriteHotPatch(hooked_.get())) {
+      return false;
+    }
+    injected_ = true;
+    return true;
+  }
+
   ScopedVirtualProtect protect(hook_location_, hook_size_, PAGE_EXECUTE_READWRITE);
   if (protect.hasErrors()) {
     return false;
@@ -402,6 +319,14 @@ bool Detour::Restore() {
     return false;
   }
 
+  if (cave_ != nullptr) {
+    if (!WriteHotPatch(original_.get())) {
+      return false;
+    }
+    injected_ = false;
+    return true;
+  }
+
   ScopedVirtualProtect protect(hook_location_, hook_size_, PAGE_EXECUTE_READWRITE);
   if (protect.hasErrors()) {
     return false;
@@ -412,10 +337,35 @@ bool Detour::Restore() {
   return true;
 }
 
+bool Detour::WriteHotPatch(const byte* short_jump) {
+  ScopedVirtualProtect protect(hook_location_, 2, PAGE_EXECUTE_READWRITE);
+  if (protect.hasErrors()) {
+    return false;
+  }
+
+  if (!cave_written_) {
+    ScopedVirtualProtect cave_protect(cave_, cave_jump_.size(), PAGE_EXECUTE_READWRITE);
+    if (cave_protect.hasErrors()) {
+      return false;
+    }
+    memcpy_s(cave_, cave_jump_.size(), cave_jump_.data(), cave_jump_.size());
+    FlushInstructionCache(GetCurrentProcess(), cave_, cave_jump_.size());
+    cave_written_ = true;
+  }
+
+  ExchangeHotPatch(hook_location_, short_jump);
+  FlushInstructionCache(GetCurrentProcess(), hook_location_, 2);
+  return true;
+}
+
 HookedModule::HookedModule(HMODULE module_handle)
   : module_handle_(module_handle),
     injected_(false),
+    import_index_(),
     hooks_() {
+  assert(module_handle_ != nullptr);
+  const byte* image = reinterpret_cast<const byte*>(module_handle_);
+  import_index_.Parse(image, ImportIndex::GetMappedImageSize(image), ImageLayout::Mapped);
 }
 
 HookedModule::~HookedModule() {
@@ -1,11 +1,18 @@
 #pragma once
 
 #include <Windows.h>
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
 
+#include "callback_list.h"
+#include "hot_patch_caves.h"
+#include "inline_hook.h"
+#include "pe_imports.h"
 #include "types.h"
 #include "win_helpers.h"
 
@@ -49,15 +56,26 @@ public:
     Builder& To(void* target_function);
 
     Builder& WithArgument(RegisterArgument argument);
+    // Passes a fixed pointer as the first argument to the target, ahead of any register arguments.
+    // Lets a single target function serve multiple hook sites.
+    Builder& WithContext(void* context);
 
     Builder& RunningOriginalCodeAfter();
     Builder& RunningOriginalCodeBefore();
     Builder& NotRunningOriginalCode();
+
+    // Installs the hook with a single atomic 2-byte short jump into a nearby int3 padding cave
+    // (which holds the long jump to the trampoline), so Inject/Restore are safe while other threads
+    // are executing the hooked code. Falls back to the normal 5-byte jump if the site isn't
+    // suitable.
+    Builder& PreferringHotPatch();
   private:
     byte* hook_location_;
     DetourTarget target_;
     std::vector<RegisterArgument> arguments_;
+    void* context_;
     RunOriginalCodeType run_original_;
+    bool hot_patch_;
   };
 
   explicit Detour(const Builder& builder);
@@ -70,6 +88,8 @@ public:
   bool Inject();
   bool Restore();
 
+  bool isHotPatched() const { return cave_ != nullptr; }
+
 private:
   class AllocBlock {
     friend class Detour;
@@ -88,8 +108,15 @@ private:
 
   static std::shared_ptr<AllocBlock> AllocSpace(size_t trampoline_size);
 
+  // Atomically swaps the first 2 bytes at hook_location_ for short_jump (either the hooked or the
+  // original bytes)
+  bool WriteHotPatch(const byte* short_jump);
+
   static uint32 page_size_;
   static std::shared_ptr<AllocBlock> current_block_;
+  // Shared by every Detour, so no two hooks ever share padding
+  static std::mutex cave_mutex_;
+  static HotPatchCaves caves_;
 
   byte* hook_location_;
   uint32 hook_size_;
@@ -97,90 +124,80 @@ private:
   std::unique_ptr<byte> original_;
   std::unique_ptr<byte> hooked_;
   bool injected_;
+  // Only set for hot patched hooks: padding that holds the long jump to the trampoline, which the
+  // short jump at hook_location_ targets
+  byte* cave_;
+  std::array<byte, 5> cave_jump_;
+  bool cave_written_;
 
   static const byte TRAMPOLINE_PREAMBLE[];
   static const byte TRAMPOLINE_POSTSCRIPT[];
 };
 
-// Type for hooking a function at a specific memory location, with methods for replacing and
-// restoring the original code. Function pointer type is specified by F, to allow for hooks of
-// varying parameter lists.
-template<typename F>
-class FuncHook {
+// Detour that calls any number of callbacks, which can be added and removed at runtime without
+// re-patching the hooked code. The trampoline always calls Dispatch, which calls whatever is in the
+// CallbackList at the time, without locking. Args must match the RegisterArguments given to the
+// Builder.
+template<typename... Args>
+class DetourDispatcher {
 public:
-  FuncHook(F func, F hook_func)
-      : callable_(func),
-        hook_func_(hook_func),
-        function_(reinterpret_cast<byte*>(func)),
-        original_mem_(),
-        hooked_mem_(),
-        injected_(false) {
-    LoadFunctionMemory();
-  }
+  typedef void (__stdcall* Callback)(Args...);
 
-  ~FuncHook() {
-    if (injected_) {
-      Restore();
-    }
+  DetourDispatcher() : state_() {}
+  explicit DetourDispatcher(Detour::Builder builder)
+      : state_(new State()) {
+    state_->detour = Detour(builder.To(reinterpret_cast<void*>(&Dispatch))
+        .WithContext(state_.get()));
   }
 
-  // TODO(tec27): This should probably update its original memory directly on hooking, so that its
-  // more amenable to things hooking the same locations. On the other hand, fuck it, JS everything!
-  bool Inject() {
-    if (injected_) return false;
-
-    ScopedVirtualProtect protect(function_, original_mem_.size(), PAGE_EXECUTE_READWRITE);
-    if (protect.has_errors()) return false;
+  DetourDispatcher(DetourDispatcher&& d) = default;
+  DetourDispatcher& operator=(DetourDispatcher&& d) = default;
 
-    for (size_t i = 0; i < hooked_mem_.size(); i++) {
-      function_[i] = hooked_mem_[i];
-    }
-    injected_ = true;
-    return true;
+  bool Inject() {
+    return state_ ? state_->detour.Inject() : false;
   }
 
   bool Restore() {
-    if (!injected_) return false;
+    return state_ ? state_->detour.Restore() : false;
+  }
 
-    ScopedVirtualProtect protect(function_, original_mem_.size(), PAGE_EXECUTE_READWRITE);
-    if (protect.has_errors()) return false;
+  // Returns false if callback was already registered
+  bool Add(Callback callback) {
+    assert(state_);
+    return state_->callbacks.Add(callback);
+  }
 
-    for (size_t i = 0; i < original_mem_.size(); i++) {
-      function_[i] = original_mem_[i];
-    }
-    injected_ = false;
-    return true;
+  // Returns false if callback was not registered
+  bool Remove(Callback callback) {
+    assert(state_);
+    return state_->callbacks.Remove(callback);
   }
 
-  F callable() const {
-    return callable_;
+  size_t size() const {
+    return state_ ? state_->callbacks.size() : 0;
   }
 
 private:
-  void LoadFunctionMemory() {
-    ScopedVirtualProtect protect(function_, original_mem_.size(), PAGE_EXECUTE_READ);
+  // Kept on the heap so that the context pointer baked into the trampoline stays valid when the
+  // dispatcher is moved
+  struct State {
+    State() : detour(), callbacks() {}
 
-    // get a pointer to the address pointer at the second byte of hooked_mem_ (param for push)
-    F* ret_target_ptr = reinterpret_cast<F*>(&hooked_mem_[1]);
-    *ret_target_ptr = hook_func_;  // set parameter of push to the address of our hook function
-    hooked_mem_[0] = 0x68;  // push (address provided through hookFunc)
-    hooked_mem_[5] = 0xc3;  // return
+    Detour detour;
+    CallbackList<Callback> callbacks;
+  };
 
-    for (size_t i = 0; i < original_mem_.size(); i++) {
-      original_mem_[i] = function_[i];
-    }
+  // disallow copying
+  DetourDispatcher(const DetourDispatcher&) = delete;
+  DetourDispatcher& operator=(const DetourDispatcher&) = delete;
+
+  static void __stdcall Dispatch(State* state, Args... args) {
+    state->callbacks.Call(args...);
   }
 
-  F callable_;
-  F hook_func_;
-  byte* function_;
-  std::array<byte, 6> original_mem_;
-  std::array<byte, 6> hooked_mem_;
-  bool injected_;
+  std::unique_ptr<State> state_;
 };
 
-
-
 // Hook type that rewrites the import table of a module (IAT hook), construct using HookedModule
 class ImportHookBase {
 public:
@@ -212,7 +229,7 @@ public:
     }
 
     ScopedVirtualProtect protect(import_entry_, sizeof(FuncType), PAGE_EXECUTE_READWRITE);
-    if (protect.has_errors()) {
+    if (protect.hasErrors()) {
       return false;
     }
 
@@ -229,7 +246,7 @@ public:
     assert(*import_entry_ == hook_func_);
 
     ScopedVirtualProtect protect(import_entry_, sizeof(FuncType), PAGE_EXECUTE_READWRITE);
-    if (protect.has_errors()) {
+    if (protect.hasErrors()) {
       return false;
     }
 
@@ -240,13 +257,11 @@ public:
   }
 
 private:
-  ImportHook(HMODULE module_handle, const std::string import_module_name,
-    const std::string import_func_name, FuncType hook_func)
+  ImportHook(FuncType* import_entry, FuncType hook_func)
     : original_func_(nullptr),
     hook_func_(hook_func),
-    import_entry_(nullptr),
+    import_entry_(import_entry),
     injected_(false) {
-    import_entry_ = GetImportEntry(module_handle, import_module_name, import_func_name);
   }
 
   ImportHook(ImportHook<Ret(Args...)>&& other)
@@ -261,71 +276,6 @@ private:
   ImportHook(const ImportHook<Ret(Args...)>&) = delete;
   ImportHook& operator=(const ImportHook<Ret(Args...)>&) = delete;
 
-  PIMAGE_NT_HEADERS GetNtHeaders(HMODULE module_handle) {
-    assert(module_handle != nullptr);
-    // HMODULES are a pointer to the start of the module in memory, so we can just use that as a
-    // pointer to the image header and traverse it to get to the PIMAGE_NT_HEADER
-    PIMAGE_DOS_HEADER dos_header = reinterpret_cast<PIMAGE_DOS_HEADER>(module_handle);
-    if (dos_header->e_magic != IMAGE_DOS_SIGNATURE) {
-      return nullptr;
-    }
-
-    PIMAGE_NT_HEADERS nt_header = reinterpret_cast<PIMAGE_NT_HEADERS>(
-        reinterpret_cast<byte*>(module_handle) + dos_header->e_lfanew);
-    if (nt_header->Signature != IMAGE_NT_SIGNATURE) {
-      return nullptr;
-    }
-
-    return nt_header;
-  }
-
-  FuncType* GetImportEntry(HMODULE module_handle, const std::string import_module_name,
-      const std::string import_func_name) {
-    PIMAGE_NT_HEADERS header = GetNtHeaders(module_handle);
-    if (header == nullptr) {
-      return nullptr;
-    }
-
-    uint32 module_offset = reinterpret_cast<uint32>(module_handle);
-    // get the first import
-    PIMAGE_IMPORT_DESCRIPTOR import = reinterpret_cast<PIMAGE_IMPORT_DESCRIPTOR>(
-        header->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT].VirtualAddress +
-        module_offset);
-    // loop over the imports until we either find the one we want, or reach the end of the table
-    while (import->FirstThunk) {
-      char* mod_name = reinterpret_cast<char*>(module_offset + import->Name);
-      if (lstrcmpiA(mod_name, import_module_name.c_str()) == 0) {
-        // this is the correct module, try to find the right function in its table
-        PIMAGE_THUNK_DATA import_first = reinterpret_cast<PIMAGE_THUNK_DATA>(
-            module_offset + import->FirstThunk);
-        PIMAGE_THUNK_DATA import_original = reinterpret_cast<PIMAGE_THUNK_DATA>(
-            module_offset + import->OriginalFirstThunk);
-
-        // loop over all the functions until we find the right one, or reach the end of the table
-        while (import_first->u1.Function) {
-          if (!IMAGE_SNAP_BY_ORDINAL(import_original->u1.Ordinal)) {
-            // the import is referenced by name, not by ordinal, so we can do a proper comparison
-            PIMAGE_IMPORT_BY_NAME import_by_name = reinterpret_cast<PIMAGE_IMPORT_BY_NAME>(
-                module_offset + import_original->u1.AddressOfData);
-            if (lstrcmpiA(reinterpret_cast<char*>(import_by_name->Name),
-                import_func_name.c_str()) == 0) {
-              // we found the correct function entry, return it
-              return reinterpret_cast<FuncType*>(&import_first->u1.Function);
-            }
-          }
-
-          import_first++;
-          import_original++;
-        }
-      }
-
-      import++;  // move to the next import
-    }
-
-    // we couldn't find the right import
-    return nullptr;
-  }
-
   FuncType original_func_;
   FuncType hook_func_;
   FuncType* import_entry_;
@@ -340,12 +290,12 @@ public:
   template<typename Ret, typename... Args>
   void AddHook(
       std::string import_module, std::string func_name, Ret(__stdcall *hook_func)(Args...)) {
-    std::unique_ptr<ImportHookBase> hook(
-        new ImportHook<Ret(Args...)>(module_handle_, import_module, func_name, hook_func));
-    if (injected_) {
-      hook->Inject();
-    }
-    hooks_.push_back(std::move(hook));
+    AddHook(import_index_.Find(import_module, func_name), hook_func);
+  }
+
+  template<typename Ret, typename... Args>
+  void AddHook(std::string import_module, uint16 ordinal, Ret(__stdcall *hook_func)(Args...)) {
+    AddHook(import_index_.Find(import_module, ordinal), hook_func);
   }
 
   bool Inject();
@@ -355,8 +305,22 @@ private:
   HookedModule(const HookedModule&) = delete;
   HookedModule& operator=(const HookedModule&) = delete;
 
+  template<typename Ret, typename... Args>
+  void AddHook(uint32 slot_rva, Ret(__stdcall *hook_func)(Args...)) {
+    using FuncType = Ret (__stdcall *)(Args...);
+    FuncType* import_entry = slot_rva == 0 ? nullptr :
+        reinterpret_cast<FuncType*>(reinterpret_cast<byte*>(module_handle_) + slot_rva);
+    std::unique_ptr<ImportHookBase> hook(new ImportHook<Ret(Args...)>(import_entry, hook_func));
+    if (injected_) {
+      hook->Inject();
+    }
+    hooks_.push_back(std::move(hook));
+  }
+
   HMODULE module_handle_;
   bool injected_;
+  // Parsed once on construction, so adding hooks is just a lookup each
+  ImportIndex import_index_;
   std::vector<std::unique_ptr<ImportHookBase>> hooks_;
 };
 
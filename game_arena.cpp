@@ -0,0 +1,64 @@
+#include "./game_arena.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+#include "./types.h"
+
+namespace apm {
+
+const size_t GameArena::BLOCK_SIZE;
+
+GameArena::GameArena()
+  : blocks_(),
+    current_(0),
+    cursor_(nullptr),
+    end_(nullptr),
+    usedInPastBlocks_(0),
+    peakBytesUsed_(0),
+    bytesReserved_(0) {
+}
+
+void GameArena::Reset() {
+  peakBytesUsed_ = peakBytesUsed();
+  usedInPastBlocks_ = 0;
+  current_ = 0;
+  if (!blocks_.empty()) {
+    cursor_ = blocks_[0].data.get();
+    end_ = cursor_ + blocks_[0].size;
+  }
+}
+
+size_t GameArena::peakBytesUsed() const {
+  return std::max(peakBytesUsed_, bytesUsed());
+}
+
+void* GameArena::AllocateFromNextBlock(size_t size, size_t alignment) {
+  // Blocks come from new, so they start out aligned enough
+  const size_t needed = std::max(size, static_cast<size_t>(1));
+  const size_t next = blocks_.empty() ? 0 : current_ + 1;
+  // Any unused block that's big enough will do. The ones that aren't stay unused for this game,
+  // but that only happens for allocations bigger than BLOCK_SIZE.
+  size_t found = next;
+  while (found < blocks_.size() && blocks_[found].size < needed) {
+    found++;
+  }
+  if (found == blocks_.size()) {
+    const size_t blockSize = std::max(needed, BLOCK_SIZE);
+    Block block = { std::unique_ptr<byte[]>(new byte[blockSize]), blockSize };
+    bytesReserved_ += block.size;
+    blocks_.push_back(std::move(block));
+  }
+  std::swap(blocks_[next], blocks_[found]);
+
+  if (next != 0) {
+    usedInPastBlocks_ += blocks_[current_].size;
+  }
+  current_ = next;
+  cursor_ = blocks_[current_].data.get();
+  end_ = cursor_ + blocks_[current_].size;
+  return Allocate(size, alignment);
+}
+
+}  // namespace apm
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "./types.h"
+
+namespace apm {
+
+// Bump allocator for state that lives for a single game. Allocating is usually just aligning and
+// advancing a pointer, nothing is freed individually, and Reset throws away everything allocated
+// since the last Reset in O(1). The blocks backing it are kept across games, so once it has grown
+// to fit a typical game, what's allocated from it no longer touches the heap. Not thread safe:
+// each arena should only be used by one thread at a time.
+class GameArena {
+public:
+  static const size_t BLOCK_SIZE = 64 * 1024;
+
+  GameArena();
+
+  // alignment must be a power of 2, no larger than new's default alignment
+  void* Allocate(size_t size, size_t alignment) {
+    byte* result = AlignUp(cursor_, alignment);
+    if (result == nullptr || result > end_ || static_cast<size_t>(end_ - result) < size) {
+      return AllocateFromNextBlock(size, alignment);
+    }
+    cursor_ = result + size;
+    return result;
+  }
+  // Everything allocated since the last Reset must no longer be in use
+  void Reset();
+
+  // Bytes handed out since the last Reset, counting alignment padding and the unused ends of
+  // blocks that were moved past
+  size_t bytesUsed() const {
+    return usedInPastBlocks_ + (blocks_.empty() ? 0 : cursor_ - blocks_[current_].data.get());
+  }
+  // Most bytes used by any one game so far
+  size_t peakBytesUsed() const;
+  // Bytes currently held from the heap
+  size_t bytesReserved() const { return bytesReserved_; }
+  size_t numBlocks() const { return blocks_.size(); }
+
+private:
+  struct Block {
+    std::unique_ptr<byte[]> data;
+    size_t size;
+  };
+
+  // Disable copying
+  GameArena(const GameArena&) = delete;
+  GameArena& operator=(const GameArena&) = delete;
+
+  static byte* AlignUp(byte* pointer, size_t alignment) {
+    return reinterpret_cast<byte*>(
+        (reinterpret_cast<uintptr_t>(pointer) + alignment - 1) & ~(alignment - 1));
+  }
+  void* AllocateFromNextBlock(size_t size, size_t alignment);
+
+  std::vector<Block> blocks_;
+  // Block being allocated from, blocks after it are unused since the last Reset
+  size_t current_;
+  byte* cursor_;
+  byte* end_;
+  size_t usedInPastBlocks_;
+  size_t peakBytesUsed_;
+  size_t bytesReserved_;
+};
+
+// Standard allocator that allocates from a GameArena, or from the heap if it has no arena (so the
+// same container types work outside of a game, e.g. when analyzing logs). Deallocating from an
+// arena does nothing, so containers using one must drop their storage (rather than just clearing
+// it) when the arena is Reset; see ResetArenaVector.
+//
+// Classes built on these take an optional GameArena* in their constructor and pass it on to their
+// containers. The same rule applies to them: when given an arena, their own Reset has to be called
+// whenever the arena's is, before they're used again.
+template <typename T>
+class ArenaAllocator {
+public:
+  typedef T value_type;
+  typedef std::true_type propagate_on_container_copy_assignment;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  ArenaAllocator() : arena_(nullptr) {}
+  explicit ArenaAllocator(GameArena* arena) : arena_(arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena()) {}
+
+  T* allocate(size_t count) {
+    if (arena_ == nullptr) {
+      return static_cast<T*>(::operator new(count * sizeof(T)));
+    }
+    return static_cast<T*>(arena_->Allocate(count * sizeof(T), alignof(T)));
+  }
+  void deallocate(T* pointer, size_t) {
+    if (arena_ == nullptr) {
+      ::operator delete(pointer);
+    }
+  }
+
+  GameArena* arena() const { return arena_; }
+
+private:
+  GameArena* arena_;
+};
+
+template <typename T, typename U>
+inline bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+inline bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return a.arena() != b.arena();
+}
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+// Empties vector and forgets its storage without touching it, for when its arena has been Reset
+template <typename T>
+inline void ResetArenaVector(ArenaVector<T>* vector) {
+  ArenaVector<T>(vector->get_allocator()).swap(*vector);
+}
+
+}  // namespace apm
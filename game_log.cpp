@@ -0,0 +1,272 @@
+#include "./game_log.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "./actions.h"
+#include "./types.h"
+#include "./varint.h"
+
+namespace apm {
+
+using std::string;
+using std::vector;
+
+const uint32 TAG_KIND_BITS = 4;
+const uint32 TAG_KIND_MASK = (1 << TAG_KIND_BITS) - 1;
+const uint32 KIND_SAMPLE = 12;
+const uint32 KIND_SEEK = 13;
+const uint32 KIND_END = 15;
+const size_t MAX_VARINT_SIZE = 10;
+// Enough for a tag, and a seek in front of it
+const size_t MAX_RECORD_OVERHEAD = 3 * MAX_VARINT_SIZE;
+
+const size_t GameLogEncoder::BLOCK_SIZE;
+
+GameLogEncoder::GameLogEncoder()
+  : flush_(),
+    block_(),
+    active_(false),
+    activePlayers_(0),
+    lastTick_(0),
+    lastSample_() {
+}
+
+void GameLogEncoder::Begin(const GameLogHeader& header, FlushFn flush) {
+  flush_ = std::move(flush);
+  block_.clear();
+  block_.reserve(BLOCK_SIZE);
+  active_ = true;
+  activePlayers_ = 0;
+  lastTick_ = 0;
+  lastSample_ = GameLogSample();
+
+  for (size_t i = 0; i < header.playerNames.size(); i++) {
+    if (!header.playerNames[i].empty()) {
+      activePlayers_ |= 1 << i;
+    }
+  }
+
+  for (uint32 i = 0; i < 4; i++) {
+    block_.push_back(static_cast<byte>(GAME_LOG_MAGIC >> (i * 8)));
+  }
+  WriteVarint(GAME_LOG_VERSION, &block_);
+  WriteVarint(header.startTime, &block_);
+  block_.push_back(header.myPlayerId);
+  block_.push_back(header.flags);
+  WriteVarint(activePlayers_, &block_);
+  for (const string& name : header.playerNames) {
+    if (!name.empty()) {
+      Reserve(MAX_VARINT_SIZE + name.size());
+      WriteVarint(name.size(), &block_);
+      WriteBytes(reinterpret_cast<const byte*>(name.data()), name.size());
+    }
+  }
+}
+
+// The decoder has to come up with the same length from the same bytes
+uint32 LoggedActionLength(const byte* action) {
+  return std::max(GetActionLength(action), 1u);
+}
+
+void GameLogEncoder::AddAction(uint32 tick, uint8 player, const byte* action) {
+  if (!active_ || player >= 12 || !(activePlayers_ & (1 << player))) {
+    return;
+  }
+
+  const uint32 length = LoggedActionLength(action);
+  Reserve(MAX_RECORD_OVERHEAD + length);
+  WriteTag(tick, player);
+  WriteBytes(action, length);
+}
+
+void GameLogEncoder::AddSample(uint32 tick, const GameLogSample& sample) {
+  if (!active_) {
+    return;
+  }
+
+  Reserve(MAX_RECORD_OVERHEAD + 12 * 3 * MAX_VARINT_SIZE);
+  WriteTag(tick, KIND_SAMPLE);
+  for (size_t i = 0; i < 12; i++) {
+    if (activePlayers_ & (1 << i)) {
+      WriteSigned(static_cast<int64>(sample.minerals[i]) - lastSample_.minerals[i]);
+      WriteSigned(static_cast<int64>(sample.vespene[i]) - lastSample_.vespene[i]);
+      WriteSigned(static_cast<int64>(sample.population[i]) - lastSample_.population[i]);
+    }
+  }
+  lastSample_ = sample;
+}
+
+void GameLogEncoder::End(uint32 tick) {
+  if (!active_) {
+    return;
+  }
+
+  Reserve(MAX_RECORD_OVERHEAD);
+  WriteTag(tick, KIND_END);
+  Flush();
+  active_ = false;
+  flush_ = FlushFn();
+}
+
+void GameLogEncoder::WriteTag(uint32 tick, uint32 kind) {
+  if (tick < lastTick_) {
+    WriteVarint(KIND_SEEK, &block_);
+    WriteVarint(tick, &block_);
+    lastTick_ = tick;
+  }
+  WriteVarint((static_cast<uint64>(tick - lastTick_) << TAG_KIND_BITS) | kind, &block_);
+  lastTick_ = tick;
+}
+
+void GameLogEncoder::WriteSigned(int64 value) {
+  WriteVarint((static_cast<uint64>(value) << 1) ^ static_cast<uint64>(value >> 63), &block_);
+}
+
+void GameLogEncoder::WriteBytes(const byte* data, size_t length) {
+  block_.insert(block_.end(), data, data + length);
+}
+
+void GameLogEncoder::Reserve(size_t size) {
+  if (block_.size() + size > BLOCK_SIZE) {
+    Flush();
+  }
+}
+
+void GameLogEncoder::Flush() {
+  if (block_.empty()) {
+    return;
+  }
+
+  vector<byte> full;
+  full.reserve(BLOCK_SIZE);
+  full.swap(block_);
+  if (flush_) {
+    flush_(std::move(full));
+  }
+}
+
+GameLogDecoder::GameLogDecoder(const byte* data, size_t size)
+  : pos_(data),
+    end_(data + size),
+    activePlayers_(0),
+    tick_(0),
+    done_(false),
+    lastSample_() {
+}
+
+GameLogDecoder::Result GameLogDecoder::ReadHeader(GameLogHeader* header) {
+  if (end_ - pos_ < 4) {
+    return Result::Error;
+  }
+  uint32 magic = 0;
+  for (uint32 i = 0; i < 4; i++) {
+    magic |= static_cast<uint32>(pos_[i]) << (i * 8);
+  }
+  pos_ += 4;
+
+  uint64 version;
+  uint64 activePlayers;
+  if (magic != GAME_LOG_MAGIC || !ReadVarint(&pos_, end_, &version) ||
+      version < 1 || version > GAME_LOG_VERSION || !ReadVarint(&pos_, end_, &header->startTime) ||
+      end_ - pos_ < 2) {
+    return Result::Error;
+  }
+  header->myPlayerId = *pos_++;
+  header->flags = *pos_++;
+  if (!ReadVarint(&pos_, end_, &activePlayers) || activePlayers >= (1 << 12)) {
+    return Result::Error;
+  }
+  activePlayers_ = static_cast<uint32>(activePlayers);
+
+  for (size_t i = 0; i < header->playerNames.size(); i++) {
+    header->playerNames[i].clear();
+    if (!(activePlayers_ & (1 << i))) {
+      continue;
+    }
+    uint64 length;
+    if (!ReadVarint(&pos_, end_, &length) || length > static_cast<uint64>(end_ - pos_)) {
+      return Result::Error;
+    }
+    header->playerNames[i].assign(reinterpret_cast<const char*>(pos_), static_cast<size_t>(length));
+    pos_ += length;
+  }
+
+  return Result::Ok;
+}
+
+GameLogDecoder::Result GameLogDecoder::Next(GameLogEvent* event) {
+  if (done_) {
+    return Result::Done;
+  }
+
+  uint64 tag;
+  if (!ReadVarint(&pos_, end_, &tag)) {
+    return Result::Error;
+  }
+  tick_ += static_cast<uint32>(tag >> TAG_KIND_BITS);
+  event->tick = tick_;
+  const uint32 kind = static_cast<uint32>(tag & TAG_KIND_MASK);
+
+  if (kind < 12) {
+    // Selections need their unit count byte to know their length
+    if (pos_ == end_ || (IsSelectionAction(*pos_) && end_ - pos_ < 2)) {
+      return Result::Error;
+    }
+    const uint32 length = LoggedActionLength(pos_);
+    if (length > static_cast<uint64>(end_ - pos_)) {
+      return Result::Error;
+    }
+    event->type = GameLogEvent::Type::Action;
+    event->player = static_cast<uint8>(kind);
+    event->actionData = pos_;
+    event->actionLength = length;
+    pos_ += length;
+    return Result::Ok;
+  } else if (kind == KIND_SAMPLE) {
+    for (size_t i = 0; i < 12; i++) {
+      if (!(activePlayers_ & (1 << i))) {
+        continue;
+      }
+      int64 minerals;
+      int64 vespene;
+      int64 population;
+      if (!ReadSigned(&minerals) || !ReadSigned(&vespene) || !ReadSigned(&population)) {
+        return Result::Error;
+      }
+      lastSample_.minerals[i] += static_cast<int32>(minerals);
+      lastSample_.vespene[i] += static_cast<int32>(vespene);
+      lastSample_.population[i] += static_cast<uint32>(population);
+    }
+    event->type = GameLogEvent::Type::Sample;
+    event->sample = lastSample_;
+    return Result::Ok;
+  } else if (kind == KIND_SEEK) {
+    uint64 tick;
+    if (tag != KIND_SEEK || !ReadVarint(&pos_, end_, &tick) || tick > tick_) {
+      return Result::Error;
+    }
+    tick_ = static_cast<uint32>(tick);
+    event->type = GameLogEvent::Type::Seek;
+    event->tick = tick_;
+    return Result::Ok;
+  } else if (kind == KIND_END) {
+    event->type = GameLogEvent::Type::End;
+    done_ = true;
+    return Result::Ok;
+  }
+
+  return Result::Error;
+}
+
+bool GameLogDecoder::ReadSigned(int64* value) {
+  uint64 encoded;
+  if (!ReadVarint(&pos_, end_, &encoded)) {
+    return false;
+  }
+  *value = static_cast<int64>((encoded >> 1) ^ (~(encoded & 1) + 1));
+  return true;
+}
+
+}  // namespace apm
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "./types.h"
+
+namespace apm {
+
+// Compact, append-only per-game log of player actions and periodic player state samples, for
+// analysis after the game is over.
+//
+// Format (all integers are LEB128 varints unless noted, signed ones zigzag encoded):
+//   header: magic (4 bytes, little endian), version, start time (seconds since the epoch),
+//     my player id (1 byte), flags (1 byte), active player mask, then for each active player in
+//     slot order its name (length + bytes)
+//   records: tag = (tick delta << 4) | kind, where kind is:
+//     0-11: an action by that player slot, followed by the raw action bytes. Their length is
+//       implied by the action (see GetActionLength), actions of unknown length are logged as just
+//       their type byte.
+//     12: a sample, followed by signed deltas of minerals, vespene and population (in that order)
+//       from the previous sample, for each active player
+//     13: seek (a replay was rewound), with a tick delta of 0, followed by the tick it went back
+//       to. Everything logged at or after that tick before the seek is superseded by what follows.
+//     15: end of log
+// Version 1 logs are the same without seeks (their ticks never went back).
+const uint32 GAME_LOG_MAGIC = 0x474C5041;  // 'APLG'
+const uint32 GAME_LOG_VERSION = 2;
+
+const uint8 GAME_LOG_FLAG_REPLAY = 1 << 0;
+
+struct GameLogHeader {
+  uint64 startTime;
+  uint8 myPlayerId;
+  uint8 flags;
+  // Slots with empty names are left out of the log
+  std::array<std::string, 12> playerNames;
+};
+
+struct GameLogSample {
+  std::array<int32, 12> minerals;
+  std::array<int32, 12> vespene;
+  std::array<uint32, 12> population;
+};
+
+// Encodes a game log into fixed size blocks, handing each one off as it fills up. Encoding only
+// touches memory, so it's cheap enough to do directly from the game's hooks.
+class GameLogEncoder {
+public:
+  using FlushFn = std::function<void(std::vector<byte> block)>;
+
+  static const size_t BLOCK_SIZE = 64 * 1024;
+
+  GameLogEncoder();
+
+  // Starts a new log, discarding any unfinished one
+  void Begin(const GameLogHeader& header, FlushFn flush);
+  // Actions/samples are added in tick order, except that a tick earlier than the last one (a replay
+  // being rewound) is logged as a seek back to it. Actions from player slots that weren't active at
+  // the start of the game are dropped.
+  void AddAction(uint32 tick, uint8 player, const byte* action);
+  void AddSample(uint32 tick, const GameLogSample& sample);
+  // Finishes the log and flushes whatever is left of it
+  void End(uint32 tick);
+
+  bool isActive() const { return active_; }
+
+private:
+  // Disable copying
+  GameLogEncoder(const GameLogEncoder&) = delete;
+  GameLogEncoder& operator=(const GameLogEncoder&) = delete;
+
+  void WriteTag(uint32 tick, uint32 kind);
+  void WriteSigned(int64 value);
+  void WriteBytes(const byte* data, size_t length);
+  // Hands the current block off if it can't fit another size bytes
+  void Reserve(size_t size);
+  void Flush();
+
+  FlushFn flush_;
+  std::vector<byte> block_;
+  bool active_;
+  uint32 activePlayers_;
+  uint32 lastTick_;
+  GameLogSample lastSample_;
+};
+
+struct GameLogEvent {
+  enum class Type {
+    Action,
+    Sample,
+    // Drop everything at or after tick that was read so far, the log continues from there
+    Seek,
+    End
+  };
+
+  Type type;
+  uint32 tick;
+  // For Action events
+  uint8 player;
+  const byte* actionData;
+  uint32 actionLength;
+  // For Sample events, only the slots of active players are filled in
+  GameLogSample sample;
+};
+
+// Reads back a log written by GameLogEncoder (from the concatenation of its blocks)
+class GameLogDecoder {
+public:
+  enum class Result {
+    Ok,
+    // No more events, the log ended cleanly
+    Done,
+    // The log is corrupt, or was cut off before its end record (e.g. the game crashed)
+    Error
+  };
+
+  GameLogDecoder(const byte* data, size_t size);
+
+  // Must be called (successfully) before Next
+  Result ReadHeader(GameLogHeader* header);
+  // Decodes the next event. Action data points into the log's data.
+  Result Next(GameLogEvent* event);
+
+  uint32 activePlayers() const { return activePlayers_; }
+
+private:
+  bool ReadSigned(int64* value);
+
+  const byte* pos_;
+  const byte* end_;
+  uint32 activePlayers_;
+  uint32 tick_;
+  bool done_;
+  GameLogSample lastSample_;
+};
+
+}  // namespace apm
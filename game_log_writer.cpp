@@ -0,0 +1,99 @@
+#include "./game_log_writer.h"
+
+#include <ctime>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "./types.h"
+
+namespace apm {
+
+using std::string;
+using std::vector;
+
+GameLogWriter::GameLogWriter()
+  : queueMutex_(),
+    queue_(),
+    processing_(),
+    file_() {
+}
+
+GameLogWriter::~GameLogWriter() {
+  Stop();
+}
+
+void GameLogWriter::Open(string path) {
+  Request request = { Request::Type::Open, std::move(path), vector<byte>() };
+  Enqueue(std::move(request));
+}
+
+void GameLogWriter::Append(vector<byte> block) {
+  Request request = { Request::Type::Append, string(), std::move(block) };
+  Enqueue(std::move(request));
+}
+
+void GameLogWriter::Close() {
+  Request request = { Request::Type::Close, string(), vector<byte>() };
+  Enqueue(std::move(request));
+}
+
+string GameLogWriter::MakeFileName(uint64 startTime, const char* extension) {
+  const std::time_t time = static_cast<std::time_t>(startTime);
+  std::tm localTime = std::tm();
+#ifdef _WIN32
+  localtime_s(&localTime, &time);
+#else
+  localtime_r(&time, &localTime);
+#endif
+  char name[64];
+  size_t length = std::strftime(name, sizeof(name), "%Y%m%d-%H%M%S", &localTime);
+  return string(name, length) + extension;
+}
+
+void GameLogWriter::Enqueue(Request request) {
+  {
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    queue_.push_back(std::move(request));
+  }
+  Wake();
+}
+
+void GameLogWriter::Execute() {
+  while (WaitForWake()) {
+    ProcessQueue();
+  }
+  // Don't lose the end of a log that was queued right before we were stopped
+  ProcessQueue();
+  file_.close();
+}
+
+void GameLogWriter::ProcessQueue() {
+  {
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    processing_.swap(queue_);
+  }
+
+  for (Request& request : processing_) {
+    switch (request.type) {
+      case Request::Type::Open:
+        file_.close();
+        file_.clear();
+        file_.open(request.path, std::ios::binary | std::ios::out | std::ios::trunc);
+        break;
+      case Request::Type::Append:
+        // Write failures just lose the log, there's nobody to report them to
+        if (file_.is_open()) {
+          file_.write(reinterpret_cast<const char*>(request.data.data()), request.data.size());
+        }
+        break;
+      case Request::Type::Close:
+        file_.close();
+        break;
+    }
+  }
+  processing_.clear();
+}
+
+}  // namespace apm
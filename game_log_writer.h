@@ -0,0 +1,59 @@
+#pragma once
+
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "./types.h"
+#include "./worker_thread.h"
+
+namespace apm {
+
+// Does the file I/O for game logs on its own thread, so that the threads producing the logs never
+// block on the disk. Logs are written one at a time: Open starts a new file (closing the previous
+// one), Append queues a block for it and Close finishes it. Anything queued is written out before
+// the thread stops.
+class GameLogWriter : public sbat::WorkerThread {
+public:
+  GameLogWriter();
+  virtual ~GameLogWriter();
+
+  void Open(std::string path);
+  void Append(std::vector<byte> block);
+  void Close();
+
+  // Returns a file name (without a directory) for a log of a game started at the given time
+  static std::string MakeFileName(uint64 startTime, const char* extension);
+
+protected:
+  virtual void Execute();
+
+private:
+  // Disable copying
+  GameLogWriter(const GameLogWriter&) = delete;
+  GameLogWriter& operator=(const GameLogWriter&) = delete;
+
+  struct Request {
+    enum class Type {
+      Open,
+      Append,
+      Close
+    };
+
+    Type type;
+    std::string path;
+    std::vector<byte> data;
+  };
+
+  void Enqueue(Request request);
+  void ProcessQueue();
+
+  std::mutex queueMutex_;
+  std::vector<Request> queue_;
+  // Access only on the GameLogWriter thread
+  std::vector<Request> processing_;
+  std::ofstream file_;
+};
+
+}  // namespace apm
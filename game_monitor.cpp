@@ -1,84 +1,360 @@
 #include "game_monitor.h"
 
-#include <Windows.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include "./actions.h"
+#include "./apm_series.h"
+#include "./apm_shifts.h"
+#include "./apm_tracker.h"
 #include "./brood_war.h"
+#include "./build_order.h"
+#include "./game_log.h"
+#include "./game_log_writer.h"
+#include "./heatmap.h"
+#include "./hotkey_stats.h"
+#include "./local_clock.h"
+#include "./player_history.h"
+#include "./player_identity.h"
+#include "./profiling.h"
+#include "./resource_series.h"
+#include "./time_format.h"
 #include "./types.h"
-#include "./win_helpers.h"
+#include "./unit_stats.h"
 
 namespace apm {
 
 using std::string;
 
-GameMonitor::GameMonitor(BroodWar bw)
+GameMonitor::GameMonitor(BroodWar bw, string logDirectory)
   : bw_(std::move(bw)),
+    hookCalls_(0),
+    hooksEnabled_(false),
     wasInGame_(false),
+    monitorArena_(),
+    apm_(&monitorArena_),
+    countedActions_(),
+    telemetry_(),
+    gameId_(0),
+    players_(),
+    apmSeries_(),
+    resources_(ResourceSeries::DEFAULT_INTERVAL_TICKS, ResourceSeries::DEFAULT_EXPECTED_SAMPLES,
+        &monitorArena_),
+    history_(),
+    historyIsReplay_(false),
+    historyPlayers_(0),
+    historyKeys_(),
+    historicalApm_(),
+    logDirectory_(std::move(logDirectory)),
+    logWriter_(),
+    logStartTime_(0),
+    logPlayerNames_(),
+    localTimeFormat_(),
+    gameTimeFormat_(),
     cachedLocalTime_(),
     localTimeValidUntil_(0),
     cachedGameTime_(),
     gameTimeValidUntil_(0),
-    apmCounter_(),
-    apmStrings_(),
-    apmCalcTime_(0) {
+    nextLogSampleTick_(0),
+    totalActions_(),
+    hotkeys_(),
+    lastActionTick_(0),
+    actionStatsStartTick_(0),
+    units_(),
+    unitsScanTick_(0),
+    unitStatsText_(),
+    apmResults_(),
+    gameArena_(),
+    gameLog_(),
+    buildOrder_(BuildOrderExtractor::DEFAULT_EXPECTED_ENTRIES, &gameArena_),
+    heatmap_(&gameArena_) {
+  CompileLocalTimeFormat(&localTimeFormat_);
+  gameTimeFormat_.Compile("mm:ss", "", "", false);
 }
 
 GameMonitor::~GameMonitor() {
+  Stop();
 }
 
+// No game start/end code sites are known for the supported versions, so isInGame is polled (Stop
+// still wakes the wait early)
+const std::chrono::milliseconds GAME_STATE_POLL_INTERVAL(200);
+const std::chrono::milliseconds APM_UPDATE_INTERVAL(100);
 void GameMonitor::Execute() {
-  while (!isTerminated()) {
-    if (wasInGame_ && !bw_.isInGame) {
-      wasInGame_ = false;
-      bw_.RestoreHooks();
-    } else if (!wasInGame_ && bw_.isInGame) {
-      wasInGame_ = true;
-      InitGameData();
-      bw_.InjectHooks();
-    }
-    Sleep(200);
+  OpenOutputs();
+  bool running = true;
+  while (running) {
+    Update();
+    running = WaitForWake(wasInGame_ ? APM_UPDATE_INTERVAL : GAME_STATE_POLL_INTERVAL);
+  }
+  CloseOutputs();
+}
+
+void GameMonitor::OpenOutputs() {
+  telemetry_ = TelemetryWriter::Create();
+  if (!logDirectory_.empty()) {
+    history_.reset(new PlayerHistory(logDirectory_));
+    history_->Open();
+    logWriter_.reset(new GameLogWriter());
+    logWriter_->SetPriorityHint(sbat::ThreadPriority::BelowNormal);
+    logWriter_->Start();
+  }
+}
+
+void GameMonitor::CloseOutputs() {
+  if (wasInGame_) {
+    wasInGame_ = false;
+    DisableHooks();
+    EndGameLog();
+  }
+  telemetry_.reset();
+  // Finishes writing anything that's still queued
+  logWriter_.reset();
+  history_.reset();
+}
+
+void GameMonitor::Update() {
+  if (wasInGame_ && !bw_.isInGame) {
+    wasInGame_ = false;
+    DisableHooks();
+    EndGameLog();
+    RecordHistory();
+  } else if (!wasInGame_ && bw_.isInGame) {
+    wasInGame_ = true;
+    InitGameData();
+    EnableHooks();
+  }
+
+  if (wasInGame_) {
+    CalculateApm();
   }
 }
 
+void GameMonitor::EnableHooks() {
+  hooksEnabled_.store(true);
+  bw_.InjectHooks();
+}
+
+// Once this returns, nothing on the BW game loop thread is accessing the game data. Restoring the
+// hooks only stops new calls into them: a Draw or OnAction that was already past the jump keeps
+// running (possibly for a while, if its thread was preempted), so wait for those to finish. The
+// flag covers a call that had jumped into a hook but hadn't been counted yet when hookCalls_ was
+// read (both are sequentially consistent, so the call sees the flag cleared if it was missed).
+void GameMonitor::DisableHooks() {
+  hooksEnabled_.store(false);
+  bw_.RestoreHooks();
+  while (hookCalls_.load() != 0) {
+    std::this_thread::yield();
+  }
+}
+
+// Called on the GameMonitor thread before the game hooks are injected, so nothing on the BW thread
+// is accessing this data yet
 void GameMonitor::InitGameData() {
   localTimeValidUntil_ = 0;
   gameTimeValidUntil_ = 0;
-  for (size_t i = 0; i < apmCounter_.size(); i++) {
-    apmCounter_[i] = 0;
-    apmStrings_[i] = "";
+  for (size_t i = 0; i < countedActions_.size(); i++) {
+    countedActions_[i] = 0;
+    totalActions_[i].store(0, std::memory_order_relaxed);
+  }
+  monitorArena_.Reset();
+  // Replays can be rewound, so keep what's needed to get back to any earlier point in them
+  apm_.Reset(bw_.isInReplay);
+  resources_.Reset();
+  gameId_++;
+  hotkeys_.Reset();
+  lastActionTick_ = 0;
+  actionStatsStartTick_ = 0;
+  units_.Reset();
+  unitsScanTick_ = 0xFFFFFFFF;
+  for (auto& text : unitStatsText_) {
+    text[0] = '\0';
+  }
+  players_.Refresh(bw_, true);
+  apmSeries_.Reset();
+  gameArena_.Reset();
+  buildOrder_.Reset();
+  uint32 heatmapPlayers = 0;
+  for (size_t i = 0; i < totalActions_.size(); i++) {
+    if (players_.isPresent(i)) {
+      heatmapPlayers |= 1 << i;
+    }
   }
-  apmCalcTime_ = 0;
+  heatmap_.Reset(heatmapPlayers);
+  LoadHistory();
+
+  ApmResults& results = apmResults_.back();
+  results.obsMode = false;
+  results.myPlayerId = 0xFFFFFFFF;
+  for (auto& line : results.lines) {
+    line[0] = '\0';
+  }
+  results.graphScale = 0;
+  apmResults_.Publish();
+
+  BeginGameLog();
 }
 
-void GameMonitor::UpdateLocalTime() {
-  uint64 tickCount = GetTickCount64();
-  if (tickCount <= localTimeValidUntil_) {
+void GameMonitor::BeginGameLog() {
+  nextLogSampleTick_ = 0;
+  if (!logWriter_) {
     return;
   }
 
-  SYSTEMTIME localTime = SYSTEMTIME();
-  GetLocalTime(&localTime);
-  WCHAR wideStr[64];
-  bool success = false;
-  int numChars =
-    GetTimeFormatEx(LOCALE_NAME_USER_DEFAULT, TIME_NOSECONDS, &localTime, nullptr, wideStr, 64);
-  if (numChars != 0) {
-    int numBytes = WideCharToMultiByte(
-      CP_THREAD_ACP, NULL, wideStr, -1, &cachedLocalTime_[0], cachedLocalTime_.size(), NULL, NULL);
-    if (numBytes != 0) {
-      success = true;
-    }    
+  GameLogHeader header = GameLogHeader();
+  header.startTime = static_cast<uint64>(std::time(nullptr));
+  header.myPlayerId = static_cast<uint8>(bw_.myPlayerId);
+  header.flags = bw_.isInReplay ? GAME_LOG_FLAG_REPLAY : 0;
+  for (size_t i = 0; i < header.playerNames.size(); i++) {
+    header.playerNames[i] = players_[i].nameRef().str();
   }
 
-  if (!success) {
-    string errorStr = "ERROR";
-    std::copy(errorStr.begin(), errorStr.end(), cachedLocalTime_.begin());
+  logStartTime_ = header.startTime;
+  logPlayerNames_ = header.playerNames;
+
+  GameLogWriter* writer = logWriter_.get();
+  writer->Open(logDirectory_ + "/" + GameLogWriter::MakeFileName(logStartTime_, ".apmlog"));
+  gameLog_.Begin(header, [writer](std::vector<byte> block) {
+    writer->Append(std::move(block));
+  });
+}
+
+// Called on the GameMonitor thread after DisableHooks
+void GameMonitor::EndGameLog() {
+  if (!gameLog_.isActive()) {
+    return;
+  }
+
+  gameLog_.End(bw_.gameTimeTicks);
+  logWriter_->Close();
+
+  WriteLogFile(".build.txt", FormatBuildOrder(buildOrder_.entries(), logPlayerNames_));
+
+  string partialNote;
+  if (actionStatsStartTick_ != 0) {
+    char note[96];
+    const uint32 seconds = actionStatsStartTick_ * 42 / 1000;
+    snprintf(note, sizeof(note), "Partial: the replay was rewound to %u:%02u, only what came after "
+        "that is included\n\n", seconds / 60, seconds % 60);
+    partialNote = note;
   }
 
-  tickCount = GetTickCount64();
-  tickCount += (60 - localTime.wSecond) * 1000;
-  localTimeValidUntil_ = tickCount;
+  string hotkeyStats = partialNote;
+  for (size_t i = 0; i < logPlayerNames_.size(); i++) {
+    if (!logPlayerNames_[i].empty()) {
+      hotkeyStats += logPlayerNames_[i] + ":\n" + FormatHotkeyStats(hotkeys_.stats(i)) + "\n";
+    }
+  }
+  WriteLogFile(".hotkeys.txt", hotkeyStats);
+
+  const uint32 heatmapFactor = 8;
+  const uint32 heatmapSize = ActionHeatmap::GRID_SIZE / heatmapFactor;
+  std::vector<uint16> grid(heatmapSize * heatmapSize);
+  string heatmaps = partialNote;
+  for (uint8 i = 0; i < logPlayerNames_.size(); i++) {
+    if (heatmap_.hasGrid(i)) {
+      heatmap_.Export(i, bw_.gameTimeTicks, heatmapFactor, grid.data());
+      heatmaps += logPlayerNames_[i] + ":\n" + FormatHeatmap(grid.data(), heatmapSize) + "\n";
+    }
+  }
+  WriteLogFile(".heatmap.txt", heatmaps);
+}
+
+// Writes a file alongside the current game's log (through the log writer thread)
+void GameMonitor::WriteLogFile(const char* extension, const string& contents) {
+  logWriter_->Open(logDirectory_ + "/" + GameLogWriter::MakeFileName(logStartTime_, extension));
+  logWriter_->Append(std::vector<byte>(contents.begin(), contents.end()));
+  logWriter_->Close();
+}
+
+void GameMonitor::LoadHistory() {
+  historyIsReplay_ = bw_.isInReplay;
+  historyPlayers_ = 0;
+  for (size_t i = 0; i < historicalApm_.size(); i++) {
+    historicalApm_[i] = -1;
+    historyKeys_[i] = 0;
+    if (!players_.isPresent(i) || players_[i].stormId == INVALID_STORM_ID) {
+      continue;
+    }
+
+    // Storm IDs are only good for telling humans apart within a session, the history goes by name
+    const NameRef name = players_[i].nameRef();
+    historyPlayers_ |= 1 << i;
+    historyKeys_[i] = PlayerHistoryKey(name.data, name.length);
+    PlayerTotals totals;
+    if (history_ && history_->Lookup(historyKeys_[i], &totals)) {
+      historicalApm_[i] = static_cast<int32>(totals.averageApm());
+    }
+  }
+}
+
+// Games shorter than this don't say much about someone's APM
+const uint32 MIN_HISTORY_GAME_TICKS = 60000 / 42;
+// Called on the GameMonitor thread after DisableHooks
+void GameMonitor::RecordHistory() {
+  const uint32 ticks = apm_.timeMillis() / 42;
+  if (!history_ || historyIsReplay_ || ticks < MIN_HISTORY_GAME_TICKS) {
+    return;
+  }
+
+  const uint64 endTime = static_cast<uint64>(std::time(nullptr));
+  for (size_t i = 0; i < historyKeys_.size(); i++) {
+    // Players without any actions were observers, or left right away
+    if ((historyPlayers_ & (1 << i)) && apm_.actions(i) != 0) {
+      history_->AddGame(historyKeys_[i], apm_.actions(i), ticks, endTime);
+    }
+  }
+}
+
+const uint32 LOG_SAMPLE_INTERVAL_TICKS = 24;  // ~1 second at fastest
+void GameMonitor::SampleGameLog() {
+  const uint32 tick = bw_.gameTimeTicks;
+  // A replay rewound to before the last sample is sampled again right away
+  const bool rewound = tick + LOG_SAMPLE_INTERVAL_TICKS < nextLogSampleTick_;
+  if (tick < nextLogSampleTick_ && !rewound) {
+    return;
+  }
+
+  GameLogSample sample;
+  for (size_t i = 0; i < sample.minerals.size(); i++) {
+    sample.minerals[i] = bw_.GetMinerals(i);
+    sample.vespene[i] = bw_.GetVespene(i);
+    sample.population[i] = bw_.GetPopulation(i);
+  }
+  gameLog_.AddSample(tick, sample);
+  nextLogSampleTick_ = tick + LOG_SAMPLE_INTERVAL_TICKS;
+}
+
+// Writes text into a clock cache, wrapped in the color codes it's drawn with
+template <typename FormatFn>
+void WriteClock(std::array<char, 128>* cache, FormatFn format) {
+  (*cache)[0] = '\x04';
+  const size_t length = 1 + format(cache->data() + 1, cache->size() - 2);
+  (*cache)[length] = '\x01';
+  (*cache)[length + 1] = '\0';
+}
+
+void GameMonitor::UpdateLocalTime() {
+  const uint64 now = GetMonotonicMillis();
+  if (now <= localTimeValidUntil_) {
+    return;
+  }
+
+  const LocalTimeOfDay localTime = GetLocalTimeOfDay();
+  WriteClock(&cachedLocalTime_, [&](char* out, size_t size) {
+    return localTimeFormat_.Format(localTime.hours, localTime.minutes, localTime.seconds, out,
+        size);
+  });
+
+  localTimeValidUntil_ = now + (60 - localTime.seconds) * 1000;
 }
 
 const uint32 LOCAL_CLOCK_X = 16;
@@ -86,8 +362,7 @@ const uint32 LOCAL_CLOCK_Y = 288;
 void GameMonitor::DrawLocalTime() {
   bw_.SetFont(bw_.fontNormal);
   UpdateLocalTime();
-  string localTimeStr = string("\x04") + cachedLocalTime_.data() + "\x01";
-  bw_.DrawText(LOCAL_CLOCK_X, LOCAL_CLOCK_Y, localTimeStr);
+  bw_.DrawText(LOCAL_CLOCK_X, LOCAL_CLOCK_Y, cachedLocalTime_.data());
 }
 
 void GameMonitor::UpdateGameTime() {
@@ -96,16 +371,10 @@ void GameMonitor::UpdateGameTime() {
     return;
   }
 
-  uint32 seconds = timeMillis / 1000;
-  uint32 minutes = seconds / 60;
-  seconds -= (minutes * 60);
-
-  int numChars = _snprintf_s(
-    cachedGameTime_.data(), cachedGameTime_.size(), _TRUNCATE, "%.2d:%.2d", minutes, seconds);
-  if (numChars == 0) {
-    string errorStr = "ERROR";
-    std::copy(errorStr.begin(), errorStr.end(), cachedGameTime_.begin());
-  }
+  const uint32 seconds = timeMillis / 1000;
+  WriteClock(&cachedGameTime_, [&](char* out, size_t size) {
+    return gameTimeFormat_.Format(0, seconds / 60, seconds % 60, out, size);
+  });
 
   gameTimeValidUntil_ = timeMillis + 1000 - (timeMillis % 1000);
 }
@@ -114,87 +383,300 @@ const uint32 GAME_CLOCK_Y = 2;
 void GameMonitor::DrawGameTime() {
   bw_.SetFont(bw_.fontLarge);
   UpdateGameTime();
-  string gameTimeStr = string("\x04") + cachedGameTime_.data() + "\x01";
   uint32 xPos = (640 - bw_.GetTextWidth(bw_, "888:88")) / 2;
-  bw_.DrawText(xPos, GAME_CLOCK_Y, gameTimeStr);
+  bw_.DrawText(xPos, GAME_CLOCK_Y, cachedGameTime_.data());
 }
 
-const double APM_INTERVAL = 0.95;  // time after which actions are worth 1/e (in minutes)
+const uint32 SHIFT_DISPLAY_MILLIS = 10000;
+const uint32 APM_GRAPH_MILLIS = 5 * 60000;
+const int32 APM_GRAPH_SCALE_STEP = 50;
 void GameMonitor::CalculateApm() {
   const uint32 timeMillis = bw_.gameTimeTicks * 42;
-  if (apmCalcTime_ != 0 && timeMillis <= (apmCalcTime_ + 250)) {
+  const bool rewound = timeMillis < apm_.timeMillis();
+  if (rewound) {
+    apm_.Seek(timeMillis);
+    apmSeries_.Rewind(timeMillis);
+    resources_.Rewind(bw_.gameTimeTicks);
+  } else if (apm_.timeMillis() != 0 && timeMillis <= (apm_.timeMillis() + 250)) {
     return;
   }
 
-  int32 timeDiff = static_cast<int32>(timeMillis - apmCalcTime_);
-  for (size_t i = 0; i < apmCounter_.size(); i++) {
-    apmCounter_[i] *= std::exp(-timeDiff / (APM_INTERVAL * 60000));
+  std::array<uint32, 12> newActions;
+  for (size_t i = 0; i < newActions.size(); i++) {
+    uint32 totalActions = totalActions_[i].load(std::memory_order_relaxed);
+    newActions[i] = totalActions - countedActions_[i];
+    countedActions_[i] = totalActions;
   }
-  apmCalcTime_ = timeMillis;
-
-  double gameDurationFactor =
-      1 - std::exp(-static_cast<int32>(timeMillis) / (APM_INTERVAL * 60000));
-  if (gameDurationFactor < 0.01) {
-    gameDurationFactor = 0.01;
+  if (rewound) {
+    // Actions counted since the last calculation were made at the later position
+    newActions.fill(0);
+  }
+  if (timeMillis >= apm_.timeMillis()) {
+    apm_.Advance(timeMillis, newActions);
   }
 
-  for (size_t i = 0; i < apmCounter_.size(); i++) {
-    string playerName = bw_.GetPlayerName(i);
-    if (!playerName.empty()) {
-      int32 apm = static_cast<int32>(apmCounter_[i] / (APM_INTERVAL * gameDurationFactor));
-      if (i == bw_.myPlayerId && !IsObsMode()) {
-        apmStrings_[i] = "\x04" "APM: " "\x07" + std::to_string(apm);
+  ApmResults& results = apmResults_.back();
+  results.obsMode = IsObsMode();
+  results.myPlayerId = bw_.myPlayerId;
+  players_.Refresh(bw_);
+  std::array<int32, 12> apms;
+  apm_.GetApm(&apms);
+  for (size_t i = 0; i < apms.size(); i++) {
+    const int32 apm = apms[i];
+    std::array<char, 64>& line = results.lines[i];
+    // in obs mode, observers are left off the list entirely
+    if (players_.isPresent(i) && !(results.obsMode && IsObserver(i))) {
+      // Players' average APM in earlier games, if we've seen them before
+      char average[16] = "";
+      if (historicalApm_[i] >= 0) {
+        snprintf(average, sizeof(average), " \x04(%d)", historicalApm_[i]);
+      }
+      // Flag a recent spike (green) or drop (red) in the player's APM
+      const ApmShift& shift = apm_.shifts().lastShift(i);
+      if (shift.kind != ApmShiftKind::None &&
+          timeMillis - shift.timeMillis < SHIFT_DISPLAY_MILLIS) {
+        const size_t length = strlen(average);
+        snprintf(average + length, sizeof(average) - length,
+            shift.kind == ApmShiftKind::Burst ? " \x07^" : " \x06v");
+      }
+      if (i == results.myPlayerId && !results.obsMode) {
+        snprintf(line.data(), line.size(), "\x04" "APM: " "\x07" "%d%s", apm,
+            average);
       } else {
-        uint8 playerColor = bw_.GetPlayerColor(i);
-        apmStrings_[i] =
-          PlayerColorToTextColor(playerColor) + playerName + ": \x07" + std::to_string(apm);
+        const PlayerIdentity& player = players_[i];
+        snprintf(line.data(), line.size(), "%c%s: \x07%d%s", player.textColor,
+            player.name.data(), apm, average);
       }
     } else {
-      apmStrings_[i] = "";
+      line[0] = '\0';
+    }
+  }
+  apmSeries_.Add(timeMillis, apms);
+  if (!results.obsMode && results.myPlayerId < apms.size()) {
+    const uint32 graphStart = timeMillis > APM_GRAPH_MILLIS ? timeMillis - APM_GRAPH_MILLIS : 0;
+    apmSeries_.Query(results.myPlayerId, graphStart, timeMillis, results.graph.size(),
+        results.graph.data());
+    int32 peak = 0;
+    for (const ApmGraphPoint& point : results.graph) {
+      if (point.samples != 0) {
+        peak = std::max(peak, point.max);
+      }
+    }
+    results.graphScale = (peak / APM_GRAPH_SCALE_STEP + 1) * APM_GRAPH_SCALE_STEP;
+    snprintf(results.graphLabel.data(), results.graphLabel.size(), "\x04%d",
+        results.graphScale);
+  } else {
+    results.graphScale = 0;
+  }
+  RecordResources();
+  if (telemetry_) {
+    PublishTelemetry(results, apms);
+  }
+  apmResults_.Publish();
+}
+
+void GameMonitor::RecordResources() {
+  ResourceSample sample;
+  for (size_t i = 0; i < 12; i++) {
+    sample.at(Resource::Minerals, i) = bw_.GetMinerals(i);
+    sample.at(Resource::Vespene, i) = bw_.GetVespene(i);
+    sample.at(Resource::Population, i) = static_cast<int32>(bw_.GetPopulation(i));
+    sample.at(Resource::Buildings, i) = static_cast<int32>(bw_.GetBuildingsControlled(i));
+  }
+  resources_.Record(bw_.gameTimeTicks, sample);
+}
+
+const uint32 INCOME_WINDOW_TICKS = 60000 / 42;  // 1 minute
+void GameMonitor::PublishTelemetry(const ApmResults& results, const std::array<int32, 12>& apm) {
+  TelemetryRecord record = TelemetryRecord();
+  record.gameId = gameId_;
+  record.gameTimeTicks = bw_.gameTimeTicks;
+  record.flags = (bw_.isInReplay ? TELEMETRY_FLAG_REPLAY : 0) |
+      (results.obsMode ? TELEMETRY_FLAG_OBS_MODE : 0);
+  record.myPlayerId = results.myPlayerId;
+  for (size_t i = 0; i < apm.size(); i++) {
+    if (!players_.isPresent(i)) {
+      continue;
     }
+    record.activePlayers |= 1 << i;
+    record.apm[i] = apm[i];
+    record.minerals[i] = resources_.Current(i, Resource::Minerals);
+    record.vespene[i] = resources_.Current(i, Resource::Vespene);
+    record.population[i] = static_cast<uint32>(resources_.Current(i, Resource::Population));
+    record.mineralIncome[i] = static_cast<int32>(
+        resources_.IncomePerMinute(i, Resource::Minerals, INCOME_WINDOW_TICKS));
+    record.vespeneIncome[i] = static_cast<int32>(
+        resources_.IncomePerMinute(i, Resource::Vespene, INCOME_WINDOW_TICKS));
+  }
+  telemetry_->Publish(record);
+
+  // Does nothing unless built with APM_ENABLE_PROFILING
+  ProfileSnapshot profile;
+  if (TakeProfileSnapshot(&profile)) {
+    telemetry_->PublishProfile(profile);
   }
 }
 
 const uint32 APM_X = 16;
 const uint32 APM_Y = 4;
 const uint32 LINE_SIZE = 12;
+const uint32 UNIT_STATS_X = APM_X + 150;
 void GameMonitor::DrawApm() {
   bw_.SetFont(bw_.fontNormal);
-  CalculateApm();
-  if (IsObsMode()) {
+  const ApmResults& results = apmResults_.Read();
+  if (results.obsMode) {
     uint32 lineNum = 0;
-    for (size_t i = 0; i < apmStrings_.size(); i++) {
-      if (!apmStrings_[i].empty() && !IsObserver(i)) {
-        bw_.DrawText(APM_X, APM_Y + lineNum * LINE_SIZE, apmStrings_[i]);
+    for (size_t i = 0; i < results.lines.size(); i++) {
+      if (results.lines[i][0] != '\0') {
+        bw_.DrawText(APM_X, APM_Y + lineNum * LINE_SIZE, results.lines[i].data());
+        if (unitStatsText_[i][0] != '\0') {
+          bw_.DrawText(UNIT_STATS_X, APM_Y + lineNum * LINE_SIZE, unitStatsText_[i].data());
+        }
         lineNum++;
       }
     }
-  } else if (bw_.myPlayerId < apmStrings_.size()) {
-    bw_.DrawText(APM_X, APM_Y, apmStrings_[bw_.myPlayerId]);
+  } else if (results.myPlayerId < results.lines.size()) {
+    bw_.DrawText(APM_X, APM_Y, results.lines[results.myPlayerId].data());
+    DrawApmGraph(results);
+  }
+}
+
+const uint32 APM_GRAPH_Y = APM_Y + LINE_SIZE + 4;
+const uint32 APM_GRAPH_HEIGHT = 32;
+const uint32 APM_GRAPH_POINT_WIDTH = 2;
+// Draws a dot per point, so the cost doesn't depend on how long the game has gone on
+void GameMonitor::DrawApmGraph(const ApmResults& results) {
+  if (results.graphScale <= 0) {
+    return;
+  }
+  bw_.SetFont(bw_.fontMini);
+  for (size_t i = 0; i < results.graph.size(); i++) {
+    const ApmGraphPoint& point = results.graph[i];
+    if (point.samples == 0) {
+      continue;
+    }
+    const uint32 height = static_cast<uint32>(
+        std::min(point.mean, results.graphScale) * APM_GRAPH_HEIGHT / results.graphScale);
+    bw_.DrawText(APM_X + i * APM_GRAPH_POINT_WIDTH, APM_GRAPH_Y + APM_GRAPH_HEIGHT - height,
+        "\x07.");
   }
+  bw_.DrawText(APM_X + APM_GRAPH_POINTS * APM_GRAPH_POINT_WIDTH + 4, APM_GRAPH_Y,
+      results.graphLabel.data());
 }
 
+// A quarter of the table is scanned each tick, which keeps the scan under 50us even when the table
+// isn't in cache, at the cost of stats lagging by up to 3 ticks (~125ms)
+const size_t UNIT_SCAN_NODES = (MAX_UNIT_NODES + 3) / 4;
+void GameMonitor::UpdateUnitStats() {
+  if (!bw_.unitNodes.valid() || bw_.gameTimeTicks == unitsScanTick_) {
+    return;
+  }
+  unitsScanTick_ = bw_.gameTimeTicks;
+  if (!units_.Scan(bw_.unitNodes.get(), UNIT_SCAN_NODES)) {
+    return;
+  }
+
+  for (size_t i = 0; i < unitStatsText_.size(); i++) {
+    const PlayerUnitStats& stats = units_.stats(i);
+    if (stats.workers == 0 && stats.armyUnits == 0) {
+      unitStatsText_[i][0] = '\0';
+      continue;
+    }
+    snprintf(unitStatsText_[i].data(), unitStatsText_[i].size(),
+        "\x04" "Army: \x07%u\x04/\x1F%u \x04W: \x07%u \x04P: \x07%u",
+        stats.armyMinerals, stats.armyGas, stats.workers, stats.producing);
+  }
+}
+
+namespace {
+// Counts a game hook call for as long as it runs (see GameMonitor::DisableHooks)
+class HookCall {
+public:
+  HookCall(std::atomic<uint32>* calls, const std::atomic<bool>& enabled)
+    : calls_(calls) {
+    calls_->fetch_add(1);
+    enabled_ = enabled.load();
+  }
+  ~HookCall() {
+    calls_->fetch_sub(1);
+  }
+
+  // False if the hooks were disabled, in which case the call must not touch the game data
+  bool enabled() const { return enabled_; }
+
+private:
+  // Disable copying
+  HookCall(const HookCall&) = delete;
+  HookCall& operator=(const HookCall&) = delete;
+
+  std::atomic<uint32>* calls_;
+  bool enabled_;
+};
+}  // namespace
+
 void GameMonitor::Draw() {
+  APM_PROBE(Draw);
+  HookCall call(&hookCalls_, hooksEnabled_);
+  if (!call.enabled()) {
+    return;
+  }
   BwFont backupFont = bw_.curFont;
 
+  UpdateUnitStats();
   DrawLocalTime();
   DrawGameTime();
   DrawApm();
 
   bw_.SetFont(backupFont);
+
+  if (gameLog_.isActive()) {
+    SampleGameLog();
+  }
 }
 
 void GameMonitor::RefreshScreen() {
+  APM_PROBE(RefreshScreen);
+  HookCall call(&hookCalls_, hooksEnabled_);
+  if (!call.enabled()) {
+    return;
+  }
   bw_.RefreshGameLayer();
 }
 
-const byte ACTION_TYPE_KEEPALIVE = 0x37;
-void GameMonitor::OnAction(byte actionType) {
-  if (bw_.activePlayerId >= apmCounter_.size() || actionType == ACTION_TYPE_KEEPALIVE) {
+void GameMonitor::OnAction(const byte* action) {
+  APM_PROBE(OnAction);
+  HookCall call(&hookCalls_, hooksEnabled_);
+  if (!call.enabled()) {
+    return;
+  }
+  const byte actionType = action[0];
+  if (bw_.activePlayerId >= totalActions_.size() || actionType == action::SYNC) {
     return;
   }
 
-  apmCounter_[bw_.activePlayerId] += 1;
+  std::atomic<uint32>& total = totalActions_[bw_.activePlayerId];
+  total.store(total.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  if (bw_.gameTimeTicks < lastActionTick_) {
+    RewindActionStats(bw_.gameTimeTicks);
+  }
+  lastActionTick_ = bw_.gameTimeTicks;
+  const uint8 player = static_cast<uint8>(bw_.activePlayerId);
+  hotkeys_.Consume(bw_.gameTimeTicks, player, action);
+  buildOrder_.Consume(bw_.gameTimeTicks, player, action);
+  heatmap_.Consume(bw_.gameTimeTicks, player, action);
+  if (gameLog_.isActive()) {
+    gameLog_.AddAction(bw_.gameTimeTicks, player, action);
+  }
+}
+
+// Called on the BW game loop thread when a replay has been rewound to tick, so that what comes
+// after it isn't counted twice. The build order can be cut back to tick, but the hotkey stats and
+// heatmaps only have totals, so they start over (and say so in their logs).
+void GameMonitor::RewindActionStats(uint32 tick) {
+  buildOrder_.Rewind(tick);
+  hotkeys_.Reset();
+  heatmap_.Clear();
+  actionStatsStartTick_ = tick;
 }
 
 bool GameMonitor::IsObsMode() {
@@ -222,25 +704,4 @@ bool GameMonitor::IsObserver(uint32 player) {
     (buildingsControlled <= 1 && population == 0);
 }
 
-char GameMonitor::PlayerColorToTextColor(uint8 playerColor) {
-  switch (playerColor) {
-    case 0x6F: return 0x08;
-    case 0xA5: return 0x0E;
-    case 0x9F: return 0x0F;
-    case 0xA4: return 0x10;
-    case 0x9C: return 0x11;
-    case 0x13: return 0x15;
-    case 0x54: return 0x16;
-    case 0x87: return 0x17;
-    case 0xB9: return 0x18;
-    case 0x88: return 0x19;
-    case 0x86: return 0x1B;
-    case 0x33: return 0x1C;
-    case 0x4D: return 0x1D;
-    case 0x9A: return 0x1E;
-    case 0x80: return 0x1F;
-    default: return 0x02;
-  }
-}
-
 } // namespace apm
\ No newline at end of file
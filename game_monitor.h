@@ -1,22 +1,67 @@
 #pragma once
 
-#include <Windows.h>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
 
 #include "./brood_war.h"
+#include "./apm_series.h"
+#include "./apm_tracker.h"
+#include "./build_order.h"
+#include "./game_arena.h"
+#include "./game_log.h"
+#include "./game_log_writer.h"
+#include "./heatmap.h"
+#include "./hotkey_stats.h"
+#include "./player_history.h"
+#include "./player_identity.h"
+#include "./resource_series.h"
+#include "./telemetry.h"
+#include "./time_format.h"
+#include "./triple_buffer.h"
 #include "./types.h"
-#include "./win_helpers.h"
+#include "./unit_stats.h"
+#include "./worker_thread.h"
 
 namespace apm {
 
-class GameMonitor : public sbat::WindowsThread {
+const size_t APM_GRAPH_POINTS = 60;
+
+// APM display state, computed on the GameMonitor thread and drawn on the BW game loop thread
+struct ApmResults {
+  bool obsMode;
+  uint32 myPlayerId;
+  // Formatted (text color coded) line for each player slot, empty if it shouldn't be displayed
+  std::array<std::array<char, 64>, 12> lines;
+  // The local player's APM over the last few minutes, not filled in obs mode
+  std::array<ApmGraphPoint, APM_GRAPH_POINTS> graph;
+  // APM at the top of the graph
+  int32 graphScale;
+  std::array<char, 16> graphLabel;
+};
+
+class GameMonitor : public sbat::WorkerThread {
 public:
-  explicit GameMonitor(BroodWar bw);
+  // If logDirectory is non-empty, a log of each game is written to it
+  explicit GameMonitor(BroodWar bw, std::string logDirectory = std::string());
   virtual ~GameMonitor();
 
   void Draw();
   void RefreshScreen();
-  void OnAction(byte actionType);
+  void OnAction(const byte* action);
+
+  // Runs one iteration of the monitor loop (game state transitions and APM calculation). Normally
+  // called on the GameMonitor thread, but headless drivers that never Start the thread can call it
+  // themselves to step the monitor deterministically.
+  void Update();
+  // Open the telemetry and (with a log directory) the player history and game log writer, and
+  // close them again, finishing the log of any game still running and writing out anything queued.
+  // Execute does this around its loop; headless drivers that want outputs do it around their
+  // Updates.
+  void OpenOutputs();
+  void CloseOutputs();
 
 protected:
   virtual void Execute();
@@ -26,31 +71,103 @@ private:
   GameMonitor(const GameMonitor&) = delete;
   GameMonitor& operator=(const GameMonitor&) = delete;
 
+  void EnableHooks();
+  void DisableHooks();
   void InitGameData();
+  void BeginGameLog();
+  void EndGameLog();
+  void WriteLogFile(const char* extension, const std::string& contents);
+  void SampleGameLog();
+  void LoadHistory();
+  void RecordHistory();
   void UpdateLocalTime();
   void DrawLocalTime();
   void UpdateGameTime();
   void DrawGameTime();
   void CalculateApm();
+  void RecordResources();
+  void PublishTelemetry(const ApmResults& results, const std::array<int32, 12>& apm);
   void DrawApm();
-  
+  void DrawApmGraph(const ApmResults& results);
+  void UpdateUnitStats();
+  void RewindActionStats(uint32 tick);
+
   bool IsObsMode();
   bool IsObserver(uint32 player);
-  char PlayerColorToTextColor(uint8 playerColor);
 
   BroodWar bw_;
+  // Number of game hook calls underway on the BW game loop thread, and whether they may touch the
+  // game data. DisableHooks clears hooksEnabled_, restores the hooks and waits for hookCalls_ to
+  // drop to 0; a call that was counted too late to be waited for sees hooksEnabled_ cleared and
+  // returns without doing anything.
+  std::atomic<uint32> hookCalls_;
+  std::atomic<bool> hooksEnabled_;
   // Access only on GameMonitor thread
   bool wasInGame_;
+  // Backs apm_'s journal and snapshots and resources_'s columns, reset at the start of each game.
+  // The rest of the per-game state is in fixed size members, reset one by one in InitGameData.
+  // What still uses the heap: the game log's blocks (they're handed off to the log writer thread),
+  // and the names and history updates done when a game starts or ends.
+  GameArena monitorArena_;
+  ApmTracker apm_;
+  // Value of totalActions_ at the last APM calculation
+  std::array<uint32, 12> countedActions_;
+  // Only created while the thread is running, so headless drivers don't publish anything
+  std::unique_ptr<TelemetryWriter> telemetry_;
+  uint32 gameId_;
+  PlayerIdentityTable players_;
+  ApmSeries apmSeries_;
+  ResourceSeries resources_;
+  std::unique_ptr<PlayerHistory> history_;
+  bool historyIsReplay_;
+  // Human players (the ones with a Storm ID) at the start of the game, and their history keys
+  uint32 historyPlayers_;
+  std::array<uint64, 12> historyKeys_;
+  // Average APM of each player over their earlier games, -1 if unknown
+  std::array<int32, 12> historicalApm_;
+  std::string logDirectory_;
+  std::unique_ptr<GameLogWriter> logWriter_;
+  uint64 logStartTime_;
+  std::array<std::string, 12> logPlayerNames_;
 
   // Acccess only on BW game loop thread
+  // Compiled in the constructor
+  TimeFormat localTimeFormat_;
+  TimeFormat gameTimeFormat_;
+  // Formatted clocks, including the color codes they're drawn with
   std::array<char, 128> cachedLocalTime_;
   uint64 localTimeValidUntil_;
   std::array<char, 128> cachedGameTime_;
   uint32 gameTimeValidUntil_;
+  uint32 nextLogSampleTick_;
 
-  std::array<double, 12> apmCounter_;
-  std::array<std::string, 12> apmStrings_;
-  uint32 apmCalcTime_;
+  // Written only on the BW game loop thread (with plain increments, since there's a single
+  // writer), read on the GameMonitor thread
+  std::array<std::atomic<uint32>, 12> totalActions_;
+  // Reset on the GameMonitor thread while the game hooks aren't injected, otherwise only accessed
+  // on the BW game loop thread (and on the GameMonitor thread after DisableHooks)
+  HotkeyAnalyzer hotkeys_;
+  // Tick of the last action, to notice a replay being rewound
+  uint32 lastActionTick_;
+  // Tick the hotkey stats and heatmaps start from: 0 normally, or the last point a replay was
+  // rewound to, since they can't be rewound and start over from there instead
+  uint32 actionStatsStartTick_;
+  UnitTableScanner units_;
+  // Game tick the unit table was last scanned on, so it's scanned once per tick rather than once
+  // per frame
+  uint32 unitsScanTick_;
+  // Army/worker/production summary for each player, drawn next to their line in obs mode
+  std::array<std::array<char, 48>, 12> unitStatsText_;
+  // Written on the GameMonitor thread, read on the BW game loop thread
+  TripleBuffer<ApmResults> apmResults_;
+  // Reset/begun/ended on the GameMonitor thread while the game hooks aren't injected, written to on
+  // the BW game loop thread in between. gameArena_ holds the per-game allocations of the rest, and
+  // is reset with them in InitGameData. The build order and heatmaps are collected whether or not
+  // the game is being logged.
+  GameArena gameArena_;
+  GameLogEncoder gameLog_;
+  BuildOrderExtractor buildOrder_;
+  ActionHeatmap heatmap_;
 };
 
 }  // namespace apm
\ No newline at end of file
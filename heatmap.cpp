@@ -0,0 +1,176 @@
+#include "./heatmap.h"
+
+#include <emmintrin.h>
+#include <algorithm>
+#include <array>
+#include <string>
+
+#include "./actions.h"
+#include "./game_arena.h"
+#include "./types.h"
+
+namespace apm {
+
+const uint32 PIXELS_PER_MAP_TILE = 32;
+// Halving 16 times leaves nothing
+const uint32 MAX_DECAY_SHIFT = 16;
+
+ActionHeatmap::ActionHeatmap(GameArena* arena)
+  : grids_(ArenaAllocator<Grid>(arena)),
+    gridIndex_() {
+  gridIndex_.fill(-1);
+}
+
+void ActionHeatmap::Reset(uint32 playerMask) {
+  int8 numGrids = 0;
+  for (size_t i = 0; i < gridIndex_.size(); i++) {
+    gridIndex_[i] = (playerMask & (1 << i)) != 0 ? numGrids++ : -1;
+  }
+  ResetArenaVector(&grids_);
+  // Zeroed, which is empty as of epoch 0
+  grids_.resize(numGrids);
+}
+
+void ActionHeatmap::Clear() {
+  // In place, since a Grid is too big to build a blank one on the stack
+  for (Grid& grid : grids_) {
+    for (Tile& tile : grid.tiles) {
+      tile.fill(0);
+    }
+    grid.epochs.fill(0);
+  }
+}
+
+void ActionHeatmap::Consume(uint32 tick, uint8 player, const byte* action) {
+  if (action[0] != action::RIGHT_CLICK && action[0] != action::TARGETED_ORDER) {
+    return;
+  }
+  // Both start with the target position in pixels
+  const uint32 x = action[1] | (action[2] << 8);
+  const uint32 y = action[3] | (action[4] << 8);
+  Add(tick, player, x / PIXELS_PER_MAP_TILE, y / PIXELS_PER_MAP_TILE);
+}
+
+// Loads a row of a tile's counters with each halved shift times. The counters are 16-bit, so a
+// 128-bit register holds a whole row.
+inline __m128i LoadTileRow(const uint16* cells, size_t row, __m128i shift) {
+  const __m128i values =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(cells + row * ActionHeatmap::TILE_SIZE));
+  return _mm_srl_epi16(values, shift);
+}
+
+void DecayTile(uint16* cells, uint32 shift) {
+  const __m128i count = _mm_cvtsi32_si128(static_cast<int>(shift));
+  for (size_t row = 0; row < ActionHeatmap::TILE_SIZE; row++) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(cells + row * ActionHeatmap::TILE_SIZE),
+        LoadTileRow(cells, row, count));
+  }
+}
+
+// Writes the average of each factor x factor block of the tile (after decaying it by shift) to
+// out, with outStride values between rows
+void DownsampleTile(const uint16* cells, uint32 shift, uint32 factor, uint16* out,
+    size_t outStride) {
+  const __m128i count = _mm_cvtsi32_si128(static_cast<int>(shift));
+  const __m128i zero = _mm_setzero_si128();
+  const uint32 blocksPerRow = ActionHeatmap::TILE_SIZE / factor;
+  uint32 blockShift = 0;
+  while ((1u << blockShift) < factor * factor) {
+    blockShift++;
+  }
+
+  for (uint32 blockRow = 0; blockRow < blocksPerRow; blockRow++) {
+    // Sum the block's rows, widened to 32 bits so they can't overflow
+    __m128i left = zero;
+    __m128i right = zero;
+    for (uint32 i = 0; i < factor; i++) {
+      const __m128i row = LoadTileRow(cells, blockRow * factor + i, count);
+      left = _mm_add_epi32(left, _mm_unpacklo_epi16(row, zero));
+      right = _mm_add_epi32(right, _mm_unpackhi_epi16(row, zero));
+    }
+    uint32 sums[ActionHeatmap::TILE_SIZE];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sums), left);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sums + 4), right);
+
+    uint16* outRow = out + blockRow * outStride;
+    for (uint32 block = 0; block < blocksPerRow; block++) {
+      uint32 total = 0;
+      for (uint32 i = 0; i < factor; i++) {
+        total += sums[block * factor + i];
+      }
+      outRow[block] = static_cast<uint16>(total >> blockShift);
+    }
+  }
+}
+
+void ActionHeatmap::Add(uint32 tick, uint8 player, uint32 x, uint32 y) {
+  if (x >= GRID_SIZE || y >= GRID_SIZE || !hasGrid(player)) {
+    return;
+  }
+
+  Grid& grid = grids_[gridIndex_[player]];
+  const size_t index = (y / TILE_SIZE) * TILES_PER_ROW + x / TILE_SIZE;
+  const uint32 epoch = tick / DECAY_TICKS;
+  // Ticks going backwards (from a replay being rewound) just leave the heat as it was
+  if (epoch > grid.epochs[index]) {
+    DecayTile(grid.tiles[index].data(), std::min(epoch - grid.epochs[index], MAX_DECAY_SHIFT));
+    grid.epochs[index] = epoch;
+  }
+  uint16& cell = grid.tiles[index][(y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE];
+  cell = static_cast<uint16>(std::min<uint32>(cell + HEAT_PER_ACTION, 0xFFFF));
+}
+
+void ActionHeatmap::Export(uint8 player, uint32 tick, uint32 factor, uint16* out) const {
+  const uint32 outSize = GRID_SIZE / factor;
+  if (!hasGrid(player)) {
+    std::fill(out, out + outSize * outSize, 0);
+    return;
+  }
+
+  const uint32 epoch = tick / DECAY_TICKS;
+  const uint32 outTileSize = TILE_SIZE / factor;
+  const Grid& grid = grids_[gridIndex_[player]];
+  for (uint32 tileY = 0; tileY < TILES_PER_ROW; tileY++) {
+    for (uint32 tileX = 0; tileX < TILES_PER_ROW; tileX++) {
+      const size_t index = tileY * TILES_PER_ROW + tileX;
+      const uint32 shift =
+          epoch > grid.epochs[index] ? std::min(epoch - grid.epochs[index], MAX_DECAY_SHIFT) : 0;
+      DownsampleTile(grid.tiles[index].data(), shift, factor,
+          out + (tileY * outTileSize) * outSize + tileX * outTileSize, outSize);
+    }
+  }
+}
+
+std::string FormatHeatmap(const uint16* grid, uint32 size) {
+  static const char LEVELS[] = " .:-=+*#%@";
+  const uint32 numLevels = sizeof(LEVELS) - 1;
+
+  uint16 hottest = 0;
+  uint32 width = 0;
+  uint32 height = 0;
+  for (uint32 y = 0; y < size; y++) {
+    for (uint32 x = 0; x < size; x++) {
+      const uint16 value = grid[y * size + x];
+      if (value != 0) {
+        hottest = std::max(hottest, value);
+        width = std::max(width, x + 1);
+        height = y + 1;
+      }
+    }
+  }
+
+  std::string result;
+  result.reserve((width + 1) * height);
+  for (uint32 y = 0; y < height; y++) {
+    for (uint32 x = 0; x < width; x++) {
+      const uint32 value = grid[y * size + x];
+      // Anything with heat at all gets at least the first non-blank level
+      const uint32 level = value == 0 ? 0 : 1 + (value * (numLevels - 1) - 1) / hottest;
+      result += LEVELS[std::min(level, numLevels - 1)];
+    }
+    result += '\n';
+  }
+  return result;
+}
+
+}  // namespace apm
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <string>
+
+#include "./game_arena.h"
+#include "./types.h"
+
+namespace apm {
+
+// Per-player heatmaps of where on the map players right click and issue targeted orders, at map
+// tile resolution. Each player's grid is split into TILE_SIZE x TILE_SIZE tiles of saturating
+// 16-bit counters stored contiguously (128 bytes per tile), and heat halves every DECAY_TICKS.
+// The decay is applied lazily, to a whole tile at a time when it's next added to and on the fly
+// when exporting, so adding never touches more than one tile.
+class ActionHeatmap {
+public:
+  // In map tiles, which covers the largest maps
+  static const uint32 GRID_SIZE = 256;
+  static const uint32 TILE_SIZE = 8;
+  static const uint32 TILES_PER_ROW = GRID_SIZE / TILE_SIZE;
+  static const uint16 HEAT_PER_ACTION = 256;
+  // ~30 seconds
+  static const uint32 DECAY_TICKS = 714;
+
+  // See ArenaAllocator for how arena is used
+  explicit ActionHeatmap(GameArena* arena = nullptr);
+
+  // Clears the heatmaps and sets up grids for the players in playerMask (bit i for player i).
+  // Allocates, so it should be done before the game starts rather than as actions come in.
+  void Reset(uint32 playerMask);
+  // Empties every grid, keeping the same players. Doesn't allocate, so it can be used as actions
+  // come in (e.g. when a replay is rewound, since the heat can't be taken back out).
+  void Clear();
+  // Takes an action as passed to BW's action handler (type byte first)
+  void Consume(uint32 tick, uint8 player, const byte* action);
+  // Adds heat at a map tile
+  void Add(uint32 tick, uint8 player, uint32 x, uint32 y);
+
+  bool hasGrid(uint8 player) const { return player < gridIndex_.size() && gridIndex_[player] >= 0; }
+  // Writes player's heatmap as of tick, averaged down by factor (1, 2, 4 or 8) in each dimension,
+  // to out, which must have room for (GRID_SIZE / factor)^2 values (stored row by row)
+  void Export(uint8 player, uint32 tick, uint32 factor, uint16* out) const;
+
+private:
+  static const uint32 NUM_TILES = TILES_PER_ROW * TILES_PER_ROW;
+  typedef std::array<uint16, TILE_SIZE * TILE_SIZE> Tile;
+
+  struct Grid {
+    std::array<Tile, NUM_TILES> tiles;
+    // Decay epoch (tick / DECAY_TICKS) that each tile's counters are current as of, kept apart
+    // from the counters so the tiles stay densely packed
+    std::array<uint32, NUM_TILES> epochs;
+  };
+
+  ArenaVector<Grid> grids_;
+  // Index into grids_ of each player's grid, -1 for players without one
+  std::array<int8, 12> gridIndex_;
+};
+
+// Renders a heatmap (as exported, size x size values) as rows of characters from ' ' (no heat) to
+// '@' (the hottest cell), leaving off empty rows and columns at the right and bottom
+std::string FormatHeatmap(const uint16* grid, uint32 size);
+
+}  // namespace apm
@@ -0,0 +1,76 @@
+#include "./hot_patch_caves.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <set>
+
+#include "./types.h"
+
+namespace sbat {
+
+const uint32 HotPatchCaves::kCaveSize;
+
+// Functions start 16 byte aligned, so the int3 padding in front of one is a run that ends on a 16
+// byte boundary. Requiring that (rather than just any 0xCC bytes) rules out immediates and
+// displacements that happen to contain 0xCCCCCCCC.
+const uintptr_t kFunctionAlignment = 16;
+
+bool IsPadding(const byte* start, uint32 size) {
+  if (!std::all_of(start, start + size, [](byte b) { return b == 0xCC; })) {
+    return false;
+  }
+  const byte* end = start + size;
+  while (reinterpret_cast<uintptr_t>(end) % kFunctionAlignment != 0) {
+    if (*end != 0xCC) {
+      return false;
+    }
+    end++;
+  }
+  return true;
+}
+
+HotPatchCaves::HotPatchCaves()
+  : claimed_() {
+}
+
+byte* HotPatchCaves::Claim(byte* hook_location, uint32 hook_size) {
+  byte* jump_end = hook_location + 2;
+  // short jumps reach -128 to +127 bytes from the end of the jump
+  for (int32 offset = -128; offset <= 127; offset++) {
+    byte* cave = jump_end + offset;
+    if (cave + kCaveSize > hook_location && cave < hook_location + hook_size) {
+      continue;  // overlaps the instruction we're replacing
+    }
+    // claimed caves are kept by their start, so any that overlaps this one starts within its size
+    auto claimed = claimed_.lower_bound(cave - (kCaveSize - 1));
+    if (claimed != claimed_.end() && *claimed < cave + kCaveSize) {
+      continue;
+    }
+    if (IsPadding(cave, kCaveSize)) {
+      claimed_.insert(cave);
+      return cave;
+    }
+  }
+
+  return nullptr;
+}
+
+bool CanHotPatch(const byte* hook_location, uint32 instruction_size) {
+  return instruction_size >= 2 && (reinterpret_cast<uintptr_t>(hook_location) % 64) != 63;
+}
+
+void ExchangeHotPatch(byte* hook_location, const byte* bytes) {
+  int16_t value;
+  memcpy(&value, bytes, sizeof(value));
+#ifdef _MSC_VER
+  _InterlockedExchange16(reinterpret_cast<short volatile*>(hook_location), value);
+#else
+  __atomic_exchange_n(reinterpret_cast<int16_t*>(hook_location), value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+}  // namespace sbat
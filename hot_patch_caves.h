@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <set>
+
+#include "./types.h"
+
+namespace sbat {
+// Hands out runs of int3 padding (as compilers emit between functions) for hot patched hooks to
+// put their long jump in. Padding is never executed, so the jump can be written there at any time
+// without racing the hooked thread. A cave is never handed out twice, since its jump stays once
+// written. Not thread safe.
+class HotPatchCaves {
+public:
+  static const uint32 kCaveSize = 5;
+
+  HotPatchCaves();
+
+  // Finds and claims a cave that can hold a 5 byte jump, is reachable by a short jump placed at
+  // hook_location and doesn't overlap the hook_size bytes being replaced there. Reads the 128 bytes
+  // on either side of hook_location (and up to the next 16 byte boundary past them). Returns
+  // nullptr if there isn't one.
+  byte* Claim(byte* hook_location, uint32 hook_size);
+
+  size_t size() const { return claimed_.size(); }
+
+private:
+  // Disable copying
+  HotPatchCaves(const HotPatchCaves&) = delete;
+  HotPatchCaves& operator=(const HotPatchCaves&) = delete;
+
+  // Claimed caves, by their first byte
+  std::set<byte*> claimed_;
+};
+
+// The short jump has to be written with a single atomic store and cover exactly one instruction, so
+// that no thread can ever observe (or be executing in the middle of) a partially written hook.
+// Locked 16-bit writes are atomic as long as they don't straddle a cache line.
+bool CanHotPatch(const byte* hook_location, uint32 instruction_size);
+
+// Swaps the 2 bytes at hook_location (which must be writable and pass CanHotPatch) for bytes, in
+// one locked write. A thread running through hook_location executes either the old or the new
+// bytes, never a mix of them.
+void ExchangeHotPatch(byte* hook_location, const byte* bytes);
+
+}  // namespace sbat
@@ -0,0 +1,225 @@
+#include "./hotkey_stats.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "./actions.h"
+#include "./game_log.h"
+#include "./types.h"
+
+namespace apm {
+
+using std::string;
+using std::vector;
+
+void PlayerHotkeyStats::Merge(const PlayerHotkeyStats& other) {
+  selects += other.selects;
+  shiftSelects += other.shiftSelects;
+  shiftDeselects += other.shiftDeselects;
+  selectedUnits += other.selectedUnits;
+  for (size_t i = 0; i < selectionSizes.size(); i++) {
+    selectionSizes[i] += other.selectionSizes[i];
+  }
+  for (size_t i = 0; i < NUM_HOTKEYS; i++) {
+    assigns[i] += other.assigns[i];
+    adds[i] += other.adds[i];
+    recalls[i] += other.recalls[i];
+    for (size_t j = 0; j < HOTKEY_INTERVAL_BUCKETS; j++) {
+      recallIntervals[i][j] += other.recallIntervals[i][j];
+    }
+  }
+}
+
+uint32 PlayerHotkeyStats::totalRecalls() const {
+  uint32 total = 0;
+  for (uint32 count : recalls) {
+    total += count;
+  }
+  return total;
+}
+
+HotkeyAnalyzer::HotkeyAnalyzer()
+  : stats_(),
+    lastRecall_() {
+  Reset();
+}
+
+void HotkeyAnalyzer::Reset() {
+  stats_.fill(PlayerHotkeyStats());
+  for (auto& player : lastRecall_) {
+    player.fill(0xFFFFFFFF);
+  }
+}
+
+uint32 IntervalBucket(uint32 ticks) {
+  uint32 bucket = 0;
+  while (ticks > 1 && bucket < HOTKEY_INTERVAL_BUCKETS - 1) {
+    ticks >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+void HotkeyAnalyzer::Consume(uint32 tick, uint8 player, const byte* action) {
+  if (player >= stats_.size()) {
+    return;
+  }
+
+  PlayerHotkeyStats& stats = stats_[player];
+  switch (action[0]) {
+    case action::SELECT: {
+      const uint32 count = std::min<uint32>(action[1], 12);
+      stats.selects++;
+      stats.selectedUnits += count;
+      stats.selectionSizes[count]++;
+      break;
+    }
+    case action::SHIFT_SELECT:
+      stats.shiftSelects++;
+      break;
+    case action::SHIFT_DESELECT:
+      stats.shiftDeselects++;
+      break;
+    case action::HOTKEY: {
+      const byte group = action[2];
+      if (group >= NUM_HOTKEYS) {
+        break;
+      }
+      if (action[1] == action::HOTKEY_ASSIGN) {
+        stats.assigns[group]++;
+      } else if (action[1] == action::HOTKEY_ADD) {
+        stats.adds[group]++;
+      } else if (action[1] == action::HOTKEY_SELECT) {
+        stats.recalls[group]++;
+        uint32& lastRecall = lastRecall_[player][group];
+        if (lastRecall != 0xFFFFFFFF && tick >= lastRecall) {
+          stats.recallIntervals[group][IntervalBucket(tick - lastRecall)]++;
+        }
+        lastRecall = tick;
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+string FormatHotkeyStats(const PlayerHotkeyStats& stats) {
+  string result;
+  char line[256];
+  const double averageSelection =
+      stats.selects != 0 ? static_cast<double>(stats.selectedUnits) / stats.selects : 0;
+  snprintf(line, sizeof(line),
+      "Selections: %u (avg %.1f units), shift-select: %u, shift-deselect: %u\n",
+      stats.selects, averageSelection, stats.shiftSelects, stats.shiftDeselects);
+  result += line;
+
+  for (size_t i = 0; i < NUM_HOTKEYS; i++) {
+    if (stats.assigns[i] == 0 && stats.adds[i] == 0 && stats.recalls[i] == 0) {
+      continue;
+    }
+    // Find the median recall interval bucket
+    uint32 intervals = 0;
+    for (uint32 count : stats.recallIntervals[i]) {
+      intervals += count;
+    }
+    uint32 seen = 0;
+    size_t medianBucket = 0;
+    for (; medianBucket < HOTKEY_INTERVAL_BUCKETS; medianBucket++) {
+      seen += stats.recallIntervals[i][medianBucket];
+      if (seen * 2 > intervals) {
+        break;
+      }
+    }
+    snprintf(line, sizeof(line), "Hotkey %zu: assigned %u, added %u, recalled %u", i,
+        stats.assigns[i], stats.adds[i], stats.recalls[i]);
+    result += line;
+    if (intervals != 0) {
+      snprintf(line, sizeof(line), " (typically every %u-%u ticks)",
+          medianBucket == 0 ? 0 : 1u << medianBucket, (1u << (medianBucket + 1)) - 1);
+      result += line;
+    }
+    result += "\n";
+  }
+  return result;
+}
+
+namespace {
+
+// Returns true if the log was read fully
+bool AnalyzeLog(const GameLogData& log, HotkeyAnalyzer* analyzer, HotkeyStatsByPlayer* result) {
+  analyzer->Reset();
+  GameLogDecoder decoder(log.data, log.size);
+  GameLogHeader header;
+  if (decoder.ReadHeader(&header) != GameLogDecoder::Result::Ok) {
+    return false;
+  }
+
+  GameLogEvent event;
+  GameLogDecoder::Result decodeResult;
+  while ((decodeResult = decoder.Next(&event)) == GameLogDecoder::Result::Ok) {
+    if (event.type == GameLogEvent::Type::Action &&
+        event.actionLength == GetActionLength(event.actionData)) {
+      analyzer->Consume(event.tick, event.player, event.actionData);
+    } else if (event.type == GameLogEvent::Type::Seek) {
+      // The stats are only totals, so after a rewind they start over from where the replay went
+      // back to, as they do in the overlay
+      analyzer->Reset();
+    }
+  }
+
+  for (size_t i = 0; i < header.playerNames.size(); i++) {
+    if (!header.playerNames[i].empty()) {
+      (*result)[header.playerNames[i]].Merge(analyzer->stats(i));
+    }
+  }
+  return decodeResult == GameLogDecoder::Result::Done;
+}
+
+}  // namespace
+
+size_t AggregateHotkeyStats(const vector<GameLogData>& logs, uint32 numThreads,
+    HotkeyStatsByPlayer* result) {
+  numThreads = std::max(1u, std::min(numThreads, static_cast<uint32>(logs.size())));
+  vector<HotkeyStatsByPlayer> threadResults(numThreads);
+  std::atomic<size_t> nextLog(0);
+  std::atomic<size_t> completeLogs(0);
+
+  auto work = [&](uint32 threadIndex) {
+    // Analyzers are ~10KB, so keep one per thread rather than one per game
+    HotkeyAnalyzer analyzer;
+    for (;;) {
+      const size_t index = nextLog.fetch_add(1, std::memory_order_relaxed);
+      if (index >= logs.size()) {
+        break;
+      }
+      if (AnalyzeLog(logs[index], &analyzer, &threadResults[threadIndex])) {
+        completeLogs.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  };
+
+  vector<std::thread> threads;
+  for (uint32 i = 1; i < numThreads; i++) {
+    threads.emplace_back(work, i);
+  }
+  work(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (const auto& threadResult : threadResults) {
+    for (const auto& entry : threadResult) {
+      (*result)[entry.first].Merge(entry.second);
+    }
+  }
+  return completeLogs.load();
+}
+
+}  // namespace apm
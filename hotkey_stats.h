@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "./types.h"
+
+namespace apm {
+
+const size_t NUM_HOTKEYS = 10;
+// Histogram buckets for the time between recalls of a hotkey, bucket i covering
+// [2^i, 2^(i+1)) ticks (bucket 0 also covers 0), with the last bucket open ended
+const size_t HOTKEY_INTERVAL_BUCKETS = 16;
+
+// Fixed size selection/hotkey usage counters for a single player, mergeable across games
+struct PlayerHotkeyStats {
+  uint32 selects;
+  uint32 shiftSelects;
+  uint32 shiftDeselects;
+  // Total units in plain selections, for the average selection size
+  uint64 selectedUnits;
+  // Number of plain selections of each size (12 is the most BW allows)
+  std::array<uint32, 13> selectionSizes;
+
+  std::array<uint32, NUM_HOTKEYS> assigns;
+  std::array<uint32, NUM_HOTKEYS> adds;
+  std::array<uint32, NUM_HOTKEYS> recalls;
+  std::array<std::array<uint32, HOTKEY_INTERVAL_BUCKETS>, NUM_HOTKEYS> recallIntervals;
+
+  void Merge(const PlayerHotkeyStats& other);
+  uint32 totalRecalls() const;
+};
+
+// Streaming analyzer of selection and hotkey actions. Consuming an action is a switch on its type
+// plus a few counter updates, without any allocation, so it's cheap enough to run on every action
+// in the game's action hook.
+class HotkeyAnalyzer {
+public:
+  HotkeyAnalyzer();
+
+  void Reset();
+  // Takes an action as passed to BW's action handler (type byte first)
+  void Consume(uint32 tick, uint8 player, const byte* action);
+
+  const PlayerHotkeyStats& stats(size_t player) const { return stats_[player]; }
+
+private:
+  std::array<PlayerHotkeyStats, 12> stats_;
+  // Tick of each player's last recall of each hotkey, 0xFFFFFFFF if none yet
+  std::array<std::array<uint32, NUM_HOTKEYS>, 12> lastRecall_;
+};
+
+// Renders a human readable summary of stats
+std::string FormatHotkeyStats(const PlayerHotkeyStats& stats);
+
+// Stats per player name, merged across games
+using HotkeyStatsByPlayer = std::map<std::string, PlayerHotkeyStats>;
+
+struct GameLogData {
+  const byte* data;
+  size_t size;
+};
+
+// Analyzes a set of recorded game logs (see game_log.h) on numThreads threads, merging the stats
+// of each player across all of the games they played in. Corrupt or truncated logs contribute what
+// could be read of them. Returns the number of logs that were read fully.
+size_t AggregateHotkeyStats(const std::vector<GameLogData>& logs, uint32 numThreads,
+    HotkeyStatsByPlayer* result);
+
+}  // namespace apm
@@ -0,0 +1,394 @@
+#include "./inline_hook.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include <assert.h>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "./deps/udis86/udis86.h"
+#include "./types.h"
+#ifdef _WIN32
+#include "./win_helpers.h"
+#endif
+
+namespace sbat {
+
+// Signed distance from one address to another, wrapping around the address space the way relative
+// jumps do
+int64 Distance(uintptr_t from, uintptr_t to) {
+  return static_cast<int64>(static_cast<intptr_t>(to - from));
+}
+
+bool FitsRel32(int64 offset) {
+  return offset >= INT32_MIN && offset <= INT32_MAX;
+}
+
+uint32 JumpSize(const byte* location, const void* target) {
+  const int64 offset = Distance(reinterpret_cast<uintptr_t>(location) + 5,
+      reinterpret_cast<uintptr_t>(target));
+  return FitsRel32(offset) ? 5 : kMaxJumpSize;
+}
+
+uint32 WriteJump(const byte* location, const void* target, byte* output) {
+  const uint32 size = JumpSize(location, target);
+  if (size == 5) {
+    const int32 offset = static_cast<int32>(Distance(reinterpret_cast<uintptr_t>(location) + 5,
+        reinterpret_cast<uintptr_t>(target)));
+    output[0] = 0xE9;  // relative jmp
+    memcpy(&output[1], &offset, sizeof(offset));
+    return size;
+  }
+
+  // only 64-bit code has targets out of reach
+  assert(sizeof(void*) == 8);
+  const uint64 address = reinterpret_cast<uintptr_t>(target);
+  output[0] = 0xFF;  // jmp [rip+0], with the target directly following the instruction
+  output[1] = 0x25;
+  memset(&output[2], 0, 4);
+  memcpy(&output[6], &address, sizeof(address));
+  return size;
+}
+
+// Instructions are at most 15 bytes, and the last one measured starts within the first
+// kMaxJumpSize bytes, so nothing past this is ever decoded
+const uint32 kMaxDecodedSize = kMaxJumpSize + 15;
+
+void InitDisassembler(ud_t* udis, const byte* code) {
+  ud_init(udis);
+  ud_set_mode(udis, sizeof(void*) * 8);
+  ud_set_syntax(udis, nullptr);  // we don't care about readable output!
+  ud_set_input_buffer(udis, code, kMaxDecodedSize);
+  ud_set_pc(udis, reinterpret_cast<uintptr_t>(code));
+}
+
+// Returns the offset operand of the relative jump or call just disassembled, or nullptr if it isn't
+// one (including jumps and calls through registers or memory, which can be copied as is)
+const ud_operand_t* GetRelativeOperand(const ud_t& udis) {
+  switch (udis.mnemonic) {
+    case UD_Ijo:
+    case UD_Ijno:
+    case UD_Ijb:
+    case UD_Ijae:
+    case UD_Ijz:
+    case UD_Ijnz:
+    case UD_Ijbe:
+    case UD_Ija:
+    case UD_Ijs:
+    case UD_Ijns:
+    case UD_Ijp:
+    case UD_Ijnp:
+    case UD_Ijl:
+    case UD_Ijge:
+    case UD_Ijle:
+    case UD_Ijg:
+    case UD_Ijmp:
+    case UD_Icall: {
+      const ud_operand_t* operand = ud_insn_opr(&udis, 0);
+      return operand != nullptr && operand->type == UD_OP_JIMM ? operand : nullptr;
+    }
+    default:
+      return nullptr;
+  }
+}
+
+int64 GetRelativeOffset(const ud_operand_t& operand) {
+  switch (operand.size) {
+    case 8: return operand.lval.sbyte;
+    case 16: return operand.lval.sword;
+    case 32: return operand.lval.sdword;
+    default:
+      // a jump/call relative offset should never exceed 32 bits
+      assert(false);
+      return 0;
+  }
+}
+
+bool CanRelocate(const ud_t& udis) {
+  switch (udis.mnemonic) {
+    case UD_Iinvalid:
+    // these only come with 8-bit offsets, so there's no longer form to rewrite them as
+    case UD_Ijcxz:
+    case UD_Ijecxz:
+    case UD_Ijrcxz:
+    case UD_Iloop:
+    case UD_Iloope:
+    case UD_Iloopne:
+      return false;
+    default:
+      break;
+  }
+  for (unsigned int i = 0; ud_insn_opr(&udis, i) != nullptr; i++) {
+    if (ud_insn_opr(&udis, i)->base == UD_R_RIP) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint32 GetRelocatedLength(const ud_t& udis) {
+  if (GetRelativeOperand(udis) == nullptr) {
+    return ud_insn_len(&udis);
+  }
+  return udis.mnemonic == UD_Ijmp || udis.mnemonic == UD_Icall ?
+      5 :  // XX YY YY YY YY
+      6;  // 0F XX YY YY YY YY
+}
+
+// Address the relative jump or call just disassembled goes to
+uintptr_t GetRelativeTarget(const ud_t& udis, const ud_operand_t& operand) {
+  return static_cast<uintptr_t>(ud_insn_off(&udis) + ud_insn_len(&udis) +
+      GetRelativeOffset(operand));
+}
+
+bool MeasureInstructions(const byte* code, uint32 min_size, uint32* size, uint32* relocated_size) {
+  ud_t udis;
+  InitDisassembler(&udis, code);
+  uint32 measured = 0;
+  uint32 relocated = 0;
+  while (measured < min_size) {
+    const uint32 length = ud_disassemble(&udis);
+    if (length == 0 || !CanRelocate(udis)) {
+      return false;
+    }
+    measured += length;
+    relocated += GetRelocatedLength(udis);
+  }
+
+  // A jump into the middle of the replaced instructions would land inside the hook's jump instead
+  const uintptr_t start = reinterpret_cast<uintptr_t>(code);
+  InitDisassembler(&udis, code);
+  for (uint32 i = 0; i < measured; ) {
+    i += ud_disassemble(&udis);
+    const ud_operand_t* operand = GetRelativeOperand(udis);
+    if (operand != nullptr) {
+      const uintptr_t target = GetRelativeTarget(udis, *operand);
+      if (target > start && target < start + measured) {
+        return false;
+      }
+    }
+  }
+
+  *size = measured;
+  *relocated_size = relocated;
+  return true;
+}
+
+bool RelocateInstructions(const byte* code, uint32 size, byte* output, uint32 relocated_size) {
+  ud_t udis;
+  InitDisassembler(&udis, code);
+  uint32 i = 0;
+  uint32 pos = 0;
+  while (i < size) {
+    const uint32 length = ud_disassemble(&udis);
+    assert(length != 0);
+    const ud_operand_t* operand = GetRelativeOperand(udis);
+    if (operand == nullptr) {
+      // not a relative instruction, no correction needed
+      assert(pos + length <= relocated_size);
+      memcpy(&output[pos], &code[i], length);
+      pos += length;
+      i += length;
+      continue;
+    }
+
+    const uint32 new_length = GetRelocatedLength(udis);
+    assert(pos + new_length <= relocated_size);
+    const int64 new_offset = Distance(reinterpret_cast<uintptr_t>(&output[pos]) + new_length,
+        GetRelativeTarget(udis, *operand));
+    if (!FitsRel32(new_offset)) {
+      return false;
+    }
+    // write the new opcode
+    switch (udis.mnemonic) {
+      case UD_Ijo: output[pos++] = 0x0F; output[pos++] = 0x80; break;
+      case UD_Ijno: output[pos++] = 0x0F; output[pos++] = 0x81; break;
+      case UD_Ijb: output[pos++] = 0x0F; output[pos++] = 0x82; break;
+      case UD_Ijae: output[pos++] = 0x0F; output[pos++] = 0x83; break;
+      case UD_Ijz: output[pos++] = 0x0F; output[pos++] = 0x84; break;
+      case UD_Ijnz: output[pos++] = 0x0F; output[pos++] = 0x85; break;
+      case UD_Ijbe: output[pos++] = 0x0F; output[pos++] = 0x86; break;
+      case UD_Ija: output[pos++] = 0x0F; output[pos++] = 0x87; break;
+      case UD_Ijs: output[pos++] = 0x0F; output[pos++] = 0x88; break;
+      case UD_Ijns: output[pos++] = 0x0F; output[pos++] = 0x89; break;
+      case UD_Ijp: output[pos++] = 0x0F; output[pos++] = 0x8A; break;
+      case UD_Ijnp: output[pos++] = 0x0F; output[pos++] = 0x8B; break;
+      case UD_Ijl: output[pos++] = 0x0F; output[pos++] = 0x8C; break;
+      case UD_Ijge: output[pos++] = 0x0F; output[pos++] = 0x8D; break;
+      case UD_Ijle: output[pos++] = 0x0F; output[pos++] = 0x8E; break;
+      case UD_Ijg: output[pos++] = 0x0F; output[pos++] = 0x8F; break;
+      case UD_Ijmp: output[pos++] = 0xE9; break;
+      case UD_Icall: output[pos++] = 0xE8; break;
+      default:
+        assert(false);  // GetRelativeOperand only returns operands of the above
+        return false;
+    }
+    const int32 offset = static_cast<int32>(new_offset);
+    memcpy(&output[pos], &offset, sizeof(offset));
+    pos += sizeof(offset);
+    i += length;
+  }
+  // they only differ if size and relocated_size didn't come from MeasureInstructions
+  assert(pos == relocated_size);
+  return pos == relocated_size;
+}
+
+// Far enough to find free space in most address spaces, and close enough that anything in the
+// allocation can still reach (and be reached from) anything near nearby
+const uintptr_t kNearbyRange = 0x40000000;
+// Windows' allocation granularity, which is also a reasonable step for mmap hints
+const uintptr_t kAllocationStep = 0x10000;
+
+#ifdef _WIN32
+byte* AllocateAt(uintptr_t address, size_t size) {
+  return static_cast<byte*>(VirtualAlloc(reinterpret_cast<void*>(address), size,
+      MEM_RESERVE | MEM_COMMIT, PAGE_EXECUTE_READWRITE));
+}
+
+void FreeExecutable(byte* memory, size_t) {
+  VirtualFree(memory, 0, MEM_RELEASE);
+}
+#else
+// mmap only takes the address as a hint, so this can return memory anywhere
+byte* AllocateAt(uintptr_t address, size_t size) {
+  void* memory = mmap(reinterpret_cast<void*>(address), size, PROT_READ | PROT_WRITE | PROT_EXEC,
+      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return memory != MAP_FAILED ? static_cast<byte*>(memory) : nullptr;
+}
+
+void FreeExecutable(byte* memory, size_t size) {
+  munmap(memory, size);
+}
+#endif
+
+// Returns memory allocated at (or with mmap, near) address if it's within kNearbyRange of center
+byte* AllocateNear(uintptr_t address, uintptr_t center, size_t size) {
+  byte* memory = AllocateAt(address, size);
+  if (memory == nullptr) {
+    return nullptr;
+  }
+  const int64 distance = Distance(center, reinterpret_cast<uintptr_t>(memory));
+  if (distance > -static_cast<int64>(kNearbyRange) && distance < static_cast<int64>(kNearbyRange)) {
+    return memory;
+  }
+  FreeExecutable(memory, size);
+  return nullptr;
+}
+
+byte* AllocateExecutable(size_t size, const void* nearby) {
+  if (sizeof(void*) == 4 || nearby == nullptr) {
+    return AllocateAt(0, size);
+  }
+
+  // search outwards from nearby, trying below it first and then above it at each distance
+  const uintptr_t center = reinterpret_cast<uintptr_t>(nearby) & ~(kAllocationStep - 1);
+  for (uintptr_t distance = kAllocationStep; distance < kNearbyRange; distance += kAllocationStep) {
+    byte* memory = nullptr;
+    if (center > distance) {
+      memory = AllocateNear(center - distance, center, size);
+    }
+    if (memory == nullptr && center + distance > center) {
+      memory = AllocateNear(center + distance, center, size);
+    }
+    if (memory != nullptr) {
+      return memory;
+    }
+  }
+  return AllocateAt(0, size);
+}
+
+bool WriteCode(byte* location, const byte* bytes, size_t size) {
+#ifdef _WIN32
+  ScopedVirtualProtect protect(location, size, PAGE_EXECUTE_READWRITE);
+  if (protect.hasErrors()) {
+    return false;
+  }
+  memcpy(location, bytes, size);
+  FlushInstructionCache(GetCurrentProcess(), location, size);
+#else
+  const uintptr_t page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  const uintptr_t start = reinterpret_cast<uintptr_t>(location) & ~(page_size - 1);
+  const size_t length = reinterpret_cast<uintptr_t>(location) + size - start;
+  void* pages = reinterpret_cast<void*>(start);
+  if (mprotect(pages, length, PROT_READ | PROT_WRITE | PROT_EXEC) != 0) {
+    return false;
+  }
+  memcpy(location, bytes, size);
+  mprotect(pages, length, PROT_READ | PROT_EXEC);
+  __builtin___clear_cache(reinterpret_cast<char*>(location),
+      reinterpret_cast<char*>(location + size));
+#endif
+  return true;
+}
+
+InlineHook::InlineHook(byte* function, const void* hook)
+  : function_(function),
+    original_(),
+    hooked_(),
+    trampoline_(nullptr),
+    trampoline_size_(0),
+    injected_(false) {
+  assert(function_ != nullptr);
+  assert(hook != nullptr);
+
+  uint32 size;
+  uint32 relocated_size;
+  if (!MeasureInstructions(function_, JumpSize(function_, hook), &size, &relocated_size)) {
+    return;
+  }
+  trampoline_size_ = relocated_size + kMaxJumpSize;
+  trampoline_ = AllocateExecutable(trampoline_size_, function_);
+  if (trampoline_ == nullptr) {
+    return;
+  }
+  if (!RelocateInstructions(function_, size, trampoline_, relocated_size)) {
+    FreeExecutable(trampoline_, trampoline_size_);
+    trampoline_ = nullptr;
+    return;
+  }
+  // continue with the rest of the function after the relocated instructions
+  WriteJump(&trampoline_[relocated_size], function_ + size, &trampoline_[relocated_size]);
+
+  original_.assign(function_, function_ + size);
+  // fill with NOPs to account for extra bytes (never executed, the jump covers whole instructions)
+  hooked_.assign(size, 0x90);
+  WriteJump(function_, hook, hooked_.data());
+}
+
+InlineHook::~InlineHook() {
+  if (injected_) {
+    Restore();
+  }
+  if (trampoline_ != nullptr) {
+    FreeExecutable(trampoline_, trampoline_size_);
+  }
+}
+
+bool InlineHook::Inject() {
+  if (injected_ || !isValid()) {
+    return false;
+  }
+  if (!WriteCode(function_, hooked_.data(), hooked_.size())) {
+    return false;
+  }
+  injected_ = true;
+  return true;
+}
+
+bool InlineHook::Restore() {
+  if (!injected_) {
+    return false;
+  }
+  if (!WriteCode(function_, original_.data(), original_.size())) {
+    return false;
+  }
+  injected_ = false;
+  return true;
+}
+
+}  // namespace sbat
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "./types.h"
+
+namespace sbat {
+// The longest jump WriteJump writes
+const uint32 kMaxJumpSize = 14;
+
+// Size of the jump WriteJump would write at location to reach target
+uint32 JumpSize(const byte* location, const void* target);
+// Writes a jump from location to target into output, which needs room for kMaxJumpSize bytes: a
+// relative jmp if target is within 2GB (always, in 32-bit code), otherwise jmp [rip+0] followed by
+// the absolute address. A plain jump keeps the return stack buffer balanced, unlike push/ret.
+// Returns its size.
+uint32 WriteJump(const byte* location, const void* target, byte* output);
+
+// Finds the whole instructions at the start of code that cover at least min_size bytes. Sets size
+// to the number of bytes they take, and relocated_size to the number they take once rewritten by
+// RelocateInstructions. Returns false if they can't be moved: one doesn't decode, is relative in a
+// way that can't be rewritten (loop/jcxz, rip-relative data) or jumps into the middle of them.
+bool MeasureInstructions(const byte* code, uint32 min_size, uint32* size, uint32* relocated_size);
+// Copies the size bytes of instructions at code (as measured by MeasureInstructions) to output,
+// rewriting relative jumps and calls (short ones as near ones) so that they still reach the same
+// targets from there. Returns false if a target is more than 2GB away from output.
+bool RelocateInstructions(const byte* code, uint32 size, byte* output, uint32 relocated_size);
+
+// Allocates size bytes of executable memory, within 1GB of nearby if there's room, so that jumps
+// between the two (and relocated instructions) can stay relative. Everything is in reach of
+// everything in 32-bit code. Returns nullptr on failure.
+byte* AllocateExecutable(size_t size, const void* nearby);
+void FreeExecutable(byte* memory, size_t size);
+
+// Copies bytes over the code at location, making it writable for the duration, and flushes it from
+// the instruction cache. Returns false if it couldn't be made writable.
+bool WriteCode(byte* location, const byte* bytes, size_t size);
+
+// Replaces the start of a function with a jump to a hook. The instructions the jump overwrites are
+// relocated into a trampoline, followed by a jump back to the rest of the function, so the original
+// can still be called while the hook is injected. Inject and Restore are not atomic: nothing may be
+// executing the start of the function while they run.
+class InlineHook {
+public:
+  InlineHook(byte* function, const void* hook);
+  ~InlineHook();
+
+  bool Inject();
+  bool Restore();
+
+  // False if the start of the function couldn't be relocated, in which case Inject always fails
+  bool isValid() const { return trampoline_ != nullptr; }
+  // Runs the original function, whether the hook is injected or not (the function itself if this
+  // isn't valid, since it can never be hooked then)
+  const byte* original() const { return trampoline_ != nullptr ? trampoline_ : function_; }
+  // The bytes Inject writes over the start of the function
+  const std::vector<byte>& hooked() const { return hooked_; }
+
+private:
+  // Disable copying
+  InlineHook(const InlineHook&) = delete;
+  InlineHook& operator=(const InlineHook&) = delete;
+
+  byte* function_;
+  std::vector<byte> original_;
+  std::vector<byte> hooked_;
+  byte* trampoline_;
+  size_t trampoline_size_;
+  bool injected_;
+};
+
+// Type for hooking a function at a specific memory location, with methods for replacing and
+// restoring the original code. Function pointer type is specified by F, to allow for hooks of
+// varying parameter lists.
+template<typename F>
+class FuncHook {
+public:
+  FuncHook(F func, F hook_func)
+      : hook_(reinterpret_cast<byte*>(func), reinterpret_cast<const void*>(hook_func)) {
+  }
+
+  bool Inject() { return hook_.Inject(); }
+  bool Restore() { return hook_.Restore(); }
+
+  // Calls the original function. Stays valid while the hook is injected, so hooks can pass calls
+  // through without restoring it.
+  F callable() const {
+    return reinterpret_cast<F>(const_cast<byte*>(hook_.original()));
+  }
+
+  bool isValid() const { return hook_.isValid(); }
+
+private:
+  // Disable copying
+  FuncHook(const FuncHook&) = delete;
+  FuncHook& operator=(const FuncHook&) = delete;
+
+  InlineHook hook_;
+};
+
+}  // namespace sbat
@@ -0,0 +1,70 @@
+#include "./local_clock.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+#include <array>
+#include <chrono>
+#include <ctime>
+
+#include "./time_format.h"
+#include "./types.h"
+
+namespace apm {
+
+#ifdef _WIN32
+LocalTimeOfDay GetLocalTimeOfDay() {
+  SYSTEMTIME localTime = SYSTEMTIME();
+  GetLocalTime(&localTime);
+  LocalTimeOfDay result = { localTime.wHour, localTime.wMinute, localTime.wSecond };
+  return result;
+}
+
+uint64 GetMonotonicMillis() {
+  return GetTickCount64();
+}
+
+bool GetLocaleString(LCTYPE type, std::array<char, 64>* out) {
+  WCHAR wideStr[64];
+  if (GetLocaleInfoEx(LOCALE_NAME_USER_DEFAULT, type, wideStr, 64) == 0) {
+    return false;
+  }
+  return WideCharToMultiByte(
+      CP_THREAD_ACP, NULL, wideStr, -1, out->data(), out->size(), NULL, NULL) != 0;
+}
+
+void CompileLocalTimeFormat(TimeFormat* format) {
+  std::array<char, 64> pattern;
+  std::array<char, 64> am;
+  std::array<char, 64> pm;
+  if (!GetLocaleString(LOCALE_STIMEFORMAT, &pattern) || !GetLocaleString(LOCALE_S1159, &am) ||
+      !GetLocaleString(LOCALE_S2359, &pm) ||
+      !format->Compile(pattern.data(), am.data(), pm.data(), true)) {
+    format->Compile("HH:mm", "", "", false);
+  }
+}
+#else
+LocalTimeOfDay GetLocalTimeOfDay() {
+  const std::time_t now = std::time(nullptr);
+  std::tm localTime = std::tm();
+  localtime_r(&now, &localTime);
+  LocalTimeOfDay result = {
+    static_cast<uint32>(localTime.tm_hour),
+    static_cast<uint32>(localTime.tm_min),
+    // tm_sec can be 60 for a leap second
+    static_cast<uint32>(localTime.tm_sec < 60 ? localTime.tm_sec : 59)
+  };
+  return result;
+}
+
+uint64 GetMonotonicMillis() {
+  return static_cast<uint64>(std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void CompileLocalTimeFormat(TimeFormat* format) {
+  format->Compile("HH:mm", "", "", false);
+}
+#endif
+
+}  // namespace apm
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "./time_format.h"
+#include "./types.h"
+
+namespace apm {
+
+struct LocalTimeOfDay {
+  uint32 hours;
+  uint32 minutes;
+  uint32 seconds;
+};
+
+// The wall clock time in the user's time zone
+LocalTimeOfDay GetLocalTimeOfDay();
+
+// Milliseconds from a clock that never goes backwards (the origin is unspecified)
+uint64 GetMonotonicMillis();
+
+// Compiles the user's time format (the one GetTimeFormatEx would use by default), without seconds,
+// into format. Falls back to "HH:mm" if it can't be looked up or compiled, and on platforms without
+// a user time format setting.
+void CompileLocalTimeFormat(TimeFormat* format);
+
+}  // namespace apm
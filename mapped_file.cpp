@@ -0,0 +1,151 @@
+#include "./mapped_file.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <string>
+
+#include "./types.h"
+
+using std::string;
+
+namespace sbat {
+
+#ifdef _WIN32
+
+MappedFile::MappedFile()
+  : data_(nullptr),
+    size_(0),
+    fileHandle_(INVALID_HANDLE_VALUE),
+    mappingHandle_(NULL) {
+}
+
+bool MappedFile::Open(const string& path) {
+  Close();
+  fileHandle_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (fileHandle_ == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(fileHandle_, &fileSize) || fileSize.QuadPart == 0 ||
+      static_cast<uint64>(fileSize.QuadPart) > SIZE_MAX) {
+    Close();
+    return false;
+  }
+  mappingHandle_ = CreateFileMappingA(fileHandle_, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (mappingHandle_ == NULL) {
+    Close();
+    return false;
+  }
+  data_ = reinterpret_cast<const byte*>(MapViewOfFile(mappingHandle_, FILE_MAP_READ, 0, 0, 0));
+  if (data_ == nullptr) {
+    Close();
+    return false;
+  }
+  size_ = static_cast<size_t>(fileSize.QuadPart);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+    data_ = nullptr;
+  }
+  if (mappingHandle_ != NULL) {
+    CloseHandle(mappingHandle_);
+    mappingHandle_ = NULL;
+  }
+  if (fileHandle_ != INVALID_HANDLE_VALUE) {
+    CloseHandle(fileHandle_);
+    fileHandle_ = INVALID_HANDLE_VALUE;
+  }
+  size_ = 0;
+}
+
+bool MoveFileReplacing(const string& from, const string& to) {
+  return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+bool TruncateFile(const string& path, uint64 size) {
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return GetLastError() == ERROR_FILE_NOT_FOUND;
+  }
+  LARGE_INTEGER fileSize;
+  LARGE_INTEGER newSize;
+  newSize.QuadPart = static_cast<LONGLONG>(size);
+  bool result = GetFileSizeEx(file, &fileSize) != 0;
+  if (result && static_cast<uint64>(fileSize.QuadPart) > size) {
+    result = SetFilePointerEx(file, newSize, NULL, FILE_BEGIN) != 0 && SetEndOfFile(file) != 0;
+  }
+  CloseHandle(file);
+  return result;
+}
+
+#else
+
+MappedFile::MappedFile()
+  : data_(nullptr),
+    size_(0) {
+}
+
+bool MappedFile::Open(const string& path) {
+  Close();
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  void* view = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (view == MAP_FAILED) {
+    return false;
+  }
+  data_ = reinterpret_cast<const byte*>(view);
+  size_ = static_cast<size_t>(fileStat.st_size);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    munmap(const_cast<byte*>(data_), size_);
+    data_ = nullptr;
+  }
+  size_ = 0;
+}
+
+bool MoveFileReplacing(const string& from, const string& to) {
+  return rename(from.c_str(), to.c_str()) == 0;
+}
+
+bool TruncateFile(const string& path, uint64 size) {
+  struct stat fileStat;
+  if (stat(path.c_str(), &fileStat) != 0) {
+    return errno == ENOENT;
+  }
+  if (static_cast<uint64>(fileStat.st_size) <= size) {
+    return true;
+  }
+  return truncate(path.c_str(), static_cast<off_t>(size)) == 0;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+  Close();
+}
+
+}  // namespace sbat
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+
+#include "./types.h"
+
+namespace sbat {
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+  MappedFile();
+  ~MappedFile();
+
+  // Maps the file at path, unmapping any previously mapped file. Returns false if it couldn't be
+  // mapped (empty files can't be mapped either).
+  bool Open(const std::string& path);
+  void Close();
+
+  bool isOpen() const { return data_ != nullptr; }
+  const byte* data() const { return data_; }
+  size_t size() const { return size_; }
+
+private:
+  // Disable copying
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const byte* data_;
+  size_t size_;
+#ifdef _WIN32
+  void* fileHandle_;
+  void* mappingHandle_;
+#endif
+};
+
+// Moves the file at from to to, replacing to if it exists. On POSIX this is atomic; on Windows,
+// to must not be mapped or open.
+bool MoveFileReplacing(const std::string& from, const std::string& to);
+
+// Cuts the file at path down to size bytes, if it's any longer. Returns true without doing anything
+// if the file doesn't exist.
+bool TruncateFile(const std::string& path, uint64 size);
+
+}  // namespace sbat
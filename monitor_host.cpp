@@ -0,0 +1,98 @@
+#include <Windows.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "./action_forwarding.h"
+#include "./game_monitor.h"
+#include "./remote_brood_war.h"
+#include "./types.h"
+
+// Runs the GameMonitor outside of BW (see RemoteBroodWar). Start this before BW: the plugin only
+// forwards actions to a monitor that's already waiting for them, and otherwise runs its own. Logs
+// and player history are written to the directory given as the only argument, or to apm_logs next
+// to this executable. Exits once BW does, or on Ctrl+C.
+
+using apm::ActionForwardReader;
+using apm::GameMonitor;
+using apm::RemoteBroodWar;
+using std::string;
+using std::unique_ptr;
+using std::wstring;
+
+// How often BW is waited for, and how often it's sampled once attached. Sampling runs at the
+// interval the in-game monitor updates at while in a game.
+const std::chrono::milliseconds ATTACH_POLL_INTERVAL(500);
+const std::chrono::milliseconds STEP_INTERVAL(100);
+
+std::atomic<bool> stopRequested(false);
+
+BOOL WINAPI OnConsoleCtrl(DWORD ctrlType) {
+  stopRequested = true;
+  // Gives the main loop time to finish the game log before the process is ended
+  return TRUE;
+}
+
+// Returns apm_logs next to this executable, creating it if necessary. Returns an empty string if
+// it can't be used, which disables logging.
+string GetDefaultLogDirectory() {
+  wchar_t selfPath[MAX_PATH];
+  DWORD copied = GetModuleFileNameW(NULL, selfPath, sizeof(selfPath) / sizeof(wchar_t));
+  if (copied == 0 || copied >= MAX_PATH) {
+    return string();
+  }
+
+  wstring directory(selfPath, copied);
+  directory = directory.substr(0, directory.find_last_of(L"\\/") + 1) + L"apm_logs";
+  if (!CreateDirectoryW(directory.c_str(), NULL) && GetLastError() != ERROR_ALREADY_EXISTS) {
+    return string();
+  }
+
+  char narrowPath[MAX_PATH * 2];
+  int numBytes = WideCharToMultiByte(
+    CP_ACP, NULL, directory.c_str(), -1, narrowPath, sizeof(narrowPath), NULL, NULL);
+  return numBytes != 0 ? string(narrowPath) : string();
+}
+
+int main(int argc, char** argv) {
+  const string logDirectory = argc > 1 ? string(argv[1]) : GetDefaultLogDirectory();
+  SetConsoleCtrlHandler(OnConsoleCtrl, TRUE);
+
+  unique_ptr<ActionForwardReader> reader = ActionForwardReader::Create();
+  if (!reader) {
+    std::fprintf(stderr, "Couldn't set up action forwarding, is another monitor running?\n");
+    return 1;
+  }
+
+  std::printf("Waiting for BW to start with the APMDisplay plugin...\n");
+  while (reader->writerProcessId() == 0) {
+    if (stopRequested) {
+      return 0;
+    }
+    std::this_thread::sleep_for(ATTACH_POLL_INTERVAL);
+  }
+  unique_ptr<RemoteBroodWar> remote = RemoteBroodWar::Attach(*reader);
+  if (!remote) {
+    std::fprintf(stderr, "Couldn't attach to BW (process %u, version %u)\n",
+        reader->writerProcessId(), reader->writerBwVersion());
+    return 1;
+  }
+  std::printf("Monitoring BW (process %u), logging to %s\n", reader->writerProcessId(),
+      logDirectory.empty() ? "nowhere" : logDirectory.c_str());
+
+  GameMonitor monitor(remote->Create(), logDirectory);
+  monitor.OpenOutputs();
+  while (!stopRequested && remote->Step(reader.get(), &monitor)) {
+    std::this_thread::sleep_for(STEP_INTERVAL);
+  }
+  monitor.CloseOutputs();
+
+  if (reader->droppedActions() != 0) {
+    std::printf("%u actions were dropped because the monitor fell behind\n",
+        reader->droppedActions());
+  }
+  return 0;
+}
@@ -0,0 +1,279 @@
+#include "./pe_imports.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "./types.h"
+
+namespace sbat {
+using std::string;
+
+namespace {
+const uint16 DOS_SIGNATURE = 0x5A4D;  // MZ
+const uint32 NT_SIGNATURE = 0x00004550;  // PE\0\0
+const uint16 PE32_MAGIC = 0x10B;
+const uint16 PE32_PLUS_MAGIC = 0x20B;
+const uint32 IMPORT_DIRECTORY_INDEX = 1;
+const uint32 IMPORT_DESCRIPTOR_SIZE = 20;
+const uint32 SECTION_HEADER_SIZE = 40;
+// Stops runaway parsing of corrupt tables that happen to lack a terminator
+const uint32 MAX_TABLE_ENTRIES = 0x10000;
+
+// Bounds checked little-endian reads from a PE image, translating RVAs to buffer offsets as needed
+// for the image's layout
+class ImageReader {
+public:
+  ImageReader(const byte* image, size_t size, ImageLayout layout)
+    : image_(image),
+      size_(size),
+      layout_(layout),
+      sections_offset_(0),
+      num_sections_(0) {
+  }
+
+  void SetSectionTable(uint32 offset, uint16 num_sections) {
+    sections_offset_ = offset;
+    num_sections_ = num_sections;
+  }
+
+  template<typename T>
+  bool ReadAt(size_t offset, T* out) const {
+    if (offset > size_ || size_ - offset < sizeof(T)) {
+      return false;
+    }
+    memcpy(out, image_ + offset, sizeof(T));
+    return true;
+  }
+
+  template<typename T>
+  bool Read(uint32 rva, T* out) const {
+    size_t offset = 0;
+    return ToOffset(rva, &offset) && ReadAt(offset, out);
+  }
+
+  bool ReadString(uint32 rva, string* out) const {
+    size_t offset = 0;
+    if (!ToOffset(rva, &offset) || offset >= size_) {
+      return false;
+    }
+    const char* start = reinterpret_cast<const char*>(image_ + offset);
+    const char* end = static_cast<const char*>(memchr(start, '\0', size_ - offset));
+    if (end == nullptr) {
+      return false;
+    }
+    out->assign(start, end);
+    return true;
+  }
+
+private:
+  bool ToOffset(uint32 rva, size_t* offset) const {
+    if (layout_ == ImageLayout::Mapped) {
+      *offset = rva;
+      return true;
+    }
+
+    for (uint16 i = 0; i < num_sections_; i++) {
+      size_t header = sections_offset_ + i * SECTION_HEADER_SIZE;
+      uint32 virtual_size, virtual_address, raw_size, raw_offset;
+      if (!ReadAt(header + 8, &virtual_size) || !ReadAt(header + 12, &virtual_address) ||
+          !ReadAt(header + 16, &raw_size) || !ReadAt(header + 20, &raw_offset)) {
+        return false;
+      }
+      uint32 section_size = std::max(virtual_size, raw_size);
+      if (rva >= virtual_address && rva - virtual_address < section_size) {
+        uint32 section_offset = rva - virtual_address;
+        if (section_offset >= raw_size) {
+          return false;  // in the zero-filled tail of the section, which isn't in the file
+        }
+        *offset = static_cast<size_t>(raw_offset) + section_offset;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const byte* image_;
+  size_t size_;
+  ImageLayout layout_;
+  uint32 sections_offset_;
+  uint16 num_sections_;
+};
+
+string ToLower(string str) {
+  std::transform(str.begin(), str.end(), str.begin(),
+      [](char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); });
+  return str;
+}
+
+// Returns the offset of the optional header, or 0 if the headers aren't valid
+uint32 GetOptionalHeaderOffset(const ImageReader& reader, uint16* magic) {
+  uint16 dos_signature;
+  int32 nt_offset;
+  uint32 nt_signature;
+  if (!reader.ReadAt(0, &dos_signature) || dos_signature != DOS_SIGNATURE ||
+      !reader.ReadAt(0x3C, &nt_offset) || nt_offset <= 0 ||
+      !reader.ReadAt(nt_offset, &nt_signature) || nt_signature != NT_SIGNATURE) {
+    return 0;
+  }
+
+  // signature + IMAGE_FILE_HEADER
+  uint32 optional_offset = static_cast<uint32>(nt_offset) + 4 + 20;
+  if (!reader.ReadAt(optional_offset, magic) ||
+      (*magic != PE32_MAGIC && *magic != PE32_PLUS_MAGIC)) {
+    return 0;
+  }
+  return optional_offset;
+}
+
+// Names can't contain NULs, so they make an unambiguous separator. Ordinal keys use a different
+// separator so they can never collide with a name.
+string NameKey(const string& module_name, const string& func_name) {
+  string key = ToLower(module_name);
+  key.push_back('\0');
+  key.append(ToLower(func_name));
+  return key;
+}
+
+string OrdinalKey(const string& module_name, uint16 ordinal) {
+  string key = ToLower(module_name);
+  key.push_back('\1');
+  key.push_back(static_cast<char>(ordinal & 0xFF));
+  key.push_back(static_cast<char>(ordinal >> 8));
+  return key;
+}
+
+// Reads the imports of a single module's descriptor into slots (keyed by NameKey or OrdinalKey).
+// Returns false if any of its tables or names can't be read.
+bool ParseDescriptor(const ImageReader& reader, uint32 name_rva, uint32 lookup_rva, uint32 iat_rva,
+    bool is_64bit, std::vector<std::pair<string, uint32>>* slots) {
+  string module_name;
+  if (!reader.ReadString(name_rva, &module_name)) {
+    return false;
+  }
+
+  const uint32 thunk_size = is_64bit ? 8 : 4;
+  const uint64 ordinal_flag = is_64bit ? 0x8000000000000000ULL : 0x80000000ULL;
+  for (uint32 j = 0; j < MAX_TABLE_ENTRIES; j++) {
+    uint64 thunk;
+    bool read;
+    if (is_64bit) {
+      read = reader.Read(lookup_rva + j * thunk_size, &thunk);
+    } else {
+      uint32 thunk32;
+      read = reader.Read(lookup_rva + j * thunk_size, &thunk32);
+      thunk = thunk32;
+    }
+    if (!read) {
+      return false;
+    }
+    if (thunk == 0) {
+      return true;
+    }
+
+    uint32 slot_rva = iat_rva + j * thunk_size;
+    if (thunk & ordinal_flag) {
+      slots->emplace_back(
+          OrdinalKey(module_name, static_cast<uint16>(thunk & 0xFFFF)), slot_rva);
+    } else {
+      string func_name;
+      // skip the 2 byte hint that precedes the name
+      if (!reader.ReadString(static_cast<uint32>(thunk) + 2, &func_name)) {
+        return false;
+      }
+      slots->emplace_back(NameKey(module_name, func_name), slot_rva);
+    }
+  }
+  return false;  // no terminator
+}
+}  // namespace
+
+ImportIndex::ImportIndex()
+  : slots_() {
+}
+
+uint32 ImportIndex::GetMappedImageSize(const byte* image) {
+  // only the headers are read here, and they always fit in the first page
+  ImageReader reader(image, 0x1000, ImageLayout::Mapped);
+  uint16 magic;
+  uint32 optional_offset = GetOptionalHeaderOffset(reader, &magic);
+  uint32 image_size;
+  if (optional_offset == 0 || !reader.ReadAt(optional_offset + 56, &image_size)) {
+    return 0;
+  }
+  return image_size;
+}
+
+bool ImportIndex::Parse(const byte* image, size_t image_size, ImageLayout layout) {
+  slots_.clear();
+
+  ImageReader reader(image, image_size, layout);
+  uint16 magic;
+  uint32 optional_offset = GetOptionalHeaderOffset(reader, &magic);
+  uint16 num_sections, optional_size;
+  if (optional_offset == 0 ||
+      !reader.ReadAt(optional_offset - 20 + 2, &num_sections) ||
+      !reader.ReadAt(optional_offset - 20 + 16, &optional_size)) {
+    return false;
+  }
+  reader.SetSectionTable(optional_offset + optional_size, num_sections);
+
+  const bool is_64bit = magic == PE32_PLUS_MAGIC;
+  const uint32 num_dirs_offset = optional_offset + (is_64bit ? 108 : 92);
+  uint32 num_dirs, import_rva;
+  if (!reader.ReadAt(num_dirs_offset, &num_dirs)) {
+    return false;
+  }
+  if (num_dirs <= IMPORT_DIRECTORY_INDEX) {
+    return true;  // no import directory, nothing to index
+  }
+  if (!reader.ReadAt(num_dirs_offset + 4 + IMPORT_DIRECTORY_INDEX * 8, &import_rva)) {
+    return false;
+  }
+  if (import_rva == 0) {
+    return true;
+  }
+
+  bool all_parsed = true;
+  std::vector<std::pair<string, uint32>> descriptor_slots;
+  for (uint32 i = 0; i < MAX_TABLE_ENTRIES; i++) {
+    uint32 descriptor = import_rva + i * IMPORT_DESCRIPTOR_SIZE;
+    uint32 lookup_rva, name_rva, iat_rva;
+    if (!reader.Read(descriptor, &lookup_rva) || !reader.Read(descriptor + 12, &name_rva) ||
+        !reader.Read(descriptor + 16, &iat_rva)) {
+      return false;  // can't find the end of the table, but keep what came before
+    }
+    if (iat_rva == 0) {
+      break;  // end of the descriptor table
+    }
+    // Without a lookup table the only thunks are in the IAT, which holds resolved addresses rather
+    // than names once the image is loaded (or bound), so there's nothing to index by
+    if (lookup_rva == 0) {
+      continue;
+    }
+
+    descriptor_slots.clear();
+    if (!ParseDescriptor(reader, name_rva, lookup_rva, iat_rva, is_64bit, &descriptor_slots)) {
+      all_parsed = false;  // only this module's imports are skipped
+      continue;
+    }
+    slots_.insert(descriptor_slots.begin(), descriptor_slots.end());
+  }
+
+  return all_parsed;
+}
+
+uint32 ImportIndex::Find(const string& module_name, const string& func_name) const {
+  auto it = slots_.find(NameKey(module_name, func_name));
+  return it != slots_.end() ? it->second : 0;
+}
+
+uint32 ImportIndex::Find(const string& module_name, uint16 ordinal) const {
+  auto it = slots_.find(OrdinalKey(module_name, ordinal));
+  return it != slots_.end() ? it->second : 0;
+}
+
+}  // namespace sbat
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+#include "./types.h"
+
+namespace sbat {
+// How the sections of a PE image are laid out in the buffer being parsed
+enum class ImageLayout {
+  Mapped = 0,  // loaded by the OS, so RVAs are offsets from the start of the image
+  File         // read straight from disk, so RVAs have to be translated through the section table
+};
+
+// Index of the imports of a PE image (32 or 64-bit), mapping each imported (module, function) pair
+// to the RVA of its IAT slot. The image is parsed once up front, after which lookups are a single
+// hash lookup. Parsing only touches the bytes it's given (no OS calls), so it works the same on
+// loaded modules and on files read from disk.
+class ImportIndex {
+public:
+  ImportIndex();
+
+  // Returns false if the image is not a valid PE file or its import directory is malformed. Modules
+  // whose tables can't be read are left out, but the rest of the imports are still indexed.
+  // Modules without a lookup table (OriginalFirstThunk) are left out too, since their IAT holds
+  // resolved addresses rather than names.
+  bool Parse(const byte* image, size_t image_size, ImageLayout layout);
+
+  // Returns the RVA of the IAT slot for the import, or 0 if it isn't imported. Names are compared
+  // case-insensitively, matching the previous lstrcmpiA lookups.
+  uint32 Find(const std::string& module_name, const std::string& func_name) const;
+  uint32 Find(const std::string& module_name, uint16 ordinal) const;
+
+  size_t size() const { return slots_.size(); }
+  bool empty() const { return slots_.empty(); }
+
+  // Reads SizeOfImage from the headers of a loaded image, or returns 0 if they aren't valid
+  static uint32 GetMappedImageSize(const byte* image);
+
+private:
+  std::unordered_map<std::string, uint32> slots_;
+};
+
+}  // namespace sbat
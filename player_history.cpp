@@ -0,0 +1,275 @@
+#include "./player_history.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "./mapped_file.h"
+#include "./types.h"
+
+namespace apm {
+
+using std::string;
+
+const uint32 HISTORY_INDEX_MAGIC = 0x49485041;  // 'APHI'
+const uint32 HISTORY_INDEX_VERSION = 2;
+// Number of players with unindexed games at which AddGame writes a new index
+const size_t MAX_PENDING_PLAYERS = 1024;
+
+struct HistoryRecord {
+  uint64 key;
+  uint32 actions;
+  uint32 ticks;
+  uint64 endTime;
+};
+static_assert(sizeof(HistoryRecord) == 24, "HistoryRecord is part of the on-disk format");
+
+struct IndexHeader {
+  uint32 magic;
+  uint32 version;
+  uint64 count;
+  // Number of log records included in the index, any after this still need to be applied
+  uint64 recordCount;
+};
+static_assert(sizeof(IndexHeader) == 24, "IndexHeader is part of the on-disk format");
+
+struct PlayerHistory::IndexEntry {
+  uint64 key;
+  uint32 games;
+  uint32 reserved;
+  uint64 actions;
+  uint64 ticks;
+};
+
+uint64 PlayerHistoryKey(const char* name, size_t length) {
+  uint64 hash = 0xCBF29CE484222325ULL;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ static_cast<byte>(name[i])) * 0x100000001B3ULL;
+  }
+  return hash;
+}
+
+void PlayerTotals::Add(const PlayerTotals& other) {
+  games += other.games;
+  actions += other.actions;
+  ticks += other.ticks;
+}
+
+double PlayerTotals::averageApm() const {
+  if (ticks == 0) {
+    return 0;
+  }
+  return actions / (ticks * 42 / 60000.0);
+}
+
+PlayerHistory::PlayerHistory(string directory)
+  : logPath_(directory + "/players.dat"),
+    indexPath_(directory + "/players.idx"),
+    log_(),
+    logRecords_(0),
+    index_(),
+    indexEntries_(nullptr),
+    indexCount_(0),
+    pending_(),
+    session_() {
+}
+
+PlayerHistory::~PlayerHistory() {
+  if (!pending_.empty()) {
+    Compact();
+  }
+}
+
+bool PlayerHistory::Open() {
+  uint64 indexedRecords = 0;
+  if (MapIndex()) {
+    indexedRecords = reinterpret_cast<const IndexHeader*>(index_.data())->recordCount;
+  }
+
+  logRecords_ = LoadLogTail(indexedRecords);
+  if (logRecords_ < indexedRecords) {
+    // The index claims more games than the log has, so it can't be trusted. Start over from the
+    // log.
+    index_.Close();
+    indexEntries_ = nullptr;
+    indexCount_ = 0;
+    pending_.clear();
+    logRecords_ = LoadLogTail(0);
+  }
+
+  // Anything after the last loaded record (a record partially written when we crashed, or ones
+  // that couldn't be read) would misalign every record appended after it
+  if (!sbat::TruncateFile(logPath_, logRecords_ * sizeof(HistoryRecord))) {
+    return false;
+  }
+  log_.open(logPath_, std::ios::binary | std::ios::out | std::ios::app);
+  return log_.is_open();
+}
+
+bool PlayerHistory::MapIndex() {
+  indexEntries_ = nullptr;
+  indexCount_ = 0;
+  if (!index_.Open(indexPath_)) {
+    return false;
+  }
+
+  const IndexHeader* header = reinterpret_cast<const IndexHeader*>(index_.data());
+  if (index_.size() < sizeof(IndexHeader) || header->magic != HISTORY_INDEX_MAGIC ||
+      header->version != HISTORY_INDEX_VERSION ||
+      header->count > (index_.size() - sizeof(IndexHeader)) / sizeof(IndexEntry)) {
+    index_.Close();
+    return false;
+  }
+
+  static_assert(sizeof(IndexEntry) == 32, "IndexEntry is part of the on-disk format");
+  indexEntries_ = reinterpret_cast<const IndexEntry*>(index_.data() + sizeof(IndexHeader));
+  indexCount_ = static_cast<size_t>(header->count);
+  return true;
+}
+
+uint64 PlayerHistory::LoadLogTail(uint64 fromRecord) {
+  std::ifstream log(logPath_, std::ios::binary | std::ios::in);
+  if (!log.is_open()) {
+    return 0;
+  }
+  log.seekg(0, std::ios::end);
+  // Ignore a partially written record at the end, if we crashed while writing it
+  const uint64 recordCount = static_cast<uint64>(log.tellg()) / sizeof(HistoryRecord);
+  if (fromRecord >= recordCount) {
+    return recordCount;
+  }
+
+  log.seekg(fromRecord * sizeof(HistoryRecord), std::ios::beg);
+  std::vector<HistoryRecord> records(4096);
+  for (uint64 loaded = fromRecord; loaded < recordCount;) {
+    const size_t count =
+        static_cast<size_t>(std::min<uint64>(recordCount - loaded, records.size()));
+    log.read(reinterpret_cast<char*>(records.data()), count * sizeof(HistoryRecord));
+    const size_t readCount = static_cast<size_t>(log.gcount()) / sizeof(HistoryRecord);
+    for (size_t i = 0; i < readCount; i++) {
+      PlayerTotals game = { 1, records[i].actions, records[i].ticks };
+      pending_[records[i].key].Add(game);
+    }
+    loaded += readCount;
+    if (readCount < count) {
+      // The log ends at the last full record that could be read
+      return loaded;
+    }
+  }
+  return recordCount;
+}
+
+void PlayerHistory::AddGame(uint64 key, uint32 actions, uint32 ticks, uint64 endTime) {
+  PlayerTotals game = { 1, actions, ticks };
+  pending_[key].Add(game);
+  session_[key].Add(game);
+
+  if (log_.is_open()) {
+    HistoryRecord record = { key, actions, ticks, endTime };
+    log_.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    log_.flush();
+    if (log_) {
+      logRecords_++;
+    }
+  }
+
+  if (pending_.size() >= MAX_PENDING_PLAYERS) {
+    Compact();
+  }
+}
+
+const PlayerHistory::IndexEntry* PlayerHistory::FindIndexed(uint64 key) const {
+  const IndexEntry* end = indexEntries_ + indexCount_;
+  const IndexEntry* entry = std::lower_bound(indexEntries_, end, key,
+      [](const IndexEntry& entry, uint64 key) { return entry.key < key; });
+  return entry != end && entry->key == key ? entry : nullptr;
+}
+
+bool PlayerHistory::Lookup(uint64 key, PlayerTotals* totals) const {
+  *totals = PlayerTotals();
+  bool found = false;
+  if (const IndexEntry* entry = FindIndexed(key)) {
+    PlayerTotals indexed = { entry->games, entry->actions, entry->ticks };
+    totals->Add(indexed);
+    found = true;
+  }
+  auto pending = pending_.find(key);
+  if (pending != pending_.end()) {
+    totals->Add(pending->second);
+    found = true;
+  }
+  return found;
+}
+
+bool PlayerHistory::LookupSession(uint64 key, PlayerTotals* totals) const {
+  auto session = session_.find(key);
+  if (session == session_.end()) {
+    *totals = PlayerTotals();
+    return false;
+  }
+  *totals = session->second;
+  return true;
+}
+
+bool PlayerHistory::Compact() {
+  // Only games that made it into the log can go into the index, or the index would claim more
+  // records than the log has
+  if (!log_.is_open() || !log_ || !WriteIndex(logRecords_)) {
+    return false;
+  }
+  pending_.clear();
+  return MapIndex();
+}
+
+bool PlayerHistory::WriteIndex(uint64 recordCount) {
+  const string tempPath = indexPath_ + ".tmp";
+  {
+    std::ofstream out(tempPath, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+      return false;
+    }
+
+    // Merge the sorted index with the sorted pending totals
+    std::vector<IndexEntry> merged;
+    merged.reserve(indexCount_ + pending_.size());
+    const IndexEntry* indexed = indexEntries_;
+    const IndexEntry* indexedEnd = indexEntries_ + indexCount_;
+    auto pending = pending_.begin();
+    while (indexed != indexedEnd || pending != pending_.end()) {
+      if (pending == pending_.end() ||
+          (indexed != indexedEnd && indexed->key < pending->first)) {
+        merged.push_back(*indexed++);
+      } else {
+        IndexEntry entry = { pending->first, 0, 0, 0, 0 };
+        if (indexed != indexedEnd && indexed->key == pending->first) {
+          entry = *indexed++;
+        }
+        entry.games += pending->second.games;
+        entry.actions += pending->second.actions;
+        entry.ticks += pending->second.ticks;
+        merged.push_back(entry);
+        ++pending;
+      }
+    }
+
+    IndexHeader header = { HISTORY_INDEX_MAGIC, HISTORY_INDEX_VERSION, merged.size(), recordCount };
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(merged.data()), merged.size() * sizeof(IndexEntry));
+    if (!out) {
+      return false;
+    }
+  }
+
+  // Windows can't replace a file that's mapped
+  index_.Close();
+  if (!sbat::MoveFileReplacing(tempPath, indexPath_)) {
+    // Keep using the old index, pending games will go into the next one
+    MapIndex();
+    return false;
+  }
+  return true;
+}
+
+}  // namespace apm
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <map>
+#include <string>
+
+#include "./mapped_file.h"
+#include "./types.h"
+
+namespace apm {
+
+// Aggregated stats of a player over a set of games
+struct PlayerTotals {
+  uint32 games;
+  uint64 actions;
+  uint64 ticks;
+
+  void Add(const PlayerTotals& other);
+  // Average APM over all of the games, 0 if there are none
+  double averageApm() const;
+};
+
+// Key a player's games are stored under: a 64 bit hash (FNV-1a) of their name. Storm IDs only
+// number the players of a single session, so a name is the closest thing to a lasting identity.
+uint64 PlayerHistoryKey(const char* name, size_t length);
+
+// Local, persistent history of the games of every player we've seen, keyed by PlayerHistoryKey.
+// Made up of two files in a directory:
+//   players.dat: an append-only log of one record per player per game, the source of truth
+//   players.idx: per player totals, sorted by key and memory mapped so lookups are a binary search
+//     without reading the whole file
+// (history.dat/history.idx from earlier versions were keyed by Storm ID, and are ignored.)
+// Games added since the index was last written are kept in memory (and are recovered from the log
+// if they never make it into the index), and merged into a new index once enough pile up.
+//
+// Not thread safe. File I/O only happens in Open, AddGame, and Compact, so those shouldn't be
+// called from the BW game loop thread.
+class PlayerHistory {
+public:
+  explicit PlayerHistory(std::string directory);
+  // Writes out any unindexed games
+  ~PlayerHistory();
+
+  // Loads the index, rebuilding it from the log if it's missing or out of date, and cuts off
+  // anything after the log's last full record. Returns false if the log can't be opened for
+  // appending (in which case AddGame only affects memory).
+  bool Open();
+
+  void AddGame(uint64 key, uint32 actions, uint32 ticks, uint64 endTime);
+  // Totals over every game recorded for key. Returns false if there are none.
+  bool Lookup(uint64 key, PlayerTotals* totals) const;
+  // Totals over the games added since this object was created. Returns false if there are none.
+  bool LookupSession(uint64 key, PlayerTotals* totals) const;
+
+  // Merges games added since the index was written into a new index
+  bool Compact();
+
+  size_t indexedPlayers() const { return indexCount_; }
+  size_t pendingPlayers() const { return pending_.size(); }
+
+private:
+  // Disable copying
+  PlayerHistory(const PlayerHistory&) = delete;
+  PlayerHistory& operator=(const PlayerHistory&) = delete;
+
+  struct IndexEntry;
+
+  bool MapIndex();
+  const IndexEntry* FindIndexed(uint64 key) const;
+  // Reads log records from the given record number on into pending_. Returns the number of
+  // records in the log, which ends at the last full record that could be read.
+  uint64 LoadLogTail(uint64 fromRecord);
+  bool WriteIndex(uint64 recordCount);
+
+  std::string logPath_;
+  std::string indexPath_;
+  std::ofstream log_;
+  uint64 logRecords_;
+
+  sbat::MappedFile index_;
+  const IndexEntry* indexEntries_;
+  size_t indexCount_;
+
+  std::map<uint64, PlayerTotals> pending_;
+  std::map<uint64, PlayerTotals> session_;
+};
+
+}  // namespace apm
@@ -0,0 +1,85 @@
+#include "./player_identity.h"
+
+#include <string.h>
+#include <algorithm>
+#include <array>
+
+#include "./brood_war.h"
+#include "./types.h"
+
+namespace apm {
+
+char PlayerColorToTextColor(uint8 playerColor) {
+  switch (playerColor) {
+    case 0x6F: return 0x08;
+    case 0xA5: return 0x0E;
+    case 0x9F: return 0x0F;
+    case 0xA4: return 0x10;
+    case 0x9C: return 0x11;
+    case 0x13: return 0x15;
+    case 0x54: return 0x16;
+    case 0x87: return 0x17;
+    case 0xB9: return 0x18;
+    case 0x88: return 0x19;
+    case 0x86: return 0x1B;
+    case 0x33: return 0x1C;
+    case 0x4D: return 0x1D;
+    case 0x9A: return 0x1E;
+    case 0x80: return 0x1F;
+    default: return 0x02;
+  }
+}
+
+PlayerIdentityTable::PlayerIdentityTable()
+  : identities_(),
+    hash_(0),
+    version_(0) {
+}
+
+const uint64 FNV_OFFSET_BASIS = 14695981039346656037ULL;
+const uint64 FNV_PRIME = 1099511628211ULL;
+uint64 HashBytes(uint64 hash, const byte* data, size_t length) {
+  // FNV-1a over 32-bit words rather than bytes, since this runs several times a second
+  size_t i = 0;
+  for (; i + 4 <= length; i += 4) {
+    uint32 word;
+    memcpy(&word, data + i, sizeof(word));
+    hash = (hash ^ word) * FNV_PRIME;
+  }
+  for (; i < length; i++) {
+    hash = (hash ^ data[i]) * FNV_PRIME;
+  }
+  return hash;
+}
+
+uint64 PlayerIdentityTable::HashPlayerData(BroodWar& bw) {
+  uint64 hash = HashBytes(FNV_OFFSET_BASIS, reinterpret_cast<const byte*>(bw.firstPlayerInfo.get()),
+      sizeof(PlayerInfo) * 12);
+  return HashBytes(hash, bw.firstPlayerColor.get(), 12);
+}
+
+bool PlayerIdentityTable::Refresh(BroodWar& bw, bool force) {
+  const uint64 hash = HashPlayerData(bw);
+  if (!force && hash == hash_ && version_ != 0) {
+    return false;
+  }
+
+  const PlayerInfo* players = bw.firstPlayerInfo.get();
+  for (size_t i = 0; i < identities_.size(); i++) {
+    PlayerIdentity& identity = identities_[i];
+    const char* name = players[i].name;
+    const char* nameEnd = std::find(name, name + sizeof(players[i].name) - 1, '\0');
+    identity.nameLength = static_cast<uint8>(nameEnd - name);
+    std::copy(name, nameEnd, identity.name.begin());
+    identity.name[identity.nameLength] = '\0';
+    identity.stormId = players[i].stormId;
+    identity.playerColor = bw.GetPlayerColor(i);
+    identity.textColor = PlayerColorToTextColor(identity.playerColor);
+  }
+
+  hash_ = hash;
+  version_++;
+  return true;
+}
+
+}  // namespace apm
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <string>
+
+#include "./brood_war.h"
+#include "./types.h"
+
+namespace apm {
+
+// A non-owning reference to a string's characters (not necessarily null terminated)
+struct NameRef {
+  const char* data;
+  size_t length;
+
+  bool empty() const { return length == 0; }
+  std::string str() const { return std::string(data, length); }
+};
+
+struct PlayerIdentity {
+  // Null terminated, nameLength characters long (empty for unused slots)
+  std::array<char, 25> name;
+  uint8 nameLength;
+  uint32 stormId;
+  uint8 playerColor;
+  // Text color code matching playerColor, for drawing the player's name
+  char textColor;
+
+  NameRef nameRef() const { NameRef ref = { name.data(), nameLength }; return ref; }
+};
+
+// Returns the text color code that best matches a player color
+char PlayerColorToTextColor(uint8 playerColor);
+
+// Names, Storm IDs and colors of each player slot, copied out of BW's player data once and only
+// copied again when that data changes (detected by hashing it, which is much cheaper than building
+// strings out of it). Meant to be owned and used by a single thread.
+class PlayerIdentityTable {
+public:
+  PlayerIdentityTable();
+
+  // Re-reads the player data from bw if it has changed since the last refresh (or if force is set).
+  // Returns true if it was re-read.
+  bool Refresh(BroodWar& bw, bool force = false);
+
+  const PlayerIdentity& operator[](size_t slot) const { return identities_[slot]; }
+  bool isPresent(size_t slot) const { return identities_[slot].nameLength != 0; }
+  // Changes every time the table is re-read
+  uint32 version() const { return version_; }
+
+private:
+  static uint64 HashPlayerData(BroodWar& bw);
+
+  std::array<PlayerIdentity, 12> identities_;
+  uint64 hash_;
+  uint32 version_;
+};
+
+}  // namespace apm
@@ -3,9 +3,12 @@
 #include <string>
 #include <vector>
 
+#include "./action_forwarding.h"
+#include "./actions.h"
 #include "./brood_war.h"
 #include "./game_monitor.h"
 #include "./func_hook.h"
+#include "./profiling.h"
 #include "./types.h"
 #include "./win_helpers.h"
 
@@ -16,6 +19,7 @@ using sbat::ScopedVirtualProtect;
 using std::string;
 using std::unique_ptr;
 using std::vector;
+using std::wstring;
 
 // We don't really work with all versions, but BWL doesn't allow for ranges, nor does Chaos support
 // anything higher than 1.16.1
@@ -81,6 +85,46 @@ BWL_FUNCTION bool ApplyPatch(HANDLE processHandle, uint32 processId) {
 }
 
 unique_ptr<GameMonitor> gameMonitor = unique_ptr<GameMonitor>();
+// Set instead of gameMonitor when a monitor is running in another process (see RemoteBroodWar), in
+// which case all the game does is forward actions to it
+unique_ptr<apm::ActionForwardWriter> actionForwarder = unique_ptr<apm::ActionForwardWriter>();
+unique_ptr<apm::BroodWar> forwardingBw = unique_ptr<apm::BroodWar>();
+
+using ExitProcessFn = void(WINAPI*)(UINT exitCode);
+unique_ptr<sbat::FuncHook<ExitProcessFn>> exitProcessHook =
+    unique_ptr<sbat::FuncHook<ExitProcessFn>>();
+
+// Runs before any other thread is killed, so the monitor can still be stopped properly here. That
+// finishes the log of a game that's still in progress when BW is closed and writes out anything
+// queued, which would otherwise be lost.
+void WINAPI OnExitProcess(UINT exitCode) {
+  if (gameMonitor) {
+    gameMonitor->Stop();
+  }
+  exitProcessHook->callable()(exitCode);
+}
+
+// Once OnInject has run this DLL is pinned (see PinSelf), so this only sees process exit. By then
+// the loader lock is held and every other thread has been killed, so destroying gameMonitor would
+// try to join threads that are gone. It's leaked instead, along with what the hooks refer to.
+extern "C" BOOL WINAPI DllMain(HINSTANCE instance, DWORD reason, LPVOID reserved) {
+  if (reason == DLL_PROCESS_DETACH) {
+    exitProcessHook.release();
+    gameMonitor.release();
+    forwardingBw.release();
+    actionForwarder.release();
+  }
+  return TRUE;
+}
+
+// The hooks jump into this DLL and the monitor's threads run in it, so it can never be unloaded
+// once they exist
+bool PinSelf() {
+  HMODULE selfHandle;
+  return GetModuleHandleExW(
+      GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_PIN,
+      reinterpret_cast<LPCWSTR>(&OnInject), &selfHandle) != FALSE;
+}
 
 bool VersionsEqual(
     VS_FIXEDFILEINFO* fileInfo, uint16 majorHi, uint16 majorLo, uint16 minorHi, uint16 minorLo) {
@@ -90,6 +134,34 @@ bool VersionsEqual(
       LOWORD(fileInfo->dwProductVersionLS) == minorLo);
 }
 
+// Returns the directory game logs should be written to (apm_logs, next to this DLL), creating it
+// if necessary. Returns an empty string if it can't be used, which disables logging.
+string GetLogDirectory() {
+  HMODULE selfHandle;
+  wchar_t selfPath[MAX_PATH];
+  BOOL gotHandle = GetModuleHandleExW(
+    GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+    reinterpret_cast<LPCWSTR>(&OnInject), &selfHandle);
+  if (!gotHandle) {
+    return string();
+  }
+  DWORD copied = GetModuleFileNameW(selfHandle, selfPath, sizeof(selfPath) / sizeof(wchar_t));
+  if (copied == 0 || copied >= MAX_PATH) {
+    return string();
+  }
+
+  wstring directory(selfPath, copied);
+  directory = directory.substr(0, directory.find_last_of(L"\\/") + 1) + L"apm_logs";
+  if (!CreateDirectoryW(directory.c_str(), NULL) && GetLastError() != ERROR_ALREADY_EXISTS) {
+    return string();
+  }
+
+  char narrowPath[MAX_PATH * 2];
+  int numBytes = WideCharToMultiByte(
+    CP_ACP, NULL, directory.c_str(), -1, narrowPath, sizeof(narrowPath), NULL, NULL);
+  return numBytes != 0 ? string(narrowPath) : string();
+}
+
 BWL_FUNCTION void OnInject() {
   wchar_t bwPath[MAX_PATH];
   HMODULE bwHandle = GetModuleHandle(NULL);
@@ -119,23 +191,57 @@ BWL_FUNCTION void OnInject() {
   }
 
   apm::DrawFn drawFn = []() {
+    APM_PROBE(DrawHook);
     gameMonitor->Draw();
   };
   apm::RefreshFn refreshFn = []() {
+    APM_PROBE(RefreshHook);
     gameMonitor->RefreshScreen();
   };
-  apm::OnActionFn onActionFn = [](const byte* actionType) {
-    gameMonitor->OnAction(*actionType);
+  apm::OnActionFn onActionFn = [](const byte* action) {
+    APM_PROBE(OnActionHook);
+    gameMonitor->OnAction(action);
+  };
+  apm::OnActionFn forwardActionFn = [](const byte* action) {
+    APM_PROBE(OnActionHook);
+    const uint32 player = forwardingBw->activePlayerId;
+    if (player < 12 && action[0] != apm::action::SYNC) {
+      actionForwarder->Forward(forwardingBw->gameTimeTicks, static_cast<uint8>(player), action);
+    }
   };
 
-  if (VersionsEqual(fileInfo, 1, 16, 1, 1)) {
-    gameMonitor.reset(new GameMonitor(apm::CreateV1161(drawFn, refreshFn, onActionFn)));
-  } else if (VersionsEqual(fileInfo, 1, 17, 0, 1)) {
-    gameMonitor.reset(new GameMonitor(apm::CreateV1170(
-        reinterpret_cast<uint32>(bwHandle), drawFn, refreshFn, onActionFn)));
-  } else {
+  const bool isV1161 = VersionsEqual(fileInfo, 1, 16, 1, 1);
+  if (!isV1161 && !VersionsEqual(fileInfo, 1, 17, 0, 1)) {
     return;
   }
-  
+  if (!PinSelf()) {
+    return;
+  }
+  // Only forwards if a monitor_host is already running (and so has created the region)
+  actionForwarder = apm::ActionForwardWriter::Open(GetCurrentProcessId(),
+      reinterpret_cast<uintptr_t>(bwHandle), isV1161 ? apm::BW_VERSION_1161 : apm::BW_VERSION_1170);
+  if (actionForwarder) {
+    onActionFn = forwardActionFn;
+  }
+
+  apm::BroodWar bw = isV1161 ?
+      apm::CreateV1161(drawFn, refreshFn, onActionFn) :
+      apm::CreateV1170(reinterpret_cast<uint32>(bwHandle), drawFn, refreshFn, onActionFn);
+  if (actionForwarder) {
+    // Nothing is drawn, so only the action hook is needed, and it can stay injected for good since
+    // actions only happen in games anyway
+    forwardingBw.reset(new apm::BroodWar(std::move(bw)));
+    forwardingBw->onActionDispatcher.Inject();
+    return;
+  }
+
+  gameMonitor.reset(new GameMonitor(std::move(bw), GetLogDirectory()));
   gameMonitor->Start();
+
+  const auto exitProcess = reinterpret_cast<ExitProcessFn>(
+      GetProcAddress(GetModuleHandleW(L"kernel32.dll"), "ExitProcess"));
+  if (exitProcess != nullptr) {
+    exitProcessHook.reset(new sbat::FuncHook<ExitProcessFn>(exitProcess, OnExitProcess));
+    exitProcessHook->Inject();
+  }
 }
\ No newline at end of file
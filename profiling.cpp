@@ -0,0 +1,140 @@
+#include "./profiling.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+#include "./types.h"
+
+namespace apm {
+
+const uint32 CycleHistogram::SUB_BUCKET_BITS;
+const uint32 CycleHistogram::SUB_BUCKETS;
+const uint32 CycleHistogram::NUM_BUCKETS;
+
+CycleHistogram::CycleHistogram()
+  : buckets_(),
+    calls_(0),
+    count_(0),
+    max_(0) {
+  Reset();
+}
+
+uint32 CycleHistogram::BucketLowerBound(uint32 bucket) {
+  if (bucket < SUB_BUCKETS) {
+    return bucket;
+  }
+  const uint32 msb = bucket / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+  const uint32 sub = bucket % SUB_BUCKETS;
+  return (SUB_BUCKETS + sub) << (msb - SUB_BUCKET_BITS);
+}
+
+uint32 CycleHistogram::Percentile(double percentile) const {
+  const uint32 total = count();
+  if (total == 0) {
+    return 0;
+  }
+
+  uint32 target = static_cast<uint32>(total * percentile);
+  if (target >= total) {
+    target = total - 1;
+  }
+  uint32 seen = 0;
+  for (uint32 i = 0; i < NUM_BUCKETS; i++) {
+    seen += buckets_[i].load(std::memory_order_relaxed);
+    if (seen > target) {
+      const uint32 lower = BucketLowerBound(i);
+      const uint32 upper = i + 1 < NUM_BUCKETS ? BucketLowerBound(i + 1) : max();
+      const uint32 midpoint = lower + (upper - lower) / 2;
+      return midpoint < max() ? midpoint : max();
+    }
+  }
+  return max();
+}
+
+void CycleHistogram::Reset() {
+  for (auto& bucket : buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  calls_.store(0, std::memory_order_relaxed);
+  count_.store(0, std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+}
+
+const char* const PROBE_NAMES[] = {
+  "GameMonitor::Draw",
+  "GameMonitor::RefreshScreen",
+  "GameMonitor::OnAction",
+  "DrawHook",
+  "RefreshHook",
+  "OnActionHook",
+};
+static_assert(sizeof(PROBE_NAMES) / sizeof(PROBE_NAMES[0]) == static_cast<size_t>(Probe::Count),
+    "every probe must have a name");
+
+namespace {
+
+// Cycle counter calibration, relative to when the module was loaded
+struct TscCalibration {
+  TscCalibration()
+    : startTsc(__rdtsc()),
+      startTime(std::chrono::steady_clock::now()) {
+  }
+
+  // Returns the measured TSC frequency, or 0 if not enough time has passed to measure it
+  double CyclesPerNanosecond() const {
+    const uint64 tsc = __rdtsc();
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+    if (elapsed < 1000000) {
+      return 0;
+    }
+    return static_cast<double>(tsc - startTsc) / elapsed;
+  }
+
+  uint64 startTsc;
+  std::chrono::steady_clock::time_point startTime;
+};
+
+#ifdef APM_ENABLE_PROFILING
+const TscCalibration calibration;
+
+uint32 CyclesToNanos(uint32 cycles, double cyclesPerNano) {
+  return cyclesPerNano > 0 ? static_cast<uint32>(cycles / cyclesPerNano) : cycles;
+}
+#endif
+
+}  // namespace
+
+std::array<CycleHistogram, static_cast<size_t>(Probe::Count)> probeHistograms;
+
+bool TakeProfileSnapshot(ProfileSnapshot* snapshot) {
+  std::memset(snapshot, 0, sizeof(*snapshot));
+  snapshot->version = PROFILE_SNAPSHOT_VERSION;
+#ifndef APM_ENABLE_PROFILING
+  return false;
+#else
+  const double cyclesPerNano = calibration.CyclesPerNanosecond();
+  snapshot->numProbes = static_cast<uint32>(Probe::Count);
+  for (uint32 i = 0; i < snapshot->numProbes; i++) {
+    const CycleHistogram& histogram = probeHistograms[i];
+    ProbeStats& stats = snapshot->probes[i];
+    std::strncpy(stats.name, PROBE_NAMES[i], sizeof(stats.name) - 1);
+    stats.calls = histogram.calls();
+    stats.count = histogram.count();
+    stats.p50 = CyclesToNanos(histogram.Percentile(0.50), cyclesPerNano);
+    stats.p99 = CyclesToNanos(histogram.Percentile(0.99), cyclesPerNano);
+    stats.max = CyclesToNanos(histogram.max(), cyclesPerNano);
+  }
+  return true;
+#endif
+}
+
+void ResetProfile() {
+  for (auto& histogram : probeHistograms) {
+    histogram.Reset();
+  }
+}
+
+}  // namespace apm
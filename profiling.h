@@ -0,0 +1,172 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+#include "./types.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+// Hot path instrumentation. Build with APM_ENABLE_PROFILING defined to compile the probes in;
+// otherwise APM_PROBE expands to nothing and the snapshot is always empty.
+//
+// Each probe site records into its own fixed size histogram of rdtsc cycle counts. Every probe is
+// only ever hit from a single thread (the BW game loop thread, for all of the current ones), so
+// recording uses plain relaxed loads and stores rather than locked instructions. rdtsc itself is
+// the expensive part (~25 cycles on bare metal, and 80+ under some hypervisors), so probes count
+// every call but only time one in PROBE_SAMPLE_INTERVAL of them. An untimed call costs a load, a
+// store and a branch; the percentiles come from the timed sample, which only misses out on max
+// being exact.
+
+namespace apm {
+
+enum class Probe {
+  Draw = 0,
+  RefreshScreen,
+  OnAction,
+  DrawHook,
+  RefreshHook,
+  OnActionHook,
+  Count
+};
+
+const uint32 PROBE_SAMPLE_INTERVAL = 8;
+
+// Log-linear histogram of cycle counts: values are bucketed by their highest set bit, with each
+// power of two split into 4 linear sub-buckets (so bucket bounds are within 25% of the value)
+class CycleHistogram {
+public:
+  static const uint32 SUB_BUCKET_BITS = 2;
+  static const uint32 SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+  static const uint32 NUM_BUCKETS = (32 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+  CycleHistogram();
+
+  // Counts a call, returning true if it's one that should be timed. Single writer only.
+  bool CountCall() {
+    const uint32 calls = calls_.load(std::memory_order_relaxed);
+    calls_.store(calls + 1, std::memory_order_relaxed);
+    return calls % PROBE_SAMPLE_INTERVAL == 0;
+  }
+  // Single writer only
+  void Record(uint64 cycles) {
+    const uint32 value = cycles > 0xFFFFFFFF ? 0xFFFFFFFF : static_cast<uint32>(cycles);
+    Increment(&buckets_[BucketFor(value)]);
+    Increment(&count_);
+    if (value > max_.load(std::memory_order_relaxed)) {
+      max_.store(value, std::memory_order_relaxed);
+    }
+  }
+
+  // Safe to call from any thread, although the result may be torn across concurrent Records
+  uint32 calls() const { return calls_.load(std::memory_order_relaxed); }
+  // Number of values recorded
+  uint32 count() const { return count_.load(std::memory_order_relaxed); }
+  uint32 max() const { return max_.load(std::memory_order_relaxed); }
+  // Returns an approximation (the midpoint of the containing bucket) of the given percentile, in
+  // cycles
+  uint32 Percentile(double percentile) const;
+  void Reset();
+
+  static uint32 BucketFor(uint32 value) {
+    if (value < SUB_BUCKETS) {
+      return value;
+    }
+    const uint32 msb = HighestBit(value);
+    const uint32 sub = (value >> (msb - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return (msb - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+  }
+  static uint32 BucketLowerBound(uint32 bucket);
+
+private:
+  // Disable copying
+  CycleHistogram(const CycleHistogram&) = delete;
+  CycleHistogram& operator=(const CycleHistogram&) = delete;
+
+  static void Increment(std::atomic<uint32>* counter) {
+    counter->store(counter->load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  static uint32 HighestBit(uint32 value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse(&index, value);
+    return index;
+#else
+    return 31 - __builtin_clz(value);
+#endif
+  }
+
+  std::array<std::atomic<uint32>, NUM_BUCKETS> buckets_;
+  std::atomic<uint32> calls_;
+  std::atomic<uint32> count_;
+  std::atomic<uint32> max_;
+};
+
+struct ProbeStats {
+  char name[32];
+  uint32 calls;
+  // Number of calls timed, which the rest are computed from
+  uint32 count;
+  // All in nanoseconds
+  uint32 p50;
+  uint32 p99;
+  uint32 max;
+};
+
+const uint32 PROFILE_SNAPSHOT_VERSION = 2;
+// Plain data, so that it can be copied into shared memory for external tools (see telemetry.h)
+struct ProfileSnapshot {
+  uint32 version;
+  uint32 numProbes;
+  ProbeStats probes[static_cast<uint32>(Probe::Count)];
+};
+
+// Defined at namespace scope (rather than created on first use) so that probes get to their
+// histogram without a call or an initialization check
+extern std::array<CycleHistogram, static_cast<size_t>(Probe::Count)> probeHistograms;
+
+inline CycleHistogram& GetProbeHistogram(Probe probe) {
+  return probeHistograms[static_cast<size_t>(probe)];
+}
+// Fills out snapshot with the current stats of every probe. Returns false (leaving snapshot empty)
+// if profiling is compiled out.
+bool TakeProfileSnapshot(ProfileSnapshot* snapshot);
+void ResetProfile();
+
+class ScopedProbe {
+public:
+  explicit ScopedProbe(Probe probe)
+    : histogram_(GetProbeHistogram(probe)),
+      start_(histogram_.CountCall() ? __rdtsc() : 0) {
+  }
+  ~ScopedProbe() {
+    // The counter is never 0 in practice, so 0 can stand for an untimed call
+    if (start_ != 0) {
+      histogram_.Record(__rdtsc() - start_);
+    }
+  }
+
+private:
+  // Disable copying
+  ScopedProbe(const ScopedProbe&) = delete;
+  ScopedProbe& operator=(const ScopedProbe&) = delete;
+
+  CycleHistogram& histogram_;
+  uint64 start_;
+};
+
+}  // namespace apm
+
+#ifdef APM_ENABLE_PROFILING
+#define APM_PROBE_CONCAT_(a, b) a##b
+#define APM_PROBE_NAME_(line) APM_PROBE_CONCAT_(apmProbe_, line)
+// Times the rest of the enclosing scope
+#define APM_PROBE(probe) ::apm::ScopedProbe APM_PROBE_NAME_(__LINE__)(::apm::Probe::probe)
+#else
+#define APM_PROBE(probe)
+#endif
@@ -0,0 +1,114 @@
+#include "./remote_brood_war.h"
+
+#include <cstdint>
+#include <memory>
+
+#include "./action_forwarding.h"
+#include "./brood_war.h"
+#include "./game_monitor.h"
+#include "./remote_memory.h"
+#include "./simulated_brood_war.h"
+#include "./types.h"
+
+namespace apm {
+
+using sbat::RemoteProcessMemory;
+using std::unique_ptr;
+
+RemoteBroodWar::RemoteBroodWar(unique_ptr<RemoteProcessMemory> process, const BroodWar& target)
+  : process_(std::move(process)),
+    mirror_(),
+    monitorInGame_(false) {
+  mirror_.SetRecordingDrawText(false);
+
+  SimulatedMemory& memory = mirror_.memory();
+  Mirror(target.isInGame, &memory.isInGame);
+  Mirror(target.isInReplay, &memory.isInReplay);
+  Mirror(target.gameTimeTicks, &memory.gameTimeTicks);
+  Mirror(target.myPlayerId, &memory.myPlayerId);
+  Mirror(target.firstPlayerInfo, memory.playerInfo.data(), memory.playerInfo.size());
+  Mirror(target.buildingsControlled, memory.buildingsControlled.data(),
+      memory.buildingsControlled.size());
+  Mirror(target.population, memory.population.data(), memory.population.size());
+  Mirror(target.minerals, memory.minerals.data(), memory.minerals.size());
+  Mirror(target.vespene, memory.vespene.data(), memory.vespene.size());
+  Mirror(target.firstPlayerColor, memory.playerColor.data(), memory.playerColor.size());
+}
+
+unique_ptr<RemoteBroodWar> RemoteBroodWar::Attach(const ActionForwardReader& reader) {
+  const uint32 processId = reader.writerProcessId();
+  if (processId == 0) {
+    return unique_ptr<RemoteBroodWar>();
+  }
+  const BroodWar target = CreateDataForVersion(reader.writerBwVersion(),
+      static_cast<uintptr_t>(reader.writerModuleBase()));
+  if (!target.isInGame.valid()) {
+    return unique_ptr<RemoteBroodWar>();
+  }
+  unique_ptr<RemoteProcessMemory> process = RemoteProcessMemory::Open(processId);
+  if (!process) {
+    return unique_ptr<RemoteBroodWar>();
+  }
+  return unique_ptr<RemoteBroodWar>(new RemoteBroodWar(std::move(process), target));
+}
+
+template <typename T>
+void RemoteBroodWar::Mirror(const DataOffset<T>& remote, T* local, size_t count) {
+  if (remote.valid()) {
+    process_->AddRegion(reinterpret_cast<uintptr_t>(remote.get()), local, sizeof(T) * count);
+  }
+}
+
+BroodWar RemoteBroodWar::Create() {
+  BroodWar bw = mirror_.Create();
+  // Not mirrored, so this turns unit stats off (as if the table hadn't been located)
+  bw.unitNodes = DataOffset<byte>();
+  return bw;
+}
+
+bool RemoteBroodWar::Step(ActionForwardReader* reader, GameMonitor* monitor) {
+  if (!Sample()) {
+    return false;
+  }
+
+  const bool inGame = mirror_.memory().isInGame;
+  if (monitorInGame_) {
+    // Everything pending was forwarded before the game ended (BW forwards on the same thread that
+    // ends it), so it all belongs to the monitor's current game, even if this Update ends it
+    ForwardActions(reader, monitor);
+    monitor->Update();
+  } else {
+    // Lets a game that just started be set up (which clears the per-game state) first. Anything
+    // pending while there's no game is from one that started after the sample, so it's left for
+    // the next Step rather than fed to a monitor that isn't in a game.
+    monitor->Update();
+    if (inGame) {
+      ForwardActions(reader, monitor);
+    }
+  }
+  monitorInGame_ = inGame;
+  return true;
+}
+
+bool RemoteBroodWar::Sample() {
+  return process_->Read();
+}
+
+size_t RemoteBroodWar::ForwardActions(ActionForwardReader* reader, GameMonitor* monitor) {
+  SimulatedMemory& memory = mirror_.memory();
+  const uint32 sampledTicks = memory.gameTimeTicks;
+  size_t count = 0;
+  ForwardedAction action;
+  while (reader->Next(&action)) {
+    memory.gameTimeTicks = action.tick;
+    memory.activePlayerId = action.player;
+    monitor->OnAction(action.data.data());
+    count++;
+  }
+
+  memory.gameTimeTicks = sampledTicks;
+  memory.activePlayerId = 0xFFFFFFFF;
+  return count;
+}
+
+}  // namespace apm
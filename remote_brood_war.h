@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory>
+
+#include "./action_forwarding.h"
+#include "./brood_war.h"
+#include "./remote_memory.h"
+#include "./simulated_brood_war.h"
+#include "./types.h"
+
+namespace apm {
+
+class GameMonitor;
+
+// BroodWar backend for running GameMonitor in a process other than BW's, so that the only work
+// done inside the game is the plugin forwarding actions (see ActionForwardWriter). Every DataOffset
+// of the BroodWar it creates points into a local mirror of the game's data, which Sample refreshes
+// with one batched read of the game's memory. Nothing can be drawn from outside the game, so the
+// monitor only produces its logs, history and telemetry; the drawing functions are the headless
+// ones from SimulatedBroodWar, with recording turned off.
+//
+// A host drives it much like GameSimulation does, calling Step on every tick in place of the
+// monitor's Update (without Starting the monitor's own thread). monitor_host.cpp is that host for
+// BW itself.
+class RemoteBroodWar {
+public:
+  // target describes where the data is in the game's process (its DataOffsets are addresses there,
+  // not in this process). The unit table isn't mirrored: unit stats are only used by the overlay.
+  RemoteBroodWar(std::unique_ptr<sbat::RemoteProcessMemory> process, const BroodWar& target);
+  // Attaches to the game whose plugin is forwarding to reader, using the data layout for the BW
+  // version it published. Returns nullptr if no plugin has attached yet, its version isn't known or
+  // its process can't be opened for reading.
+  static std::unique_ptr<RemoteBroodWar> Attach(const ActionForwardReader& reader);
+
+  // The returned BroodWar refers to this object, so it must outlive it
+  BroodWar Create();
+
+  // Samples the game, then runs monitor's Update and feeds it the pending actions in whichever
+  // order keeps each action in the game it came from: a game that just started is set up before
+  // its first actions arrive, and a game that just ended gets its last ones before it's finished.
+  // Returns false if the game's memory couldn't be read (most likely because it exited).
+  bool Step(ActionForwardReader* reader, GameMonitor* monitor);
+
+  // Copies the game's current data into the mirror. Returns false if the game's memory couldn't be
+  // read.
+  bool Sample();
+  // Feeds every action reader has pending to monitor (which must be using a BroodWar from this),
+  // with the mirror's tick and active player set to those the action was forwarded with. Returns
+  // the number of actions fed. Step takes care of calling this at the right point around Update.
+  size_t ForwardActions(ActionForwardReader* reader, GameMonitor* monitor);
+
+  SimulatedMemory& memory() { return mirror_.memory(); }
+  const sbat::RemoteProcessMemory& process() const { return *process_; }
+
+private:
+  // Disable copying
+  RemoteBroodWar(const RemoteBroodWar&) = delete;
+  RemoteBroodWar& operator=(const RemoteBroodWar&) = delete;
+
+  template <typename T>
+  void Mirror(const DataOffset<T>& remote, T* local, size_t count = 1);
+
+  std::unique_ptr<sbat::RemoteProcessMemory> process_;
+  SimulatedBroodWar mirror_;
+  // Whether the game was running as of the last Step, which is what the monitor last saw
+  bool monitorInGame_;
+};
+
+}  // namespace apm
@@ -0,0 +1,183 @@
+#include "./remote_memory.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#endif
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "./types.h"
+
+using std::unique_ptr;
+
+namespace sbat {
+
+// Regions closer together than this are read as one span. It's less than a page, so the gap
+// between them can only touch pages that the regions themselves are in, and merging can't cause a
+// read of memory that isn't mapped.
+const size_t MAX_SPAN_GAP = 512;
+
+#ifdef _WIN32
+
+unique_ptr<RemoteProcessMemory> RemoteProcessMemory::Open(uint32 processId) {
+  HANDLE handle = OpenProcess(PROCESS_VM_READ, FALSE, processId);
+  if (handle == NULL) {
+    return unique_ptr<RemoteProcessMemory>();
+  }
+  return unique_ptr<RemoteProcessMemory>(new RemoteProcessMemory(processId, handle));
+}
+
+RemoteProcessMemory::~RemoteProcessMemory() {
+  CloseHandle(handle_);
+}
+
+bool RemoteProcessMemory::ReadSpans() {
+  for (const Span& span : spans_) {
+    SIZE_T bytesRead = 0;
+    readCalls_++;
+    if (!ReadProcessMemory(handle_, reinterpret_cast<LPCVOID>(span.remoteAddress), span.local,
+        span.size, &bytesRead) || bytesRead != span.size) {
+      errorCode_ = GetLastError();
+      return false;
+    }
+  }
+  return true;
+}
+
+#else
+
+unique_ptr<RemoteProcessMemory> RemoteProcessMemory::Open(uint32 processId) {
+  if (kill(static_cast<pid_t>(processId), 0) != 0) {
+    return unique_ptr<RemoteProcessMemory>();
+  }
+  return unique_ptr<RemoteProcessMemory>(new RemoteProcessMemory(processId, nullptr));
+}
+
+RemoteProcessMemory::~RemoteProcessMemory() {
+}
+
+bool RemoteProcessMemory::ReadSpans() {
+#ifdef __linux__
+  std::vector<iovec> localVecs(std::min<size_t>(spans_.size(), IOV_MAX));
+  std::vector<iovec> remoteVecs(localVecs.size());
+  for (size_t begin = 0; begin < spans_.size(); begin += localVecs.size()) {
+    const size_t end = std::min(begin + localVecs.size(), spans_.size());
+    size_t expected = 0;
+    for (size_t i = begin; i < end; i++) {
+      localVecs[i - begin].iov_base = spans_[i].local;
+      localVecs[i - begin].iov_len = spans_[i].size;
+      remoteVecs[i - begin].iov_base = reinterpret_cast<void*>(spans_[i].remoteAddress);
+      remoteVecs[i - begin].iov_len = spans_[i].size;
+      expected += spans_[i].size;
+    }
+
+    readCalls_++;
+    const ssize_t bytesRead = process_vm_readv(static_cast<pid_t>(processId_), localVecs.data(),
+        end - begin, remoteVecs.data(), end - begin, 0);
+    if (bytesRead < 0 || static_cast<size_t>(bytesRead) != expected) {
+      // A short read means one of the spans wasn't mapped
+      errorCode_ = bytesRead < 0 ? errno : EFAULT;
+      return false;
+    }
+  }
+  return true;
+#else
+  errorCode_ = ENOSYS;
+  return false;
+#endif
+}
+
+#endif
+
+RemoteProcessMemory::RemoteProcessMemory(uint32 processId, void* handle)
+  : processId_(processId),
+    handle_(handle),
+    regions_(),
+    spans_(),
+    staging_(),
+    spansValid_(false),
+    errorCode_(0),
+    readCalls_(0) {
+}
+
+void RemoteProcessMemory::AddRegion(uintptr_t remoteAddress, void* local, size_t size) {
+  if (size == 0) {
+    return;
+  }
+  Region region = { remoteAddress, reinterpret_cast<byte*>(local), size };
+  regions_.push_back(region);
+  spansValid_ = false;
+}
+
+void RemoteProcessMemory::ClearRegions() {
+  regions_.clear();
+  spansValid_ = false;
+}
+
+void RemoteProcessMemory::BuildSpans() {
+  std::sort(regions_.begin(), regions_.end(), [](const Region& a, const Region& b) {
+    return a.remoteAddress < b.remoteAddress;
+  });
+
+  spans_.clear();
+  size_t stagingSize = 0;
+  for (size_t i = 0; i < regions_.size();) {
+    Span span = { regions_[i].remoteAddress, regions_[i].size, nullptr, i, i + 1 };
+    for (; span.endRegion < regions_.size(); span.endRegion++) {
+      const Region& next = regions_[span.endRegion];
+      if (next.remoteAddress > span.remoteAddress + span.size + MAX_SPAN_GAP) {
+        break;
+      }
+      span.size = std::max(span.size, next.remoteAddress + next.size - span.remoteAddress);
+    }
+    if (span.endRegion - span.firstRegion > 1) {
+      // Pointed into staging_ below, once it's done being resized
+      stagingSize += span.size;
+    } else {
+      span.local = regions_[i].local;
+    }
+    spans_.push_back(span);
+    i = span.endRegion;
+  }
+
+  staging_.resize(stagingSize);
+  size_t stagingOffset = 0;
+  for (Span& span : spans_) {
+    if (span.local == nullptr) {
+      span.local = staging_.data() + stagingOffset;
+      stagingOffset += span.size;
+    }
+  }
+  spansValid_ = true;
+}
+
+bool RemoteProcessMemory::Read() {
+  if (!spansValid_) {
+    BuildSpans();
+  }
+  if (!ReadSpans()) {
+    return false;
+  }
+
+  for (const Span& span : spans_) {
+    if (span.endRegion - span.firstRegion == 1) {
+      continue;
+    }
+    for (size_t i = span.firstRegion; i < span.endRegion; i++) {
+      const Region& region = regions_[i];
+      std::memcpy(region.local, span.local + (region.remoteAddress - span.remoteAddress),
+          region.size);
+    }
+  }
+  return true;
+}
+
+}  // namespace sbat
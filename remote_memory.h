@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "./types.h"
+
+namespace sbat {
+
+// Reads regions of another process's memory, batched so that sampling many scattered variables
+// costs as few system calls as possible. Regions are registered up front and each Read copies all
+// of them. Regions that lie close together in the other process are merged into a single span
+// (read through a staging buffer), and on Linux every span is gathered by one process_vm_readv
+// call (per IOV_MAX spans). Windows has no vectored equivalent, so there it's one
+// ReadProcessMemory call per span.
+class RemoteProcessMemory {
+public:
+  // Returns nullptr if the process doesn't exist or can't be opened for reading
+  static std::unique_ptr<RemoteProcessMemory> Open(uint32 processId);
+  ~RemoteProcessMemory();
+
+  // Registers size bytes at remoteAddress in the other process to be copied to local on every Read
+  void AddRegion(uintptr_t remoteAddress, void* local, size_t size);
+  void ClearRegions();
+  // Copies every region. Returns false if any of them couldn't be read (e.g. the process exited or
+  // unmapped it), in which case the local copies may be partially updated.
+  bool Read();
+
+  // The platform error code from the last failed Read
+  uint32 errorCode() const { return errorCode_; }
+  // System calls made by every Read so far
+  uint64 readCalls() const { return readCalls_; }
+  // Number of separate spans each Read covers (valid after the first Read)
+  size_t numSpans() const { return spans_.size(); }
+
+private:
+  struct Region {
+    uintptr_t remoteAddress;
+    byte* local;
+    size_t size;
+  };
+
+  struct Span {
+    uintptr_t remoteAddress;
+    size_t size;
+    // Where the span is read to: straight to the region's local copy for spans of a single region,
+    // otherwise into staging_ (and scattered from there)
+    byte* local;
+    // Range of regions_ [firstRegion, endRegion) the span covers
+    size_t firstRegion;
+    size_t endRegion;
+  };
+
+  RemoteProcessMemory(uint32 processId, void* handle);
+  // Disable copying
+  RemoteProcessMemory(const RemoteProcessMemory&) = delete;
+  RemoteProcessMemory& operator=(const RemoteProcessMemory&) = delete;
+
+  void BuildSpans();
+  bool ReadSpans();
+
+  uint32 processId_;
+  // Process handle on Windows, unused elsewhere
+  void* handle_;
+  std::vector<Region> regions_;
+  std::vector<Span> spans_;
+  std::vector<byte> staging_;
+  bool spansValid_;
+  uint32 errorCode_;
+  uint64 readCalls_;
+};
+
+}  // namespace sbat
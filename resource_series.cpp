@@ -0,0 +1,252 @@
+#include "./resource_series.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "./game_log.h"
+#include "./types.h"
+
+namespace apm {
+
+const size_t DeltaColumn::CHECKPOINT_INTERVAL;
+const int16 DeltaColumn::ESCAPE;
+const uint32 ResourceSeries::DEFAULT_INTERVAL_TICKS;
+const size_t ResourceSeries::DEFAULT_EXPECTED_SAMPLES;
+
+DeltaColumn::DeltaColumn(size_t expectedSize, GameArena* arena)
+  : deltas_(ArenaAllocator<int16>(arena)),
+    checkpoints_(ArenaAllocator<Checkpoint>(arena)),
+    expectedSize_(expectedSize),
+    size_(0),
+    last_(0) {
+  deltas_.reserve(expectedSize_);
+  checkpoints_.reserve(expectedSize_ / CHECKPOINT_INTERVAL + 1);
+}
+
+void DeltaColumn::Append(int32 value) {
+  if (size_ % CHECKPOINT_INTERVAL == 0) {
+    Checkpoint checkpoint = { value, static_cast<uint32>(deltas_.size()) };
+    checkpoints_.push_back(checkpoint);
+  } else {
+    const int64 delta = static_cast<int64>(value) - last_;
+    if (delta > ESCAPE && delta <= 32767) {
+      deltas_.push_back(static_cast<int16>(delta));
+    } else {
+      deltas_.push_back(ESCAPE);
+      deltas_.push_back(static_cast<int16>(static_cast<uint16>(value)));
+      deltas_.push_back(static_cast<int16>(static_cast<uint16>(static_cast<uint32>(value) >> 16)));
+    }
+  }
+  last_ = value;
+  size_++;
+}
+
+void DeltaColumn::Clear() {
+  deltas_.clear();
+  checkpoints_.clear();
+  size_ = 0;
+  last_ = 0;
+}
+
+void DeltaColumn::Reset() {
+  ResetArenaVector(&deltas_);
+  ResetArenaVector(&checkpoints_);
+  deltas_.reserve(expectedSize_);
+  checkpoints_.reserve(expectedSize_ / CHECKPOINT_INTERVAL + 1);
+  size_ = 0;
+  last_ = 0;
+}
+
+void DeltaColumn::Truncate(size_t size) {
+  if (size >= size_) {
+    return;
+  }
+  if (size == 0) {
+    Clear();
+    return;
+  }
+
+  // Walk up to the new last value to find where its delta ends
+  const size_t lastIndex = size - 1;
+  const Checkpoint& checkpoint = checkpoints_[lastIndex / CHECKPOINT_INTERVAL];
+  int32 value = checkpoint.value;
+  const int16* delta = deltas_.data() + checkpoint.offset;
+  for (size_t i = 0; i < lastIndex % CHECKPOINT_INTERVAL; i++) {
+    value = ApplyDelta(value, &delta);
+  }
+  const size_t deltasSize = static_cast<size_t>(delta - deltas_.data());
+  deltas_.resize(deltasSize);
+  checkpoints_.resize(lastIndex / CHECKPOINT_INTERVAL + 1);
+  size_ = size;
+  last_ = value;
+}
+
+int32 DeltaColumn::at(size_t index) const {
+  int32 result = 0;
+  ForEach(index, index + 1, [&result](size_t, int32 value) {
+    result = value;
+  });
+  return result;
+}
+
+ResourceSeries::ResourceSeries(uint32 intervalTicks, size_t expectedSamples, GameArena* arena)
+  : intervalTicks_(intervalTicks != 0 ? intervalTicks : 1),
+    size_(0),
+    columns_() {
+  columns_.reserve(RESOURCE_COUNT * 12);
+  for (size_t i = 0; i < RESOURCE_COUNT * 12; i++) {
+    columns_.emplace_back(expectedSamples, arena);
+  }
+}
+
+void ResourceSeries::Reset() {
+  for (auto& column : columns_) {
+    column.Reset();
+  }
+  size_ = 0;
+}
+
+void ResourceSeries::Rewind(uint32 tick) {
+  const size_t index = tick / intervalTicks_;
+  if (index >= size_) {
+    return;
+  }
+
+  for (auto& column : columns_) {
+    column.Truncate(index);
+  }
+  size_ = index;
+}
+
+void ResourceSeries::Record(uint32 tick, const ResourceSample& sample) {
+  const size_t index = tick / intervalTicks_;
+  if (index < size_) {
+    return;
+  }
+
+  // Fill in any intervals we missed, so that sample indexes stay tied to game time
+  for (; size_ < index; size_++) {
+    for (auto& column : columns_) {
+      column.Append(column.back());
+    }
+  }
+  for (size_t resource = 0; resource < RESOURCE_COUNT; resource++) {
+    for (size_t player = 0; player < 12; player++) {
+      columns_[resource * 12 + player].Append(sample.values[resource][player]);
+    }
+  }
+  size_++;
+}
+
+int32 ResourceSeries::Value(size_t player, Resource resource, size_t index) const {
+  return column(player, resource).at(index);
+}
+
+int32 ResourceSeries::Current(size_t player, Resource resource) const {
+  return column(player, resource).back();
+}
+
+ResourceFlow ResourceSeries::Flow(size_t player, Resource resource, size_t begin,
+    size_t end) const {
+  ResourceFlow flow = ResourceFlow();
+  end = std::min(end, size_);
+  if (begin >= end) {
+    return flow;
+  }
+
+  int64 total = 0;
+  int32 previous = 0;
+  column(player, resource).ForEach(begin, end, [&](size_t index, int32 value) {
+    if (index != begin) {
+      const int32 delta = value - previous;
+      if (delta > 0) {
+        flow.gained += delta;
+      } else {
+        flow.spent -= delta;
+      }
+    }
+    total += value;
+    previous = value;
+  });
+  flow.averageValue = static_cast<double>(total) / (end - begin);
+  flow.ticks = static_cast<uint32>(end - begin - 1) * intervalTicks_;
+  return flow;
+}
+
+const double TICKS_PER_MINUTE = 60000.0 / 42;
+double ResourceSeries::IncomePerMinute(size_t player, Resource resource,
+    uint32 windowTicks) const {
+  const size_t windowSamples = windowTicks / intervalTicks_ + 1;
+  const size_t begin = size_ > windowSamples ? size_ - windowSamples : 0;
+  const ResourceFlow flow = Flow(player, resource, begin, size_);
+  return flow.ticks != 0 ? flow.gained * TICKS_PER_MINUTE / flow.ticks : 0;
+}
+
+double ResourceSeries::SpendingQuotient(size_t player) const {
+  const ResourceFlow minerals = Flow(player, Resource::Minerals, 0, size_);
+  const ResourceFlow vespene = Flow(player, Resource::Vespene, 0, size_);
+  if (minerals.ticks == 0) {
+    return 0;
+  }
+
+  const double income = (minerals.gained + vespene.gained) * TICKS_PER_MINUTE / minerals.ticks;
+  const double unspent = std::max(minerals.averageValue + vespene.averageValue, 1.0);
+  return 35 * (0.00137 * income - std::log(unspent)) + 240;
+}
+
+void ResourceSeries::Chart(size_t player, Resource resource, int32* out,
+    size_t numBuckets) const {
+  std::fill(out, out + numBuckets, 0);
+  if (size_ == 0 || numBuckets == 0) {
+    return;
+  }
+
+  std::vector<int64> sums(numBuckets);
+  std::vector<uint32> counts(numBuckets);
+  const size_t total = size_;
+  column(player, resource).ForEach(0, size_, [&](size_t index, int32 value) {
+    const size_t bucket = index * numBuckets / total;
+    sums[bucket] += value;
+    counts[bucket]++;
+  });
+  for (size_t i = 0; i < numBuckets; i++) {
+    // Buckets without any samples (more buckets than samples) repeat the one before them
+    if (counts[i] != 0) {
+      out[i] = static_cast<int32>(sums[i] / counts[i]);
+    } else if (i > 0) {
+      out[i] = out[i - 1];
+    }
+  }
+}
+
+bool ResourceSeries::LoadFromGameLog(const byte* data, size_t size) {
+  Reset();
+  GameLogDecoder decoder(data, size);
+  GameLogHeader header;
+  if (decoder.ReadHeader(&header) != GameLogDecoder::Result::Ok) {
+    return false;
+  }
+
+  ResourceSample sample = ResourceSample();
+  GameLogEvent event;
+  GameLogDecoder::Result result;
+  while ((result = decoder.Next(&event)) == GameLogDecoder::Result::Ok) {
+    if (event.type == GameLogEvent::Type::Seek) {
+      Rewind(event.tick);
+    }
+    if (event.type != GameLogEvent::Type::Sample) {
+      continue;
+    }
+    for (size_t i = 0; i < 12; i++) {
+      sample.at(Resource::Minerals, i) = event.sample.minerals[i];
+      sample.at(Resource::Vespene, i) = event.sample.vespene[i];
+      sample.at(Resource::Population, i) = static_cast<int32>(event.sample.population[i]);
+    }
+    Record(event.tick, sample);
+  }
+
+  return result == GameLogDecoder::Result::Done;
+}
+
+}  // namespace apm
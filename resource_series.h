@@ -0,0 +1,175 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "./game_arena.h"
+#include "./types.h"
+
+namespace apm {
+
+// A column of int32 values stored as int16 deltas from the previous value, with a full value
+// checkpoint every CHECKPOINT_INTERVAL entries so that random access only has to sum up a short
+// run of deltas. Deltas that don't fit in an int16 are escaped and stored in full.
+class DeltaColumn {
+public:
+  static const size_t CHECKPOINT_INTERVAL = 64;
+
+  // The values come from arena, if there is one (see ArenaAllocator)
+  explicit DeltaColumn(size_t expectedSize = 0, GameArena* arena = nullptr);
+
+  void Append(int32 value);
+  // Empties the column, keeping its storage
+  void Clear();
+  // Empties the column and drops its storage, reserving expectedSize again
+  void Reset();
+  // Drops every value from index size on
+  void Truncate(size_t size);
+
+  size_t size() const { return size_; }
+  int32 back() const { return last_; }
+  int32 at(size_t index) const;
+
+  // Calls fn(index, value) for each value in [begin, end)
+  template <typename Fn>
+  void ForEach(size_t begin, size_t end, Fn fn) const {
+    if (end > size_) {
+      end = size_;
+    }
+    if (begin >= end) {
+      return;
+    }
+
+    size_t index = begin - begin % CHECKPOINT_INTERVAL;
+    const Checkpoint& checkpoint = checkpoints_[index / CHECKPOINT_INTERVAL];
+    int32 value = checkpoint.value;
+    const int16* delta = deltas_.data() + checkpoint.offset;
+    for (;;) {
+      if (index >= begin) {
+        fn(index, value);
+      }
+      index++;
+      if (index == end) {
+        break;
+      }
+      if (index % CHECKPOINT_INTERVAL == 0) {
+        value = checkpoints_[index / CHECKPOINT_INTERVAL].value;
+      } else {
+        value = ApplyDelta(value, &delta);
+      }
+    }
+  }
+
+private:
+  static const int16 ESCAPE = -32768;
+
+  struct Checkpoint {
+    int32 value;
+    uint32 offset;
+  };
+
+  static int32 ApplyDelta(int32 value, const int16** delta) {
+    const int16* pos = *delta;
+    if (*pos != ESCAPE) {
+      *delta = pos + 1;
+      return value + *pos;
+    }
+    *delta = pos + 3;
+    return static_cast<int32>(
+        static_cast<uint32>(static_cast<uint16>(pos[1])) |
+        (static_cast<uint32>(static_cast<uint16>(pos[2])) << 16));
+  }
+
+  ArenaVector<int16> deltas_;
+  ArenaVector<Checkpoint> checkpoints_;
+  size_t expectedSize_;
+  size_t size_;
+  int32 last_;
+};
+
+enum class Resource {
+  Minerals = 0,
+  Vespene,
+  Population,
+  Buildings,
+  Count
+};
+
+const size_t RESOURCE_COUNT = static_cast<size_t>(Resource::Count);
+
+// Values of every resource for every player slot at a point in time
+struct ResourceSample {
+  std::array<std::array<int32, 12>, RESOURCE_COUNT> values;
+
+  int32& at(Resource resource, size_t player) {
+    return values[static_cast<size_t>(resource)][player];
+  }
+};
+
+struct ResourceFlow {
+  // Sums of the increases and decreases between consecutive samples. With short sample intervals
+  // these are a good approximation of the amount gathered and spent.
+  int64 gained;
+  int64 spent;
+  double averageValue;
+  // Length of the measured range, in game ticks
+  uint32 ticks;
+};
+
+// Per player time series of resources, sampled every intervalTicks game ticks into delta compressed
+// columns. Whole game queries only have to scan a few thousand int16s per column, so they're cheap
+// enough to run every frame.
+class ResourceSeries {
+public:
+  static const uint32 DEFAULT_INTERVAL_TICKS = 24;
+  // An hour at ~1 second intervals
+  static const size_t DEFAULT_EXPECTED_SAMPLES = 3600;
+
+  // expectedSamples is used to preallocate the columns, they'll grow if needed. The columns come
+  // from arena, if there is one (see ArenaAllocator).
+  explicit ResourceSeries(uint32 intervalTicks = DEFAULT_INTERVAL_TICKS,
+      size_t expectedSamples = DEFAULT_EXPECTED_SAMPLES, GameArena* arena = nullptr);
+
+  void Reset();
+  // Drops the samples of tick's interval and every one after it, so that recording can pick up
+  // from tick again (e.g. after a replay is rewound)
+  void Rewind(uint32 tick);
+  // Records sample as the values at tick. Only the first sample in each interval is kept, and any
+  // intervals skipped since the last one are filled in with that last sample's values.
+  void Record(uint32 tick, const ResourceSample& sample);
+
+  uint32 intervalTicks() const { return intervalTicks_; }
+  // Number of samples recorded, sample i being of tick i * intervalTicks()
+  size_t size() const { return size_; }
+
+  int32 Value(size_t player, Resource resource, size_t index) const;
+  int32 Current(size_t player, Resource resource) const;
+
+  // Flow over samples [begin, end)
+  ResourceFlow Flow(size_t player, Resource resource, size_t begin, size_t end) const;
+  // Approximate rate of gathering over the last windowTicks of the game, per game minute
+  double IncomePerMinute(size_t player, Resource resource, uint32 windowTicks) const;
+  // Spending quotient (as popularized by SC2 analysis tools) over the whole game, from mineral and
+  // vespene income and the average amount left unspent. ~50 is a beginner, ~100 a pro.
+  double SpendingQuotient(size_t player) const;
+  // Fills out the average value of a resource within each of numBuckets evenly sized chunks of the
+  // game, for charting resource float
+  void Chart(size_t player, Resource resource, int32* out, size_t numBuckets) const;
+
+  // Builds the series from the samples of a recorded game log (see game_log.h). Logs don't record
+  // buildings, so those stay 0. Returns false if the log is corrupt or truncated (samples before
+  // the problem are kept).
+  bool LoadFromGameLog(const byte* data, size_t size);
+
+private:
+  const DeltaColumn& column(size_t player, Resource resource) const {
+    return columns_[static_cast<size_t>(resource) * 12 + player];
+  }
+
+  uint32 intervalTicks_;
+  size_t size_;
+  std::vector<DeltaColumn> columns_;
+};
+
+}  // namespace apm
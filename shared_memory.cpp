@@ -0,0 +1,136 @@
+#include "./shared_memory.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <string>
+
+#include "./types.h"
+
+using std::string;
+
+namespace sbat {
+
+#ifdef _WIN32
+
+SharedMemory::SharedMemory(const string& name, size_t size, Mode mode)
+  : name_(name),
+    mode_(mode),
+    data_(nullptr),
+    size_(0),
+    errorCode_(0),
+    mappingHandle_(NULL) {
+  if (mode_ == Mode::Create) {
+    mappingHandle_ = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+        static_cast<uint32>(static_cast<uint64>(size) >> 32), static_cast<uint32>(size),
+        name_.c_str());
+    if (mappingHandle_ != NULL && GetLastError() == ERROR_ALREADY_EXISTS) {
+      // Someone else owns the name, and writing our layout over theirs would corrupt both
+      errorCode_ = ERROR_ALREADY_EXISTS;
+      CloseHandle(mappingHandle_);
+      mappingHandle_ = NULL;
+      return;
+    }
+  } else {
+    mappingHandle_ = OpenFileMappingA(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, name_.c_str());
+  }
+  if (mappingHandle_ == NULL) {
+    errorCode_ = GetLastError();
+    return;
+  }
+
+  void* view = MapViewOfFile(mappingHandle_, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0);
+  if (view == nullptr) {
+    errorCode_ = GetLastError();
+    return;
+  }
+  if (mode_ == Mode::Create) {
+    size_ = size;
+  } else {
+    // The view covers the whole mapping, rounded up to the page size
+    MEMORY_BASIC_INFORMATION info;
+    if (VirtualQuery(view, &info, sizeof(info)) == 0) {
+      errorCode_ = GetLastError();
+      UnmapViewOfFile(view);
+      return;
+    }
+    size_ = info.RegionSize;
+  }
+  data_ = view;
+}
+
+SharedMemory::~SharedMemory() {
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+  }
+  if (mappingHandle_ != NULL) {
+    CloseHandle(mappingHandle_);
+  }
+}
+
+#else
+
+SharedMemory::SharedMemory(const string& name, size_t size, Mode mode)
+  : name_(name[0] == '/' ? name : "/" + name),
+    mode_(mode),
+    data_(nullptr),
+    size_(0),
+    errorCode_(0) {
+  int fd;
+  if (mode_ == Mode::Create) {
+    // O_EXCL so that an existing object (another creator's, or one left behind by a creator that
+    // crashed) is never taken over
+    fd = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd != -1 && ftruncate(fd, size) != 0) {
+      errorCode_ = errno;
+      close(fd);
+      shm_unlink(name_.c_str());
+      return;
+    }
+    size_ = size;
+  } else {
+    fd = shm_open(name_.c_str(), O_RDWR, 0);
+    struct stat fileStat;
+    if (fd != -1 && fstat(fd, &fileStat) != 0) {
+      errorCode_ = errno;
+      close(fd);
+      return;
+    }
+    size_ = fd != -1 ? static_cast<size_t>(fileStat.st_size) : 0;
+  }
+  if (fd == -1) {
+    errorCode_ = errno;
+    return;
+  }
+
+  void* view = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (view == MAP_FAILED) {
+    errorCode_ = errno;
+    if (mode_ == Mode::Create) {
+      shm_unlink(name_.c_str());
+    }
+  } else {
+    data_ = view;
+  }
+  // The mapping keeps the object alive on its own
+  close(fd);
+}
+
+SharedMemory::~SharedMemory() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+  if (data_ != nullptr && mode_ == Mode::Create) {
+    shm_unlink(name_.c_str());
+  }
+}
+
+#endif
+
+}  // namespace sbat
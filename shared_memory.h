@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+
+#include "./types.h"
+
+namespace sbat {
+
+// A named region of memory shared between processes (a file mapping backed by the page file on
+// Windows, a POSIX shm object elsewhere). The creating side owns the name: creating fails if the
+// name is already in use, and on POSIX the object is unlinked when the creator is destroyed,
+// although existing mappings stay valid.
+class SharedMemory {
+public:
+  enum class Mode {
+    Create,
+    Open
+  };
+
+  // size is ignored for Mode::Open, the whole existing region is mapped
+  SharedMemory(const std::string& name, size_t size, Mode mode);
+  ~SharedMemory();
+
+  bool hasErrors() const { return data_ == nullptr; }
+  // The platform error code from the failed call, if hasErrors()
+  uint32 errorCode() const { return errorCode_; }
+  void* data() const { return data_; }
+  size_t size() const { return size_; }
+
+private:
+  // Disable copying
+  SharedMemory(const SharedMemory&) = delete;
+  SharedMemory& operator=(const SharedMemory&) = delete;
+
+  std::string name_;
+  Mode mode_;
+  void* data_;
+  size_t size_;
+  uint32 errorCode_;
+#ifdef _WIN32
+  void* mappingHandle_;
+#endif
+};
+
+}  // namespace sbat
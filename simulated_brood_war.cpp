@@ -0,0 +1,176 @@
+#include "./simulated_brood_war.h"
+
+#include <assert.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "./brood_war.h"
+#include "./game_monitor.h"
+#include "./types.h"
+
+namespace apm {
+
+using std::string;
+using std::vector;
+
+const uint32 SIM_TEXT_CHAR_WIDTH = 8;
+
+SimulatedBroodWar::SimulatedBroodWar()
+  : memory_(),
+    drawTextCalls_(),
+    recordingDrawText_(true),
+    drawTextCount_(0),
+    setFontCalls_(0),
+    hooksInjected_(false),
+    hooksChangedAt_(0) {
+  // Distinct values, so recorded calls show which font was set
+  memory_.fontUltraLarge = 4;
+  memory_.fontLarge = 3;
+  memory_.fontNormal = 2;
+  memory_.fontMini = 1;
+  memory_.curFont = memory_.fontNormal;
+  memory_.activePlayerId = 0xFFFFFFFF;
+  memory_.unitNodes.resize(MAX_UNIT_NODES * UNIT_NODE_SIZE);
+}
+
+template <typename T>
+void PointAt(DataOffset<T>* offset, T* location) {
+  offset->reset(reinterpret_cast<uintptr_t>(location));
+}
+
+BroodWar SimulatedBroodWar::Create() {
+  BroodWar bw;
+
+  PointAt(&bw.isInGame, &memory_.isInGame);
+  PointAt(&bw.isInReplay, &memory_.isInReplay);
+  PointAt(&bw.gameTimeTicks, &memory_.gameTimeTicks);
+  PointAt(&bw.lastTextWidth, &memory_.lastTextWidth);
+  PointAt(&bw.activePlayerId, &memory_.activePlayerId);
+  PointAt(&bw.myPlayerId, &memory_.myPlayerId);
+  PointAt(&bw.firstPlayerInfo, memory_.playerInfo.data());
+  PointAt(&bw.buildingsControlled, memory_.buildingsControlled.data());
+  PointAt(&bw.population, memory_.population.data());
+  PointAt(&bw.minerals, memory_.minerals.data());
+  PointAt(&bw.vespene, memory_.vespene.data());
+  PointAt(&bw.firstPlayerColor, memory_.playerColor.data());
+  PointAt(&bw.unitNodes, memory_.unitNodes.data());
+
+  PointAt(&bw.curFont, &memory_.curFont);
+  PointAt(&bw.fontUltraLarge, &memory_.fontUltraLarge);
+  PointAt(&bw.fontLarge, &memory_.fontLarge);
+  PointAt(&bw.fontNormal, &memory_.fontNormal);
+  PointAt(&bw.fontMini, &memory_.fontMini);
+
+  bw.SetFont = [this](BwFont font) {
+    memory_.curFont = font;
+    setFontCalls_++;
+  };
+  bw.DrawText = [this](uint32 x, uint32 y, const char* text) {
+    drawTextCount_++;
+    if (recordingDrawText_) {
+      DrawTextCall call = { x, y, memory_.curFont, string(text) };
+      drawTextCalls_.push_back(std::move(call));
+    }
+  };
+  bw.RefreshGameLayer = []() {
+    return true;
+  };
+  bw.GetTextWidth = [](const BroodWar& bw, const string& text) {
+    bw.lastTextWidth = static_cast<uint32>(text.size()) * SIM_TEXT_CHAR_WIDTH;
+    return bw.lastTextWidth;
+  };
+  bw.OnHooksChanged = [this](bool injected) {
+    hooksChangedAt_ = std::chrono::steady_clock::now().time_since_epoch().count();
+    hooksInjected_ = injected;
+  };
+
+  return bw;
+}
+
+void SimulatedBroodWar::ClearCalls() {
+  drawTextCalls_.clear();
+  drawTextCount_ = 0;
+  setFontCalls_ = 0;
+}
+
+void SimulatedBroodWar::StartGame(const vector<string>& playerNames, bool isReplay) {
+  for (size_t i = 0; i < memory_.playerInfo.size(); i++) {
+    PlayerInfo& info = memory_.playerInfo[i];
+    info = PlayerInfo();
+    info.playerId = static_cast<uint32>(i);
+    info.stormId = static_cast<uint32>(i + 1);
+    if (i < playerNames.size()) {
+      size_t length = std::min(playerNames[i].size(), sizeof(info.name) - 1);
+      std::copy(playerNames[i].begin(), playerNames[i].begin() + length, info.name);
+    }
+    // Enough to not be considered an observer
+    memory_.buildingsControlled[i] = info.name[0] != '\0' ? 1 : 0;
+    memory_.population[i] = info.name[0] != '\0' ? 4 : 0;
+    memory_.minerals[i] = 50;
+    memory_.vespene[i] = 0;
+    memory_.playerColor[i] = 0x6F;
+  }
+
+  std::fill(memory_.unitNodes.begin(), memory_.unitNodes.end(), 0);
+
+  memory_.gameTimeTicks = 0;
+  memory_.activePlayerId = 0xFFFFFFFF;
+  memory_.myPlayerId = 0;
+  memory_.isInReplay = isReplay;
+  memory_.isInGame = true;
+}
+
+void SimulatedBroodWar::EndGame() {
+  memory_.isInGame = false;
+  memory_.isInReplay = false;
+}
+
+ActionScript::ActionScript()
+  : entries_(),
+    data_() {
+}
+
+void ActionScript::Add(uint32 tick, uint8 player, const byte* data, uint32 length) {
+  assert(entries_.empty() || entries_.back().tick <= tick);
+  Entry entry = { tick, static_cast<uint32>(data_.size()), length, player };
+  entries_.push_back(entry);
+  data_.insert(data_.end(), data, data + length);
+}
+
+ActionScript::Action ActionScript::operator[](size_t index) const {
+  const Entry& entry = entries_[index];
+  Action action = { entry.tick, entry.player, &data_[entry.offset], entry.length };
+  return action;
+}
+
+GameSimulation::GameSimulation(SimulatedBroodWar* sim, GameMonitor* monitor)
+  : sim_(sim),
+    monitor_(monitor),
+    tick_(0),
+    nextAction_(0) {
+  monitor_->Update();
+}
+
+void GameSimulation::RunUntil(const ActionScript& script, uint32 endTick, uint32 ticksPerDraw) {
+  SimulatedMemory& memory = sim_->memory();
+  for (; tick_ < endTick; tick_++) {
+    memory.gameTimeTicks = tick_;
+    while (nextAction_ < script.size() && script[nextAction_].tick <= tick_) {
+      ActionScript::Action action = script[nextAction_];
+      memory.activePlayerId = action.player;
+      monitor_->OnAction(action.data);
+      nextAction_++;
+    }
+    memory.activePlayerId = 0xFFFFFFFF;
+
+    monitor_->Update();
+    if (ticksPerDraw != 0 && tick_ % ticksPerDraw == 0) {
+      monitor_->Draw();
+      monitor_->RefreshScreen();
+    }
+  }
+}
+
+}  // namespace apm
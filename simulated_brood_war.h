@@ -0,0 +1,148 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "./brood_war.h"
+#include "./types.h"
+
+namespace apm {
+
+class GameMonitor;
+
+// In-process stand-in for the parts of BW's memory that BroodWar exposes
+struct SimulatedMemory {
+  bool isInGame;
+  bool isInReplay;
+  uint32 gameTimeTicks;
+  uint32 lastTextWidth;
+  uint32 activePlayerId;
+  uint32 myPlayerId;
+  std::array<PlayerInfo, 12> playerInfo;
+  std::array<uint32, 12> buildingsControlled;
+  std::array<uint32, 12> population;
+  std::array<uint32, 12> minerals;
+  std::array<uint32, 12> vespene;
+  std::array<uint8, 12> playerColor;
+  // MAX_UNIT_NODES * UNIT_NODE_SIZE bytes, all unused (zeroed) at the start of a game
+  std::vector<byte> unitNodes;
+
+  BwFont curFont;
+  BwFont fontUltraLarge;
+  BwFont fontLarge;
+  BwFont fontNormal;
+  BwFont fontMini;
+};
+
+struct DrawTextCall {
+  uint32 x;
+  uint32 y;
+  BwFont font;
+  std::string text;
+};
+
+// Headless BroodWar backend, for running GameMonitor outside of the game (e.g. to profile or
+// benchmark the overlay). Every DataOffset of the BroodWar it creates points into memory(), and
+// the drawing functions record their calls instead of drawing. Hooks are left unset, so injecting
+// them only records when it happened; the driver calls GameMonitor's entry points directly.
+class SimulatedBroodWar {
+public:
+  SimulatedBroodWar();
+
+  // The returned BroodWar refers to this object, so it must outlive it
+  BroodWar Create();
+
+  SimulatedMemory& memory() { return memory_; }
+  const std::vector<DrawTextCall>& drawTextCalls() const { return drawTextCalls_; }
+  uint32 setFontCalls() const { return setFontCalls_; }
+  // Turns off recording of DrawText calls (they're still counted), for benchmarks where the
+  // recording would dominate
+  void SetRecordingDrawText(bool recording) { recordingDrawText_ = recording; }
+  uint32 drawTextCount() const { return drawTextCount_; }
+  void ClearCalls();
+
+  // Whether the monitor has the hooks injected, and when it last injected or restored them. Safe to
+  // call while the monitor's thread is running.
+  bool hooksInjected() const { return hooksInjected_; }
+  std::chrono::steady_clock::time_point hooksChangedAt() const {
+    return std::chrono::steady_clock::time_point(
+        std::chrono::steady_clock::duration(hooksChangedAt_.load()));
+  }
+
+  // Resets memory to the start of a game with the given player names (empty names leave a slot
+  // unused), with player 0 as the local player
+  void StartGame(const std::vector<std::string>& playerNames, bool isReplay);
+  void EndGame();
+
+private:
+  // Disable copying
+  SimulatedBroodWar(const SimulatedBroodWar&) = delete;
+  SimulatedBroodWar& operator=(const SimulatedBroodWar&) = delete;
+
+  SimulatedMemory memory_;
+  std::vector<DrawTextCall> drawTextCalls_;
+  bool recordingDrawText_;
+  uint32 drawTextCount_;
+  uint32 setFontCalls_;
+  std::atomic<bool> hooksInjected_;
+  // steady_clock ticks, so it can be atomic
+  std::atomic<std::chrono::steady_clock::rep> hooksChangedAt_;
+};
+
+// A stream of raw action data (in the format BW hands to the action hook, type byte first), stored
+// contiguously so that long scripts or replay-derived streams stay cheap to iterate
+class ActionScript {
+public:
+  struct Action {
+    uint32 tick;
+    uint8 player;
+    const byte* data;
+    uint32 length;
+  };
+
+  ActionScript();
+
+  // Actions must be added in tick order
+  void Add(uint32 tick, uint8 player, const byte* data, uint32 length);
+  void Add(uint32 tick, uint8 player, byte actionType) { Add(tick, player, &actionType, 1); }
+
+  size_t size() const { return entries_.size(); }
+  Action operator[](size_t index) const;
+
+private:
+  struct Entry {
+    uint32 tick;
+    uint32 offset;
+    uint32 length;
+    uint8 player;
+  };
+
+  std::vector<Entry> entries_;
+  std::vector<byte> data_;
+};
+
+// Drives a GameMonitor (which must be using a BroodWar from sim) through an ActionScript, as fast
+// as possible. The monitor's thread shouldn't be started; the driver calls Update itself so that
+// runs are deterministic.
+class GameSimulation {
+public:
+  GameSimulation(SimulatedBroodWar* sim, GameMonitor* monitor);
+
+  // Advances game time up to endTick, feeding every action scheduled before then through OnAction
+  // and drawing a frame every ticksPerDraw ticks
+  void RunUntil(const ActionScript& script, uint32 endTick, uint32 ticksPerDraw = 1);
+
+  uint32 tick() const { return tick_; }
+  size_t nextAction() const { return nextAction_; }
+
+private:
+  SimulatedBroodWar* sim_;
+  GameMonitor* monitor_;
+  uint32 tick_;
+  size_t nextAction_;
+};
+
+}  // namespace apm
@@ -0,0 +1,175 @@
+#include "./telemetry.h"
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+
+#include "./shared_memory.h"
+#include "./types.h"
+
+namespace apm {
+
+using sbat::SharedMemory;
+using std::string;
+using std::unique_ptr;
+
+namespace {
+
+size_t SlotsOffset() {
+  return (sizeof(TelemetryHeader) + alignof(TelemetrySlot) - 1) & ~(alignof(TelemetrySlot) - 1);
+}
+
+}  // namespace
+
+unique_ptr<TelemetryWriter> TelemetryWriter::Create(const string& name, uint32 slotCount) {
+  const size_t size = SlotsOffset() + sizeof(TelemetrySlot) * slotCount;
+  unique_ptr<SharedMemory> memory(new SharedMemory(name, size, SharedMemory::Mode::Create));
+  if (memory->hasErrors() || slotCount == 0) {
+    return unique_ptr<TelemetryWriter>();
+  }
+
+  return unique_ptr<TelemetryWriter>(new TelemetryWriter(std::move(memory), slotCount));
+}
+
+TelemetryWriter::TelemetryWriter(unique_ptr<SharedMemory> memory, uint32 slotCount)
+  : memory_(std::move(memory)),
+    header_(nullptr),
+    slots_(nullptr),
+    slotCount_(slotCount),
+    writeIndex_(0) {
+  byte* base = reinterpret_cast<byte*>(memory_->data());
+  slots_ = reinterpret_cast<TelemetrySlot*>(base + SlotsOffset());
+  for (uint32 i = 0; i < slotCount_; i++) {
+    TelemetrySlot* slot = new (&slots_[i]) TelemetrySlot();
+    slot->sequence.store(0, std::memory_order_relaxed);
+  }
+
+  header_ = new (base) TelemetryHeader();
+  header_->version = TELEMETRY_VERSION;
+  header_->headerSize = sizeof(TelemetryHeader);
+  header_->slotSize = sizeof(TelemetrySlot);
+  header_->slotCount = slotCount_;
+  header_->writeIndex.store(0, std::memory_order_relaxed);
+  header_->profileSequence.store(0, std::memory_order_relaxed);
+  header_->magic.store(TELEMETRY_MAGIC, std::memory_order_release);
+}
+
+void TelemetryWriter::Publish(const TelemetryRecord& record) {
+  TelemetrySlot& slot = slots_[writeIndex_ % slotCount_];
+  // Mark the slot as being written before touching the record, so readers that copied it while
+  // we write see a changed sequence and discard their copy
+  slot.sequence.store(2 * writeIndex_ + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(&slot.record, &record, sizeof(record));
+  slot.sequence.store(2 * (writeIndex_ + 1), std::memory_order_release);
+
+  writeIndex_++;
+  header_->writeIndex.store(writeIndex_, std::memory_order_release);
+}
+
+void TelemetryWriter::PublishProfile(const ProfileSnapshot& profile) {
+  // Same protocol as the slots, with a single slot
+  const uint32 sequence = header_->profileSequence.load(std::memory_order_relaxed);
+  header_->profileSequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(&header_->profile, &profile, sizeof(profile));
+  header_->profileSequence.store(sequence + 2, std::memory_order_release);
+}
+
+unique_ptr<TelemetryReader> TelemetryReader::Open(const string& name) {
+  unique_ptr<SharedMemory> memory(new SharedMemory(name, 0, SharedMemory::Mode::Open));
+  if (memory->hasErrors() || memory->size() < sizeof(TelemetryHeader)) {
+    return unique_ptr<TelemetryReader>();
+  }
+
+  const TelemetryHeader* header = reinterpret_cast<const TelemetryHeader*>(memory->data());
+  if (header->magic.load(std::memory_order_acquire) != TELEMETRY_MAGIC ||
+      header->version != TELEMETRY_VERSION ||
+      header->headerSize != sizeof(TelemetryHeader) ||
+      header->slotSize != sizeof(TelemetrySlot) ||
+      header->slotCount == 0 ||
+      memory->size() < SlotsOffset() + sizeof(TelemetrySlot) * header->slotCount) {
+    return unique_ptr<TelemetryReader>();
+  }
+
+  return unique_ptr<TelemetryReader>(new TelemetryReader(std::move(memory)));
+}
+
+TelemetryReader::TelemetryReader(unique_ptr<SharedMemory> memory)
+  : memory_(std::move(memory)),
+    header_(nullptr),
+    slots_(nullptr),
+    slotCount_(0),
+    readIndex_(0),
+    lostRecords_(0) {
+  const byte* base = reinterpret_cast<const byte*>(memory_->data());
+  header_ = reinterpret_cast<const TelemetryHeader*>(base);
+  slots_ = reinterpret_cast<const TelemetrySlot*>(base + SlotsOffset());
+  slotCount_ = header_->slotCount;
+
+  const uint32 writeIndex = header_->writeIndex.load(std::memory_order_acquire);
+  readIndex_ = writeIndex > slotCount_ ? writeIndex - slotCount_ : 0;
+}
+
+TelemetryReader::Result TelemetryReader::Next(TelemetryRecord* record) {
+  Result result = Result::Record;
+  for (;;) {
+    const uint32 writeIndex = header_->writeIndex.load(std::memory_order_acquire);
+    if (writeIndex == readIndex_) {
+      return Result::Empty;
+    }
+    if (writeIndex - readIndex_ > slotCount_) {
+      // Resuming at the oldest slot would just race the writer for it, so skip to the middle of the
+      // ring instead to give ourselves some headroom
+      const uint32 resumeIndex = writeIndex - (slotCount_ + 1) / 2;
+      lostRecords_ += resumeIndex - readIndex_;
+      readIndex_ = resumeIndex;
+      result = Result::Overrun;
+    }
+
+    const TelemetrySlot& slot = slots_[readIndex_ % slotCount_];
+    const uint32 expected = 2 * (readIndex_ + 1);
+    if (slot.sequence.load(std::memory_order_acquire) == expected) {
+      std::memcpy(record, &slot.record, sizeof(*record));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) == expected) {
+        readIndex_++;
+        return result;
+      }
+    }
+
+    // The writer lapped us while we were reading this slot, so it's gone. Go around again, which
+    // will skip ahead to the oldest slot that's still intact.
+    lostRecords_++;
+    readIndex_++;
+    result = Result::Overrun;
+  }
+}
+
+void TelemetryReader::SkipToLatest() {
+  const uint32 writeIndex = header_->writeIndex.load(std::memory_order_acquire);
+  readIndex_ = writeIndex != 0 ? writeIndex - 1 : 0;
+}
+
+bool TelemetryReader::ReadProfile(ProfileSnapshot* profile) const {
+  // The profile is only rewritten every APM update, so a few retries are plenty
+  for (uint32 attempt = 0; attempt < 4; attempt++) {
+    const uint32 sequence = header_->profileSequence.load(std::memory_order_acquire);
+    if (sequence == 0) {
+      return false;
+    }
+    if (sequence % 2 != 0) {
+      continue;
+    }
+    std::memcpy(profile, &header_->profile, sizeof(*profile));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header_->profileSequence.load(std::memory_order_relaxed) == sequence) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace apm
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "./profiling.h"
+#include "./shared_memory.h"
+#include "./types.h"
+
+namespace apm {
+
+// Live game stats published into shared memory for external consumers (stream overlays, coaching
+// tools, etc.). The region starts with a TelemetryHeader, followed by slotCount TelemetrySlots
+// forming a ring. There's a single writer (the GameMonitor thread); any number of readers can
+// follow along without locks or syscalls, detecting torn and lapped slots through each slot's
+// sequence number. The header also holds the latest hot path profile (see profiling.h), when the
+// writer was built with profiling enabled.
+
+const char TELEMETRY_MAPPING_NAME[] = "APMDisplayTelemetry";
+const uint32 TELEMETRY_MAGIC = 0x544D5041;  // 'APMT'
+const uint32 TELEMETRY_VERSION = 3;
+const uint32 TELEMETRY_SLOT_COUNT = 1024;
+
+const uint32 TELEMETRY_FLAG_REPLAY = 1 << 0;
+const uint32 TELEMETRY_FLAG_OBS_MODE = 1 << 1;
+
+// Fixed layout, shared with readers in other processes. Changing it requires bumping
+// TELEMETRY_VERSION.
+struct TelemetryRecord {
+  // Incremented for every game the writer sees, so readers can tell games apart
+  uint32 gameId;
+  uint32 gameTimeTicks;
+  uint32 flags;
+  uint32 myPlayerId;
+  // Bit i is set if player slot i is in use
+  uint32 activePlayers;
+  std::array<int32, 12> apm;
+  std::array<int32, 12> minerals;
+  std::array<int32, 12> vespene;
+  std::array<uint32, 12> population;
+  // Approximate gathering rates over the last game minute, per game minute
+  std::array<int32, 12> mineralIncome;
+  std::array<int32, 12> vespeneIncome;
+};
+
+struct alignas(64) TelemetrySlot {
+  // 2 * (index + 1) once the record for ring index is complete, odd while it's being written
+  std::atomic<uint32> sequence;
+  TelemetryRecord record;
+};
+
+struct TelemetryHeader {
+  // Written last by the creator, readers must not trust anything else until it's set
+  std::atomic<uint32> magic;
+  uint32 version;
+  uint32 headerSize;
+  uint32 slotSize;
+  uint32 slotCount;
+  // Index of the next record to be written (so writeIndex - 1 is the newest complete one)
+  alignas(64) std::atomic<uint32> writeIndex;
+  // Incremented before and after profile is rewritten (so it's odd while it's being written), 0 if
+  // no profile has been published
+  alignas(64) std::atomic<uint32> profileSequence;
+  ProfileSnapshot profile;
+};
+
+class TelemetryWriter {
+public:
+  // Returns nullptr if the shared memory couldn't be created, including when another writer (in
+  // this or another process) already has the name
+  static std::unique_ptr<TelemetryWriter> Create(
+      const std::string& name = TELEMETRY_MAPPING_NAME, uint32 slotCount = TELEMETRY_SLOT_COUNT);
+
+  void Publish(const TelemetryRecord& record);
+  // Replaces the published profile
+  void PublishProfile(const ProfileSnapshot& profile);
+
+private:
+  TelemetryWriter(std::unique_ptr<sbat::SharedMemory> memory, uint32 slotCount);
+  // Disable copying
+  TelemetryWriter(const TelemetryWriter&) = delete;
+  TelemetryWriter& operator=(const TelemetryWriter&) = delete;
+
+  std::unique_ptr<sbat::SharedMemory> memory_;
+  TelemetryHeader* header_;
+  TelemetrySlot* slots_;
+  uint32 slotCount_;
+  uint32 writeIndex_;
+};
+
+class TelemetryReader {
+public:
+  enum class Result {
+    Record,
+    // Nothing new has been written
+    Empty,
+    // The reader fell more than a ring behind; the records in between were lost and reading
+    // continues from the middle of the ring
+    Overrun
+  };
+
+  // Returns nullptr if the shared memory doesn't exist or doesn't match this version's layout
+  static std::unique_ptr<TelemetryReader> Open(const std::string& name = TELEMETRY_MAPPING_NAME);
+
+  // Copies the next unread record into record, if there is one. Starts with the oldest record in
+  // the ring.
+  Result Next(TelemetryRecord* record);
+  // Skips ahead so that the next call to Next returns the newest record
+  void SkipToLatest();
+  // Copies the latest profile into profile. Returns false if none has been published, or if the
+  // writer kept replacing it while it was being copied.
+  bool ReadProfile(ProfileSnapshot* profile) const;
+
+  uint64 lostRecords() const { return lostRecords_; }
+
+private:
+  TelemetryReader(std::unique_ptr<sbat::SharedMemory> memory);
+  // Disable copying
+  TelemetryReader(const TelemetryReader&) = delete;
+  TelemetryReader& operator=(const TelemetryReader&) = delete;
+
+  std::unique_ptr<sbat::SharedMemory> memory_;
+  const TelemetryHeader* header_;
+  const TelemetrySlot* slots_;
+  uint32 slotCount_;
+  uint32 readIndex_;
+  uint64 lostRecords_;
+};
+
+}  // namespace apm
@@ -0,0 +1,105 @@
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "./apm_series.h"
+#include "./types.h"
+
+// Adds two hours of samples for 12 players, and at a few points along the way measures how long
+// it takes to query the graph of the last 5 and 60 minutes, and how far its points are from the
+// exact means of the samples they cover.
+
+using apm::ApmGraphPoint;
+using apm::ApmSeries;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const uint32 STEP = 252;
+const size_t POINTS = 60;
+const int QUERIES = 20000;
+
+struct Sample {
+  uint32 time;
+  int32 apm;
+};
+
+void MeasureQueries(const ApmSeries& series, const std::vector<Sample>& samples, uint32 now) {
+  std::array<ApmGraphPoint, POINTS> points;
+  for (uint32 windowMinutes : { 5U, 60U }) {
+    const uint32 window = windowMinutes * 60000;
+    const uint32 start = now > window ? now - window : 0;
+    auto queryStart = Clock::now();
+    for (int i = 0; i < QUERIES; i++) {
+      series.Query(i % 12, start, now, points.size(), points.data());
+    }
+    const double queryNanos =
+        std::chrono::duration<double, std::nano>(Clock::now() - queryStart).count() / QUERIES;
+
+    // Compare each point to the exact mean of the samples in its span
+    series.Query(0, start, now, points.size(), points.data());
+    double totalError = 0;
+    int compared = 0;
+    int empty = 0;
+    for (size_t i = 0; i < points.size(); i++) {
+      if (points[i].samples == 0) {
+        empty++;
+        continue;
+      }
+      const uint32 pointStart = start + static_cast<uint32>(uint64(now - start) * i / POINTS);
+      const uint32 pointEnd = start + static_cast<uint32>(uint64(now - start) * (i + 1) / POINTS);
+      double sum = 0;
+      int count = 0;
+      for (const Sample& sample : samples) {
+        if (sample.time >= pointStart && sample.time < pointEnd) {
+          sum += sample.apm;
+          count++;
+        }
+      }
+      if (count != 0) {
+        totalError += std::fabs(points[i].mean - sum / count);
+        compared++;
+      }
+    }
+    std::printf("game %3u min, last %2u min: query %5.0f ns, mean error %.1f APM, %d empty\n",
+        (now + 30000) / 60000, windowMinutes, queryNanos,
+        compared != 0 ? totalError / compared : 0, empty);
+  }
+}
+
+}  // namespace
+
+int main() {
+  ApmSeries series;
+  std::mt19937 rng(1);
+  // Player 0's samples, to check the queries against
+  std::vector<Sample> samples;
+  std::array<int32, 12> apm;
+  const uint32 checkpoints[] = { 5, 15, 30, 60, 120 };
+  size_t nextCheckpoint = 0;
+  double addNanos = 0;
+  uint64 adds = 0;
+  for (uint32 time = STEP; time <= 120 * 60000; time += STEP) {
+    for (int player = 0; player < 12; player++) {
+      apm[player] = static_cast<int32>(150 + 100 * std::sin(time / 60000.0 + player) + rng() % 40);
+    }
+    auto addStart = Clock::now();
+    series.Add(time, apm);
+    addNanos += std::chrono::duration<double, std::nano>(Clock::now() - addStart).count();
+    adds++;
+    Sample sample = { time, apm[0] };
+    samples.push_back(sample);
+
+    if (nextCheckpoint < 5 && time + STEP > checkpoints[nextCheckpoint] * 60000) {
+      MeasureQueries(series, samples, time);
+      nextCheckpoint++;
+    }
+  }
+  std::printf("add: %.0f ns per sample of 12 players\n", addNanos / adds);
+  std::printf("memory: %zu bytes\n", sizeof(ApmSeries));
+  return 0;
+}
@@ -0,0 +1,139 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "./apm_shifts.h"
+#include "./types.h"
+
+// Measures the detector's false shift rate on steady play, how often and how quickly it detects
+// real changes, and its throughput. Actions either arrive independently (a Poisson process) or in
+// clusters averaging 2.5 actions, which is closer to how players actually act.
+
+using apm::ApmShift;
+using apm::ApmShiftDetector;
+using apm::ApmShiftKind;
+
+namespace {
+
+const uint32 STEP = 252;
+
+class ActionGenerator {
+public:
+  ActionGenerator(uint64 seed, bool clustered)
+    : rng_(seed),
+      clustered_(clustered) {
+  }
+
+  uint32 Count(double apm, uint32 millis) {
+    const double mean = apm * millis / 60000.0;
+    if (!clustered_) {
+      return std::poisson_distribution<uint32>(mean)(rng_);
+    }
+    const uint32 clusters = std::poisson_distribution<uint32>(mean / 2.5)(rng_);
+    std::geometric_distribution<uint32> extra(1 / 2.5);
+    uint32 total = 0;
+    for (uint32 i = 0; i < clusters; i++) {
+      total += 1 + extra(rng_);
+    }
+    return total;
+  }
+
+private:
+  std::mt19937_64 rng_;
+  bool clustered_;
+};
+
+void MeasureFalseShifts(bool clustered) {
+  for (double apm : { 60.0, 150.0, 300.0 }) {
+    ActionGenerator actions(1, clustered);
+    ApmShiftDetector detector;
+    uint64 shifts = 0;
+    const int games = 200;
+    for (int game = 0; game < games; game++) {
+      detector.Reset();
+      for (uint32 time = STEP; time <= 20 * 60000; time += STEP) {
+        shifts += detector.Update(0, time, STEP, actions.Count(apm, STEP));
+      }
+    }
+    std::printf("steady %3.0f APM: %.2f false shifts per hour\n", apm, shifts / (games / 3.0));
+  }
+}
+
+void MeasureDetection(bool clustered, double fromApm, double toApm) {
+  ActionGenerator actions(2, clustered);
+  ApmShiftDetector detector;
+  const int runs = 1000;
+  int detected = 0;
+  int wrong = 0;
+  double totalDelay = 0;
+  double totalEstimate = 0;
+  for (int run = 0; run < runs; run++) {
+    detector.Reset();
+    const uint32 change = 60000 + (run % 40) * STEP;
+    bool found = false;
+    for (uint32 time = STEP; time <= change + 30000; time += STEP) {
+      const double apm = time <= change ? fromApm : toApm;
+      if (!detector.Update(0, time, STEP, actions.Count(apm, STEP))) {
+        continue;
+      }
+      const ApmShift& shift = detector.lastShift(0);
+      const bool rightKind = (shift.kind == ApmShiftKind::Burst) == (toApm > fromApm);
+      if (time <= change || !rightKind) {
+        wrong++;
+      } else if (!found) {
+        found = true;
+        detected++;
+        totalDelay += time - change;
+        totalEstimate += shift.toApm;
+      }
+    }
+  }
+  std::printf("%3.0f -> %3.0f: detected %5.1f%% within 30s, mean delay %.1fs, "
+      "estimated new APM %.0f, %d false or wrong\n", fromApm, toApm, 100.0 * detected / runs,
+      detected != 0 ? totalDelay / detected / 1000 : 0,
+      detected != 0 ? totalEstimate / detected : 0, wrong);
+}
+
+void MeasureThroughput() {
+  std::mt19937 rng(3);
+  std::vector<uint32> counts(1 << 16);
+  for (uint32& count : counts) {
+    count = rng() % 3;
+  }
+
+  ApmShiftDetector detector;
+  uint64 updates = 0;
+  uint64 shifts = 0;
+  uint32 time = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int repeat = 0; repeat < 200; repeat++) {
+    for (size_t i = 0; i < counts.size(); i += 12) {
+      time += STEP;
+      for (uint32 player = 0; player < 12; player++) {
+        shifts += detector.Update(player, time, STEP, counts[(i + player) & 0xFFFF]);
+      }
+      updates += 12;
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::printf("throughput: %.1f M player updates/s (%.1f ns each), %llu shifts\n",
+      updates / seconds / 1e6, seconds * 1e9 / updates, static_cast<unsigned long long>(shifts));
+}
+
+}  // namespace
+
+int main() {
+  for (int clustered = 0; clustered < 2; clustered++) {
+    std::printf("== %s ==\n", clustered ? "clustered actions" : "independent actions");
+    MeasureFalseShifts(clustered != 0);
+    MeasureDetection(clustered != 0, 150, 300);
+    MeasureDetection(clustered != 0, 150, 225);
+    MeasureDetection(clustered != 0, 150, 0);
+    MeasureDetection(clustered != 0, 150, 60);
+    MeasureDetection(clustered != 0, 300, 120);
+    MeasureDetection(clustered != 0, 80, 200);
+  }
+  MeasureThroughput();
+  return 0;
+}
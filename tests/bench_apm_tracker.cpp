@@ -0,0 +1,97 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "./apm_tracker.h"
+#include "./types.h"
+
+// Measures seeking around replays of various lengths and player counts, checking each seek against
+// the APM recorded on the way forward, and compares that to recomputing from the start of the game.
+
+using apm::ApmTracker;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const uint32 STEP = 252;
+const int SEEKS = 2000;
+
+void MeasureSeeks(int players, uint32 minutes) {
+  std::mt19937 rng(players * 100 + minutes);
+  std::poisson_distribution<uint32> actionCount(200 * 0.252 / 60);
+  ApmTracker tracker;
+  tracker.Reset(true);
+  std::map<uint32, std::array<int32, 12>> recorded;
+  for (uint32 time = STEP; time <= minutes * 60000; time += STEP) {
+    std::array<uint32, 12> actions = std::array<uint32, 12>();
+    for (int player = 0; player < players; player++) {
+      actions[player] = actionCount(rng);
+    }
+    tracker.Advance(time, actions);
+    tracker.GetApm(&recorded[time]);
+  }
+
+  double totalNanos = 0;
+  double worstNanos = 0;
+  int mismatches = 0;
+  // Seeking moves the tracker, so each seek starts from a fresh copy
+  std::vector<ApmTracker> copies(SEEKS, tracker);
+  for (int i = 0; i < SEEKS; i++) {
+    ApmTracker& copy = copies[i];
+    const uint32 target = rng() % (minutes * 60000);
+    auto start = Clock::now();
+    copy.Seek(target);
+    const double nanos = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    totalNanos += nanos;
+    worstNanos = std::max(worstNanos, nanos);
+
+    std::array<int32, 12> apm;
+    copy.GetApm(&apm);
+    auto it = recorded.upper_bound(target);
+    const std::array<int32, 12> expected =
+        it == recorded.begin() ? std::array<int32, 12>() : std::prev(it)->second;
+    if (apm != expected) {
+      mismatches++;
+    }
+  }
+  std::printf("%d players, %3u min: journal %6zu bytes, %2zu checkpoints, seek mean %.1f us, "
+      "worst %.1f us, %d mismatches\n", players, minutes, tracker.journalSize(),
+      tracker.numCheckpoints(), totalNanos / SEEKS / 1000, worstNanos / 1000, mismatches);
+}
+
+}  // namespace
+
+int main() {
+  for (int players : { 2, 8 }) {
+    for (uint32 minutes : { 20U, 60U }) {
+      MeasureSeeks(players, minutes);
+    }
+  }
+
+  // What a seek would cost without the journal: replaying the whole game from the start
+  std::mt19937 rng(5);
+  std::poisson_distribution<uint32> actionCount(200 * 0.252 / 60);
+  std::vector<std::array<uint32, 12>> updates;
+  for (uint32 time = STEP; time <= 60 * 60000; time += STEP) {
+    std::array<uint32, 12> actions = std::array<uint32, 12>();
+    actions[0] = actionCount(rng);
+    actions[1] = actionCount(rng);
+    updates.push_back(actions);
+  }
+  auto start = Clock::now();
+  ApmTracker tracker;
+  tracker.Reset(false);
+  uint32 time = 0;
+  for (const std::array<uint32, 12>& actions : updates) {
+    time += STEP;
+    tracker.Advance(time, actions);
+  }
+  std::printf("replaying an hour from the start instead: %.0f us\n",
+      std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+  return 0;
+}
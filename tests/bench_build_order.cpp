@@ -0,0 +1,110 @@
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "./actions.h"
+#include "./build_order.h"
+#include "./game_log.h"
+#include "./types.h"
+
+// Measures extracting build orders from recorded game logs (including decoding them), and
+// consuming actions live from the action hook.
+
+using apm::BuildOrderExtractor;
+
+namespace {
+
+namespace action = apm::action;
+
+const int GAMES = 500;
+const int LIVE_ACTIONS = 20000000;
+
+// A 2 player game of 7 to 28 minutes at ~300 APM, mostly selections and right clicks
+std::vector<byte> MakeLog(std::mt19937* rng, size_t* numActions) {
+  std::vector<byte> log;
+  apm::GameLogEncoder encoder;
+  apm::GameLogHeader header = apm::GameLogHeader();
+  header.playerNames[0] = "p1";
+  header.playerNames[1] = "p2";
+  encoder.Begin(header, [&log](std::vector<byte> block) {
+    log.insert(log.end(), block.begin(), block.end());
+  });
+
+  const uint32 ticks = 10000 + (*rng)() % 30000;
+  for (uint32 tick = 0; tick < ticks; tick++) {
+    for (uint8 player = 0; player < 2; player++) {
+      if ((*rng)() % 1000 >= 170) {
+        continue;
+      }
+      byte data[16] = {};
+      const uint32 kind = (*rng)() % 10;
+      if (kind < 4) {
+        data[0] = action::SELECT;
+        data[1] = static_cast<byte>(1 + (*rng)() % 4);
+      } else if (kind < 7) {
+        data[0] = action::RIGHT_CLICK;
+      } else if (kind == 7) {
+        data[0] = action::TRAIN;
+        data[1] = (*rng)() % 2 ? 7 : 0;
+      } else if (kind == 8) {
+        data[0] = action::BUILD;
+        data[1] = 0x1E;
+        data[2] = static_cast<byte>((*rng)());
+        data[6] = 109;
+      } else {
+        data[0] = (*rng)() % 2 ? action::TECH : action::UPGRADE;
+        data[1] = static_cast<byte>((*rng)() % 40);
+      }
+      encoder.AddAction(tick, player, data);
+      (*numActions)++;
+    }
+  }
+  encoder.End(ticks);
+  return log;
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 rng(9);
+  std::vector<std::vector<byte>> logs;
+  size_t numActions = 0;
+  size_t numBytes = 0;
+  for (int i = 0; i < GAMES; i++) {
+    logs.push_back(MakeLog(&rng, &numActions));
+    numBytes += logs.back().size();
+  }
+
+  BuildOrderExtractor extractor;
+  std::array<std::string, 12> names;
+  size_t entries = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (const std::vector<byte>& log : logs) {
+    if (!apm::ExtractBuildOrder(log.data(), log.size(), &extractor, &names)) {
+      std::printf("failed to extract a build order\n");
+      return 1;
+    }
+    entries += extractor.entries().size();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::printf("from logs: %d games, %zu actions (%.1f MB), %.1f M actions/s (%.0f MB/s), "
+      "%zu entries\n", GAMES, numActions, numBytes / 1e6, numActions / seconds / 1e6,
+      numBytes / seconds / 1e6, entries);
+
+  const byte train[] = { action::TRAIN, 7, 0 };
+  const byte rightClick[] = { action::RIGHT_CLICK, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+  extractor.Reset();
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < LIVE_ACTIONS; i++) {
+    extractor.Consume(i >> 3, i & 1, (i & 7) == 0 ? train : rightClick);
+    if (extractor.entries().size() > 1000000) {
+      extractor.Reset();
+    }
+  }
+  seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::printf("live: %.1f ns per action\n", seconds * 1e9 / LIVE_ACTIONS);
+  return 0;
+}
@@ -0,0 +1,72 @@
+#include <chrono>
+#include <cstdio>
+
+#include "./callback_list.h"
+#include "./types.h"
+
+// Measures the per-call cost of dispatching an action to 1, 4 and 16 registered callbacks, against
+// calling the same number of functions directly. This is what DetourDispatcher adds on top of the
+// trampoline for each hooked action.
+
+using sbat::CallbackList;
+
+namespace {
+
+typedef void (*Callback)(const byte* action);
+
+const int CALLS = 20000000;
+
+volatile uint32 sink;
+
+template <uint32 Index>
+void Consume(const byte* action) {
+  sink = sink + action[0] + Index;
+}
+
+const Callback CALLBACKS[] = {
+  &Consume<0>, &Consume<1>, &Consume<2>, &Consume<3>, &Consume<4>, &Consume<5>, &Consume<6>,
+  &Consume<7>, &Consume<8>, &Consume<9>, &Consume<10>, &Consume<11>, &Consume<12>, &Consume<13>,
+  &Consume<14>, &Consume<15>,
+};
+
+// Called through a volatile pointer so the loop can't be specialized for the callback count
+void CallDirectly(uint32 count, const byte* action) {
+  for (uint32 i = 0; i < count; i++) {
+    CALLBACKS[i](action);
+  }
+}
+void (*volatile callDirectly)(uint32, const byte*) = &CallDirectly;
+
+void Run(uint32 count) {
+  CallbackList<Callback> list;
+  for (uint32 i = 0; i < count; i++) {
+    list.Add(CALLBACKS[i]);
+  }
+  const byte action[] = { 0x14, 0, 0, 0, 0 };
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < CALLS; i++) {
+    list.Call(action);
+  }
+  const double dispatched = std::chrono::duration<double, std::nano>(
+      std::chrono::steady_clock::now() - start).count() / CALLS;
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < CALLS; i++) {
+    callDirectly(count, action);
+  }
+  const double direct = std::chrono::duration<double, std::nano>(
+      std::chrono::steady_clock::now() - start).count() / CALLS;
+
+  std::printf("%2u callbacks: %5.2f ns/call dispatched, %5.2f ns/call direct\n",
+      count, dispatched, direct);
+}
+
+}  // namespace
+
+int main() {
+  Run(1);
+  Run(4);
+  Run(16);
+  return 0;
+}
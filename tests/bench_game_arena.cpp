@@ -0,0 +1,139 @@
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+
+#include "./actions.h"
+#include "./apm_tracker.h"
+#include "./build_order.h"
+#include "./game_arena.h"
+#include "./heatmap.h"
+#include "./resource_series.h"
+#include "./types.h"
+
+// Soaks the per-game state GameMonitor keeps in arenas through thousands of games of random
+// lengths and player counts, with and without the arenas, measuring the run time and how many heap
+// allocations are made once the first games have warmed things up.
+
+using apm::GameArena;
+
+namespace {
+
+const int GAMES = 1000;
+const int WARMUP_GAMES = 50;
+
+std::atomic<uint64> heapAllocations(0);
+
+}  // namespace
+
+void* operator new(size_t size) {
+  heapAllocations++;
+  void* result = std::malloc(size != 0 ? size : 1);
+  if (result == nullptr) {
+    throw std::bad_alloc();
+  }
+  return result;
+}
+
+void operator delete(void* pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+  std::free(pointer);
+}
+
+namespace {
+
+namespace action = apm::action;
+
+void Soak(bool useArenas) {
+  GameArena monitorArena;
+  GameArena gameArena;
+  apm::ApmTracker tracker(useArenas ? &monitorArena : nullptr);
+  apm::ResourceSeries resources(apm::ResourceSeries::DEFAULT_INTERVAL_TICKS,
+      apm::ResourceSeries::DEFAULT_EXPECTED_SAMPLES, useArenas ? &monitorArena : nullptr);
+  apm::BuildOrderExtractor buildOrder(apm::BuildOrderExtractor::DEFAULT_EXPECTED_ENTRIES,
+      useArenas ? &gameArena : nullptr);
+  apm::ActionHeatmap heatmap(useArenas ? &gameArena : nullptr);
+  std::mt19937 rng(7);
+  byte rightClick[10] = { action::RIGHT_CLICK };
+  const byte train[3] = { action::TRAIN, 0x25, 0 };
+  const byte build[8] = { action::BUILD, 0x1E, 0, 0, 0, 0, 0x6F, 0 };
+
+  uint64 warmAllocations = 0;
+  uint64 totalTicks = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (int game = 0; game < GAMES; game++) {
+    if (game == WARMUP_GAMES) {
+      warmAllocations = heapAllocations;
+    }
+    const bool replay = rng() % 2 == 0;
+    const uint32 players = 2 + rng() % 7;
+    const uint32 minutes = 5 + rng() % 35;
+    monitorArena.Reset();
+    gameArena.Reset();
+    tracker.Reset(replay);
+    resources.Reset();
+    buildOrder.Reset();
+    heatmap.Reset((1u << players) - 1);
+
+    std::array<uint32, 12> actions = std::array<uint32, 12>();
+    apm::ResourceSample sample = apm::ResourceSample();
+    const uint32 endTick = minutes * 60 * 1000 / 42;
+    for (uint32 tick = 0; tick < endTick; tick++) {
+      for (uint8 player = 0; player < players; player++) {
+        if (rng() % 8 != 0) {
+          continue;
+        }
+        actions[player]++;
+        const uint32 kind = rng() % 16;
+        const byte* data = kind == 0 ? train : kind == 1 ? build : rightClick;
+        rightClick[1] = static_cast<byte>(rng());
+        rightClick[2] = static_cast<byte>(rng() % 32);
+        buildOrder.Consume(tick, player, data);
+        heatmap.Consume(tick, player, data);
+      }
+      if (tick % 12 == 11) {
+        tracker.Advance(tick * 42, actions);
+        actions.fill(0);
+      }
+      if (tick % 24 == 0) {
+        for (uint8 player = 0; player < players; player++) {
+          sample.at(apm::Resource::Minerals, player) += static_cast<int32>(rng() % 16) - 4;
+        }
+        resources.Record(tick, sample);
+      }
+      if (replay && tick % 20000 == 19999) {
+        tracker.Seek(tick * 42 / 2);
+        resources.Rewind(tick / 2);
+      }
+    }
+    totalTicks += endTick;
+  }
+  const double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+
+  std::printf("%s: %d games (%llu ticks) in %.1f s, %llu heap allocations after game %d\n",
+      useArenas ? "arenas" : "heap", GAMES, static_cast<unsigned long long>(totalTicks), seconds,
+      static_cast<unsigned long long>(heapAllocations - warmAllocations), WARMUP_GAMES);
+  if (useArenas) {
+    std::printf("  monitor arena: peak %zu KB, reserved %zu KB in %zu blocks\n",
+        monitorArena.peakBytesUsed() / 1024, monitorArena.bytesReserved() / 1024,
+        monitorArena.numBlocks());
+    std::printf("  game arena:    peak %zu KB, reserved %zu KB in %zu blocks\n",
+        gameArena.peakBytesUsed() / 1024, gameArena.bytesReserved() / 1024,
+        gameArena.numBlocks());
+  }
+}
+
+}  // namespace
+
+int main() {
+  Soak(true);
+  Soak(false);
+  return 0;
+}
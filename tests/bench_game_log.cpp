@@ -0,0 +1,143 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "./actions.h"
+#include "./game_log.h"
+#include "./test_util.h"
+#include "./types.h"
+
+// Measures encoding game logs (as the action and draw hooks do, one action or sample at a time) and
+// decoding them again (as the build order, hotkey and resource readers do), in MB of log per
+// second. The games are 20 minute 1v1s at ~200 APM, with a sample every 24 ticks.
+
+using apm::GameLogDecoder;
+using apm::GameLogEncoder;
+using apm::GameLogEvent;
+
+namespace {
+
+namespace action = apm::action;
+
+const int GAMES = 200;
+const uint32 TICKS = 20 * 60 * 1000 / 42;
+
+struct Record {
+  uint32 tick;
+  // 0-11 for an action by that player, 12 for a sample
+  uint8 kind;
+  byte data[16];
+};
+
+// The game's actions and samples, generated up front so that only the encoder is timed
+std::vector<Record> MakeGame(std::mt19937* rng) {
+  std::vector<Record> records;
+  for (uint32 tick = 0; tick < TICKS; tick++) {
+    for (uint8 player = 0; player < 2; player++) {
+      if ((*rng)() % 1000 >= 140) {
+        continue;
+      }
+      Record record;
+      record.tick = tick;
+      record.kind = player;
+      for (byte& b : record.data) {
+        b = static_cast<byte>((*rng)());
+      }
+      const uint32 kind = (*rng)() % 10;
+      if (kind < 3) {
+        record.data[0] = action::SELECT;
+        record.data[1] = static_cast<byte>(1 + (*rng)() % 6);
+      } else if (kind < 5) {
+        record.data[0] = action::HOTKEY;
+      } else if (kind < 8) {
+        record.data[0] = action::RIGHT_CLICK;
+      } else if (kind == 8) {
+        record.data[0] = action::TRAIN;
+      } else {
+        record.data[0] = action::BUILD;
+      }
+      records.push_back(record);
+    }
+    if (tick % 24 == 0) {
+      Record record = Record();
+      record.tick = tick;
+      record.kind = 12;
+      records.push_back(record);
+    }
+  }
+  return records;
+}
+
+void Encode(const std::vector<Record>& records, std::mt19937* rng, std::vector<byte>* log) {
+  GameLogEncoder encoder;
+  apm::GameLogHeader header = apm::GameLogHeader();
+  header.playerNames[0] = "player one";
+  header.playerNames[1] = "player two";
+  encoder.Begin(header, [log](std::vector<byte> block) {
+    log->insert(log->end(), block.begin(), block.end());
+  });
+  apm::GameLogSample sample = apm::GameLogSample();
+  for (const Record& record : records) {
+    if (record.kind < 12) {
+      encoder.AddAction(record.tick, record.kind, record.data);
+    } else {
+      for (size_t i = 0; i < 2; i++) {
+        sample.minerals[i] = static_cast<int32>((*rng)() % 1500);
+        sample.vespene[i] = static_cast<int32>((*rng)() % 800);
+        sample.population[i] = record.tick / 75;
+      }
+      encoder.AddSample(record.tick, sample);
+    }
+  }
+  encoder.End(TICKS);
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 rng(37);
+  std::vector<std::vector<Record>> games;
+  size_t numRecords = 0;
+  for (int i = 0; i < GAMES; i++) {
+    games.push_back(MakeGame(&rng));
+    numRecords += games.back().size();
+  }
+
+  std::vector<std::vector<byte>> logs(GAMES);
+  for (std::vector<byte>& log : logs) {
+    log.reserve(256 * 1024);
+  }
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < GAMES; i++) {
+    Encode(games[i], &rng, &logs[i]);
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  size_t numBytes = 0;
+  for (const std::vector<byte>& log : logs) {
+    numBytes += log.size();
+  }
+  std::printf("%d games, %zu records, %.1f KB per game\n", GAMES, numRecords,
+      numBytes / 1024.0 / GAMES);
+  std::printf("encode: %.0f MB/s, %.1f ns per record\n", numBytes / seconds / 1e6,
+      seconds * 1e9 / numRecords);
+
+  size_t numEvents = 0;
+  start = std::chrono::steady_clock::now();
+  for (const std::vector<byte>& log : logs) {
+    GameLogDecoder decoder(log.data(), log.size());
+    apm::GameLogHeader header;
+    CHECK(decoder.ReadHeader(&header) == GameLogDecoder::Result::Ok);
+    GameLogEvent event;
+    GameLogDecoder::Result result;
+    while ((result = decoder.Next(&event)) == GameLogDecoder::Result::Ok) {
+      numEvents++;
+    }
+    CHECK(result == GameLogDecoder::Result::Done);
+  }
+  seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  CHECK_EQ(numRecords + GAMES, numEvents);
+  std::printf("decode: %.0f MB/s, %.1f ns per record\n", numBytes / seconds / 1e6,
+      seconds * 1e9 / numEvents);
+  return 0;
+}
@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#include "./game_monitor.h"
+#include "./simulated_brood_war.h"
+#include "./types.h"
+
+// Runs GameMonitor through a 30 minute game at 300 APM per player, drawing every frame, and
+// reports how fast that goes compared to real time. Draw calls are counted but not recorded, so
+// they don't dominate. Then runs the monitor's own thread through a series of short games, and
+// reports how long it takes to inject the hooks after a game starts (actions before that are
+// missed) and to restore them after it ends.
+
+using apm::ActionScript;
+using apm::GameMonitor;
+using apm::GameSimulation;
+using apm::SimulatedBroodWar;
+
+namespace {
+
+const uint32 TICKS_PER_MINUTE = 1000 * 60 / 42;
+const uint32 GAME_TICKS = 30 * TICKS_PER_MINUTE;
+const uint32 PLAYERS = 8;
+
+void Run(bool isReplay) {
+  SimulatedBroodWar sim;
+  sim.SetRecordingDrawText(false);
+  GameMonitor monitor(sim.Create());
+  sim.StartGame({ "a", "b", "c", "d", "e", "f", "g", "h" }, isReplay);
+
+  ActionScript script;
+  const byte select[] = { 0x09, 0x01, 0x34, 0x12 };
+  for (uint32 tick = 0; tick < GAME_TICKS; tick++) {
+    for (uint32 player = 0; player < PLAYERS; player++) {
+      // 300 APM is an action every 4.76 ticks
+      if ((tick * 21 + player * 7) % 100 < 21) {
+        if (tick % 3 == 0) {
+          script.Add(tick, static_cast<uint8>(player), select, sizeof(select));
+        } else {
+          script.Add(tick, static_cast<uint8>(player), 0x14);
+        }
+      }
+    }
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  GameSimulation run(&sim, &monitor);
+  run.RunUntil(script, GAME_TICKS);
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  sim.EndGame();
+  monitor.Update();
+
+  double gameSeconds = GAME_TICKS * 0.042;
+  std::printf("%s: %zu actions, %u draw calls in %.3f s (%.0fx real time, %.2f us per frame)\n",
+      isReplay ? "replay" : "game", script.size(), sim.drawTextCount(), seconds,
+      gameSeconds / seconds, seconds * 1e6 / GAME_TICKS);
+}
+
+// Waits for the monitor's thread to inject (or restore) the hooks, and returns how long after since
+// it did
+double WaitForHooks(const SimulatedBroodWar& sim, bool injected,
+    std::chrono::steady_clock::time_point since) {
+  while (sim.hooksInjected() != injected) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return std::chrono::duration<double, std::milli>(sim.hooksChangedAt() - since).count();
+}
+
+void MeasureTimeToInject() {
+  const int GAMES = 20;
+  SimulatedBroodWar sim;
+  GameMonitor monitor(sim.Create());
+  monitor.Start();
+
+  double injectTotal = 0;
+  double injectMax = 0;
+  double restoreTotal = 0;
+  double restoreMax = 0;
+  for (int i = 0; i < GAMES; i++) {
+    // so games start and end at different points of the monitor's wait
+    std::this_thread::sleep_for(std::chrono::milliseconds(i * 37 % 200));
+    auto start = std::chrono::steady_clock::now();
+    sim.StartGame({ "a", "b" }, false);
+    const double inject = WaitForHooks(sim, true, start);
+    injectTotal += inject;
+    injectMax = std::max(injectMax, inject);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(i * 53 % 100));
+    start = std::chrono::steady_clock::now();
+    sim.EndGame();
+    const double restore = WaitForHooks(sim, false, start);
+    restoreTotal += restore;
+    restoreMax = std::max(restoreMax, restore);
+  }
+  monitor.Stop();
+
+  std::printf("time to inject: %.1f ms mean, %.1f ms max; to restore: %.1f ms mean, %.1f ms max\n",
+      injectTotal / GAMES, injectMax, restoreTotal / GAMES, restoreMax);
+}
+
+}  // namespace
+
+int main() {
+  Run(false);
+  Run(true);
+  MeasureTimeToInject();
+  return 0;
+}
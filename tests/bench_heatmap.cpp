@@ -0,0 +1,55 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "./heatmap.h"
+#include "./types.h"
+
+// Measures adding heat for 8 players' clicks, and exporting a player's heatmap at each
+// downsampling factor (with decay applied on the way out).
+
+using apm::ActionHeatmap;
+
+namespace {
+
+const int ACTIONS = 2000000;
+const int EXPORTS = 1000;
+
+}  // namespace
+
+int main() {
+  std::mt19937 rng(1);
+  std::normal_distribution<double> position(128, 40);
+  std::vector<uint32> xs(ACTIONS);
+  std::vector<uint32> ys(ACTIONS);
+  for (int i = 0; i < ACTIONS; i++) {
+    xs[i] = std::min<uint32>(255, static_cast<uint32>(std::abs(position(rng))));
+    ys[i] = std::min<uint32>(255, static_cast<uint32>(std::abs(position(rng))));
+  }
+
+  ActionHeatmap heatmap;
+  heatmap.Reset(0xFF);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < ACTIONS; i++) {
+    heatmap.Add(i / 64, static_cast<uint8>(i & 7), xs[i], ys[i]);
+  }
+  double elapsed = std::chrono::duration<double, std::nano>(
+      std::chrono::steady_clock::now() - start).count();
+  std::printf("add: %.1f ns/action\n", elapsed / ACTIONS);
+
+  const uint32 tick = (ACTIONS - 1) / 64;
+  std::vector<uint16> out(ActionHeatmap::GRID_SIZE * ActionHeatmap::GRID_SIZE);
+  for (uint32 factor : { 1u, 2u, 4u, 8u }) {
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < EXPORTS; i++) {
+      heatmap.Export(0, tick + i * ActionHeatmap::DECAY_TICKS / 4, factor, out.data());
+    }
+    elapsed = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - start).count();
+    std::printf("export, factor %u: %.1f us\n", factor, elapsed / EXPORTS);
+  }
+  return 0;
+}
@@ -0,0 +1,105 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "./actions.h"
+#include "./game_log.h"
+#include "./hotkey_stats.h"
+#include "./types.h"
+
+// Measures aggregating hotkey stats over a set of recorded game logs, on one and several threads,
+// and consuming actions live from the action hook.
+
+using apm::HotkeyAnalyzer;
+using apm::HotkeyStatsByPlayer;
+
+namespace {
+
+namespace action = apm::action;
+
+const int GAMES = 40;
+const uint32 GAME_TICKS = 28000;
+const int LIVE_ACTIONS = 20000000;
+
+// A 2 player game at ~300 APM, with a quarter of the actions being hotkey use
+std::vector<byte> MakeLog(std::mt19937* rng, int game, size_t* numActions) {
+  static const char* const names[] = { "alice", "bob", "carol", "dave" };
+  std::vector<byte> log;
+  apm::GameLogEncoder encoder;
+  apm::GameLogHeader header = apm::GameLogHeader();
+  header.playerNames[0] = names[game % 4];
+  header.playerNames[1] = names[(game + 1) % 4];
+  encoder.Begin(header, [&log](std::vector<byte> block) {
+    log.insert(log.end(), block.begin(), block.end());
+  });
+
+  for (uint32 tick = 0; tick < GAME_TICKS; tick++) {
+    for (uint8 player = 0; player < 2; player++) {
+      if ((*rng)() % 1000 >= 170) {
+        continue;
+      }
+      byte data[32] = {};
+      switch ((*rng)() % 4) {
+        case 0:
+          data[0] = action::SELECT;
+          data[1] = static_cast<byte>(1 + (*rng)() % 12);
+          break;
+        case 1:
+          data[0] = action::HOTKEY;
+          data[1] = static_cast<byte>((*rng)() % 3);
+          data[2] = static_cast<byte>((*rng)() % 10);
+          break;
+        case 2:
+          data[0] = action::SHIFT_SELECT;
+          data[1] = 1;
+          break;
+        default:
+          data[0] = action::RIGHT_CLICK;
+          break;
+      }
+      encoder.AddAction(tick, player, data);
+      (*numActions)++;
+    }
+  }
+  encoder.End(GAME_TICKS);
+  return log;
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 rng(11);
+  std::vector<std::vector<byte>> logs;
+  size_t numActions = 0;
+  for (int i = 0; i < GAMES; i++) {
+    logs.push_back(MakeLog(&rng, i, &numActions));
+  }
+  std::vector<apm::GameLogData> data;
+  for (const std::vector<byte>& log : logs) {
+    apm::GameLogData entry = { log.data(), log.size() };
+    data.push_back(entry);
+  }
+
+  for (uint32 threads : { 1U, 4U }) {
+    HotkeyStatsByPlayer result;
+    auto start = std::chrono::steady_clock::now();
+    const size_t read = apm::AggregateHotkeyStats(data, threads, &result);
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%u threads: %zu of %d logs, %.1f M actions/s\n", threads, read, GAMES,
+        numActions / seconds / 1e6);
+  }
+
+  HotkeyAnalyzer analyzer;
+  const byte recall[] = { action::HOTKEY, action::HOTKEY_SELECT, 3 };
+  const byte select[] = { action::SELECT, 1, 0, 0 };
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < LIVE_ACTIONS; i++) {
+    analyzer.Consume(i >> 2, i & 1, (i & 1) ? recall : select);
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::printf("live: %.2f ns per action (%u recalls)\n", seconds * 1e9 / LIVE_ACTIONS,
+      analyzer.stats(1).recalls[3]);
+  return 0;
+}
@@ -0,0 +1,131 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "./inline_hook.h"
+#include "./test_util.h"
+#include "./types.h"
+
+// Measures what a call through a hooked function costs, redirected by the old push/ret stub versus
+// FuncHook's relative and absolute jumps, and passing through to the original via its trampoline.
+// Each call is made at the bottom of a chain of nested calls: push/ret leaves the return stack
+// buffer one entry off, so every return up the chain is mispredicted, while a jump leaves it
+// balanced. The hooked function is hand written x86-64 System V code, so this only runs there.
+
+using sbat::AllocateExecutable;
+using sbat::FreeExecutable;
+using sbat::FuncHook;
+
+#if defined(__x86_64__) && defined(__linux__)
+namespace {
+
+const int CALLS = 5000000;
+const size_t PAGE_SIZE = 4096;
+
+// int f(int x) { return x + 1; }, with enough nops in front for an absolute jump to replace
+const byte FUNCTION[] = {
+  0x0F, 0x1F, 0x44, 0x00, 0x00,  // nop dword [rax+rax]
+  0x0F, 0x1F, 0x44, 0x00, 0x00,
+  0x0F, 0x1F, 0x44, 0x00, 0x00,
+  0x8D, 0x47, 0x01,  // lea eax, [rdi+1]
+  0xC3,  // ret
+};
+
+typedef int (*Function)(int);
+
+Function volatile target = nullptr;
+Function volatile passThrough = nullptr;
+
+// Through a volatile pointer, so the compiler can't flatten the chain
+int Nest(int depth, int x);
+int (*volatile nest)(int, int) = &Nest;
+int Nest(int depth, int x) {
+  return depth == 0 ? target(x) : nest(depth - 1, x) - 1;
+}
+
+int Hook(int x) {
+  return x + 1;
+}
+
+int PassThroughHook(int x) {
+  return passThrough(x);
+}
+
+byte* CreateFunction(const void* nearby) {
+  byte* page = AllocateExecutable(PAGE_SIZE, nearby);
+  memset(page, 0xCC, PAGE_SIZE);
+  memcpy(page, FUNCTION, sizeof(FUNCTION));
+  return page;
+}
+
+// push <low half of hook>; mov dword [rsp+4], <high half of hook>; ret
+void WritePushRet(byte* location, const void* hook) {
+  const uint64 address = reinterpret_cast<uintptr_t>(hook);
+  const uint32 low = static_cast<uint32>(address);
+  const uint32 high = static_cast<uint32>(address >> 32);
+  byte stub[] = { 0x68, 0, 0, 0, 0, 0xC7, 0x44, 0x24, 0x04, 0, 0, 0, 0, 0xC3 };
+  memcpy(&stub[1], &low, sizeof(low));
+  memcpy(&stub[9], &high, sizeof(high));
+  sbat::WriteCode(location, stub, sizeof(stub));
+}
+
+void Run(const char* name, Function function) {
+  target = function;
+  for (int depth : { 0, 8 }) {
+    uint32 sum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < CALLS; i++) {
+      sum += static_cast<uint32>(nest(depth, i));
+    }
+    const double ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start).count() / CALLS;
+    // every variant returns x + 1 - depth, so they all have to agree on this
+    const uint32 expected = static_cast<uint32>(
+        static_cast<int64>(CALLS) * (CALLS - 1) / 2 + static_cast<int64>(CALLS) * (1 - depth));
+    CHECK_EQ(expected, sum);
+    std::printf("%-34s depth %d: %6.2f ns/call\n", name, depth, ns);
+  }
+}
+
+}  // namespace
+#endif
+
+int main() {
+#if defined(__x86_64__) && defined(__linux__)
+  byte* nearby = CreateFunction(reinterpret_cast<const void*>(&Hook));
+  byte* farAway = CreateFunction(nullptr);
+  const Function nearbyFunction = reinterpret_cast<Function>(nearby);
+  const Function farFunction = reinterpret_cast<Function>(farAway);
+
+  Run("unhooked", nearbyFunction);
+  {
+    FuncHook<Function> hook(nearbyFunction, &Hook);
+    CHECK(hook.Inject());
+    CHECK_EQ(0xE9, nearby[0]);
+    Run("FuncHook, relative jmp", nearbyFunction);
+  }
+  {
+    FuncHook<Function> hook(farFunction, &Hook);
+    CHECK(hook.Inject());
+    if (farAway[0] == 0xFF) {
+      Run("FuncHook, absolute jmp", farFunction);
+    } else {
+      std::printf("(the far function ended up within 2GB of the hook)\n");
+    }
+  }
+  {
+    FuncHook<Function> hook(nearbyFunction, &PassThroughHook);
+    passThrough = hook.callable();
+    CHECK(hook.Inject());
+    Run("FuncHook, passing through", nearbyFunction);
+  }
+  WritePushRet(nearby, reinterpret_cast<const void*>(&Hook));
+  Run("push/ret stub", nearbyFunction);
+
+  FreeExecutable(nearby, PAGE_SIZE);
+  FreeExecutable(farAway, PAGE_SIZE);
+#else
+  std::printf("Only runs on x86-64 Linux\n");
+#endif
+  return 0;
+}
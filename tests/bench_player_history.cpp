@@ -0,0 +1,76 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+#include "./player_history.h"
+#include "./test_util.h"
+#include "./types.h"
+
+// Measures recording a large history, opening it (with and without an up to date index), and
+// looking players up in it.
+
+using apm::PlayerHistory;
+using apm::PlayerTotals;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const uint32 GAMES = 200000;
+const uint32 PLAYERS = 20000;
+const uint32 LOOKUPS = 1000000;
+
+double MillisSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+}  // namespace
+
+int main() {
+  TempDirectory dir;
+  std::mt19937 rng(3);
+  auto start = Clock::now();
+  {
+    PlayerHistory history(dir.path());
+    history.Open();
+    for (uint32 i = 0; i < GAMES; i++) {
+      history.AddGame(rng() % PLAYERS * 7 + 1, 3000 + rng() % 5000, 20000, 1700000000 + i);
+    }
+  }
+  std::printf("add %u games: %.0f ms\n", GAMES, MillisSince(start));
+
+  {
+    start = Clock::now();
+    PlayerHistory history(dir.path());
+    history.Open();
+    std::printf("open: %.2f ms (%zu indexed players, %zu pending)\n", MillisSince(start),
+        history.indexedPlayers(), history.pendingPlayers());
+
+    start = Clock::now();
+    uint32 found = 0;
+    double totalApm = 0;
+    PlayerTotals totals;
+    for (uint32 i = 0; i < LOOKUPS; i++) {
+      if (history.Lookup(rng() % PLAYERS * 7 + 1, &totals)) {
+        found++;
+        totalApm += totals.averageApm();
+      }
+    }
+    std::printf("lookup: %.0f ns each (%u found, average APM %.1f)\n",
+        MillisSince(start) * 1e6 / LOOKUPS, found, totalApm / found);
+
+    start = Clock::now();
+    history.AddGame(36, 100, 20000, 1);
+    std::printf("single add: %.3f ms\n", MillisSince(start));
+  }
+
+  std::remove(dir.File("players.idx").c_str());
+  start = Clock::now();
+  PlayerHistory history(dir.path());
+  history.Open();
+  std::printf("open without an index: %.1f ms (%zu pending)\n", MillisSince(start),
+      history.pendingPlayers());
+  start = Clock::now();
+  history.Compact();
+  std::printf("compact: %.1f ms (%zu indexed)\n", MillisSince(start), history.indexedPlayers());
+  return 0;
+}
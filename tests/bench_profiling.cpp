@@ -0,0 +1,53 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#include "./profiling.h"
+#include "./types.h"
+
+// Measures what a probe adds to the function it's in, and what rdtsc costs on this machine (which
+// is what decides how expensive the timed calls are).
+
+namespace {
+
+const int CALLS = 20000000;
+
+volatile int sink;
+
+void Plain() {
+  sink = sink + 1;
+}
+
+void Probed() {
+  APM_PROBE(Draw);
+  sink = sink + 1;
+}
+
+// Called through a volatile pointer so neither function can be inlined into the loop
+double TimeCalls(void (*volatile fn)()) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < CALLS; i++) {
+    fn();
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / CALLS;
+}
+
+}  // namespace
+
+int main() {
+  double plain = 1e9;
+  double probed = 1e9;
+  for (int run = 0; run < 5; run++) {
+    plain = std::min(plain, TimeCalls(Plain));
+    probed = std::min(probed, TimeCalls(Probed));
+  }
+  std::printf("plain %.2f ns, probed %.2f ns, probe cost %.2f ns\n", plain, probed, probed - plain);
+
+  const uint64 start = __rdtsc();
+  for (int i = 0; i < CALLS; i++) {
+    sink = static_cast<int>(__rdtsc());
+  }
+  std::printf("rdtsc alone ~%.1f cycles\n", static_cast<double>(__rdtsc() - start) / CALLS);
+  return 0;
+}
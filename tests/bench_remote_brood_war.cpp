@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "./action_forwarding.h"
+#include "./actions.h"
+#include "./brood_war.h"
+#include "./game_monitor.h"
+#include "./remote_brood_war.h"
+#include "./remote_memory.h"
+#include "./simulated_brood_war.h"
+#include "./test_util.h"
+#include "./types.h"
+
+// Measures what a monitor running outside the game spends each tick: sampling the game's data with
+// one batched read versus one read per variable, and a whole Step (sampling, the monitor's Update
+// and feeding it the forwarded actions) for an 8 player game at ~300 APM each. The game is
+// simulated in this process and read through RemoteProcessMemory, as it would be from another one.
+
+using apm::ActionForwardReader;
+using apm::ActionForwardWriter;
+using apm::RemoteBroodWar;
+using apm::SimulatedBroodWar;
+using apm::SimulatedMemory;
+using sbat::RemoteProcessMemory;
+using std::unique_ptr;
+
+namespace {
+
+const uint32 TICKS = 20000;
+
+double Percentile(std::vector<double> values, double percentile) {
+  std::sort(values.begin(), values.end());
+  return values[static_cast<size_t>(percentile * (values.size() - 1))];
+}
+
+template <typename T>
+void AddSingle(std::vector<unique_ptr<RemoteProcessMemory>>* reads, T* remote, size_t count,
+    std::vector<byte>* local) {
+  reads->push_back(RemoteProcessMemory::Open(CurrentProcessId()));
+  local->resize(sizeof(T) * count);
+  reads->back()->AddRegion(reinterpret_cast<uintptr_t>(remote), local->data(), local->size());
+}
+
+}  // namespace
+
+int main() {
+  const std::string name = UniqueName("apm_bench_remote");
+  SimulatedBroodWar game;
+  apm::BroodWar target = game.Create();
+  unique_ptr<ActionForwardReader> reader = ActionForwardReader::Create(name);
+  unique_ptr<ActionForwardWriter> writer =
+      ActionForwardWriter::Open(CurrentProcessId(), 0, apm::BW_VERSION_UNKNOWN, name);
+  RemoteBroodWar remote(RemoteProcessMemory::Open(CurrentProcessId()), target);
+  apm::GameMonitor monitor(remote.Create());
+
+  // The same variables RemoteBroodWar mirrors, each read on its own
+  SimulatedMemory& memory = game.memory();
+  std::vector<unique_ptr<RemoteProcessMemory>> single;
+  std::vector<std::vector<byte>> singleLocal(10);
+  AddSingle(&single, &memory.isInGame, 1, &singleLocal[0]);
+  AddSingle(&single, &memory.isInReplay, 1, &singleLocal[1]);
+  AddSingle(&single, &memory.gameTimeTicks, 1, &singleLocal[2]);
+  AddSingle(&single, &memory.myPlayerId, 1, &singleLocal[3]);
+  AddSingle(&single, memory.playerInfo.data(), memory.playerInfo.size(), &singleLocal[4]);
+  AddSingle(&single, memory.buildingsControlled.data(), 12, &singleLocal[5]);
+  AddSingle(&single, memory.population.data(), 12, &singleLocal[6]);
+  AddSingle(&single, memory.minerals.data(), 12, &singleLocal[7]);
+  AddSingle(&single, memory.vespene.data(), 12, &singleLocal[8]);
+  AddSingle(&single, memory.playerColor.data(), 12, &singleLocal[9]);
+
+  game.StartGame({ "a", "b", "c", "d", "e", "f", "g", "h" }, false);
+  const byte rightClick[10] = { apm::action::RIGHT_CLICK, 0x40, 0x02, 0x80, 0x01 };
+  const byte select[8] = { apm::action::SELECT, 3, 1, 0, 2, 0, 3, 0 };
+  std::vector<double> batchedTimes;
+  std::vector<double> singleTimes;
+  std::vector<double> stepTimes;
+  for (uint32 tick = 1; tick <= TICKS; tick++) {
+    memory.gameTimeTicks = tick;
+    for (uint8 player = 0; player < 8; player++) {
+      memory.minerals[player] = tick * 3 + player;
+      if ((tick + player) % 8 == 0) {
+        writer->Forward(tick, player, tick & 1 ? rightClick : select);
+      }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    remote.Sample();
+    auto end = std::chrono::steady_clock::now();
+    batchedTimes.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+
+    start = std::chrono::steady_clock::now();
+    for (auto& read : single) {
+      read->Read();
+    }
+    end = std::chrono::steady_clock::now();
+    singleTimes.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+
+    start = std::chrono::steady_clock::now();
+    remote.Step(reader.get(), &monitor);
+    end = std::chrono::steady_clock::now();
+    stepTimes.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+  }
+
+  uint64 singleCalls = 0;
+  for (auto& read : single) {
+    singleCalls += read->readCalls();
+  }
+  std::printf("10 variables in %zu spans\n", remote.process().numSpans());
+  std::printf("batched read:    p50 %6.2f us, p99 %6.2f us, %.2f reads/tick\n",
+      Percentile(batchedTimes, 0.5), Percentile(batchedTimes, 0.99),
+      static_cast<double>(remote.process().readCalls()) / (2 * TICKS));
+  std::printf("per-variable:    p50 %6.2f us, p99 %6.2f us, %.2f reads/tick\n",
+      Percentile(singleTimes, 0.5), Percentile(singleTimes, 0.99),
+      static_cast<double>(singleCalls) / TICKS);
+  std::printf("step (+actions): p50 %6.2f us, p99 %6.2f us, %u dropped\n",
+      Percentile(stepTimes, 0.5), Percentile(stepTimes, 0.99), reader->droppedActions());
+  return 0;
+}
@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+#include "./resource_series.h"
+#include "./types.h"
+
+// Records 20 and 60 minute games for 8 players at the monitor's sampling interval, and measures
+// the whole game queries the overlay makes: income over the last minute, the spending quotient and
+// a 100 point resource float chart. Also measures recording a sample.
+
+using apm::Resource;
+using apm::ResourceSample;
+using apm::ResourceSeries;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const uint32 INTERVAL_TICKS = 24;
+const uint32 TICKS_PER_MINUTE = 60000 / 42;
+const size_t PLAYERS = 8;
+const int QUERIES = 2000;
+
+// Mining at a rate that builds up over the game, spending in chunks now and then
+void RecordGame(uint32 minutes, std::mt19937* rng, ResourceSeries* series, double* recordNanos) {
+  series->Reset();
+  ResourceSample sample = ResourceSample();
+  const uint32 ticks = minutes * TICKS_PER_MINUTE;
+  const auto start = Clock::now();
+  for (uint32 tick = 0; tick < ticks; tick += INTERVAL_TICKS) {
+    for (size_t player = 0; player < PLAYERS; player++) {
+      int32& minerals = sample.at(Resource::Minerals, player);
+      int32& vespene = sample.at(Resource::Vespene, player);
+      minerals += static_cast<int32>(8 + tick / 2000 + (*rng)() % 4);
+      vespene += static_cast<int32>(tick / 3000);
+      if ((*rng)() % 6 == 0) {
+        minerals -= std::min(minerals, static_cast<int32>(50 + (*rng)() % 400));
+        vespene -= std::min(vespene, static_cast<int32>((*rng)() % 200));
+      }
+      sample.at(Resource::Population, player) = static_cast<int32>(std::min(tick / 100, 400U));
+      sample.at(Resource::Buildings, player) = static_cast<int32>(tick / 1500);
+    }
+    series->Record(tick, sample);
+  }
+  *recordNanos = std::chrono::duration<double, std::nano>(Clock::now() - start).count() /
+      series->size();
+}
+
+template <typename Fn>
+double MeasureMicros(Fn query) {
+  const auto start = Clock::now();
+  for (int i = 0; i < QUERIES; i++) {
+    query(i % PLAYERS);
+  }
+  return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / QUERIES;
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 rng(38);
+  ResourceSeries series;
+  for (uint32 minutes : { 20U, 60U }) {
+    double recordNanos;
+    RecordGame(minutes, &rng, &series, &recordNanos);
+
+    double checksum = 0;
+    const double income = MeasureMicros([&](size_t player) {
+      checksum += series.IncomePerMinute(player, Resource::Minerals, TICKS_PER_MINUTE);
+    });
+    const double spendingQuotient = MeasureMicros([&](size_t player) {
+      checksum += series.SpendingQuotient(player);
+    });
+    std::array<int32, 100> chart;
+    const double chartMicros = MeasureMicros([&](size_t player) {
+      series.Chart(player, Resource::Minerals, chart.data(), chart.size());
+      checksum += chart[50];
+    });
+
+    std::printf("%u minutes (%zu samples): record %.0f ns/sample, income %.2f us, "
+        "spending quotient %.2f us, chart %.2f us (checksum %.0f)\n", minutes, series.size(),
+        recordNanos, income, spendingQuotient, chartMicros, checksum);
+  }
+  return 0;
+}
@@ -0,0 +1,73 @@
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "./telemetry.h"
+#include "./test_util.h"
+#include "./types.h"
+
+// Measures how fast the writer can publish while readers follow along, and how many records the
+// readers lose when it publishes flat out (GameMonitor publishes a few times a second, at which
+// rate they lose none).
+
+using apm::TelemetryReader;
+using apm::TelemetryRecord;
+using apm::TelemetryWriter;
+
+namespace {
+
+const uint32 RECORDS = 1000000;
+const int READERS = 4;
+
+}  // namespace
+
+int main() {
+  const std::string name = UniqueName("apm_bench_telemetry");
+  std::unique_ptr<TelemetryWriter> writer = TelemetryWriter::Create(name);
+  if (!writer) {
+    std::printf("couldn't create %s\n", name.c_str());
+    return 1;
+  }
+
+  std::vector<std::unique_ptr<TelemetryReader>> readers;
+  std::vector<uint64> read(READERS);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < READERS; i++) {
+    readers.push_back(TelemetryReader::Open(name));
+    TelemetryReader* reader = readers.back().get();
+    uint64* count = &read[i];
+    threads.emplace_back([reader, count]() {
+      TelemetryRecord record = TelemetryRecord();
+      while (record.gameTimeTicks != RECORDS) {
+        if (reader->Next(&record) == TelemetryReader::Result::Empty) {
+          std::this_thread::yield();
+          continue;
+        }
+        (*count)++;
+      }
+    });
+  }
+
+  TelemetryRecord record = TelemetryRecord();
+  auto start = std::chrono::steady_clock::now();
+  for (uint32 tick = 1; tick <= RECORDS; tick++) {
+    record.gameTimeTicks = tick;
+    record.apm[0] = static_cast<int32>(tick);
+    writer->Publish(record);
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  std::printf("writer: %.1f M records/s (%.0f ns each)\n", RECORDS / seconds / 1e6,
+      seconds * 1e9 / RECORDS);
+  for (int i = 0; i < READERS; i++) {
+    std::printf("reader %d: read %llu, lost %llu\n", i, static_cast<unsigned long long>(read[i]),
+        static_cast<unsigned long long>(readers[i]->lostRecords()));
+  }
+  return 0;
+}
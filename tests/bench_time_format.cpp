@@ -0,0 +1,49 @@
+#include <chrono>
+#include <cstdio>
+
+#include "./time_format.h"
+#include "./types.h"
+
+// Compares formatting with compiled formats (a local clock and a game clock) to snprintf.
+
+using apm::TimeFormat;
+
+namespace {
+
+const int CALLS = 10000000;
+
+volatile size_t sink;
+
+template <typename Fn>
+double NanosPerCall(Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < CALLS; i++) {
+    sink = sink + fn(i);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / CALLS;
+}
+
+}  // namespace
+
+int main() {
+  char out[128];
+  TimeFormat localTime;
+  localTime.Compile("h:mm:ss tt", "AM", "PM", false);
+  TimeFormat gameTime;
+  gameTime.Compile("mm:ss", "", "", false);
+
+  const double local = NanosPerCall([&](int i) {
+    return localTime.Format(i % 24, i % 60, (i >> 3) % 60, out, sizeof(out));
+  });
+  const double game = NanosPerCall([&](int i) {
+    return gameTime.Format(0, i % 6000, (i >> 3) % 60, out, sizeof(out));
+  });
+  const double formatted = NanosPerCall([&](int i) {
+    return static_cast<size_t>(
+        std::snprintf(out, sizeof(out), "%.2d:%.2d", i % 6000, (i >> 3) % 60));
+  });
+  std::printf("h:mm:ss tt: %.1f ns, mm:ss: %.1f ns, snprintf mm:ss: %.1f ns\n", local, game,
+      formatted);
+  return 0;
+}
@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "./types.h"
+#include "./unit_stats.h"
+#include "./unit_types.h"
+
+// Measures one scan of a full unit table when every node changed, when a typical tick's worth of
+// nodes changed and when none did, with the table both in and out of the cache.
+
+using apm::MAX_UNIT_NODES;
+using apm::UNIT_NODE_SIZE;
+using apm::UnitTableScanner;
+
+namespace {
+
+const uint16 TYPES[] = { 0, 7, 41, 64, 37, 38, 65, 66, 5, 43, 111, 142, 160, 36, 42 };
+const int REPS = 300;
+// Larger than the last level cache, written to between scans to evict the table
+const size_t FLUSH_BYTES = 32 * 1024 * 1024;
+
+void SetNode(std::vector<byte>* nodes, size_t index, std::mt19937* rng) {
+  byte* node = &(*nodes)[index * UNIT_NODE_SIZE];
+  const uint32 sprite = 0x00600000 + static_cast<uint32>(index);
+  const uint16 type = TYPES[(*rng)() % 15];
+  const uint16 producing = (*rng)() % 10 == 0 ? 0 : apm::UNIT_TYPE_NONE;
+  std::memcpy(node + apm::UNIT_SPRITE_OFFSET, &sprite, sizeof(sprite));
+  std::memcpy(node + apm::UNIT_TYPE_OFFSET, &type, sizeof(type));
+  node[apm::UNIT_PLAYER_OFFSET] = static_cast<byte>((*rng)() % 8);
+  std::memcpy(node + apm::UNIT_BUILD_QUEUE_OFFSET, &producing, sizeof(producing));
+}
+
+void Run(const char* name, int changes, bool reset, bool cold, std::vector<byte>* nodes,
+    std::vector<byte>* flush, UnitTableScanner* scanner, std::mt19937* rng) {
+  double total = 0;
+  double worst = 0;
+  for (int rep = 0; rep < REPS; rep++) {
+    for (int i = 0; i < changes; i++) {
+      SetNode(nodes, (*rng)() % MAX_UNIT_NODES, rng);
+    }
+    if (reset) {
+      scanner->Reset();
+    }
+    if (cold) {
+      for (size_t i = 0; i < flush->size(); i += 64) {
+        (*flush)[i]++;
+      }
+    }
+    const auto start = std::chrono::steady_clock::now();
+    scanner->Scan(nodes->data());
+    const double micros = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - start).count();
+    total += micros;
+    worst = std::max(worst, micros);
+  }
+  std::printf("%-16s %s cache: mean %7.1f us, worst %7.1f us\n",
+      name, cold ? "cold" : "warm", total / REPS, worst);
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 rng(7);
+  std::vector<byte> nodes(MAX_UNIT_NODES * UNIT_NODE_SIZE);
+  for (size_t i = 0; i < MAX_UNIT_NODES; i++) {
+    SetNode(&nodes, i, &rng);
+  }
+  std::vector<byte> flush(FLUSH_BYTES);
+  UnitTableScanner scanner;
+  scanner.Scan(nodes.data());
+
+  for (bool cold : { false, true }) {
+    Run("all changed", 0, true, cold, &nodes, &flush, &scanner, &rng);
+    Run("40 changed", 40, false, cold, &nodes, &flush, &scanner, &rng);
+    Run("none changed", 0, false, cold, &nodes, &flush, &scanner, &rng);
+  }
+  return 0;
+}
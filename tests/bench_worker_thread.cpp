@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "./worker_thread.h"
+
+// Measures how long a WorkerThread takes to get going after Wake, and how long Stop takes to join
+// it, with the hints GameMonitor uses for its thread.
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const int WAKES = 2000;
+
+class LatencyThread : public sbat::WorkerThread {
+public:
+  LatencyThread()
+    : WorkerThread(),
+      wakes(0),
+      wokenAt(),
+      latencies() {
+    latencies.reserve(WAKES);
+  }
+  virtual ~LatencyThread() {
+    Stop();
+  }
+
+  std::atomic<int> wakes;
+  std::atomic<Clock::rep> wokenAt;
+  std::vector<double> latencies;
+
+protected:
+  virtual void Execute() {
+    while (WaitForWake()) {
+      Clock::rep now = Clock::now().time_since_epoch().count();
+      latencies.push_back(
+          std::chrono::duration<double, std::micro>(Clock::duration(now - wokenAt)).count());
+      wakes++;
+    }
+  }
+};
+
+}  // namespace
+
+int main() {
+  LatencyThread thread;
+  thread.SetPriorityHint(sbat::ThreadPriority::AboveNormal);
+  thread.SetAffinityHint(1);
+  thread.Start();
+  for (int i = 0; i < WAKES; i++) {
+    thread.wokenAt = Clock::now().time_since_epoch().count();
+    thread.Wake();
+    while (thread.wakes == i) {
+    }
+  }
+
+  auto stopStart = Clock::now();
+  thread.Stop();
+  std::printf("stop took %.1f us\n",
+      std::chrono::duration<double, std::micro>(Clock::now() - stopStart).count());
+  std::sort(thread.latencies.begin(), thread.latencies.end());
+  std::printf("wake p50 %.1f us, p99 %.1f us\n", thread.latencies[thread.latencies.size() / 2],
+      thread.latencies[thread.latencies.size() * 99 / 100]);
+  return 0;
+}
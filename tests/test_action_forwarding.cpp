@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "./action_forwarding.h"
+#include "./actions.h"
+#include "./brood_war.h"
+#include "./test_util.h"
+#include "./types.h"
+
+using apm::ActionForwardReader;
+using apm::ActionForwardWriter;
+using apm::ForwardedAction;
+using std::string;
+using std::unique_ptr;
+
+namespace {
+
+namespace action = apm::action;
+
+const byte SELECT_12[26] = { action::SELECT, 12, 1, 0, 2, 0, 3, 0 };
+const byte RIGHT_CLICK[10] = { action::RIGHT_CLICK, 0x40, 0x01, 0x60, 0x00 };
+
+void TestOpenNeedsReader() {
+  const string name = UniqueName("apm_test_actions");
+  CHECK(ActionForwardWriter::Open(1, 2, 0, name) == nullptr);
+  {
+    unique_ptr<ActionForwardReader> reader = ActionForwardReader::Create(name, 512);
+    CHECK(reader != nullptr);
+    CHECK_EQ(0U, reader->writerProcessId());
+    // Only one reader can own the region
+    CHECK(ActionForwardReader::Create(name, 512) == nullptr);
+
+    unique_ptr<ActionForwardWriter> writer =
+        ActionForwardWriter::Open(1234, 0x400000, apm::BW_VERSION_1170, name);
+    CHECK(writer != nullptr);
+    CHECK_EQ(1234U, reader->writerProcessId());
+    CHECK_EQ(0x400000U, reader->writerModuleBase());
+    CHECK_EQ(apm::BW_VERSION_1170, reader->writerBwVersion());
+  }
+  CHECK(ActionForwardWriter::Open(1, 2, 0, name) == nullptr);
+}
+
+void TestInvalidCapacity() {
+  const string name = UniqueName("apm_test_actions");
+  CHECK(ActionForwardReader::Create(name, 1000) == nullptr);
+  // Too small to hold the longest action
+  CHECK(ActionForwardReader::Create(name, 256) == nullptr);
+  CHECK(ActionForwardReader::Create(name, 512) != nullptr);
+}
+
+void TestForwardsActions() {
+  const string name = UniqueName("apm_test_actions");
+  unique_ptr<ActionForwardReader> reader = ActionForwardReader::Create(name, 4096);
+  unique_ptr<ActionForwardWriter> writer = ActionForwardWriter::Open(1, 2, 0, name);
+  ForwardedAction forwarded;
+  CHECK(!reader->Next(&forwarded));
+
+  CHECK(writer->Forward(10, 3, SELECT_12));
+  CHECK(writer->Forward(11, 7, RIGHT_CLICK));
+  CHECK(reader->Next(&forwarded));
+  CHECK_EQ(10U, forwarded.tick);
+  CHECK_EQ(3, forwarded.player);
+  CHECK_EQ(26, forwarded.length);
+  CHECK(std::equal(SELECT_12, SELECT_12 + 26, forwarded.data.begin()));
+  CHECK(reader->Next(&forwarded));
+  CHECK_EQ(11U, forwarded.tick);
+  CHECK_EQ(7, forwarded.player);
+  CHECK_EQ(10, forwarded.length);
+  CHECK_EQ(action::RIGHT_CLICK, forwarded.data[0]);
+  CHECK(!reader->Next(&forwarded));
+}
+
+void TestWrapsAroundAndDrops() {
+  const string name = UniqueName("apm_test_actions");
+  unique_ptr<ActionForwardReader> reader = ActionForwardReader::Create(name, 512);
+  unique_ptr<ActionForwardWriter> writer = ActionForwardWriter::Open(1, 2, 0, name);
+  uint32 written = 0;
+  uint32 read = 0;
+  uint32 nextTick = 0;
+  bool inOrder = true;
+  ForwardedAction forwarded;
+  for (uint32 tick = 0; tick < 100000; tick++) {
+    const byte* data = tick % 3 != 0 ? RIGHT_CLICK : SELECT_12;
+    if (writer->Forward(tick, static_cast<uint8>(tick % 8), data)) {
+      written++;
+    }
+    if (tick % 40 == 0) {
+      while (reader->Next(&forwarded)) {
+        read++;
+        inOrder = inOrder && forwarded.tick >= nextTick && forwarded.player == forwarded.tick % 8 &&
+            forwarded.length == (forwarded.tick % 3 != 0 ? 10 : 26) &&
+            forwarded.data[0] == (forwarded.tick % 3 != 0 ? action::RIGHT_CLICK : action::SELECT);
+        nextTick = forwarded.tick + 1;
+      }
+    }
+  }
+  while (reader->Next(&forwarded)) {
+    read++;
+  }
+  CHECK(inOrder);
+  CHECK_EQ(written, read);
+  // The reader falls behind between drains, so some are dropped (and counted) rather than
+  // overwriting unread ones
+  CHECK(reader->droppedActions() > 0);
+  CHECK_EQ(100000U, written + reader->droppedActions());
+}
+
+void TestNewWriterContinues() {
+  const string name = UniqueName("apm_test_actions");
+  unique_ptr<ActionForwardReader> reader = ActionForwardReader::Create(name, 512);
+  ForwardedAction forwarded;
+  for (uint32 i = 0; i < 30; i++) {
+    unique_ptr<ActionForwardWriter> writer = ActionForwardWriter::Open(i + 1, 2, 0, name);
+    CHECK(writer->Forward(i, 0, RIGHT_CLICK));
+    writer.reset();
+    CHECK(reader->Next(&forwarded));
+    CHECK_EQ(i, forwarded.tick);
+    CHECK_EQ(i + 1, reader->writerProcessId());
+  }
+  CHECK(!reader->Next(&forwarded));
+}
+
+void TestConcurrentWriter() {
+  const string name = UniqueName("apm_test_actions");
+  unique_ptr<ActionForwardReader> reader = ActionForwardReader::Create(name, 1024);
+  unique_ptr<ActionForwardWriter> writer = ActionForwardWriter::Open(1, 2, 0, name);
+  const uint32 ACTIONS = 200000;
+  std::thread game([&writer, ACTIONS]() {
+    for (uint32 tick = 0; tick < ACTIONS; tick++) {
+      // Retry rather than drop, so the reader should see every action exactly once
+      const byte* data = tick & 1 ? RIGHT_CLICK : SELECT_12;
+      while (!writer->Forward(tick, static_cast<uint8>(tick % 12), data)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  uint32 expected = 0;
+  bool intact = true;
+  ForwardedAction forwarded;
+  while (expected < ACTIONS) {
+    if (!reader->Next(&forwarded)) {
+      std::this_thread::yield();
+      continue;
+    }
+    intact = intact && forwarded.tick == expected && forwarded.player == expected % 12 &&
+        forwarded.length == (expected & 1 ? 10 : 26) &&
+        forwarded.data[1] == (expected & 1 ? 0x40 : 12);
+    expected++;
+  }
+  game.join();
+  CHECK(intact);
+  CHECK(!reader->Next(&forwarded));
+}
+
+}  // namespace
+
+int main() {
+  RUN_TEST(TestOpenNeedsReader);
+  RUN_TEST(TestInvalidCapacity);
+  RUN_TEST(TestForwardsActions);
+  RUN_TEST(TestWrapsAroundAndDrops);
+  RUN_TEST(TestNewWriterContinues);
+  RUN_TEST(TestConcurrentWriter);
+  return 0;
+}
@@ -0,0 +1,144 @@
+#include <array>
+
+#include "./apm_series.h"
+#include "./test_util.h"
+#include "./types.h"
+
+using apm::ApmGraphPoint;
+using apm::ApmSeries;
+
+namespace {
+
+const size_t POINTS = 60;
+
+std::array<int32, 12> AllPlayers(int32 apm) {
+  std::array<int32, 12> result;
+  result.fill(apm);
+  return result;
+}
+
+void TestEmpty() {
+  ApmSeries series;
+  std::array<ApmGraphPoint, POINTS> points;
+  series.Query(0, 0, 60000, POINTS, points.data());
+  for (const ApmGraphPoint& point : points) {
+    CHECK_EQ(0U, point.samples);
+  }
+}
+
+void TestOnePointPerBucket() {
+  ApmSeries series;
+  for (uint32 time = 0; time < 600000; time += 1000) {
+    std::array<int32, 12> apm = AllPlayers(100);
+    apm[1] = 200;
+    series.Add(time, apm);
+  }
+  std::array<ApmGraphPoint, POINTS> points;
+  series.Query(1, 540000, 600000, POINTS, points.data());
+  for (const ApmGraphPoint& point : points) {
+    CHECK_EQ(1U, point.samples);
+    CHECK_EQ(200, point.mean);
+    CHECK_EQ(200, point.min);
+    CHECK_EQ(200, point.max);
+  }
+  series.Query(0, 540000, 600000, POINTS, points.data());
+  CHECK_EQ(100, points[0].mean);
+
+  // Nothing has happened after the newest sample yet
+  series.Query(0, 600000, 660000, POINTS, points.data());
+  CHECK_EQ(0U, points[30].samples);
+  // and there are no player slots past 12
+  series.Query(12, 540000, 600000, POINTS, points.data());
+  CHECK_EQ(0U, points[0].samples);
+}
+
+void TestSummarizesSamples() {
+  ApmSeries series;
+  for (uint32 time = 0; time < 20000; time += 250) {
+    series.Add(time, AllPlayers(time % 500 == 0 ? 50 : 150));
+  }
+  std::array<ApmGraphPoint, 10> points;
+  series.Query(0, 10000, 20000, points.size(), points.data());
+  for (const ApmGraphPoint& point : points) {
+    CHECK_EQ(4U, point.samples);
+    CHECK_EQ(50, point.min);
+    CHECK_EQ(150, point.max);
+    CHECK_EQ(100, point.mean);
+  }
+}
+
+void TestClampsValues() {
+  ApmSeries series;
+  std::array<int32, 12> apm = AllPlayers(-5);
+  apm[1] = 100000;
+  series.Add(0, apm);
+  std::array<ApmGraphPoint, 1> points;
+  series.Query(0, 0, 1000, 1, points.data());
+  CHECK_EQ(0, points[0].mean);
+  series.Query(1, 0, 1000, 1, points.data());
+  CHECK_EQ(32767, points[0].mean);
+}
+
+void TestLongGame() {
+  ApmSeries series;
+  const uint32 end = 2 * 60 * 60000;
+  for (uint32 time = 0; time < end; time += 252) {
+    series.Add(time, AllPlayers(time < 5 * 60000 ? 300 : 100));
+  }
+
+  std::array<ApmGraphPoint, POINTS> points;
+  // The whole game
+  series.Query(0, 0, end, POINTS, points.data());
+  for (const ApmGraphPoint& point : points) {
+    CHECK(point.samples > 0U);
+  }
+  CHECK_EQ(300, points[0].mean);
+  CHECK_EQ(100, points[POINTS - 1].mean);
+
+  // The start of the game is long gone from the finer levels, but a coarser one still has it
+  series.Query(0, 0, 5 * 60000, POINTS, points.data());
+  uint32 filled = 0;
+  for (const ApmGraphPoint& point : points) {
+    if (point.samples > 0) {
+      filled++;
+      CHECK_EQ(300, point.max);
+    }
+  }
+  CHECK(filled > 0U);
+}
+
+void TestRewind() {
+  ApmSeries series;
+  for (uint32 time = 0; time < 60000; time += 1000) {
+    series.Add(time, AllPlayers(100));
+  }
+  series.Rewind(30000);
+  for (uint32 time = 31000; time < 60000; time += 1000) {
+    series.Add(time, AllPlayers(300));
+  }
+
+  std::array<ApmGraphPoint, 30> points;
+  series.Query(0, 30000, 60000, points.size(), points.data());
+  // The bucket holding the rewind point is kept
+  CHECK_EQ(100, points[0].mean);
+  for (size_t i = 1; i < points.size(); i++) {
+    CHECK_EQ(1U, points[i].samples);
+    CHECK_EQ(300, points[i].mean);
+  }
+
+  series.Reset();
+  series.Query(0, 0, 60000, points.size(), points.data());
+  CHECK_EQ(0U, points[0].samples);
+}
+
+}  // namespace
+
+int main() {
+  RUN_TEST(TestEmpty);
+  RUN_TEST(TestOnePointPerBucket);
+  RUN_TEST(TestSummarizesSamples);
+  RUN_TEST(TestClampsValues);
+  RUN_TEST(TestLongGame);
+  RUN_TEST(TestRewind);
+  return 0;
+}
@@ -0,0 +1,151 @@
+#include <random>
+
+#include "./apm_shifts.h"
+#include "./test_util.h"
+#include "./types.h"
+
+using apm::ApmShift;
+using apm::ApmShiftDetector;
+using apm::ApmShiftKind;
+
+namespace {
+
+const uint32 STEP = 252;
+
+// Spreads actions as evenly over time as whole actions allow
+class EvenActions {
+public:
+  EvenActions()
+    : total_(0) {
+  }
+
+  uint32 Count(double apm, uint32 millis) {
+    const double before = total_;
+    total_ += apm * millis / 60000.0;
+    return static_cast<uint32>(total_) - static_cast<uint32>(before);
+  }
+
+private:
+  double total_;
+};
+
+// Actions at random times (a Poisson process), using a fixed seed so runs are repeatable with a
+// given standard library
+class RandomActions {
+public:
+  explicit RandomActions(uint32 seed)
+    : rng_(seed) {
+  }
+
+  uint32 Count(double apm, uint32 millis) {
+    uint32 count = 0;
+    const double chance = apm / 60000.0;
+    for (uint32 i = 0; i < millis; i++) {
+      if (std::generate_canonical<double, 32>(rng_) < chance) {
+        count++;
+      }
+    }
+    return count;
+  }
+
+private:
+  std::mt19937 rng_;
+};
+
+// Plays fromApm for a minute and then toApm for 30 seconds, returning the first shift detected
+// and the game time it was detected at (0 if there wasn't one)
+template <typename Actions>
+uint32 RunChange(Actions* actions, double fromApm, double toApm, ApmShift* shift) {
+  const uint32 change = 60000;
+  ApmShiftDetector detector;
+  for (uint32 time = STEP; time <= change + 30000; time += STEP) {
+    const double apm = time <= change ? fromApm : toApm;
+    if (detector.Update(0, time, STEP, actions->Count(apm, STEP))) {
+      *shift = detector.lastShift(0);
+      return time;
+    }
+  }
+  return 0;
+}
+
+void TestSteadyPlayHasNoShifts() {
+  for (double apm : { 60.0, 150.0, 300.0 }) {
+    EvenActions even;
+    RandomActions random(1);
+    ApmShiftDetector detector;
+    uint32 randomShifts = 0;
+    for (uint32 time = STEP; time <= 20 * 60000; time += STEP) {
+      CHECK(!detector.Update(0, time, STEP, even.Count(apm, STEP)));
+      if (detector.Update(1, time, STEP, random.Count(apm, STEP))) {
+        randomShifts++;
+      }
+    }
+    CHECK(detector.lastShift(0).kind == ApmShiftKind::None);
+    // Random play does look like a shift now and then, but rarely
+    CHECK(randomShifts <= 3);
+  }
+}
+
+void TestBurst() {
+  EvenActions actions;
+  ApmShift shift;
+  const uint32 detectedAt = RunChange(&actions, 150, 300, &shift);
+  CHECK(detectedAt > 60000);
+  CHECK(detectedAt < 70000);
+  CHECK(shift.kind == ApmShiftKind::Burst);
+  CHECK_EQ(detectedAt, shift.timeMillis);
+  // The baseline has started adapting to the new rate by the time the shift is detected
+  CHECK(shift.fromApm > 140 && shift.fromApm < 220);
+  CHECK(shift.toApm > 220 && shift.toApm < 380);
+}
+
+void TestCollapse() {
+  EvenActions actions;
+  ApmShift shift;
+  const uint32 detectedAt = RunChange(&actions, 150, 0, &shift);
+  CHECK(detectedAt > 60000);
+  CHECK(detectedAt < 70000);
+  CHECK(shift.kind == ApmShiftKind::Collapse);
+  CHECK(shift.toApm < 30);
+}
+
+void TestRandomChangesAreDetected() {
+  RandomActions actions(2);
+  ApmShift shift;
+  uint32 detectedAt = RunChange(&actions, 80, 200, &shift);
+  CHECK(detectedAt > 60000);
+  CHECK(shift.kind == ApmShiftKind::Burst);
+  detectedAt = RunChange(&actions, 300, 60, &shift);
+  CHECK(detectedAt > 60000);
+  CHECK(shift.kind == ApmShiftKind::Collapse);
+}
+
+void TestPlayersAreIndependent() {
+  EvenActions active;
+  EvenActions steady;
+  ApmShiftDetector detector;
+  bool shifted = false;
+  for (uint32 time = STEP; time <= 90000; time += STEP) {
+    if (detector.Update(0, time, STEP, active.Count(time <= 60000 ? 150 : 0, STEP))) {
+      shifted = true;
+    }
+    CHECK(!detector.Update(1, time, STEP, steady.Count(150, STEP)));
+  }
+  CHECK(shifted);
+  CHECK(detector.lastShift(0).kind == ApmShiftKind::Collapse);
+  CHECK(detector.lastShift(1).kind == ApmShiftKind::None);
+
+  detector.Reset();
+  CHECK(detector.lastShift(0).kind == ApmShiftKind::None);
+}
+
+}  // namespace
+
+int main() {
+  RUN_TEST(TestSteadyPlayHasNoShifts);
+  RUN_TEST(TestBurst);
+  RUN_TEST(TestCollapse);
+  RUN_TEST(TestRandomChangesAreDetected);
+  RUN_TEST(TestPlayersAreIndependent);
+  return 0;
+}
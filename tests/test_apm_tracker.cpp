@@ -0,0 +1,130 @@
+#include <array>
+#include <vector>
+
+#include "./apm_tracker.h"
+#include "./game_arena.h"
+#include "./test_util.h"
+#include "./types.h"
+
+using apm::ApmTracker;
+
+namespace {
+
+const uint32 STEP = 250;
+
+std::array<uint32, 12> ActionsAt(uint32 time) {
+  std::array<uint32, 12> actions = std::array<uint32, 12>();
+  actions[0] = time % 7;
+  actions[5] = 3 + time % 11;
+  return actions;
+}
+
+void CheckSameState(const ApmTracker& expected, const ApmTracker& actual) {
+  CHECK_EQ(expected.timeMillis(), actual.timeMillis());
+  std::array<int32, 12> expectedApm;
+  std::array<int32, 12> actualApm;
+  expected.GetApm(&expectedApm);
+  actual.GetApm(&actualApm);
+  CHECK(expectedApm == actualApm);
+  for (size_t player = 0; player < 12; player++) {
+    CHECK_EQ(expected.actions(player), actual.actions(player));
+  }
+}
+
+void TestCountsActions() {
+  ApmTracker tracker;
+  tracker.Reset(false);
+  std::array<int32, 12> apm;
+  tracker.GetApm(&apm);
+  CHECK_EQ(0, apm[0]);
+  for (uint32 time = STEP; time <= 60000; time += STEP) {
+    tracker.Advance(time, ActionsAt(time));
+  }
+  CHECK_EQ(60000U, tracker.timeMillis());
+  tracker.GetApm(&apm);
+  CHECK(apm[5] > apm[0]);
+  CHECK(apm[0] > 0);
+  CHECK_EQ(0, apm[1]);
+  // Without checkpointing, seeking does nothing and nothing is journaled
+  tracker.Seek(30000);
+  CHECK_EQ(60000U, tracker.timeMillis());
+  CHECK_EQ(0U, tracker.journalSize());
+}
+
+void TestSeekMatchesReplaying() {
+  ApmTracker tracker;
+  tracker.Reset(true);
+  const uint32 end = 10 * 60000;
+  for (uint32 time = STEP; time <= end; time += STEP) {
+    tracker.Advance(time, ActionsAt(time));
+  }
+
+  const uint32 targets[] = { 300000, 123456, 5000, 250, 599750 };
+  for (uint32 target : targets) {
+    ApmTracker seeking;
+    seeking.Reset(true);
+    ApmTracker expected;
+    expected.Reset(true);
+    for (uint32 time = STEP; time <= end; time += STEP) {
+      seeking.Advance(time, ActionsAt(time));
+      // Seeking between updates lands on the last one before it
+      if (time <= target) {
+        expected.Advance(time, ActionsAt(time));
+      }
+    }
+    seeking.Seek(target);
+    CheckSameState(expected, seeking);
+
+    // and carries on from there as if it had never gone further
+    for (uint32 time = expected.timeMillis() + STEP; time <= target + 10000; time += STEP) {
+      seeking.Advance(time, ActionsAt(time));
+      expected.Advance(time, ActionsAt(time));
+    }
+    CheckSameState(expected, seeking);
+  }
+}
+
+void TestCheckpointsStayBounded() {
+  ApmTracker tracker;
+  tracker.Reset(true);
+  const uint32 end = 3 * 60 * 60000;
+  for (uint32 time = STEP; time <= end; time += STEP) {
+    tracker.Advance(time, ActionsAt(time));
+  }
+  CHECK(tracker.numCheckpoints() <= ApmTracker::MAX_CHECKPOINTS);
+  CHECK(tracker.numCheckpoints() > ApmTracker::MAX_CHECKPOINTS / 4);
+  // A few bytes per update
+  CHECK(tracker.journalSize() < end / STEP * 8);
+
+  ApmTracker expected;
+  expected.Reset(false);
+  for (uint32 time = STEP; time <= 3600000; time += STEP) {
+    expected.Advance(time, ActionsAt(time));
+  }
+  tracker.Seek(3600000);
+  CheckSameState(expected, tracker);
+}
+
+void TestArena() {
+  apm::GameArena arena;
+  ApmTracker tracker(&arena);
+  for (int game = 0; game < 3; game++) {
+    arena.Reset();
+    tracker.Reset(true);
+    for (uint32 time = STEP; time <= 120000; time += STEP) {
+      tracker.Advance(time, ActionsAt(time));
+    }
+    tracker.Seek(60000);
+    CHECK_EQ(60000U, tracker.timeMillis());
+  }
+}
+
+}  // namespace
+
+int main() {
+  RUN_TEST(TestCountsActions);
+  RUN_TEST(TestSeekMatchesReplaying);
+  RUN_TEST(TestCheckpointsStayBounded);
+  RUN_TEST(TestArena);
+  return 0;
+}
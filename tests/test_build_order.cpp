@@ -0,0 +1,198 @@
+#include <array>
+#include <string>
+#include <vector>
+
+#include "./actions.h"
+#include "./build_order.h"
+#include "./game_arena.h"
+#include "./game_log.h"
+#include "./test_util.h"
+#include "./types.h"
+
+using apm::BuildOrderEntry;
+using apm::BuildOrderExtractor;
+using apm::BuildOrderKind;
+using std::string;
+
+namespace {
+
+namespace action = apm::action;
+
+const byte TRAIN_SCV[] = { action::TRAIN, 7, 0 };
+const byte RIGHT_CLICK[] = { action::RIGHT_CLICK, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+// Build a Supply Depot (109) at x, y
+std::array<byte, 8> BuildDepot(uint16 x, uint16 y) {
+  std::array<byte, 8> build = {{
+    action::BUILD, 0x1E, static_cast<byte>(x), static_cast<byte>(x >> 8),
+    static_cast<byte>(y), static_cast<byte>(y >> 8), 109, 0
+  }};
+  return build;
+}
+
+void TestKinds() {
+  BuildOrderExtractor extractor;
+  const byte morph[] = { action::UNIT_MORPH, 103, 0 };
+  const byte lair[] = { action::BUILDING_MORPH, 132, 0 };
+  const byte tech[] = { action::TECH, 5 };
+  const byte upgrade[] = { action::UPGRADE, 9 };
+  CHECK(extractor.Consume(1, 0, TRAIN_SCV));
+  CHECK(extractor.Consume(2, 1, BuildDepot(10, 20).data()));
+  CHECK(extractor.Consume(3, 2, morph));
+  CHECK(extractor.Consume(4, 3, lair));
+  CHECK(extractor.Consume(5, 4, tech));
+  CHECK(extractor.Consume(6, 5, upgrade));
+  CHECK(!extractor.Consume(7, 0, RIGHT_CLICK));
+  // Not a player slot
+  CHECK(!extractor.Consume(8, 12, TRAIN_SCV));
+
+  const auto& entries = extractor.entries();
+  CHECK_EQ(6U, entries.size());
+  const BuildOrderKind kinds[] = { BuildOrderKind::Train, BuildOrderKind::Build,
+      BuildOrderKind::UnitMorph, BuildOrderKind::BuildingMorph, BuildOrderKind::Research,
+      BuildOrderKind::Upgrade };
+  const uint16 ids[] = { 7, 109, 103, 132, 5, 9 };
+  for (size_t i = 0; i < entries.size(); i++) {
+    CHECK_EQ(i + 1, entries[i].tick);
+    CHECK_EQ(i, entries[i].player);
+    CHECK(entries[i].kind == kinds[i]);
+    CHECK_EQ(ids[i], entries[i].id);
+  }
+}
+
+void TestRepeatedPlacementCountedOnce() {
+  BuildOrderExtractor extractor;
+  CHECK(extractor.Consume(10, 0, BuildDepot(10, 20).data()));
+  // Spamming the same placement in a tick only builds one
+  CHECK(!extractor.Consume(10, 0, BuildDepot(10, 20).data()));
+  // but another player, position or tick is a different building
+  CHECK(extractor.Consume(10, 1, BuildDepot(10, 20).data()));
+  CHECK(extractor.Consume(10, 0, BuildDepot(12, 20).data()));
+  CHECK(extractor.Consume(11, 0, BuildDepot(12, 20).data()));
+  CHECK_EQ(4U, extractor.entries().size());
+}
+
+void TestRewind() {
+  BuildOrderExtractor extractor;
+  for (uint32 tick = 0; tick < 100; tick += 10) {
+    extractor.Consume(tick, 0, TRAIN_SCV);
+  }
+  extractor.Consume(100, 0, BuildDepot(10, 20).data());
+  extractor.Rewind(50);
+  CHECK_EQ(5U, extractor.entries().size());
+  CHECK_EQ(40U, extractor.entries().back().tick);
+
+  // The placement was rewound too, so replaying it counts again
+  CHECK(extractor.Consume(100, 0, BuildDepot(10, 20).data()));
+  CHECK_EQ(6U, extractor.entries().size());
+
+  extractor.Reset();
+  CHECK(extractor.entries().empty());
+}
+
+void TestFormat() {
+  BuildOrderExtractor extractor;
+  extractor.Consume(100, 0, TRAIN_SCV);
+  extractor.Consume(1500, 1, BuildDepot(10, 20).data());
+  const byte tech[] = { action::TECH, 5 };
+  extractor.Consume(1600, 0, tech);
+  // Unnamed players are left out
+  extractor.Consume(1700, 2, TRAIN_SCV);
+
+  std::array<string, 12> names;
+  names[0] = "p1";
+  names[1] = "p2";
+  CHECK_EQ(string("00:04 p1: Train SCV\n01:03 p2: Build Supply Depot\n01:07 p1: Research #5\n"),
+      FormatBuildOrder(extractor.entries(), names));
+}
+
+std::vector<byte> EncodeLog(const std::vector<std::vector<byte>>& actions) {
+  std::vector<byte> log;
+  apm::GameLogEncoder encoder;
+  apm::GameLogHeader header = apm::GameLogHeader();
+  header.playerNames[0] = "p1";
+  header.playerNames[1] = "p2";
+  encoder.Begin(header, [&log](std::vector<byte> block) {
+    log.insert(log.end(), block.begin(), block.end());
+  });
+  uint32 tick = 0;
+  for (const std::vector<byte>& action : actions) {
+    encoder.AddAction(tick, static_cast<uint8>(tick % 2), action.data());
+    tick += 5;
+  }
+  encoder.End(tick);
+  return log;
+}
+
+void TestExtractFromLog() {
+  std::vector<std::vector<byte>> actions;
+  for (int i = 0; i < 50; i++) {
+    actions.emplace_back(i % 5 == 0 ? std::begin(TRAIN_SCV) : std::begin(RIGHT_CLICK),
+        i % 5 == 0 ? std::end(TRAIN_SCV) : std::end(RIGHT_CLICK));
+  }
+  const std::vector<byte> log = EncodeLog(actions);
+
+  BuildOrderExtractor extractor;
+  std::array<string, 12> names;
+  CHECK(apm::ExtractBuildOrder(log.data(), log.size(), &extractor, &names));
+  CHECK_EQ(string("p2"), names[1]);
+  CHECK_EQ(10U, extractor.entries().size());
+  CHECK_EQ(25U, extractor.entries()[1].tick);
+
+  // A cut off log still gives what came before the cut
+  CHECK(!apm::ExtractBuildOrder(log.data(), log.size() / 2, &extractor, nullptr));
+  CHECK(!extractor.entries().empty());
+  CHECK(extractor.entries().size() < 10U);
+}
+
+// A replay rewound while it was being logged gives the build order of what was watched last
+void TestExtractFromRewoundLog() {
+  std::vector<byte> log;
+  apm::GameLogEncoder encoder;
+  apm::GameLogHeader header = apm::GameLogHeader();
+  header.playerNames[0] = "p1";
+  encoder.Begin(header, [&log](std::vector<byte> block) {
+    log.insert(log.end(), block.begin(), block.end());
+  });
+  for (uint32 tick = 0; tick < 100; tick += 10) {
+    encoder.AddAction(tick, 0, TRAIN_SCV);
+  }
+  for (uint32 tick = 50; tick < 100; tick += 10) {
+    encoder.AddAction(tick, 0, TRAIN_SCV);
+  }
+  encoder.End(100);
+
+  BuildOrderExtractor extractor;
+  CHECK(apm::ExtractBuildOrder(log.data(), log.size(), &extractor, nullptr));
+  CHECK_EQ(10U, extractor.entries().size());
+  for (size_t i = 0; i < extractor.entries().size(); i++) {
+    CHECK_EQ(i * 10, extractor.entries()[i].tick);
+  }
+}
+
+void TestArena() {
+  apm::GameArena arena;
+  BuildOrderExtractor extractor(4, &arena);
+  for (int game = 0; game < 3; game++) {
+    arena.Reset();
+    extractor.Reset();
+    for (uint32 tick = 0; tick < 100; tick++) {
+      extractor.Consume(tick, 0, TRAIN_SCV);
+    }
+    CHECK_EQ(100U, extractor.entries().size());
+    CHECK_EQ(99U, extractor.entries().back().tick);
+  }
+}
+
+}  // namespace
+
+int main() {
+  RUN_TEST(TestKinds);
+  RUN_TEST(TestRepeatedPlacementCountedOnce);
+  RUN_TEST(TestRewind);
+  RUN_TEST(TestFormat);
+  RUN_TEST(TestExtractFromLog);
+  RUN_TEST(TestExtractFromRewoundLog);
+  RUN_TEST(TestArena);
+  return 0;
+}
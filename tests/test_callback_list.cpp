@@ -0,0 +1,118 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "./callback_list.h"
+#include "./test_util.h"
+#include "./types.h"
+
+using sbat::CallbackList;
+
+namespace {
+
+typedef void (*Callback)(uint32 value);
+
+// Bit i is set by callback i, so a call's result shows exactly which callbacks it saw
+std::atomic<uint32> called(0);
+
+template <uint32 Index>
+void SetBit(uint32 value) {
+  called.fetch_or(value << Index, std::memory_order_relaxed);
+}
+
+const Callback CALLBACKS[] = {
+  &SetBit<0>, &SetBit<1>, &SetBit<2>, &SetBit<3>, &SetBit<4>, &SetBit<5>, &SetBit<6>, &SetBit<7>,
+};
+
+uint32 CallAndCollect(const CallbackList<Callback>& list) {
+  called.store(0, std::memory_order_relaxed);
+  list.Call(1);
+  return called.load(std::memory_order_relaxed);
+}
+
+void TestAddAndRemove() {
+  CallbackList<Callback> list;
+  CHECK_EQ(0U, list.size());
+  CHECK_EQ(0U, CallAndCollect(list));
+
+  CHECK(list.Add(CALLBACKS[0]));
+  CHECK(list.Add(CALLBACKS[3]));
+  CHECK(!list.Add(CALLBACKS[0]));
+  CHECK_EQ(2U, list.size());
+  CHECK_EQ(0x9U, CallAndCollect(list));
+
+  CHECK(list.Remove(CALLBACKS[0]));
+  CHECK(!list.Remove(CALLBACKS[0]));
+  CHECK(!list.Remove(CALLBACKS[5]));
+  CHECK_EQ(0x8U, CallAndCollect(list));
+  // The initial list and one per change, failed ones don't publish anything
+  CHECK_EQ(4U, list.numPublished());
+}
+
+std::vector<Callback> order;
+
+void First(uint32) { order.push_back(&First); }
+void Second(uint32) { order.push_back(&Second); }
+void Third(uint32) { order.push_back(&Third); }
+
+void TestCallsInOrder() {
+  CallbackList<Callback> list;
+  list.Add(&First);
+  list.Add(&Second);
+  list.Add(&Third);
+  list.Remove(&Second);
+  list.Add(&Second);
+  list.Call(0);
+  CHECK(order == std::vector<Callback>({ &First, &Third, &Second }));
+}
+
+// Whether mask is the lowest n bits for some n, or its complement within the low 7 bits
+bool IsPrefixOrSuffix(uint32 mask) {
+  const uint32 suffix = ~mask & 0x7F;
+  return (mask & (mask + 1)) == 0 || (suffix & (suffix + 1)) == 0;
+}
+
+// One thread calls through the list the whole time (as the hooked game thread would) while another
+// keeps adding callbacks 0-6 in order and then removing them in the same order. Every call has to
+// see exactly one of the published lists: callback 7 (which stays registered) plus a run of the
+// others that's either a prefix (while adding) or a suffix (while removing).
+void TestChangesWhileCalling() {
+  CallbackList<Callback> list;
+  list.Add(CALLBACKS[7]);
+  std::atomic<bool> done(false);
+  std::atomic<uint32> calls(0);
+  std::atomic<uint32> torn(0);
+  std::thread caller([&]() {
+    while (!done.load(std::memory_order_acquire)) {
+      const uint32 seen = CallAndCollect(list);
+      if ((seen & 0x80) == 0 || !IsPrefixOrSuffix(seen & 0x7F)) {
+        torn++;
+      }
+      calls++;
+    }
+  });
+
+  for (uint32 i = 0; i < 2000; i++) {
+    for (uint32 j = 0; j < 7; j++) {
+      list.Add(CALLBACKS[j]);
+    }
+    std::this_thread::yield();
+    for (uint32 j = 0; j < 7; j++) {
+      list.Remove(CALLBACKS[j]);
+    }
+  }
+  done.store(true, std::memory_order_release);
+  caller.join();
+  CHECK(calls > 0);
+  CHECK_EQ(0U, torn.load());
+  CHECK_EQ(1U, list.size());
+}
+
+}  // namespace
+
+int main() {
+  RUN_TEST(TestAddAndRemove);
+  RUN_TEST(TestCallsInOrder);
+  RUN_TEST(TestChangesWhileCalling);
+  return 0;
+}
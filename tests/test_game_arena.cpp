@@ -0,0 +1,211 @@
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <random>
+
+#include "./actions.h"
+#include "./apm_tracker.h"
+#include "./build_order.h"
+#include "./game_arena.h"
+#include "./heatmap.h"
+#include "./resource_series.h"
+#include "./test_util.h"
+#include "./types.h"
+
+using apm::ArenaAllocator;
+using apm::ArenaVector;
+using apm::GameArena;
+
+namespace {
+
+std::atomic<uint64> heapAllocations(0);
+
+}  // namespace
+
+// Counts every heap allocation in the process, to check what's supposed to stay off the heap
+void* operator new(size_t size) {
+  heapAllocations++;
+  void* result = std::malloc(size != 0 ? size : 1);
+  if (result == nullptr) {
+    throw std::bad_alloc();
+  }
+  return result;
+}
+
+void operator delete(void* pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+  std::free(pointer);
+}
+
+namespace {
+
+bool IsAligned(const void* pointer, size_t alignment) {
+  return reinterpret_cast<uintptr_t>(pointer) % alignment == 0;
+}
+
+void TestAllocate() {
+  GameArena arena;
+  CHECK_EQ(0U, arena.numBlocks());
+  CHECK_EQ(0U, arena.bytesUsed());
+
+  byte* first = static_cast<byte*>(arena.Allocate(3, 1));
+  byte* second = static_cast<byte*>(arena.Allocate(8, 8));
+  byte* third = static_cast<byte*>(arena.Allocate(1, 1));
+  CHECK_EQ(1U, arena.numBlocks());
+  CHECK_EQ(GameArena::BLOCK_SIZE, arena.bytesReserved());
+  CHECK(IsAligned(second, 8));
+  CHECK(second >= first + 3);
+  CHECK(third == second + 8);
+  CHECK_EQ(static_cast<size_t>(third + 1 - first), arena.bytesUsed());
+  // Zero byte allocations still get a usable pointer
+  CHECK(arena.Allocate(0, 4) != nullptr);
+}
+
+void TestBlocks() {
+  GameArena arena;
+  arena.Allocate(GameArena::BLOCK_SIZE - 16, 1);
+  void* spilled = arena.Allocate(64, 16);
+  CHECK_EQ(2U, arena.numBlocks());
+  CHECK(IsAligned(spilled, 16));
+  // The unused end of the first block counts as used
+  CHECK_EQ(GameArena::BLOCK_SIZE + 64, arena.bytesUsed());
+
+  // Bigger than a block gets a block of its own size
+  arena.Allocate(3 * GameArena::BLOCK_SIZE, 8);
+  CHECK_EQ(3U, arena.numBlocks());
+  CHECK_EQ(5 * GameArena::BLOCK_SIZE, arena.bytesReserved());
+  const size_t used = arena.bytesUsed();
+
+  arena.Reset();
+  CHECK_EQ(0U, arena.bytesUsed());
+  CHECK_EQ(used, arena.peakBytesUsed());
+  CHECK_EQ(3U, arena.numBlocks());
+  // A game that fits in what's already reserved doesn't add to it, big allocation included
+  arena.Allocate(GameArena::BLOCK_SIZE / 2, 8);
+  arena.Allocate(3 * GameArena::BLOCK_SIZE, 8);
+  arena.Allocate(GameArena::BLOCK_SIZE / 2, 8);
+  CHECK_EQ(3U, arena.numBlocks());
+  CHECK_EQ(5 * GameArena::BLOCK_SIZE, arena.bytesReserved());
+}
+
+void TestResetReusesMemory() {
+  GameArena arena;
+  void* first = arena.Allocate(100, 8);
+  arena.Allocate(100, 8);
+  arena.Reset();
+  CHECK(arena.Allocate(100, 8) == first);
+}
+
+void TestArenaVector() {
+  GameArena arena;
+  ArenaVector<uint32> values{ArenaAllocator<uint32>(&arena)};
+  for (uint32 i = 0; i < 1000; i++) {
+    values.push_back(i);
+  }
+  CHECK_EQ(999U, values.back());
+  CHECK(arena.bytesUsed() >= 1000 * sizeof(uint32));
+
+  arena.Reset();
+  apm::ResetArenaVector(&values);
+  CHECK(values.empty());
+  CHECK(values.capacity() == 0);
+  values.push_back(7);
+  CHECK(values.get_allocator().arena() == &arena);
+
+  // Without an arena it's an ordinary vector
+  const uint64 before = heapAllocations;
+  ArenaVector<uint32> heapValues;
+  heapValues.push_back(1);
+  CHECK(heapAllocations > before);
+  CHECK(ArenaAllocator<uint32>() != ArenaAllocator<uint32>(&arena));
+  CHECK(ArenaAllocator<byte>(&arena) == ArenaAllocator<uint32>(&arena));
+}
+
+// Runs a game through the arena-backed per-game state the way GameMonitor does
+void PlayGame(std::mt19937* rng, GameArena* monitorArena, GameArena* gameArena,
+    apm::ApmTracker* tracker, apm::ResourceSeries* resources, apm::BuildOrderExtractor* buildOrder,
+    apm::ActionHeatmap* heatmap, bool replay, uint32 minutes) {
+  namespace action = apm::action;
+  byte rightClick[10] = { action::RIGHT_CLICK };
+  const byte train[3] = { action::TRAIN, 0x25, 0 };
+  const byte build[8] = { action::BUILD, 0x1E, 0, 0, 0, 0, 0x6F, 0 };
+  const uint32 players = 8;
+  monitorArena->Reset();
+  gameArena->Reset();
+  tracker->Reset(replay);
+  resources->Reset();
+  buildOrder->Reset();
+  heatmap->Reset((1u << players) - 1);
+
+  std::array<uint32, 12> actions = std::array<uint32, 12>();
+  apm::ResourceSample sample = apm::ResourceSample();
+  const uint32 endTick = minutes * 60 * 1000 / 42;
+  for (uint32 tick = 0; tick < endTick; tick++) {
+    for (uint8 player = 0; player < players; player++) {
+      if ((*rng)() % 8 != 0) {
+        continue;
+      }
+      actions[player]++;
+      const uint32 kind = (*rng)() % 16;
+      const byte* data = kind == 0 ? train : kind == 1 ? build : rightClick;
+      rightClick[1] = static_cast<byte>((*rng)());
+      rightClick[2] = static_cast<byte>((*rng)() % 32);
+      buildOrder->Consume(tick, player, data);
+      heatmap->Consume(tick, player, data);
+    }
+    if (tick % 12 == 11) {
+      tracker->Advance(tick * 42, actions);
+      actions.fill(0);
+    }
+    if (tick % 24 == 0) {
+      for (uint8 player = 0; player < players; player++) {
+        sample.at(apm::Resource::Minerals, player) += static_cast<int32>((*rng)() % 16) - 4;
+      }
+      resources->Record(tick, sample);
+    }
+    if (replay && tick % 20000 == 19999) {
+      tracker->Seek(tick * 42 / 2);
+      resources->Rewind(tick / 2);
+    }
+  }
+}
+
+void TestGamesStayOffTheHeap() {
+  std::mt19937 rng(7);
+  GameArena monitorArena;
+  GameArena gameArena;
+  apm::ApmTracker tracker(&monitorArena);
+  // Expecting fewer samples than the longest game has, so the columns grow within the arena too
+  apm::ResourceSeries resources(24, 1000, &monitorArena);
+  apm::BuildOrderExtractor buildOrder(apm::BuildOrderExtractor::DEFAULT_EXPECTED_ENTRIES,
+      &gameArena);
+  apm::ActionHeatmap heatmap(&gameArena);
+  // Warm up on the longest game, after which the arenas have all the blocks they'll need
+  PlayGame(&rng, &monitorArena, &gameArena, &tracker, &resources, &buildOrder, &heatmap, true,
+      30);
+  const size_t reserved = monitorArena.bytesReserved() + gameArena.bytesReserved();
+
+  const uint64 before = heapAllocations;
+  for (uint32 game = 0; game < 6; game++) {
+    PlayGame(&rng, &monitorArena, &gameArena, &tracker, &resources, &buildOrder, &heatmap,
+        game % 2 == 0, 5 + game * 4);
+  }
+  CHECK_EQ(before, heapAllocations.load());
+  CHECK_EQ(reserved, monitorArena.bytesReserved() + gameArena.bytesReserved());
+}
+
+}  // namespace
+
+int main() {
+  RUN_TEST(TestAllocate);
+  RUN_TEST(TestBlocks);
+  RUN_TEST(TestResetReusesMemory);
+  RUN_TEST(TestArenaVector);
+  RUN_TEST(TestGamesStayOffTheHeap);
+  return 0;
+}
@@ -0,0 +1,304 @@
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "./actions.h"
+#include "./game_log.h"
+#include "./test_util.h"
+#include "./types.h"
+
+using apm::GameLogDecoder;
+using apm::GameLogEncoder;
+using apm::GameLogEvent;
+using apm::GameLogHeader;
+using apm::GameLogSample;
+using std::string;
+using std::vector;
+
+namespace {
+
+typedef GameLogDecoder::Result Result;
+
+const byte HOTKEY[] = { apm::action::HOTKEY, 0, 2 };
+
+GameLogHeader MakeHeader() {
+  GameLogHeader header = GameLogHeader();
+  header.startTime = 1234567890123ULL;
+  header.myPlayerId = 3;
+  header.flags = apm::GAME_LOG_FLAG_REPLAY;
+  header.playerNames[0] = "a";
+  header.playerNames[3] = "bob";
+  return header;
+}
+
+// Logs hotkey actions from players 0 and 3 every 3 ticks, and a sample every 24
+vector<byte> EncodeGame(uint32 endTick, size_t* numBlocks) {
+  vector<byte> log;
+  *numBlocks = 0;
+  GameLogEncoder encoder;
+  encoder.Begin(MakeHeader(), [&log, numBlocks](vector<byte> block) {
+    log.insert(log.end(), block.begin(), block.end());
+    (*numBlocks)++;
+  });
+  CHECK(encoder.isActive());
+  GameLogSample sample = GameLogSample();
+  for (uint32 tick = 0; tick < endTick; tick += 3) {
+    encoder.AddAction(tick, (tick / 3) % 2 ? 0 : 3, HOTKEY);
+    if (tick % 24 == 0) {
+      sample.minerals[0] = static_cast<int32>(tick * 7) - 100000;
+      sample.population[3] = tick;
+      encoder.AddSample(tick, sample);
+    }
+  }
+  encoder.End(endTick);
+  CHECK(!encoder.isActive());
+  return log;
+}
+
+void TestRoundTrip() {
+  size_t numBlocks;
+  const vector<byte> log = EncodeGame(50000, &numBlocks);
+
+  GameLogDecoder decoder(log.data(), log.size());
+  GameLogHeader header;
+  CHECK(decoder.ReadHeader(&header) == Result::Ok);
+  CHECK_EQ(1234567890123ULL, header.startTime);
+  CHECK_EQ(3, header.myPlayerId);
+  CHECK_EQ(apm::GAME_LOG_FLAG_REPLAY, header.flags);
+  CHECK_EQ(string("bob"), header.playerNames[3]);
+  CHECK(header.playerNames[1].empty());
+  CHECK_EQ((1U << 0) | (1U << 3), decoder.activePlayers());
+
+  GameLogEvent event;
+  Result result;
+  uint32 actions = 0;
+  uint32 samples = 0;
+  uint32 lastTick = 0;
+  while ((result = decoder.Next(&event)) == Result::Ok) {
+    CHECK(event.tick >= lastTick);
+    lastTick = event.tick;
+    if (event.type == GameLogEvent::Type::Action) {
+      CHECK_EQ((event.tick / 3) % 2 ? 0 : 3, event.player);
+      CHECK_EQ(3U, event.actionLength);
+      CHECK_EQ(2, event.actionData[2]);
+      actions++;
+    } else if (event.type == GameLogEvent::Type::Sample) {
+      CHECK_EQ(static_cast<int32>(event.tick * 7) - 100000, event.sample.minerals[0]);
+      CHECK_EQ(event.tick, event.sample.population[3]);
+      samples++;
+    }
+  }
+  CHECK(result == Result::Done);
+  CHECK_EQ(16667U, actions);
+  CHECK_EQ(2084U, samples);
+  CHECK_EQ(50000U, lastTick);
+}
+
+void TestSpansBlocks() {
+  size_t numBlocks;
+  const vector<byte> log = EncodeGame(1000000, &numBlocks);
+  CHECK(numBlocks > 2U);
+  GameLogDecoder decoder(log.data(), log.size());
+  GameLogHeader header;
+  CHECK(decoder.ReadHeader(&header) == Result::Ok);
+  GameLogEvent event;
+  Result result;
+  uint32 actions = 0;
+  while ((result = decoder.Next(&event)) == Result::Ok) {
+    if (event.type == GameLogEvent::Type::Action) {
+      actions++;
+    }
+  }
+  CHECK(result == Result::Done);
+  CHECK_EQ(333334U, actions);
+}
+
+void TestDropsAndTruncatesActions() {
+  vector<byte> log;
+  GameLogEncoder encoder;
+  encoder.Begin(MakeHeader(), [&log](vector<byte> block) {
+    log.insert(log.end(), block.begin(), block.end());
+  });
+  // Player 1 wasn't in the game at the start
+  encoder.AddAction(1, 1, HOTKEY);
+  // An action of unknown length is logged as just its type
+  const byte unknown[] = { 0xFE, 1, 2, 3 };
+  encoder.AddAction(2, 0, unknown);
+  encoder.End(3);
+
+  GameLogDecoder decoder(log.data(), log.size());
+  GameLogHeader header;
+  CHECK(decoder.ReadHeader(&header) == Result::Ok);
+  GameLogEvent event;
+  CHECK(decoder.Next(&event) == Result::Ok);
+  CHECK(event.type == GameLogEvent::Type::Action);
+  CHECK_EQ(2U, event.tick);
+  CHECK_EQ(1U, event.actionLength);
+  CHECK_EQ(0xFE, event.actionData[0]);
+  CHECK(decoder.Next(&event) == Result::Ok);
+  CHECK(event.type == GameLogEvent::Type::End);
+  CHECK_EQ(3U, event.tick);
+  CHECK(decoder.Next(&event) == Result::Done);
+}
+
+void TestCorruptLogs() {
+  size_t numBlocks;
+  vector<byte> log = EncodeGame(5000, &numBlocks);
+  GameLogHeader header;
+  GameLogEvent event;
+
+  // Cut off before the end record, as if the game had crashed
+  GameLogDecoder cut(log.data(), log.size() - 1);
+  CHECK(cut.ReadHeader(&header) == Result::Ok);
+  Result result;
+  while ((result = cut.Next(&event)) == Result::Ok) {
+  }
+  CHECK(result == Result::Error);
+
+  GameLogDecoder empty(log.data(), 0);
+  CHECK(empty.ReadHeader(&header) == Result::Error);
+
+  log[0] ^= 0xFF;
+  GameLogDecoder badMagic(log.data(), log.size());
+  CHECK(badMagic.ReadHeader(&header) == Result::Error);
+}
+
+// Ticks of the actions read from log, with the ones superseded by seeks dropped
+vector<uint32> ReadActionTicks(const vector<byte>& log) {
+  GameLogDecoder decoder(log.data(), log.size());
+  GameLogHeader header;
+  CHECK(decoder.ReadHeader(&header) == Result::Ok);
+  vector<uint32> ticks;
+  GameLogEvent event;
+  Result result;
+  while ((result = decoder.Next(&event)) == Result::Ok) {
+    if (event.type == GameLogEvent::Type::Action) {
+      ticks.push_back(event.tick);
+    } else if (event.type == GameLogEvent::Type::Seek) {
+      while (!ticks.empty() && ticks.back() >= event.tick) {
+        ticks.pop_back();
+      }
+    }
+  }
+  CHECK(result == Result::Done);
+  return ticks;
+}
+
+// A replay rewound from tick 300 to 150 logs a seek, and what's after it replaces the actions from
+// 150 on rather than being appended to them
+void TestSeek() {
+  vector<byte> log;
+  GameLogEncoder encoder;
+  encoder.Begin(MakeHeader(), [&log](vector<byte> block) {
+    log.insert(log.end(), block.begin(), block.end());
+  });
+  for (uint32 tick = 0; tick <= 300; tick += 3) {
+    encoder.AddAction(tick, 0, HOTKEY);
+  }
+  for (uint32 tick = 150; tick < 400; tick += 3) {
+    encoder.AddAction(tick, 3, HOTKEY);
+  }
+  encoder.End(400);
+
+  GameLogDecoder decoder(log.data(), log.size());
+  GameLogHeader header;
+  CHECK(decoder.ReadHeader(&header) == Result::Ok);
+  GameLogEvent event;
+  for (uint32 tick = 0; tick <= 300; tick += 3) {
+    CHECK(decoder.Next(&event) == Result::Ok);
+    CHECK_EQ(tick, event.tick);
+  }
+  CHECK(decoder.Next(&event) == Result::Ok);
+  CHECK(event.type == GameLogEvent::Type::Seek);
+  CHECK_EQ(150U, event.tick);
+  CHECK(decoder.Next(&event) == Result::Ok);
+  CHECK(event.type == GameLogEvent::Type::Action);
+  CHECK_EQ(150U, event.tick);
+  CHECK_EQ(3, event.player);
+
+  const vector<uint32> ticks = ReadActionTicks(log);
+  CHECK_EQ(50U + 84U, ticks.size());
+  for (size_t i = 0; i < ticks.size(); i++) {
+    CHECK_EQ(i * 3, ticks[i]);
+  }
+
+  // Seeks only go back, one forwards is corrupt
+  vector<byte> forwards(log.begin(), log.end() - 1);
+  const byte seekForwards[] = { 13, 0xC8, 0x03, 0x0F };  // seek to 456
+  forwards.insert(forwards.end(), std::begin(seekForwards), std::end(seekForwards));
+  GameLogDecoder corrupt(forwards.data(), forwards.size());
+  CHECK(corrupt.ReadHeader(&header) == Result::Ok);
+  Result result;
+  while ((result = corrupt.Next(&event)) == Result::Ok) {
+  }
+  CHECK(result == Result::Error);
+}
+
+// 20 minutes at the fastest speed, both players at ~200 APM with a realistic mix of actions, and
+// samples every 24 ticks like GameMonitor takes them
+void TestTypical1v1Size() {
+  const uint32 TICKS = 20 * 60 * 1000 / 42;
+  std::mt19937 rng(20);
+  vector<byte> log;
+  GameLogEncoder encoder;
+  GameLogHeader header = GameLogHeader();
+  header.startTime = 1700000000;
+  header.playerNames[0] = "player one";
+  header.playerNames[1] = "player two";
+  encoder.Begin(header, [&log](vector<byte> block) {
+    log.insert(log.end(), block.begin(), block.end());
+  });
+  GameLogSample sample = GameLogSample();
+  uint32 actions = 0;
+  for (uint32 tick = 0; tick < TICKS; tick++) {
+    for (uint8 player = 0; player < 2; player++) {
+      if (rng() % 1000 >= 140) {
+        continue;
+      }
+      byte data[16];
+      for (byte& b : data) {
+        b = static_cast<byte>(rng());
+      }
+      const uint32 kind = rng() % 10;
+      if (kind < 3) {
+        data[0] = apm::action::SELECT;
+        data[1] = static_cast<byte>(1 + rng() % 6);
+      } else if (kind < 5) {
+        data[0] = apm::action::HOTKEY;
+      } else if (kind < 8) {
+        data[0] = apm::action::RIGHT_CLICK;
+      } else if (kind == 8) {
+        data[0] = apm::action::TRAIN;
+      } else {
+        data[0] = apm::action::BUILD;
+      }
+      encoder.AddAction(tick, player, data);
+      actions++;
+    }
+    if (tick % 24 == 0) {
+      for (size_t i = 0; i < 2; i++) {
+        sample.minerals[i] = static_cast<int32>(rng() % 1500);
+        sample.vespene[i] = static_cast<int32>(rng() % 800);
+        sample.population[i] = std::min(tick / 150, 200U) * 2;
+      }
+      encoder.AddSample(tick, sample);
+    }
+  }
+  encoder.End(TICKS);
+  std::printf("  %u actions, %zu bytes\n", actions, log.size());
+  CHECK(log.size() < 100 * 1024);
+}
+
+}  // namespace
+
+int main() {
+  RUN_TEST(TestRoundTrip);
+  RUN_TEST(TestSpansBlocks);
+  RUN_TEST(TestDropsAndTruncatesActions);
+  RUN_TEST(TestCorruptLogs);
+  RUN_TEST(TestSeek);
+  RUN_TEST(TestTypical1v1Size);
+  return 0;
+}
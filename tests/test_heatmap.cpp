@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "./actions.h"
+#include "./game_arena.h"
+#include "./heatmap.h"
+#include "./test_util.h"
+#include "./types.h"
+
+using apm::ActionHeatmap;
+
+namespace {
+
+const uint32 GRID_SIZE = ActionHeatmap::GRID_SIZE;
+const uint32 DECAY_TICKS = ActionHeatmap::DECAY_TICKS;
+const uint16 HEAT = ActionHeatmap::HEAT_PER_ACTION;
+
+std::vector<uint16> Export(const ActionHeatmap& heatmap, uint8 player, uint32 tick,
+    uint32 factor = 1) {
+  std::vector<uint16> result((GRID_SIZE / factor) * (GRID_SIZE / factor), 0xBEEF);
+  heatmap.Export(player, tick, factor, result.data());
+  return result;
+}
+
+uint16 At(const std::vector<uint16>& grid, uint32 x, uint32 y, uint32 factor = 1) {
+  return grid[y * (GRID_SIZE / factor) + x];
+}
+
+// A flat grid that decays every cell eagerly, to check the tiled one against
+class ReferenceHeatmap {
+public:
+  ReferenceHeatmap()
+    : cells_(GRID_SIZE * GRID_SIZE),
+      epoch_(0) {
+  }
+
+  void Add(uint32 tick, uint32 x, uint32 y) {
+    DecayTo(tick / DECAY_TICKS);
+    uint16& cell = cells_[y * GRID_SIZE + x];
+    cell = static_cast<uint16>(std::min<uint32>(cell + HEAT, 0xFFFF));
+  }
+
+  std::vector<uint16> Export(uint32 tick, uint32 factor) const {
+    const uint32 decay = tick / DECAY_TICKS - epoch_;
+    const uint32 size = GRID_SIZE / factor;
+    uint32 shift = 0;
+    while ((1u << shift) < factor * factor) {
+      shift++;
+    }
+    std::vector<uint32> sums(size * size);
+    for (uint32 y = 0; y < GRID_SIZE; y++) {
+      for (uint32 x = 0; x < GRID_SIZE; x++) {
+        const uint16 cell = cells_[y * GRID_SIZE + x];
+        sums[(y / factor) * size + x / factor] += decay >= 16 ? 0 : cell >> decay;
+      }
+    }
+    std::vector<uint16> result(size * size);
+    for (size_t i = 0; i < sums.size(); i++) {
+      result[i] = static_cast<uint16>(sums[i] >> shift);
+    }
+    return result;
+  }
+
+private:
+  void DecayTo(uint32 epoch) {
+    if (epoch > epoch_) {
+      const uint32 shift = epoch - epoch_;
+      for (uint16& cell : cells_) {
+        cell = shift >= 16 ? 0 : static_cast<uint16>(cell >> shift);
+      }
+      epoch_ = epoch;
+    }
+  }
+
+  std::vector<uint16> cells_;
+  uint32 epoch_;
+};
+
+void TestAddAndExport() {
+  ActionHeatmap heatmap;
+  heatmap.Reset(0x5);
+  CHECK(heatmap.hasGrid(0));
+  CHECK(!heatmap.hasGrid(1));
+  CHECK(heatmap.hasGrid(2));
+  CHECK(!heatmap.hasGrid(12));
+
+  heatmap.Add(0, 0, 10, 20);
+  heatmap.Add(1, 0, 10, 20);
+  heatmap.Add(2, 2, 255, 255);
+  // Players without a grid and positions off the grid are ignored
+  heatmap.Add(3, 1, 10, 20);
+  heatmap.Add(4, 0, GRID_SIZE, 0);
+
+  const std::vector<uint16> grid = Export(heatmap, 0, 10);
+  CHECK_EQ(2 * HEAT, At(grid, 10, 20));
+  CHECK_EQ(0, At(grid, 11, 20));
+  CHECK_EQ(0, At(grid, 255, 255));
+  CHECK_EQ(HEAT, At(Export(heatmap, 2, 10), 255, 255));
+  const std::vector<uint16> empty = Export(heatmap, 1, 10);
+  CHECK(std::count(empty.begin(), empty.end(), 0) == static_cast<long>(empty.size()));
+}
+
+void TestDecay() {
+  ActionHeatmap heatmap;
+  heatmap.Reset(0x1);
+  heatmap.Add(0, 0, 5, 5);
+  CHECK_EQ(HEAT, At(Export(heatmap, 0, DECAY_TICKS - 1), 5, 5));
+  CHECK_EQ(HEAT / 2, At(Export(heatmap, 0, DECAY_TICKS), 5, 5));
+  CHECK_EQ(HEAT / 8, At(Export(heatmap, 0, 3 * DECAY_TICKS), 5, 5));
+  CHECK_EQ(0, At(Export(heatmap, 0, 100 * DECAY_TICKS), 5, 5));
+
+  // Adding to the tile later decays what was already in it first
+  heatmap.Add(2 * DECAY_TICKS, 0, 6, 5);
+  const std::vector<uint16> grid = Export(heatmap, 0, 2 * DECAY_TICKS);
+  CHECK_EQ(HEAT / 4, At(grid, 5, 5));
+  CHECK_EQ(HEAT, At(grid, 6, 5));
+
+  // Going back in time (a replay being rewound) leaves the heat as it was
+  heatmap.Add(0, 0, 5, 5);
+  CHECK_EQ(HEAT / 4 + HEAT, At(Export(heatmap, 0, 2 * DECAY_TICKS), 5, 5));
+}
+
+void TestSaturates() {
+  ActionHeatmap heatmap;
+  heatmap.Reset(0x1);
+  for (int i = 0; i < 1000; i++) {
+    heatmap.Add(0, 0, 1, 1);
+  }
+  CHECK_EQ(0xFFFF, At(Export(heatmap, 0, 0), 1, 1));
+}
+
+void TestConsume() {
+  ActionHeatmap heatmap;
+  heatmap.Reset(0x1);
+  // Positions are in pixels, 32 to a map tile
+  const byte rightClick[] = { apm::action::RIGHT_CLICK, 0x40, 0x01, 0x60, 0x00 };
+  const byte targeted[] = { apm::action::TARGETED_ORDER, 0x1F, 0x00, 0x20, 0x00 };
+  const byte other[] = { apm::action::SYNC, 0x40, 0x01, 0x60, 0x00 };
+  heatmap.Consume(0, 0, rightClick);
+  heatmap.Consume(0, 0, targeted);
+  heatmap.Consume(0, 0, other);
+  const std::vector<uint16> grid = Export(heatmap, 0, 0);
+  CHECK_EQ(HEAT, At(grid, 10, 3));
+  CHECK_EQ(HEAT, At(grid, 0, 1));
+  CHECK_EQ(2, std::count(grid.begin(), grid.end(), HEAT));
+}
+
+void TestDownsample() {
+  ActionHeatmap heatmap;
+  heatmap.Reset(0x1);
+  heatmap.Add(0, 0, 0, 0);
+  heatmap.Add(0, 0, 1, 1);
+  heatmap.Add(0, 0, 7, 7);
+  heatmap.Add(0, 0, 8, 0);
+  // Each output value is the average of a factor x factor block
+  const std::vector<uint16> half = Export(heatmap, 0, 0, 2);
+  CHECK_EQ(2 * HEAT / 4, At(half, 0, 0, 2));
+  CHECK_EQ(HEAT / 4, At(half, 3, 3, 2));
+  CHECK_EQ(HEAT / 4, At(half, 4, 0, 2));
+  const std::vector<uint16> eighth = Export(heatmap, 0, 0, 8);
+  CHECK_EQ(3 * HEAT / 64, At(eighth, 0, 0, 8));
+  CHECK_EQ(HEAT / 64, At(eighth, 1, 0, 8));
+}
+
+void TestMatchesReference() {
+  std::mt19937 rng(1);
+  std::normal_distribution<double> position(128, 40);
+  ActionHeatmap heatmap;
+  heatmap.Reset(0x1);
+  ReferenceHeatmap reference;
+  uint32 tick = 0;
+  for (int i = 0; i < 50000; i++) {
+    tick += rng() % 3;
+    const uint32 x = std::min<uint32>(GRID_SIZE - 1, static_cast<uint32>(std::abs(position(rng))));
+    const uint32 y = std::min<uint32>(GRID_SIZE - 1, static_cast<uint32>(std::abs(position(rng))));
+    heatmap.Add(tick, 0, x, y);
+    reference.Add(tick, x, y);
+  }
+  for (uint32 factor : { 1u, 2u, 4u, 8u }) {
+    for (uint32 later : { 0u, DECAY_TICKS, 5 * DECAY_TICKS }) {
+      CHECK(Export(heatmap, 0, tick + later, factor) == reference.Export(tick + later, factor));
+    }
+  }
+}
+
+void TestClearAndReset() {
+  apm::GameArena arena;
+  ActionHeatmap heatmap(&arena);
+  heatmap.Reset(0x3);
+  heatmap.Add(5 * DECAY_TICKS, 0, 3, 3);
+  heatmap.Add(5 * DECAY_TICKS, 1, 3, 3);
+  heatmap.Clear();
+  CHECK(heatmap.hasGrid(1));
+  CHECK_EQ(0, At(Export(heatmap, 0, 0), 3, 3));
+  // Clearing resets the decay too, so heat added early on counts fully again
+  heatmap.Add(0, 1, 3, 3);
+  CHECK_EQ(HEAT, At(Export(heatmap, 1, 0), 3, 3));
+
+  arena.Reset();
+  heatmap.Reset(0x4);
+  CHECK(!heatmap.hasGrid(0));
+  CHECK(heatmap.hasGrid(2));
+  CHECK_EQ(0, At(Export(heatmap, 2, 0), 3, 3));
+}
+
+void TestFormatHeatmap() {
+  const uint16 grid[] = {
+    0, 10, 0, 0,
+    0, 100, 0, 0,
+    1, 0, 0, 0,
+    0, 0, 0, 0,
+  };
+  CHECK(apm::FormatHeatmap(grid, 4) == " .\n @\n. \n");
+  const uint16 empty[4] = {};
+  CHECK(apm::FormatHeatmap(empty, 2).empty());
+}
+
+}  // namespace
+
+int main() {
+  RUN_TEST(TestAddAndExport);
+  RUN_TEST(TestDecay);
+  RUN_TEST(TestSaturates);
+  RUN_TEST(TestConsume);
+  RUN_TEST(TestDownsample);
+  RUN_TEST(TestMatchesReference);
+  RUN_TEST(TestClearAndReset);
+  RUN_TEST(TestFormatHeatmap);
+  return 0;
+}
@@ -0,0 +1,185 @@
+#if defined(__linux__) && (defined(__x86_64__) || defined(__i386__))
+#define HOT_PATCH_STRESS_TEST
+#include <sys/mman.h>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <thread>
+
+#include "./hot_patch_caves.h"
+#include "./test_util.h"
+#include "./types.h"
+
+using sbat::CanHotPatch;
+using sbat::ExchangeHotPatch;
+using sbat::HotPatchCaves;
+
+namespace {
+
+// A fake code section: nops, with int3 padding wherever a test puts some
+struct alignas(16) Code {
+  byte bytes[512];
+
+  Code() {
+    std::fill(bytes, bytes + sizeof(bytes), 0x90);
+  }
+
+  void Pad(size_t start, size_t end) {
+    std::fill(bytes + start, bytes + end, 0xCC);
+  }
+};
+
+const size_t HOOK = 0x100;
+
+void TestClaimsPaddingBeforeAlignedFunction() {
+  Code code;
+  code.Pad(0xB0, 0xC0);
+  HotPatchCaves caves;
+  // 16 bytes of padding hold 3 caves, each handed out once
+  CHECK_EQ(code.bytes + 0xB0, caves.Claim(code.bytes + HOOK, 2));
+  CHECK_EQ(code.bytes + 0xB5, caves.Claim(code.bytes + HOOK, 2));
+  CHECK_EQ(code.bytes + 0xBA, caves.Claim(code.bytes + HOOK, 2));
+  CHECK(caves.Claim(code.bytes + HOOK, 2) == nullptr);
+  CHECK_EQ(3U, caves.size());
+}
+
+void TestSharedBetweenNearbyHooks() {
+  Code code;
+  code.Pad(0xF0, 0x100);
+  HotPatchCaves caves;
+  // Two hooks in reach of the same padding get separate, non-overlapping caves
+  CHECK_EQ(code.bytes + 0xF0, caves.Claim(code.bytes + HOOK, 2));
+  CHECK_EQ(code.bytes + 0xF5, caves.Claim(code.bytes + HOOK + 0x10, 2));
+  // and once it's used up, neither gets any more
+  CHECK_EQ(code.bytes + 0xFA, caves.Claim(code.bytes + HOOK + 0x10, 2));
+  CHECK(caves.Claim(code.bytes + HOOK, 2) == nullptr);
+}
+
+void TestIgnoresInt3InsideInstructions() {
+  Code code;
+  // e.g. mov eax, 0xCCCCCCCC followed by more code, which doesn't reach an alignment boundary
+  code.Pad(0x121, 0x126);
+  HotPatchCaves caves;
+  CHECK(caves.Claim(code.bytes + HOOK, 2) == nullptr);
+}
+
+void TestIgnoresPaddingOutOfReach() {
+  Code code;
+  // A short jump at HOOK reaches HOOK + 2 - 128 to HOOK + 2 + 127
+  code.Pad(0x70, 0x80);
+  code.Pad(0x190, 0x1A0);
+  HotPatchCaves caves;
+  CHECK(caves.Claim(code.bytes + HOOK, 2) == nullptr);
+}
+
+void TestNeverOverlapsHookedInstruction() {
+  Code code;
+  // The hooked instruction itself is 0xCC bytes up to a boundary
+  code.Pad(HOOK, HOOK + 0x10);
+  HotPatchCaves caves;
+  byte* cave = caves.Claim(code.bytes + HOOK, 6);
+  CHECK(cave != nullptr);
+  CHECK(cave >= code.bytes + HOOK + 6);
+}
+
+void TestCanHotPatch() {
+  alignas(64) byte line[128] = {};
+  CHECK(CanHotPatch(line + 62, 2));
+  // the 2 bytes would straddle a cache line, so the write can't be atomic
+  CHECK(!CanHotPatch(line + 63, 2));
+  CHECK(!CanHotPatch(line + 64, 1));
+}
+
+#ifdef HOT_PATCH_STRESS_TEST
+// Hooks a real function the way Detour does, on a page of executable code: a 2 byte instruction
+// at the start is swapped for a short jump into int3 padding, which holds a long jump to the hook.
+// One thread keeps calling the function while the main thread keeps injecting and restoring, so
+// the exchange happens while the first instruction is being fetched and executed. Every call has
+// to land in either the original (returns 1) or the hook (returns 2).
+void TestExchangeWhileExecuting() {
+  const size_t PAGE_SIZE = 4096;
+  void* page = mmap(nullptr, PAGE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  CHECK(page != MAP_FAILED);
+  byte* code = static_cast<byte*>(page);
+  std::fill(code, code + PAGE_SIZE, 0x90);
+  std::fill(code + 0x130, code + 0x140, 0xCC);
+  const byte original[] = {
+    0x66, 0x90,  // xchg ax, ax
+    0xB8, 0x01, 0x00, 0x00, 0x00,  // mov eax, 1
+    0xC3,  // ret
+  };
+  const byte hook[] = {
+    0xB8, 0x02, 0x00, 0x00, 0x00,  // mov eax, 2
+    0xC3,  // ret
+  };
+  // Claim reads 128 bytes either side of the hook, so keep those on the page
+  byte* location = code + 0x140;
+  memcpy(location, original, sizeof(original));
+  memcpy(code + 0x180, hook, sizeof(hook));
+
+  HotPatchCaves caves;
+  CHECK(CanHotPatch(location, 2));
+  byte* cave = caves.Claim(location, 2);
+  CHECK_EQ(code + 0x130, cave);
+  cave[0] = 0xE9;  // relative jump
+  const int32 offset = static_cast<int32>((code + 0x180) - (cave + 5));
+  memcpy(cave + 1, &offset, sizeof(offset));
+  const byte shortJump[] = { 0xEB, static_cast<byte>(cave - (location + 2)) };
+
+  typedef int (*Function)();
+  Function function = reinterpret_cast<Function>(location);
+  std::atomic<bool> done(false);
+  std::atomic<uint32> calls[3] = {};
+  std::atomic<uint32> bad(0);
+  std::thread caller([&]() {
+    while (!done.load(std::memory_order_acquire)) {
+      const int result = function();
+      if (result == 1 || result == 2) {
+        calls[result]++;
+      } else {
+        bad++;
+      }
+    }
+  });
+
+  const uint32 MIN_FLIPS = 200000;
+  uint32 flips = 0;
+  // keep going until the caller has run both ways a fair amount, but give up eventually
+  while (flips < MIN_FLIPS * 50 &&
+      (flips < MIN_FLIPS || calls[1].load() < 1000 || calls[2].load() < 1000)) {
+    ExchangeHotPatch(location, (flips % 2 == 0) ? shortJump : original);
+    flips++;
+    // an odd interval, so the caller gets to run with the hook both in and out on a single core
+    if (flips % 999 == 0) {
+      std::this_thread::yield();
+    }
+  }
+  done.store(true, std::memory_order_release);
+  caller.join();
+  ExchangeHotPatch(location, original);
+
+  CHECK_EQ(0U, bad.load());
+  CHECK(calls[1].load() > 0);
+  CHECK(calls[2].load() > 0);
+  CHECK_EQ(1, function());
+  munmap(page, PAGE_SIZE);
+}
+#endif
+
+}  // namespace
+
+int main() {
+  RUN_TEST(TestClaimsPaddingBeforeAlignedFunction);
+  RUN_TEST(TestSharedBetweenNearbyHooks);
+  RUN_TEST(TestIgnoresInt3InsideInstructions);
+  RUN_TEST(TestIgnoresPaddingOutOfReach);
+  RUN_TEST(TestNeverOverlapsHookedInstruction);
+  RUN_TEST(TestCanHotPatch);
+#ifdef HOT_PATCH_STRESS_TEST
+  RUN_TEST(TestExchangeWhileExecuting);
+#endif
+  return 0;
+}
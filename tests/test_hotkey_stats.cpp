@@ -0,0 +1,150 @@
+#include <string>
+#include <vector>
+
+#include "./actions.h"
+#include "./game_log.h"
+#include "./hotkey_stats.h"
+#include "./test_util.h"
+#include "./types.h"
+
+using apm::HotkeyAnalyzer;
+using apm::HotkeyStatsByPlayer;
+using apm::PlayerHotkeyStats;
+using std::string;
+using std::vector;
+
+namespace {
+
+namespace action = apm::action;
+
+const byte RECALL_3[] = { action::HOTKEY, action::HOTKEY_SELECT, 3 };
+const byte ASSIGN_3[] = { action::HOTKEY, action::HOTKEY_ASSIGN, 3 };
+const byte ADD_3[] = { action::HOTKEY, action::HOTKEY_ADD, 3 };
+
+void TestSelections() {
+  HotkeyAnalyzer analyzer;
+  const byte select2[] = { action::SELECT, 2, 0, 0, 0, 0 };
+  const byte select40[] = { action::SELECT, 40 };
+  const byte shiftSelect[] = { action::SHIFT_SELECT, 1, 0, 0 };
+  const byte shiftDeselect[] = { action::SHIFT_DESELECT, 1, 0, 0 };
+  analyzer.Consume(0, 1, select2);
+  // More than BW allows, counted as a full selection
+  analyzer.Consume(1, 1, select40);
+  analyzer.Consume(2, 1, shiftSelect);
+  analyzer.Consume(3, 1, shiftDeselect);
+  // Not a player slot
+  analyzer.Consume(4, 12, select2);
+
+  const PlayerHotkeyStats& stats = analyzer.stats(1);
+  CHECK_EQ(2U, stats.selects);
+  CHECK_EQ(14U, stats.selectedUnits);
+  CHECK_EQ(1U, stats.selectionSizes[2]);
+  CHECK_EQ(1U, stats.selectionSizes[12]);
+  CHECK_EQ(1U, stats.shiftSelects);
+  CHECK_EQ(1U, stats.shiftDeselects);
+  CHECK_EQ(0U, analyzer.stats(0).selects);
+}
+
+void TestHotkeys() {
+  HotkeyAnalyzer analyzer;
+  const byte badGroup[] = { action::HOTKEY, action::HOTKEY_SELECT, 10 };
+  analyzer.Consume(0, 0, ASSIGN_3);
+  analyzer.Consume(1, 0, ADD_3);
+  analyzer.Consume(10, 0, RECALL_3);
+  analyzer.Consume(11, 0, RECALL_3);
+  analyzer.Consume(111, 0, RECALL_3);
+  analyzer.Consume(112, 0, badGroup);
+
+  const PlayerHotkeyStats& stats = analyzer.stats(0);
+  CHECK_EQ(1U, stats.assigns[3]);
+  CHECK_EQ(1U, stats.adds[3]);
+  CHECK_EQ(3U, stats.recalls[3]);
+  CHECK_EQ(3U, stats.totalRecalls());
+  // Intervals of 1 and 100 ticks, the first recall has nothing to measure from
+  CHECK_EQ(1U, stats.recallIntervals[3][0]);
+  CHECK_EQ(1U, stats.recallIntervals[3][6]);
+  uint32 intervals = 0;
+  for (uint32 count : stats.recallIntervals[3]) {
+    intervals += count;
+  }
+  CHECK_EQ(2U, intervals);
+
+  analyzer.Reset();
+  CHECK_EQ(0U, analyzer.stats(0).totalRecalls());
+  // Reset forgets the last recall too
+  analyzer.Consume(200, 0, RECALL_3);
+  CHECK_EQ(0U, analyzer.stats(0).recallIntervals[3][6] + analyzer.stats(0).recallIntervals[3][0]);
+}
+
+void TestMergeAndFormat() {
+  HotkeyAnalyzer analyzer;
+  analyzer.Consume(0, 0, ASSIGN_3);
+  analyzer.Consume(10, 0, RECALL_3);
+  analyzer.Consume(20, 0, RECALL_3);
+  PlayerHotkeyStats merged = PlayerHotkeyStats();
+  merged.Merge(analyzer.stats(0));
+  merged.Merge(analyzer.stats(0));
+  CHECK_EQ(2U, merged.assigns[3]);
+  CHECK_EQ(4U, merged.totalRecalls());
+  CHECK_EQ(2U, merged.recallIntervals[3][3]);
+
+  const string text = apm::FormatHotkeyStats(merged);
+  CHECK(text.find("Selections: 0") != string::npos);
+  CHECK(text.find("Hotkey 3: assigned 2, added 0, recalled 4") != string::npos);
+  CHECK(text.find("Hotkey 0") == string::npos);
+}
+
+vector<byte> EncodeLog(const string& p1, const string& p2, uint32 recalls) {
+  vector<byte> log;
+  apm::GameLogEncoder encoder;
+  apm::GameLogHeader header = apm::GameLogHeader();
+  header.playerNames[0] = p1;
+  header.playerNames[1] = p2;
+  encoder.Begin(header, [&log](vector<byte> block) {
+    log.insert(log.end(), block.begin(), block.end());
+  });
+  for (uint32 i = 0; i < recalls; i++) {
+    encoder.AddAction(i * 10, 0, RECALL_3);
+    encoder.AddAction(i * 10 + 1, 1, ASSIGN_3);
+  }
+  encoder.End(recalls * 10);
+  return log;
+}
+
+void TestAggregate() {
+  vector<vector<byte>> logs;
+  for (uint32 i = 0; i < 20; i++) {
+    logs.push_back(EncodeLog(i % 2 ? "alice" : "bob", "carol", 100));
+  }
+  vector<apm::GameLogData> data;
+  for (const vector<byte>& log : logs) {
+    apm::GameLogData entry = { log.data(), log.size() };
+    data.push_back(entry);
+  }
+
+  for (uint32 threads = 1; threads <= 4; threads += 3) {
+    HotkeyStatsByPlayer result;
+    CHECK_EQ(20U, apm::AggregateHotkeyStats(data, threads, &result));
+    CHECK_EQ(3U, result.size());
+    CHECK_EQ(1000U, result["alice"].totalRecalls());
+    CHECK_EQ(1000U, result["bob"].totalRecalls());
+    CHECK_EQ(2000U, result["carol"].assigns[3]);
+  }
+
+  // A cut off log isn't counted as read, but what could be read of it still is
+  data[0].size /= 2;
+  HotkeyStatsByPlayer result;
+  CHECK_EQ(19U, apm::AggregateHotkeyStats(data, 2, &result));
+  CHECK(result["bob"].totalRecalls() > 900U);
+  CHECK(result["bob"].totalRecalls() < 1000U);
+}
+
+}  // namespace
+
+int main() {
+  RUN_TEST(TestSelections);
+  RUN_TEST(TestHotkeys);
+  RUN_TEST(TestMergeAndFormat);
+  RUN_TEST(TestAggregate);
+  return 0;
+}
@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "./inline_hook.h"
+#include "./test_util.h"
+#include "./types.h"
+
+using sbat::AllocateExecutable;
+using sbat::FreeExecutable;
+using sbat::FuncHook;
+using sbat::JumpSize;
+using sbat::MeasureInstructions;
+using sbat::WriteJump;
+
+// The hand written functions below are x86-64 System V code
+#if defined(__x86_64__) && defined(__linux__)
+#define INLINE_HOOK_TESTS
+namespace {
+
+// int f(int x) { return x ? 8 : 7; }, with a short conditional jump in its first 5 bytes
+const byte FUNCTION[] = {
+  0x31, 0xC0,  // xor eax, eax
+  0x85, 0xFF,  // test edi, edi
+  0x74, 0x02,  // jz +2
+  0xFF, 0xC0,  // inc eax
+  0x83, 0xC0, 0x07,  // add eax, 7
+  0xC3,  // ret
+};
+// The same function with enough in front of the jump to be replaced by an absolute jump
+const byte LONG_NOP[] = { 0x0F, 0x1F, 0x80, 0x00, 0x00, 0x00, 0x00 };
+
+typedef int (*Function)(int);
+
+// A page of code to hook, copied out of FUNCTION (after prefix, if any)
+class Code {
+public:
+  Code(byte* page, const byte* prefix, size_t prefix_size)
+    : page_(page) {
+    std::fill(page_, page_ + PAGE_SIZE, 0xCC);
+    memcpy(page_, prefix, prefix_size);
+    memcpy(page_ + prefix_size, FUNCTION, sizeof(FUNCTION));
+  }
+  ~Code() {
+    FreeExecutable(page_, PAGE_SIZE);
+  }
+
+  byte* bytes() const { return page_; }
+  Function function() const { return reinterpret_cast<Function>(page_); }
+
+  static const size_t PAGE_SIZE = 4096;
+
+private:
+  byte* page_;
+};
+
+FuncHook<Function>* currentHook = nullptr;
+
+// Passes the call through to the original, to show which one ran
+int Hook(int x) {
+  return 100 + currentHook->callable()(x);
+}
+
+void TestWriteJump() {
+  byte code[0x200] = {};
+  byte output[sbat::kMaxJumpSize];
+  CHECK_EQ(5U, WriteJump(code, code + 0x100, output));
+  CHECK_EQ(0xE9, output[0]);
+  int32 offset;
+  memcpy(&offset, &output[1], sizeof(offset));
+  CHECK_EQ(0x100 - 5, offset);
+  CHECK_EQ(5U, WriteJump(code + 8, code, output));
+  memcpy(&offset, &output[1], sizeof(offset));
+  CHECK_EQ(-13, offset);
+
+  if (sizeof(void*) == 8) {
+    // more than 2GB away needs an absolute jump
+    const uintptr_t far = reinterpret_cast<uintptr_t>(code) ^ (uintptr_t(1) << 40);
+    CHECK_EQ(sbat::kMaxJumpSize, WriteJump(code, reinterpret_cast<void*>(far), output));
+    const byte jump[] = { 0xFF, 0x25, 0x00, 0x00, 0x00, 0x00 };
+    CHECK(std::equal(jump, jump + sizeof(jump), output));
+    uintptr_t target;
+    memcpy(&target, &output[6], sizeof(target));
+    CHECK_EQ(far, target);
+  }
+}
+
+void TestMeasureInstructions() {
+  uint32 size;
+  uint32 relocatedSize;
+  // xor, test and jz, with the short jz rewritten as a near one
+  CHECK(MeasureInstructions(FUNCTION, 5, &size, &relocatedSize));
+  CHECK_EQ(6U, size);
+  CHECK_EQ(10U, relocatedSize);
+  CHECK(MeasureInstructions(FUNCTION, 1, &size, &relocatedSize));
+  CHECK_EQ(2U, size);
+
+  // loop has no longer form
+  const byte loop[] = { 0xE2, 0xFE, 0x90, 0x90, 0x90, 0xC3 };
+  CHECK(!MeasureInstructions(loop, 5, &size, &relocatedSize));
+  // a jump back into the replaced bytes would land in the middle of the hook's jump
+  const byte jumpIntoHook[] = { 0x90, 0x90, 0xEB, 0xFD, 0x90, 0xC3 };
+  CHECK(!MeasureInstructions(jumpIntoHook, 5, &size, &relocatedSize));
+  if (sizeof(void*) == 8) {
+    // mov eax, [rip+0], which would read from somewhere else once moved
+    const byte ripRelative[] = { 0x8B, 0x05, 0x00, 0x00, 0x00, 0x00, 0xC3 };
+    CHECK(!MeasureInstructions(ripRelative, 5, &size, &relocatedSize));
+  }
+}
+
+void CheckHook(const Code& code, uint32 expectedJumpSize) {
+  const Function function = code.function();
+  CHECK_EQ(7, function(0));
+  CHECK_EQ(8, function(1));
+
+  FuncHook<Function> hook(function, &Hook);
+  currentHook = &hook;
+  CHECK(hook.isValid());
+  CHECK_EQ(expectedJumpSize, JumpSize(code.bytes(), reinterpret_cast<const void*>(&Hook)));
+  // the original can be called before the hook is injected
+  CHECK_EQ(8, hook.callable()(1));
+
+  CHECK(hook.Inject());
+  CHECK(!hook.Inject());
+  CHECK_EQ(expectedJumpSize == 5 ? 0xE9 : 0xFF, code.bytes()[0]);
+  CHECK_EQ(107, function(0));
+  CHECK_EQ(108, function(1));
+  // and while it is, taking both sides of the relocated jz
+  CHECK_EQ(7, hook.callable()(0));
+  CHECK_EQ(8, hook.callable()(1));
+
+  CHECK(hook.Restore());
+  CHECK_EQ(7, function(0));
+  CHECK_EQ(8, function(1));
+  CHECK(hook.Inject());
+  CHECK_EQ(108, function(1));
+  currentHook = nullptr;
+}
+
+void TestHookNearby() {
+  byte* page = AllocateExecutable(Code::PAGE_SIZE, reinterpret_cast<const void*>(&Hook));
+  CHECK(page != nullptr);
+  Code code(page, nullptr, 0);
+  CheckHook(code, 5);
+  // the hook restores the function when it's destroyed
+  CHECK_EQ(8, code.function()(1));
+}
+
+// mmap puts memory far above the executable when there's no hint, so the hook needs an absolute
+// jump (and a longer prologue for it to replace)
+void TestHookFarAway() {
+  byte* page = AllocateExecutable(Code::PAGE_SIZE, nullptr);
+  CHECK(page != nullptr);
+  Code code(page, LONG_NOP, sizeof(LONG_NOP));
+  if (JumpSize(code.bytes(), reinterpret_cast<const void*>(&Hook)) == 5) {
+    std::printf("  skipped, the code ended up within 2GB of the hook\n");
+    return;
+  }
+  CheckHook(code, sbat::kMaxJumpSize);
+}
+
+void TestUnrelocatableFunction() {
+  byte* page = AllocateExecutable(Code::PAGE_SIZE, reinterpret_cast<const void*>(&Hook));
+  CHECK(page != nullptr);
+  const byte jecxz[] = { 0xE3, 0x00 };  // jecxz +0
+  Code code(page, jecxz, sizeof(jecxz));
+  FuncHook<Function> hook(code.function(), &Hook);
+  CHECK(!hook.isValid());
+  CHECK(!hook.Inject());
+  CHECK_EQ(code.function(), hook.callable());
+}
+
+}  // namespace
+#endif
+
+int main() {
+#ifdef INLINE_HOOK_TESTS
+  RUN_TEST(TestWriteJump);
+  RUN_TEST(TestMeasureInstructions);
+  RUN_TEST(TestHookNearby);
+  RUN_TEST(TestHookFarAway);
+  RUN_TEST(TestUnrelocatableFunction);
+#else
+  std::printf("Only runs on x86-64 Linux, skipping\n");
+#endif
+  return 0;
+}
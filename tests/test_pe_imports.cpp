@@ -0,0 +1,227 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "./pe_imports.h"
+#include "./test_util.h"
+#include "./types.h"
+
+using sbat::ImageLayout;
+using sbat::ImportIndex;
+
+namespace {
+
+const uint32 OPTIONAL_HEADER = 0x98;
+const uint32 SECTION_RVA = 0x1000;
+const uint32 SECTION_SIZE = 0x800;
+// Where the section's bytes start in the file layout
+const uint32 SECTION_FILE_OFFSET = 0x400;
+const uint32 IMAGE_SIZE = SECTION_RVA + SECTION_SIZE;
+
+// Builds a minimal PE image with one section holding the import tables, laid out either as it would
+// be on disk or once mapped
+class ImageBuilder {
+public:
+  ImageBuilder(bool is_64bit, ImageLayout layout)
+    : is_64bit_(is_64bit),
+      layout_(layout),
+      bytes_(layout == ImageLayout::Mapped ? IMAGE_SIZE : SECTION_FILE_OFFSET + SECTION_SIZE) {
+    PutAt<uint16>(0, 0x5A4D);
+    PutAt<uint32>(0x3C, 0x80);
+    PutAt<uint32>(0x80, 0x00004550);
+    // IMAGE_FILE_HEADER: 1 section, followed by the optional header with 16 data directories
+    const uint16 optional_size = is_64bit ? 240 : 224;
+    PutAt<uint16>(0x84 + 2, 1);
+    PutAt<uint16>(0x84 + 16, optional_size);
+    PutAt<uint16>(OPTIONAL_HEADER, is_64bit ? 0x20B : 0x10B);
+    PutAt<uint32>(OPTIONAL_HEADER + 56, IMAGE_SIZE);
+    PutAt<uint32>(OPTIONAL_HEADER + (is_64bit ? 108 : 92), 16);
+
+    const uint32 section = OPTIONAL_HEADER + optional_size;
+    PutAt<uint32>(section + 8, SECTION_SIZE);
+    PutAt<uint32>(section + 12, SECTION_RVA);
+    PutAt<uint32>(section + 16, SECTION_SIZE);
+    PutAt<uint32>(section + 20, SECTION_FILE_OFFSET);
+  }
+
+  void SetImportDirectory(uint32 rva) {
+    PutAt<uint32>(OPTIONAL_HEADER + (is_64bit_ ? 112 : 96) + 8, rva);
+  }
+
+  void SetDescriptor(uint32 rva, uint32 lookup_rva, uint32 name_rva, uint32 iat_rva) {
+    Put<uint32>(rva, lookup_rva);
+    Put<uint32>(rva + 12, name_rva);
+    Put<uint32>(rva + 16, iat_rva);
+  }
+
+  void PutString(uint32 rva, const char* str) {
+    std::memcpy(&bytes_[ToOffset(rva)], str, std::strlen(str) + 1);
+  }
+
+  // Writes a lookup table entry, either a hint/name RVA or an ordinal
+  void PutThunk(uint32 rva, uint32 index, uint64 value) {
+    if (is_64bit_) {
+      Put<uint64>(rva + index * 8, value);
+    } else {
+      Put<uint32>(rva + index * 4, static_cast<uint32>(value));
+    }
+  }
+
+  uint64 OrdinalThunk(uint16 ordinal) const {
+    return (is_64bit_ ? 0x8000000000000000ULL : 0x80000000ULL) | ordinal;
+  }
+
+  uint32 ThunkSize() const {
+    return is_64bit_ ? 8 : 4;
+  }
+
+  const std::vector<byte>& bytes() const { return bytes_; }
+
+private:
+  uint32 ToOffset(uint32 rva) const {
+    return layout_ == ImageLayout::File && rva >= SECTION_RVA ?
+        rva - SECTION_RVA + SECTION_FILE_OFFSET : rva;
+  }
+
+  template <typename T>
+  void PutAt(uint32 offset, T value) {
+    std::memcpy(&bytes_[offset], &value, sizeof(value));
+  }
+
+  template <typename T>
+  void Put(uint32 rva, T value) {
+    PutAt(ToOffset(rva), value);
+  }
+
+  bool is_64bit_;
+  ImageLayout layout_;
+  std::vector<byte> bytes_;
+};
+
+const uint32 DESCRIPTORS = 0x1000;
+const uint32 KERNEL32_LOOKUP = 0x1100;
+const uint32 KERNEL32_IAT = 0x1200;
+const uint32 USER32_LOOKUP = 0x1140;
+const uint32 USER32_IAT = 0x1240;
+const uint32 BOUND_IAT = 0x1280;
+const uint32 NAMES = 0x1400;
+
+// KERNEL32.dll (2 names and an ordinal), a module without a lookup table, then USER32.dll
+void AddImports(ImageBuilder* builder) {
+  builder->SetImportDirectory(DESCRIPTORS);
+  builder->PutString(NAMES, "KERNEL32.dll");
+  builder->PutString(NAMES + 0x20 + 2, "GetProcAddress");
+  builder->PutString(NAMES + 0x40 + 2, "LoadLibraryA");
+  builder->PutString(NAMES + 0x60, "bound.dll");
+  builder->PutString(NAMES + 0x80, "USER32.dll");
+  builder->PutString(NAMES + 0xA0 + 2, "MessageBoxA");
+
+  builder->SetDescriptor(DESCRIPTORS, KERNEL32_LOOKUP, NAMES, KERNEL32_IAT);
+  builder->PutThunk(KERNEL32_LOOKUP, 0, NAMES + 0x20);
+  builder->PutThunk(KERNEL32_LOOKUP, 1, NAMES + 0x40);
+  builder->PutThunk(KERNEL32_LOOKUP, 2, builder->OrdinalThunk(16));
+  builder->SetDescriptor(DESCRIPTORS + 20, 0, NAMES + 0x60, BOUND_IAT);
+  builder->PutThunk(BOUND_IAT, 0, NAMES + 0x20);
+  builder->SetDescriptor(DESCRIPTORS + 40, USER32_LOOKUP, NAMES + 0x80, USER32_IAT);
+  builder->PutThunk(USER32_LOOKUP, 0, NAMES + 0xA0);
+}
+
+void CheckImports(const ImageBuilder& builder, ImageLayout layout) {
+  ImportIndex index;
+  CHECK(index.Parse(builder.bytes().data(), builder.bytes().size(), layout));
+  CHECK_EQ(4U, index.size());
+  CHECK_EQ(KERNEL32_IAT, index.Find("KERNEL32.dll", "GetProcAddress"));
+  CHECK_EQ(KERNEL32_IAT + builder.ThunkSize(), index.Find("kernel32.DLL", "loadlibrarya"));
+  CHECK_EQ(KERNEL32_IAT + 2 * builder.ThunkSize(), index.Find("kernel32.dll", 16));
+  CHECK_EQ(USER32_IAT, index.Find("user32.dll", "MessageBoxA"));
+  // Ordinals and names are looked up separately
+  CHECK_EQ(0U, index.Find("kernel32.dll", "16"));
+  CHECK_EQ(0U, index.Find("kernel32.dll", 17));
+  // Modules without a lookup table aren't indexed
+  CHECK_EQ(0U, index.Find("bound.dll", "GetProcAddress"));
+  CHECK_EQ(0U, index.Find("user32.dll", "GetProcAddress"));
+}
+
+void TestPe32Mapped() {
+  ImageBuilder builder(false, ImageLayout::Mapped);
+  AddImports(&builder);
+  CheckImports(builder, ImageLayout::Mapped);
+  CHECK_EQ(IMAGE_SIZE, ImportIndex::GetMappedImageSize(builder.bytes().data()));
+}
+
+void TestPe32File() {
+  ImageBuilder builder(false, ImageLayout::File);
+  AddImports(&builder);
+  CheckImports(builder, ImageLayout::File);
+}
+
+void TestPe32PlusMapped() {
+  ImageBuilder builder(true, ImageLayout::Mapped);
+  AddImports(&builder);
+  CheckImports(builder, ImageLayout::Mapped);
+}
+
+void TestPe32PlusFile() {
+  ImageBuilder builder(true, ImageLayout::File);
+  AddImports(&builder);
+  CheckImports(builder, ImageLayout::File);
+}
+
+void TestNoImports() {
+  ImageBuilder builder(false, ImageLayout::Mapped);
+  ImportIndex index;
+  CHECK(index.Parse(builder.bytes().data(), builder.bytes().size(), ImageLayout::Mapped));
+  CHECK(index.empty());
+}
+
+void TestUnreadableModuleIsSkipped() {
+  ImageBuilder builder(false, ImageLayout::Mapped);
+  AddImports(&builder);
+  // KERNEL32's lookup table now points past the end of the image
+  builder.SetDescriptor(DESCRIPTORS, IMAGE_SIZE + 0x100, NAMES, KERNEL32_IAT);
+  ImportIndex index;
+  CHECK(!index.Parse(builder.bytes().data(), builder.bytes().size(), ImageLayout::Mapped));
+  CHECK_EQ(1U, index.size());
+  CHECK_EQ(0U, index.Find("kernel32.dll", "GetProcAddress"));
+  CHECK_EQ(USER32_IAT, index.Find("user32.dll", "MessageBoxA"));
+}
+
+void TestUnterminatedDescriptorTable() {
+  ImageBuilder builder(false, ImageLayout::Mapped);
+  AddImports(&builder);
+  // The last descriptor that fits runs off the end of the image instead of being a terminator
+  const uint32 last = IMAGE_SIZE - 20;
+  builder.SetDescriptor(last, USER32_LOOKUP, NAMES + 0x80, USER32_IAT);
+  builder.SetImportDirectory(last);
+  ImportIndex index;
+  CHECK(!index.Parse(builder.bytes().data(), builder.bytes().size(), ImageLayout::Mapped));
+  // but what came before the end is kept
+  CHECK_EQ(USER32_IAT, index.Find("user32.dll", "MessageBoxA"));
+}
+
+void TestInvalidHeaders() {
+  ImageBuilder builder(false, ImageLayout::Mapped);
+  AddImports(&builder);
+  std::vector<byte> bytes = builder.bytes();
+  bytes[0] = 'X';
+  ImportIndex index;
+  CHECK(!index.Parse(bytes.data(), bytes.size(), ImageLayout::Mapped));
+  CHECK(index.empty());
+  CHECK_EQ(0U, ImportIndex::GetMappedImageSize(bytes.data()));
+  // Too short to hold the NT headers
+  CHECK(!index.Parse(builder.bytes().data(), 0x90, ImageLayout::Mapped));
+}
+
+}  // namespace
+
+int main() {
+  RUN_TEST(TestPe32Mapped);
+  RUN_TEST(TestPe32File);
+  RUN_TEST(TestPe32PlusMapped);
+  RUN_TEST(TestPe32PlusFile);
+  RUN_TEST(TestNoImports);
+  RUN_TEST(TestUnreadableModuleIsSkipped);
+  RUN_TEST(TestUnterminatedDescriptorTable);
+  RUN_TEST(TestInvalidHeaders);
+  return 0;
+}
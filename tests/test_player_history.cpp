@@ -0,0 +1,182 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "./player_history.h"
+#include "./test_util.h"
+#include "./types.h"
+
+using apm::PlayerHistory;
+using apm::PlayerHistoryKey;
+using apm::PlayerTotals;
+
+namespace {
+
+const uint64 RECORD_SIZE = 24;
+
+uint64 FileSize(const std::string& path) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  return file ? static_cast<uint64>(file.tellg()) : 0;
+}
+
+void TestTotals() {
+  PlayerTotals totals = PlayerTotals();
+  CHECK_EQ(0.0, totals.averageApm());
+  PlayerTotals game = { 1, 100, 1000 };
+  totals.Add(game);
+  totals.Add(game);
+  CHECK_EQ(2U, totals.games);
+  CHECK_EQ(200U, totals.actions);
+  // 2000 ticks is 1.4 minutes
+  CHECK(totals.averageApm() > 142.8 && totals.averageApm() < 142.9);
+}
+
+// Storm IDs get reused by other players from one session to the next, so games are keyed by name
+void TestKeyedByName() {
+  const uint64 key = PlayerHistoryKey("Flash", 5);
+  CHECK_EQ(key, PlayerHistoryKey("Flash[abc]", 5));
+  CHECK(key != PlayerHistoryKey("flash", 5));
+  CHECK(key != PlayerHistoryKey("Flas", 4));
+  CHECK(PlayerHistoryKey("", 0) != PlayerHistoryKey("\0", 1));
+
+  TempDirectory dir;
+  {
+    PlayerHistory history(dir.path());
+    CHECK(history.Open());
+    history.AddGame(key, 300, 1000, 0);
+  }
+  PlayerHistory history(dir.path());
+  CHECK(history.Open());
+  PlayerTotals totals;
+  CHECK(history.Lookup(PlayerHistoryKey("Flash", 5), &totals));
+  CHECK_EQ(300U, totals.actions);
+  CHECK(!history.Lookup(PlayerHistoryKey("Jaedong", 7), &totals));
+}
+
+void TestPersistsAcrossOpens() {
+  TempDirectory dir;
+  {
+    PlayerHistory history(dir.path());
+    CHECK(history.Open());
+    history.AddGame(1, 100, 1000, 0);
+    history.AddGame(2, 50, 1000, 0);
+    history.AddGame(1, 200, 1000, 0);
+    PlayerTotals totals;
+    CHECK(history.Lookup(1, &totals));
+    CHECK_EQ(2U, totals.games);
+    CHECK_EQ(300U, totals.actions);
+    CHECK(history.LookupSession(2, &totals));
+    CHECK_EQ(1U, totals.games);
+    CHECK(!history.Lookup(3, &totals));
+  }
+
+  PlayerHistory history(dir.path());
+  CHECK(history.Open());
+  // Written out into the index when the last one was destroyed
+  CHECK_EQ(2U, history.indexedPlayers());
+  CHECK_EQ(0U, history.pendingPlayers());
+  PlayerTotals totals;
+  CHECK(history.Lookup(1, &totals));
+  CHECK_EQ(2U, totals.games);
+  CHECK_EQ(2000U, totals.ticks);
+  // Only games added through this object count towards the session
+  CHECK(!history.LookupSession(1, &totals));
+  history.AddGame(1, 10, 100, 0);
+  CHECK(history.LookupSession(1, &totals));
+  CHECK_EQ(1U, totals.games);
+  CHECK(history.Lookup(1, &totals));
+  CHECK_EQ(3U, totals.games);
+}
+
+void TestRebuildsMissingIndex() {
+  TempDirectory dir;
+  {
+    PlayerHistory history(dir.path());
+    CHECK(history.Open());
+    for (uint32 i = 0; i < 10; i++) {
+      history.AddGame(i % 3, 100, 1000, i);
+    }
+  }
+  std::remove(dir.File("players.idx").c_str());
+
+  PlayerHistory history(dir.path());
+  CHECK(history.Open());
+  PlayerTotals totals;
+  CHECK(history.Lookup(0, &totals));
+  CHECK_EQ(4U, totals.games);
+  CHECK(history.Compact());
+  CHECK_EQ(3U, history.indexedPlayers());
+  CHECK_EQ(0U, history.pendingPlayers());
+  CHECK(history.Lookup(2, &totals));
+  CHECK_EQ(3U, totals.games);
+}
+
+void TestCutsOffPartialRecord() {
+  TempDirectory dir;
+  {
+    PlayerHistory history(dir.path());
+    CHECK(history.Open());
+    history.AddGame(1, 100, 1000, 0);
+    history.AddGame(2, 50, 1000, 0);
+  }
+  // As if the process died partway through writing a record
+  {
+    std::ofstream log(dir.File("players.dat"), std::ios::binary | std::ios::app);
+    log.write("xxxxx", 5);
+  }
+
+  {
+    PlayerHistory history(dir.path());
+    CHECK(history.Open());
+    history.AddGame(1, 100, 1000, 0);
+  }
+  CHECK_EQ(3 * RECORD_SIZE, FileSize(dir.File("players.dat")));
+
+  std::remove(dir.File("players.idx").c_str());
+  PlayerHistory history(dir.path());
+  CHECK(history.Open());
+  PlayerTotals totals;
+  CHECK(history.Lookup(1, &totals));
+  CHECK_EQ(2U, totals.games);
+  CHECK(history.Lookup(2, &totals));
+  CHECK_EQ(1U, totals.games);
+}
+
+void TestIndexesOnceManyPlayersPending() {
+  TempDirectory dir;
+  PlayerHistory history(dir.path());
+  CHECK(history.Open());
+  for (uint32 i = 0; i < 3000; i++) {
+    history.AddGame(i, 100, 1000, 0);
+  }
+  CHECK(history.indexedPlayers() > 0U);
+  CHECK(history.pendingPlayers() < 3000U);
+  PlayerTotals totals;
+  for (uint32 i = 0; i < 3000; i += 100) {
+    CHECK(history.Lookup(i, &totals));
+    CHECK_EQ(1U, totals.games);
+  }
+}
+
+void TestWithoutDirectory() {
+  TempDirectory dir;
+  PlayerHistory history(dir.File("missing"));
+  CHECK(!history.Open());
+  history.AddGame(1, 100, 1000, 0);
+  PlayerTotals totals;
+  CHECK(history.Lookup(1, &totals));
+  CHECK_EQ(1U, totals.games);
+}
+
+}  // namespace
+
+int main() {
+  RUN_TEST(TestTotals);
+  RUN_TEST(TestKeyedByName);
+  RUN_TEST(TestPersistsAcrossOpens);
+  RUN_TEST(TestRebuildsMissingIndex);
+  RUN_TEST(TestCutsOffPartialRecord);
+  RUN_TEST(TestIndexesOnceManyPlayersPending);
+  RUN_TEST(TestWithoutDirectory);
+  return 0;
+}
@@ -0,0 +1,101 @@
+#include <cstring>
+#include <string>
+
+#include "./brood_war.h"
+#include "./player_identity.h"
+#include "./simulated_brood_war.h"
+#include "./test_util.h"
+#include "./types.h"
+
+using apm::BroodWar;
+using apm::PlayerIdentityTable;
+using apm::SimulatedBroodWar;
+using std::string;
+
+namespace {
+
+void TestReadsPlayers() {
+  SimulatedBroodWar sim;
+  BroodWar bw = sim.Create();
+  sim.StartGame({ "a", "", "bob" }, false);
+  sim.memory().playerColor[2] = 0xA5;
+
+  PlayerIdentityTable players;
+  CHECK_EQ(0U, players.version());
+  CHECK(players.Refresh(bw));
+  CHECK_EQ(1U, players.version());
+  CHECK(players.isPresent(0));
+  CHECK(!players.isPresent(1));
+  CHECK_EQ(string("bob"), players[2].nameRef().str());
+  CHECK_EQ(3U, players[2].nameLength);
+  CHECK_EQ('\0', players[2].name[3]);
+  CHECK_EQ(3U, players[2].stormId);
+  CHECK_EQ(0xA5, players[2].playerColor);
+  CHECK_EQ(apm::PlayerColorToTextColor(0xA5), players[2].textColor);
+  CHECK(players[1].nameRef().empty());
+
+  // A name that fills the whole field is cut off before its last byte, which BW keeps for the null
+  apm::PlayerInfo& info = sim.memory().playerInfo[3];
+  memset(info.name, 'x', sizeof(info.name));
+  CHECK(players.Refresh(bw));
+  CHECK_EQ(sizeof(info.name) - 1, players[3].nameLength);
+  CHECK_EQ(string(sizeof(info.name) - 1, 'x'), players[3].nameRef().str());
+}
+
+// Re-reads only when a PlayerInfo block or player color changes, unless forced
+void TestRefreshesOnlyOnChange() {
+  SimulatedBroodWar sim;
+  BroodWar bw = sim.Create();
+  sim.StartGame({ "a", "b" }, false);
+  PlayerIdentityTable players;
+  CHECK(players.Refresh(bw));
+
+  CHECK(!players.Refresh(bw));
+  CHECK(!players.Refresh(bw));
+  CHECK_EQ(1U, players.version());
+
+  // A name change
+  strcpy(sim.memory().playerInfo[1].name, "c");
+  CHECK(players.Refresh(bw));
+  CHECK_EQ(2U, players.version());
+  CHECK_EQ(string("c"), players[1].nameRef().str());
+  CHECK(!players.Refresh(bw));
+
+  // Anything else in the block, even if it's not copied out
+  sim.memory().playerInfo[11].race = 2;
+  CHECK(players.Refresh(bw));
+  CHECK_EQ(3U, players.version());
+
+  // A color change
+  sim.memory().playerColor[0] = 0x9F;
+  CHECK(players.Refresh(bw));
+  CHECK_EQ(0x9F, players[0].playerColor);
+  CHECK_EQ(apm::PlayerColorToTextColor(0x9F), players[0].textColor);
+  CHECK(!players.Refresh(bw));
+  CHECK_EQ(4U, players.version());
+
+  // Forced without any change
+  CHECK(players.Refresh(bw, true));
+  CHECK_EQ(5U, players.version());
+  CHECK_EQ(string("a"), players[0].nameRef().str());
+  CHECK(!players.Refresh(bw));
+}
+
+// The first refresh reads the players whatever the hash, even with no game started
+void TestFirstRefreshAlwaysReads() {
+  SimulatedBroodWar sim;
+  BroodWar bw = sim.Create();
+  PlayerIdentityTable players;
+  CHECK(players.Refresh(bw));
+  CHECK(!players.isPresent(0));
+  CHECK(!players.Refresh(bw));
+}
+
+}  // namespace
+
+int main() {
+  RUN_TEST(TestReadsPlayers);
+  RUN_TEST(TestRefreshesOnlyOnChange);
+  RUN_TEST(TestFirstRefreshAlwaysReads);
+  return 0;
+}
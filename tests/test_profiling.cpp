@@ -0,0 +1,107 @@
+#include <cstring>
+
+#include "./profiling.h"
+#include "./test_util.h"
+#include "./types.h"
+
+using apm::CycleHistogram;
+using apm::Probe;
+
+namespace {
+
+void TestBucketBounds() {
+  const uint32 values[] = { 0, 1, 3, 4, 5, 7, 8, 100, 1000, 12345, 0x7FFFFFFF, 0xFFFFFFFF };
+  for (uint32 value : values) {
+    const uint32 bucket = CycleHistogram::BucketFor(value);
+    CHECK(bucket < CycleHistogram::NUM_BUCKETS);
+    CHECK(CycleHistogram::BucketLowerBound(bucket) <= value);
+    if (bucket + 1 < CycleHistogram::NUM_BUCKETS) {
+      CHECK(value < CycleHistogram::BucketLowerBound(bucket + 1));
+    }
+  }
+  CHECK_EQ(CycleHistogram::NUM_BUCKETS - 1, CycleHistogram::BucketFor(0xFFFFFFFF));
+  // Every bucket starts where the last one ended
+  for (uint32 bucket = 1; bucket < CycleHistogram::NUM_BUCKETS; bucket++) {
+    const uint32 lower = CycleHistogram::BucketLowerBound(bucket);
+    CHECK_EQ(bucket, CycleHistogram::BucketFor(lower));
+    CHECK_EQ(bucket - 1, CycleHistogram::BucketFor(lower - 1));
+  }
+}
+
+void TestPercentiles() {
+  CycleHistogram histogram;
+  CHECK_EQ(0U, histogram.Percentile(0.5));
+  for (int i = 0; i < 99; i++) {
+    histogram.Record(1000);
+  }
+  histogram.Record(100000);
+  CHECK_EQ(100U, histogram.count());
+  CHECK_EQ(100000U, histogram.max());
+  // Within the 25% a bucket spans
+  const uint32 p50 = histogram.Percentile(0.5);
+  CHECK(p50 >= 750 && p50 <= 1250);
+  const uint32 p99 = histogram.Percentile(0.99);
+  CHECK(p99 >= 75000 && p99 <= 100000);
+  CHECK(histogram.Percentile(1.0) <= histogram.max());
+
+  histogram.Record(0x100000000ULL);
+  CHECK_EQ(0xFFFFFFFFU, histogram.max());
+
+  histogram.Reset();
+  CHECK_EQ(0U, histogram.count());
+  CHECK_EQ(0U, histogram.max());
+  CHECK_EQ(0U, histogram.Percentile(0.99));
+}
+
+void TestCountCallSamples() {
+  CycleHistogram histogram;
+  uint32 timed = 0;
+  for (uint32 i = 0; i < apm::PROBE_SAMPLE_INTERVAL * 10; i++) {
+    if (histogram.CountCall()) {
+      timed++;
+    }
+  }
+  CHECK_EQ(10U, timed);
+  CHECK_EQ(apm::PROBE_SAMPLE_INTERVAL * 10, histogram.calls());
+  // Counting a call doesn't record anything, only the timed calls do
+  CHECK_EQ(0U, histogram.count());
+}
+
+void ProbedFunction() {
+  APM_PROBE(Draw);
+}
+
+void TestProbeAndSnapshot() {
+  apm::ResetProfile();
+  for (uint32 i = 0; i < apm::PROBE_SAMPLE_INTERVAL * 2; i++) {
+    ProbedFunction();
+  }
+  const CycleHistogram& histogram = apm::GetProbeHistogram(Probe::Draw);
+  CHECK_EQ(apm::PROBE_SAMPLE_INTERVAL * 2, histogram.calls());
+  CHECK_EQ(2U, histogram.count());
+
+  apm::ProfileSnapshot snapshot;
+  CHECK(apm::TakeProfileSnapshot(&snapshot));
+  CHECK_EQ(apm::PROFILE_SNAPSHOT_VERSION, snapshot.version);
+  CHECK_EQ(static_cast<uint32>(Probe::Count), snapshot.numProbes);
+  const apm::ProbeStats& draw = snapshot.probes[static_cast<uint32>(Probe::Draw)];
+  CHECK(std::strcmp(draw.name, "GameMonitor::Draw") == 0);
+  CHECK_EQ(apm::PROBE_SAMPLE_INTERVAL * 2, draw.calls);
+  CHECK_EQ(2U, draw.count);
+  CHECK(draw.p50 <= draw.max);
+  CHECK_EQ(0U, snapshot.probes[static_cast<uint32>(Probe::OnAction)].calls);
+
+  apm::ResetProfile();
+  CHECK(apm::TakeProfileSnapshot(&snapshot));
+  CHECK_EQ(0U, snapshot.probes[static_cast<uint32>(Probe::Draw)].calls);
+}
+
+}  // namespace
+
+int main() {
+  RUN_TEST(TestBucketBounds);
+  RUN_TEST(TestPercentiles);
+  RUN_TEST(TestCountCallSamples);
+  RUN_TEST(TestProbeAndSnapshot);
+  return 0;
+}
@@ -0,0 +1,198 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "./action_forwarding.h"
+#include "./actions.h"
+#include "./brood_war.h"
+#include "./game_monitor.h"
+#include "./player_history.h"
+#include "./remote_brood_war.h"
+#include "./remote_memory.h"
+#include "./simulated_brood_war.h"
+#include "./test_util.h"
+#include "./types.h"
+
+using apm::ActionForwardReader;
+using apm::ActionForwardWriter;
+using apm::BroodWar;
+using apm::ForwardedAction;
+using apm::GameMonitor;
+using apm::PlayerHistory;
+using apm::RemoteBroodWar;
+using apm::SimulatedBroodWar;
+using sbat::RemoteProcessMemory;
+using std::string;
+using std::unique_ptr;
+
+namespace {
+
+const byte RIGHT_CLICK[10] = { apm::action::RIGHT_CLICK, 0x40, 0x01, 0x60, 0x00 };
+
+// Stands in for the game in this process, read through RemoteProcessMemory just as it would be
+// from another one
+struct Fixture {
+  Fixture()
+    : name(UniqueName("apm_test_remote")),
+      game(),
+      target(game.Create()),
+      reader(ActionForwardReader::Create(name)),
+      writer(ActionForwardWriter::Open(CurrentProcessId(), 0, apm::BW_VERSION_UNKNOWN, name)) {
+  }
+
+  size_t Pending() {
+    size_t count = 0;
+    ForwardedAction action;
+    while (reader->Next(&action)) {
+      count++;
+    }
+    return count;
+  }
+
+  string name;
+  SimulatedBroodWar game;
+  BroodWar target;
+  unique_ptr<ActionForwardReader> reader;
+  unique_ptr<ActionForwardWriter> writer;
+};
+
+void TestSamplesGame() {
+  Fixture fixture;
+  RemoteBroodWar remote(RemoteProcessMemory::Open(CurrentProcessId()), fixture.target);
+  fixture.game.StartGame({ "alice", "bob" }, false);
+  fixture.game.memory().gameTimeTicks = 1234;
+  fixture.game.memory().minerals[1] = 500;
+  CHECK(!remote.memory().isInGame);
+  CHECK(remote.Sample());
+  CHECK(remote.memory().isInGame);
+  CHECK_EQ(1234U, remote.memory().gameTimeTicks);
+  CHECK_EQ(500U, remote.memory().minerals[1]);
+  CHECK(string(remote.memory().playerInfo[1].name) == "bob");
+  // The mirror is only updated by sampling
+  fixture.game.memory().gameTimeTicks = 1300;
+  CHECK_EQ(1234U, remote.memory().gameTimeTicks);
+  CHECK(remote.process().numSpans() > 0);
+}
+
+void TestForwardActions() {
+  Fixture fixture;
+  RemoteBroodWar remote(RemoteProcessMemory::Open(CurrentProcessId()), fixture.target);
+  GameMonitor monitor(remote.Create());
+  fixture.game.StartGame({ "alice", "bob" }, false);
+  fixture.game.memory().gameTimeTicks = 50;
+  CHECK(remote.Step(fixture.reader.get(), &monitor));
+
+  fixture.writer->Forward(40, 1, RIGHT_CLICK);
+  fixture.writer->Forward(45, 0, RIGHT_CLICK);
+  CHECK_EQ(2U, remote.ForwardActions(fixture.reader.get(), &monitor));
+  // The sampled tick is put back, and there's no active player outside of the action hook
+  CHECK_EQ(50U, remote.memory().gameTimeTicks);
+  CHECK_EQ(0xFFFFFFFFU, remote.memory().activePlayerId);
+  CHECK_EQ(0U, remote.ForwardActions(fixture.reader.get(), &monitor));
+}
+
+void TestStepKeepsActionsInTheirGame() {
+  Fixture fixture;
+  RemoteBroodWar remote(RemoteProcessMemory::Open(CurrentProcessId()), fixture.target);
+  GameMonitor monitor(remote.Create());
+  CHECK(remote.Step(fixture.reader.get(), &monitor));
+
+  // Actions from a game that started after the last sample are fed once it's been set up, in the
+  // same Step
+  fixture.game.StartGame({ "alice", "bob" }, false);
+  fixture.game.memory().gameTimeTicks = 10;
+  fixture.writer->Forward(5, 0, RIGHT_CLICK);
+  fixture.writer->Forward(8, 1, RIGHT_CLICK);
+  CHECK(remote.Step(fixture.reader.get(), &monitor));
+  CHECK_EQ(0U, fixture.Pending());
+
+  // The last actions of a game that ended since the last sample still go to it
+  fixture.game.memory().gameTimeTicks = 900;
+  fixture.writer->Forward(899, 0, RIGHT_CLICK);
+  fixture.game.EndGame();
+  CHECK(remote.Step(fixture.reader.get(), &monitor));
+  CHECK_EQ(0U, fixture.Pending());
+  CHECK(!remote.memory().isInGame);
+
+  // Actions forwarded while the sample shows no game belong to one that started after it, so
+  // they're left for the next Step
+  CHECK(remote.Step(fixture.reader.get(), &monitor));
+  fixture.writer->Forward(1, 0, RIGHT_CLICK);
+  CHECK(remote.Step(fixture.reader.get(), &monitor));
+  CHECK_EQ(1U, fixture.Pending());
+}
+
+void TestUnreadableGame() {
+  Fixture fixture;
+  // Somewhere that's never mapped
+  fixture.target.isInGame.reset(0x10);
+  RemoteBroodWar remote(RemoteProcessMemory::Open(CurrentProcessId()), fixture.target);
+  GameMonitor monitor(remote.Create());
+  CHECK(!remote.Sample());
+  CHECK(!remote.Step(fixture.reader.get(), &monitor));
+}
+
+// A host with a log directory gets the same history the in-game monitor would have written
+void TestStepWritesOutputs() {
+  TempDirectory dir;
+  Fixture fixture;
+  RemoteBroodWar remote(RemoteProcessMemory::Open(CurrentProcessId()), fixture.target);
+  {
+    GameMonitor monitor(remote.Create(), dir.path());
+    monitor.OpenOutputs();
+    fixture.game.StartGame({ "alice", "bob" }, false);
+    for (uint32 tick = 0; tick < 2000; tick += 100) {
+      fixture.game.memory().gameTimeTicks = tick;
+      fixture.writer->Forward(tick, 0, RIGHT_CLICK);
+      CHECK(remote.Step(fixture.reader.get(), &monitor));
+    }
+    fixture.game.EndGame();
+    CHECK(remote.Step(fixture.reader.get(), &monitor));
+    monitor.CloseOutputs();
+  }
+
+  PlayerHistory history(dir.path());
+  CHECK(history.Open());
+  apm::PlayerTotals totals;
+  CHECK(history.Lookup(apm::PlayerHistoryKey("alice", 5), &totals));
+  CHECK_EQ(1U, totals.games);
+  // No actions, so not counted
+  CHECK(!history.Lookup(apm::PlayerHistoryKey("bob", 3), &totals));
+}
+
+void TestDataForVersion() {
+  CHECK(!apm::CreateDataForVersion(apm::BW_VERSION_UNKNOWN, 0x400000).isInGame.valid());
+  CHECK(!apm::CreateDataForVersion(1234, 0x400000).isInGame.valid());
+  // 1.16.1 is always at the same place, 1.17.0 is relative to where BW was loaded
+  const BroodWar v1161 = apm::CreateDataForVersion(apm::BW_VERSION_1161, 0x10000000);
+  CHECK_EQ(0x006D11ECU, reinterpret_cast<uintptr_t>(v1161.isInGame.get()));
+  CHECK(v1161.unitNodes.valid());
+  const BroodWar v1170 = apm::CreateDataForVersion(apm::BW_VERSION_1170, 0x10000000);
+  CHECK_EQ(0x1026743DU, reinterpret_cast<uintptr_t>(v1170.isInGame.get()));
+  CHECK(!v1170.unitNodes.valid());
+}
+
+// Attaches once the plugin has published a process and a version it knows the data of
+void TestAttach() {
+  const string name = UniqueName("apm_test_remote");
+  unique_ptr<ActionForwardReader> reader = ActionForwardReader::Create(name);
+  CHECK(RemoteBroodWar::Attach(*reader) == nullptr);
+  unique_ptr<ActionForwardWriter> writer =
+      ActionForwardWriter::Open(CurrentProcessId(), 0x400000, apm::BW_VERSION_UNKNOWN, name);
+  CHECK(RemoteBroodWar::Attach(*reader) == nullptr);
+  writer = ActionForwardWriter::Open(CurrentProcessId(), 0x400000, apm::BW_VERSION_1170, name);
+  CHECK(RemoteBroodWar::Attach(*reader) != nullptr);
+}
+
+}  // namespace
+
+int main() {
+  RUN_TEST(TestSamplesGame);
+  RUN_TEST(TestForwardActions);
+  RUN_TEST(TestStepKeepsActionsInTheirGame);
+  RUN_TEST(TestUnreadableGame);
+  RUN_TEST(TestStepWritesOutputs);
+  RUN_TEST(TestDataForVersion);
+  RUN_TEST(TestAttach);
+  return 0;
+}
@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+#include "./game_log.h"
+#include "./resource_series.h"
+#include "./test_util.h"
+#include "./types.h"
+
+using apm::DeltaColumn;
+using apm::Resource;
+using apm::ResourceFlow;
+using apm::ResourceSample;
+using apm::ResourceSeries;
+
+namespace {
+
+const size_t CHECKPOINT = DeltaColumn::CHECKPOINT_INTERVAL;
+
+// Small steps with the occasional jump too big for an int16 delta (including the escape value
+// itself and the extremes), so that both encodings show up within and across checkpoints
+std::vector<int32> MakeValues(size_t count) {
+  std::vector<int32> values;
+  int32 value = 50;
+  for (size_t i = 0; i < count; i++) {
+    switch (i % 37) {
+      case 5: value = std::numeric_limits<int32>::max(); break;
+      case 6: value = std::numeric_limits<int32>::min(); break;
+      case 7: value = 0; break;
+      case 11: value -= 32768; break;
+      case 12: value += 32767; break;
+      case 13: value += 32768; break;
+      default: value += static_cast<int32>(i % 9) - 4; break;
+    }
+    values.push_back(value);
+  }
+  return values;
+}
+
+void CheckColumn(const DeltaColumn& column, const std::vector<int32>& values) {
+  CHECK_EQ(values.size(), column.size());
+  for (size_t i = 0; i < values.size(); i++) {
+    CHECK_EQ(values[i], column.at(i));
+  }
+  if (!values.empty()) {
+    CHECK_EQ(values.back(), column.back());
+  }
+}
+
+void TestDeltaColumn() {
+  const std::vector<int32> values = MakeValues(CHECKPOINT * 5 + 17);
+  DeltaColumn column(16);
+  for (int32 value : values) {
+    column.Append(value);
+  }
+  CheckColumn(column, values);
+
+  // Ranges starting and ending off checkpoints, and running past the end
+  const size_t ranges[][2] = { { 0, 1 }, { 3, 70 }, { 63, 65 }, { 100, 400 }, { 200, 1000 } };
+  for (const auto& range : ranges) {
+    size_t next = range[0];
+    column.ForEach(range[0], range[1], [&](size_t index, int32 value) {
+      CHECK_EQ(next, index);
+      CHECK_EQ(values[index], value);
+      next++;
+    });
+    CHECK_EQ(std::min(range[1], values.size()), next);
+  }
+  bool called = false;
+  column.ForEach(10, 10, [&](size_t, int32) { called = true; });
+  column.ForEach(values.size(), values.size() + 5, [&](size_t, int32) { called = true; });
+  CHECK(!called);
+
+  column.Clear();
+  CHECK_EQ(0U, column.size());
+  CHECK_EQ(0, column.back());
+}
+
+// Cut back to sizes on and around checkpoints and escaped values, then appended to again, which
+// has to pick up from the right place in the deltas
+void TestTruncate() {
+  const std::vector<int32> values = MakeValues(CHECKPOINT * 4 + 9);
+  const size_t sizes[] = { 0, 1, 6, 7, 14, CHECKPOINT - 1, CHECKPOINT, CHECKPOINT + 1,
+      CHECKPOINT * 3 + 12, values.size() - 1, values.size(), values.size() + 10 };
+  for (size_t size : sizes) {
+    DeltaColumn column;
+    for (int32 value : values) {
+      column.Append(value);
+    }
+    column.Truncate(size);
+    std::vector<int32> expected(values.begin(), values.begin() + std::min(size, values.size()));
+    CheckColumn(column, expected);
+
+    for (int32 value : MakeValues(CHECKPOINT + 20)) {
+      column.Append(value + 3);
+      expected.push_back(value + 3);
+    }
+    CheckColumn(column, expected);
+  }
+}
+
+ResourceSample MakeSample(int32 minerals, int32 vespene) {
+  ResourceSample sample = ResourceSample();
+  sample.at(Resource::Minerals, 1) = minerals;
+  sample.at(Resource::Vespene, 1) = vespene;
+  sample.at(Resource::Population, 1) = 8;
+  return sample;
+}
+
+void TestRecordAndRewind() {
+  ResourceSeries series(24, 10);
+  series.Record(0, MakeSample(50, 0));
+  // Only the first sample of an interval counts
+  series.Record(10, MakeSample(60, 0));
+  series.Record(24, MakeSample(70, 0));
+  // Skipped intervals repeat the last sample
+  series.Record(24 * 4 + 5, MakeSample(90, 5));
+  CHECK_EQ(5U, series.size());
+  const int32 minerals[] = { 50, 70, 70, 70, 90 };
+  for (size_t i = 0; i < series.size(); i++) {
+    CHECK_EQ(minerals[i], series.Value(1, Resource::Minerals, i));
+  }
+  CHECK_EQ(90, series.Current(1, Resource::Minerals));
+  CHECK_EQ(5, series.Current(1, Resource::Vespene));
+  CHECK_EQ(0, series.Current(0, Resource::Minerals));
+
+  // Past the end of what was recorded, nothing to drop
+  series.Rewind(24 * 10);
+  CHECK_EQ(5U, series.size());
+  series.Rewind(24 * 2 + 3);
+  CHECK_EQ(2U, series.size());
+  CHECK_EQ(70, series.Current(1, Resource::Minerals));
+  series.Record(24 * 2, MakeSample(100, 0));
+  CHECK_EQ(3U, series.size());
+  CHECK_EQ(100, series.Value(1, Resource::Minerals, 2));
+
+  // Grows past the expected size
+  for (uint32 i = 3; i < 1000; i++) {
+    series.Record(i * 24, MakeSample(static_cast<int32>(i), 0));
+  }
+  CHECK_EQ(1000U, series.size());
+  CHECK_EQ(999, series.Value(1, Resource::Minerals, 999));
+  CHECK_EQ(500, series.Value(1, Resource::Minerals, 500));
+
+  series.Reset();
+  CHECK_EQ(0U, series.size());
+  CHECK_EQ(0, series.Current(1, Resource::Minerals));
+}
+
+// Mines 8 minerals a sample and spends 100 of them every 20th, over 1000 samples of 24 ticks
+ResourceSeries MakeEconomy() {
+  ResourceSeries series(24, 1000);
+  int32 minerals = 50;
+  for (uint32 i = 0; i < 1000; i++) {
+    if (i != 0) {
+      minerals += 8;
+      if (i % 20 == 0) {
+        minerals -= 100;
+      }
+    }
+    series.Record(i * 24, MakeSample(minerals, 0));
+  }
+  return series;
+}
+
+void TestIncomeQueries() {
+  const ResourceSeries series = MakeEconomy();
+  // 999 steps: 950 of +8 and 49 of -92
+  const ResourceFlow flow = series.Flow(1, Resource::Minerals, 0, 1000);
+  CHECK_EQ(950 * 8, flow.gained);
+  CHECK_EQ(49 * 92, flow.spent);
+  CHECK_EQ(999U * 24, flow.ticks);
+  const ResourceFlow part = series.Flow(1, Resource::Minerals, 11, 20);
+  CHECK_EQ(8 * 8, part.gained);
+  CHECK_EQ(0, part.spent);
+  CHECK_EQ(0U, series.Flow(1, Resource::Minerals, 20, 20).ticks);
+  // Clamped to what was recorded
+  CHECK_EQ(9U * 24, series.Flow(1, Resource::Minerals, 990, 5000).ticks);
+
+  // The last 20 steps include one spend, which doesn't count as income
+  const double ticksPerMinute = 60000.0 / 42;
+  const double income = series.IncomePerMinute(1, Resource::Minerals, 20 * 24);
+  CHECK(std::fabs(19 * 8 * ticksPerMinute / (20 * 24) - income) < 1e-6);
+  CHECK_EQ(0, series.IncomePerMinute(0, Resource::Minerals, 20 * 24));
+
+  // A player who never spends floats more and scores lower than one who does
+  ResourceSeries floating(24, 1000);
+  for (uint32 i = 0; i < 1000; i++) {
+    floating.Record(i * 24, MakeSample(50 + static_cast<int32>(i) * 8, 0));
+  }
+  CHECK(floating.SpendingQuotient(1) < series.SpendingQuotient(1));
+  CHECK_EQ(0, ResourceSeries().SpendingQuotient(1));
+
+  // 4 buckets of 250 samples: the averages of a sawtooth going up by 3 a sample
+  int32 chart[4];
+  series.Chart(1, Resource::Minerals, chart, 4);
+  for (size_t i = 1; i < 4; i++) {
+    CHECK(std::abs(chart[i] - chart[i - 1] - 750) <= 10);
+  }
+  // More buckets than samples repeat the last one
+  ResourceSeries tiny(24, 4);
+  tiny.Record(0, MakeSample(10, 0));
+  tiny.Record(24, MakeSample(20, 0));
+  int32 tinyChart[4];
+  tiny.Chart(1, Resource::Minerals, tinyChart, 4);
+  const int32 expected[] = { 10, 10, 20, 20 };
+  for (size_t i = 0; i < 4; i++) {
+    CHECK_EQ(expected[i], tinyChart[i]);
+  }
+}
+
+// A log of a replay that was rewound loads as what was watched last
+void TestLoadFromGameLog() {
+  std::vector<byte> log;
+  apm::GameLogEncoder encoder;
+  apm::GameLogHeader header = apm::GameLogHeader();
+  header.playerNames[1] = "p2";
+  encoder.Begin(header, [&log](std::vector<byte> block) {
+    log.insert(log.end(), block.begin(), block.end());
+  });
+  apm::GameLogSample sample = apm::GameLogSample();
+  for (uint32 i = 0; i < 100; i++) {
+    sample.minerals[1] = static_cast<int32>(i);
+    encoder.AddSample(i * 24, sample);
+  }
+  for (uint32 i = 50; i < 80; i++) {
+    sample.minerals[1] = static_cast<int32>(i) * 2;
+    encoder.AddSample(i * 24, sample);
+  }
+  encoder.End(80 * 24);
+
+  ResourceSeries series(24, 100);
+  CHECK(series.LoadFromGameLog(log.data(), log.size()));
+  CHECK_EQ(80U, series.size());
+  CHECK_EQ(49, series.Value(1, Resource::Minerals, 49));
+  CHECK_EQ(100, series.Value(1, Resource::Minerals, 50));
+  CHECK_EQ(158, series.Current(1, Resource::Minerals));
+
+  CHECK(!series.LoadFromGameLog(log.data(), log.size() / 2));
+  CHECK(series.size() > 0U);
+}
+
+}  // namespace
+
+int main() {
+  RUN_TEST(TestDeltaColumn);
+  RUN_TEST(TestTruncate);
+  RUN_TEST(TestRecordAndRewind);
+  RUN_TEST(TestIncomeQueries);
+  RUN_TEST(TestLoadFromGameLog);
+  return 0;
+}
@@ -0,0 +1,193 @@
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "./game_monitor.h"
+#include "./simulated_brood_war.h"
+#include "./test_util.h"
+#include "./types.h"
+
+using apm::ActionScript;
+using apm::GameMonitor;
+using apm::GameSimulation;
+using apm::SimulatedBroodWar;
+
+namespace {
+
+// Both players act every 14 ticks, which at the fastest game speed is 102 APM
+ActionScript MakeScript(uint32 endTick) {
+  ActionScript script;
+  for (uint32 tick = 0; tick < endTick; tick += 7) {
+    script.Add(tick, static_cast<uint8>(tick % 2), 0x14);
+  }
+  return script;
+}
+
+// Returns the text of the first DrawText call containing all of parts (the color codes between
+// them are skipped), or an empty string if there isn't one
+std::string FindText(const SimulatedBroodWar& sim, const std::vector<std::string>& parts) {
+  for (const apm::DrawTextCall& call : sim.drawTextCalls()) {
+    size_t pos = 0;
+    bool found = true;
+    for (const std::string& part : parts) {
+      pos = call.text.find(part, pos);
+      if (pos == std::string::npos) {
+        found = false;
+        break;
+      }
+      pos += part.size();
+    }
+    if (found) {
+      return call.text;
+    }
+  }
+  return std::string();
+}
+
+void TestActionScript() {
+  ActionScript script;
+  const byte select[] = { 0x09, 0x01, 0x34, 0x12 };
+  script.Add(3, 1, select, sizeof(select));
+  script.Add(3, 2, 0x14);
+  CHECK_EQ(2U, script.size());
+  CHECK_EQ(3U, script[0].tick);
+  CHECK_EQ(1, script[0].player);
+  CHECK_EQ(4U, script[0].length);
+  CHECK_EQ(0x34, script[0].data[2]);
+  CHECK_EQ(2, script[1].player);
+  CHECK_EQ(1U, script[1].length);
+  CHECK_EQ(0x14, script[1].data[0]);
+}
+
+void TestPlayerGame() {
+  SimulatedBroodWar sim;
+  GameMonitor monitor(sim.Create());
+  sim.StartGame({ "a", "b" }, false);
+  ActionScript script = MakeScript(5000);
+  GameSimulation run(&sim, &monitor);
+  run.RunUntil(script, 5000, 4);
+  CHECK_EQ(5000U, run.tick());
+  CHECK_EQ(script.size(), run.nextAction());
+  CHECK(sim.drawTextCount() > 0);
+
+  // One more frame, to look at what it draws
+  sim.ClearCalls();
+  run.RunUntil(script, 5001, 4);
+  CHECK(!FindText(sim, { "APM: ", "102" }).empty());
+  CHECK(!FindText(sim, { "03:29" }).empty());
+  // Only the local player is shown outside of obs mode
+  CHECK(FindText(sim, { "b: " }).empty());
+
+  sim.EndGame();
+  monitor.Update();
+}
+
+void TestReplayShowsEveryPlayer() {
+  SimulatedBroodWar sim;
+  GameMonitor monitor(sim.Create());
+  sim.StartGame({ "a", "b" }, true);
+  ActionScript script = MakeScript(5000);
+  GameSimulation run(&sim, &monitor);
+  run.RunUntil(script, 5000, 4);
+  sim.ClearCalls();
+  run.RunUntil(script, 5001, 4);
+  CHECK(!FindText(sim, { "a: ", "102" }).empty());
+  CHECK(!FindText(sim, { "b: ", "102" }).empty());
+  sim.EndGame();
+  monitor.Update();
+}
+
+void TestNextGameStartsOver() {
+  SimulatedBroodWar sim;
+  GameMonitor monitor(sim.Create());
+  sim.StartGame({ "a", "b" }, false);
+  ActionScript script = MakeScript(5000);
+  {
+    GameSimulation run(&sim, &monitor);
+    run.RunUntil(script, 5000, 4);
+  }
+  sim.EndGame();
+  monitor.Update();
+
+  // A game with no actions at all, which would still show APM if the last game's carried over
+  sim.StartGame({ "a", "b" }, false);
+  GameSimulation run(&sim, &monitor);
+  run.RunUntil(ActionScript(), 2000, 4);
+  sim.ClearCalls();
+  run.RunUntil(ActionScript(), 2001, 4);
+  CHECK(!FindText(sim, { "APM: ", "0" }).empty());
+  CHECK(FindText(sim, { "APM: ", "102" }).empty());
+  sim.EndGame();
+  monitor.Update();
+}
+
+void TestHooksFollowGame() {
+  SimulatedBroodWar sim;
+  GameMonitor monitor(sim.Create());
+  monitor.Update();
+  CHECK(!sim.hooksInjected());
+  sim.StartGame({ "a", "b" }, false);
+  monitor.Update();
+  CHECK(sim.hooksInjected());
+  sim.EndGame();
+  monitor.Update();
+  CHECK(!sim.hooksInjected());
+}
+
+// A Draw that's still running on the game thread when the game ends has to finish before the
+// monitor goes on to tear the game's data down, and one that starts after that has to do nothing
+void TestGameEndWaitsForHookCalls() {
+  SimulatedBroodWar sim;
+  apm::BroodWar bw = sim.Create();
+  // Draw blocks in its first DrawText until released
+  std::atomic<bool> drawing(false);
+  std::atomic<bool> released(false);
+  auto drawText = bw.DrawText;
+  bw.DrawText = [&](uint32 x, uint32 y, const char* text) {
+    drawing = true;
+    while (!released) {
+      std::this_thread::yield();
+    }
+    drawText(x, y, text);
+  };
+  GameMonitor monitor(std::move(bw));
+  sim.StartGame({ "a", "b" }, false);
+  monitor.Update();
+
+  std::thread gameThread([&]() { monitor.Draw(); });
+  while (!drawing) {
+    std::this_thread::yield();
+  }
+  sim.EndGame();
+  std::atomic<bool> ended(false);
+  std::thread monitorThread([&]() {
+    monitor.Update();
+    ended = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  // the hooks are restored right away, but the rest waits for the Draw
+  CHECK(!sim.hooksInjected());
+  CHECK(!ended);
+  released = true;
+  gameThread.join();
+  monitorThread.join();
+  CHECK(ended);
+
+  const uint32 drawn = sim.drawTextCount();
+  monitor.Draw();
+  CHECK_EQ(drawn, sim.drawTextCount());
+}
+
+}  // namespace
+
+int main() {
+  RUN_TEST(TestActionScript);
+  RUN_TEST(TestPlayerGame);
+  RUN_TEST(TestReplayShowsEveryPlayer);
+  RUN_TEST(TestNextGameStartsOver);
+  RUN_TEST(TestHooksFollowGame);
+  RUN_TEST(TestGameEndWaitsForHookCalls);
+  return 0;
+}
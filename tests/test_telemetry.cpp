@@ -0,0 +1,195 @@
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "./profiling.h"
+#include "./telemetry.h"
+#include "./test_util.h"
+#include "./types.h"
+
+using apm::TelemetryReader;
+using apm::TelemetryRecord;
+using apm::TelemetryWriter;
+using std::string;
+using std::unique_ptr;
+
+namespace {
+
+typedef TelemetryReader::Result Result;
+
+// A record whose fields can all be checked against its tick, to catch torn copies
+TelemetryRecord MakeRecord(uint32 tick) {
+  TelemetryRecord record = TelemetryRecord();
+  record.gameTimeTicks = tick;
+  for (size_t i = 0; i < record.apm.size(); i++) {
+    record.apm[i] = static_cast<int32>(tick);
+    record.minerals[i] = static_cast<int32>(tick * 3);
+  }
+  return record;
+}
+
+bool IsIntact(const TelemetryRecord& record) {
+  for (size_t i = 0; i < record.apm.size(); i++) {
+    if (record.apm[i] != static_cast<int32>(record.gameTimeTicks) ||
+        record.minerals[i] != static_cast<int32>(record.gameTimeTicks * 3)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void TestOpenNeedsWriter() {
+  const string name = UniqueName("apm_test_telemetry");
+  CHECK(TelemetryReader::Open(name) == nullptr);
+  {
+    unique_ptr<TelemetryWriter> writer = TelemetryWriter::Create(name, 8);
+    CHECK(writer != nullptr);
+    CHECK(TelemetryReader::Open(name) != nullptr);
+  }
+  CHECK(TelemetryReader::Open(name) == nullptr);
+}
+
+void TestCreateIsExclusive() {
+  const string name = UniqueName("apm_test_telemetry");
+  unique_ptr<TelemetryWriter> writer = TelemetryWriter::Create(name, 8);
+  CHECK(writer != nullptr);
+  CHECK(TelemetryWriter::Create(name, 8) == nullptr);
+  // and the failed attempt didn't take the name away from the first writer
+  CHECK(TelemetryReader::Open(name) != nullptr);
+}
+
+void TestReadsInOrder() {
+  const string name = UniqueName("apm_test_telemetry");
+  unique_ptr<TelemetryWriter> writer = TelemetryWriter::Create(name, 8);
+  unique_ptr<TelemetryReader> reader = TelemetryReader::Open(name);
+  TelemetryRecord record;
+  CHECK(reader->Next(&record) == Result::Empty);
+  for (uint32 tick = 1; tick <= 3; tick++) {
+    writer->Publish(MakeRecord(tick));
+  }
+  for (uint32 tick = 1; tick <= 3; tick++) {
+    CHECK(reader->Next(&record) == Result::Record);
+    CHECK_EQ(tick, record.gameTimeTicks);
+    CHECK(IsIntact(record));
+  }
+  CHECK(reader->Next(&record) == Result::Empty);
+  CHECK_EQ(0U, reader->lostRecords());
+}
+
+void TestLateReaderStartsAtOldest() {
+  const string name = UniqueName("apm_test_telemetry");
+  unique_ptr<TelemetryWriter> writer = TelemetryWriter::Create(name, 8);
+  for (uint32 tick = 1; tick <= 20; tick++) {
+    writer->Publish(MakeRecord(tick));
+  }
+  unique_ptr<TelemetryReader> reader = TelemetryReader::Open(name);
+  TelemetryRecord record;
+  CHECK(reader->Next(&record) == Result::Record);
+  CHECK_EQ(13U, record.gameTimeTicks);
+
+  reader->SkipToLatest();
+  CHECK(reader->Next(&record) == Result::Record);
+  CHECK_EQ(20U, record.gameTimeTicks);
+  CHECK(reader->Next(&record) == Result::Empty);
+}
+
+void TestOverrunSkipsToMiddle() {
+  const string name = UniqueName("apm_test_telemetry");
+  unique_ptr<TelemetryWriter> writer = TelemetryWriter::Create(name, 8);
+  unique_ptr<TelemetryReader> reader = TelemetryReader::Open(name);
+  for (uint32 tick = 1; tick <= 20; tick++) {
+    writer->Publish(MakeRecord(tick));
+  }
+  TelemetryRecord record;
+  CHECK(reader->Next(&record) == Result::Overrun);
+  CHECK_EQ(17U, record.gameTimeTicks);
+  CHECK_EQ(16U, reader->lostRecords());
+  for (uint32 tick = 18; tick <= 20; tick++) {
+    CHECK(reader->Next(&record) == Result::Record);
+    CHECK_EQ(tick, record.gameTimeTicks);
+  }
+  CHECK(reader->Next(&record) == Result::Empty);
+}
+
+void TestProfile() {
+  const string name = UniqueName("apm_test_telemetry");
+  unique_ptr<TelemetryWriter> writer = TelemetryWriter::Create(name, 8);
+  unique_ptr<TelemetryReader> reader = TelemetryReader::Open(name);
+  apm::ProfileSnapshot profile;
+  CHECK(!reader->ReadProfile(&profile));
+
+  apm::ProfileSnapshot published = apm::ProfileSnapshot();
+  published.version = apm::PROFILE_SNAPSHOT_VERSION;
+  published.numProbes = 1;
+  std::strcpy(published.probes[0].name, "probe");
+  published.probes[0].calls = 42;
+  writer->PublishProfile(published);
+  CHECK(reader->ReadProfile(&profile));
+  CHECK_EQ(42U, profile.probes[0].calls);
+  CHECK(std::strcmp(profile.probes[0].name, "probe") == 0);
+
+  published.probes[0].calls = 43;
+  writer->PublishProfile(published);
+  CHECK(reader->ReadProfile(&profile));
+  CHECK_EQ(43U, profile.probes[0].calls);
+}
+
+// Readers racing the writer must only ever see whole records, in order, and account for every
+// record they miss
+void TestConcurrentReadersSeeIntactRecords() {
+  const string name = UniqueName("apm_test_telemetry");
+  const uint32 records = 100000;
+  unique_ptr<TelemetryWriter> writer = TelemetryWriter::Create(name, 64);
+  std::atomic<int> failures(0);
+  // Opened up front, so they start at the first record however late their threads get going
+  std::vector<unique_ptr<TelemetryReader>> readers;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 2; i++) {
+    readers.push_back(TelemetryReader::Open(name));
+    CHECK(readers.back() != nullptr);
+    TelemetryReader* reader = readers.back().get();
+    threads.emplace_back([&failures, reader, records]() {
+      TelemetryRecord record;
+      uint32 last = 0;
+      uint64 read = 0;
+      while (last != records) {
+        Result result = reader->Next(&record);
+        if (result == Result::Empty) {
+          std::this_thread::yield();
+          continue;
+        }
+        if (!IsIntact(record) || record.gameTimeTicks <= last) {
+          failures++;
+        }
+        last = record.gameTimeTicks;
+        read++;
+      }
+      if (read + reader->lostRecords() != records) {
+        failures++;
+      }
+    });
+  }
+  for (uint32 tick = 1; tick <= records; tick++) {
+    writer->Publish(MakeRecord(tick));
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  CHECK_EQ(0, failures.load());
+}
+
+}  // namespace
+
+int main() {
+  RUN_TEST(TestOpenNeedsWriter);
+  RUN_TEST(TestCreateIsExclusive);
+  RUN_TEST(TestReadsInOrder);
+  RUN_TEST(TestLateReaderStartsAtOldest);
+  RUN_TEST(TestOverrunSkipsToMiddle);
+  RUN_TEST(TestProfile);
+  RUN_TEST(TestConcurrentReadersSeeIntactRecords);
+  return 0;
+}
@@ -0,0 +1,79 @@
+#include <cstring>
+#include <string>
+
+#include "./test_util.h"
+#include "./time_format.h"
+#include "./types.h"
+
+using apm::TimeFormat;
+using std::string;
+
+namespace {
+
+string Format(const char* pattern, const char* am, const char* pm, bool dropSeconds, uint32 hours,
+    uint32 minutes, uint32 seconds) {
+  TimeFormat format;
+  CHECK(format.Compile(pattern, am, pm, dropSeconds));
+  char out[128];
+  const size_t length = format.Format(hours, minutes, seconds, out, sizeof(out));
+  CHECK_EQ(std::strlen(out), length);
+  return string(out);
+}
+
+void TestLocaleFormats() {
+  // en-US
+  CHECK_EQ(string("12:05 AM"), Format("h:mm:ss tt", "AM", "PM", true, 0, 5, 9));
+  CHECK_EQ(string("1:05:09 PM"), Format("h:mm:ss tt", "AM", "PM", false, 13, 5, 9));
+  // de-DE
+  CHECK_EQ(string("09:07"), Format("HH:mm:ss", "", "", true, 9, 7, 3));
+  CHECK_EQ(string("9:07"), Format("H:mm:ss", "", "", true, 9, 7, 3));
+  // ko-KR, with its designators in code page 949
+  CHECK_EQ(string("\xBF\xC0\xC8\xC4 3:30"),
+      Format("tt h:mm:ss", "\xBF\xC0\xC0\xFC", "\xBF\xC0\xC8\xC4", true, 15, 30, 0));
+}
+
+void TestQuotedText() {
+  CHECK_EQ(string("8 h 04 min 02 s"), Format("H 'h' mm 'min' ss 's'", "", "", false, 8, 4, 2));
+  CHECK_EQ(string("23h59"), Format("HH'h'mm", "", "", false, 23, 59, 0));
+  // Two quotes in a row are a literal quote
+  CHECK_EQ(string("'01'"), Format("''HH''", "", "", false, 1, 0, 0));
+}
+
+void TestMarkers() {
+  CHECK_EQ(string("12:00 P"), Format("hh:mm t", "AM", "PM", false, 12, 0, 0));
+  CHECK_EQ(string("12:00 AM"), Format("hh:mm tt", "AM", "PM", false, 0, 0, 0));
+  CHECK_EQ(string("11:59 AM"), Format("hh:mm tt", "AM", "PM", false, 11, 59, 0));
+}
+
+void TestElapsedTimes() {
+  CHECK_EQ(string("03:59"), Format("mm:ss", "", "", false, 0, 3, 59));
+  CHECK_EQ(string("125:07"), Format("mm:ss", "", "", false, 0, 125, 7));
+  CHECK_EQ(string("12345:01"), Format("mm:ss", "", "", false, 0, 12345, 1));
+}
+
+void TestTruncation() {
+  TimeFormat format;
+  CHECK(format.Compile("HH:mm:ss", "", "", false));
+  char out[5];
+  CHECK_EQ(4U, format.Format(12, 34, 56, out, sizeof(out)));
+  CHECK_EQ(string("12:3"), string(out));
+}
+
+void TestTooComplex() {
+  TimeFormat format;
+  CHECK(!format.Compile("H:m:s H:m:s H:m:s H:m:s H:m:s", "", "", false));
+  const string longText = "'" + string(100, 'x') + "'";
+  CHECK(!format.Compile(longText.c_str(), "", "", false));
+}
+
+}  // namespace
+
+int main() {
+  RUN_TEST(TestLocaleFormats);
+  RUN_TEST(TestQuotedText);
+  RUN_TEST(TestMarkers);
+  RUN_TEST(TestElapsedTimes);
+  RUN_TEST(TestTruncation);
+  RUN_TEST(TestTooComplex);
+  return 0;
+}
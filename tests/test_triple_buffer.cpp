@@ -0,0 +1,95 @@
+#include <array>
+#include <atomic>
+#include <thread>
+
+#include "./test_util.h"
+#include "./triple_buffer.h"
+#include "./types.h"
+
+using apm::TripleBuffer;
+
+namespace {
+
+// Every value is derived from the sequence number, so a snapshot mixing two publishes shows up
+struct Snapshot {
+  uint32 sequence;
+  std::array<uint32, 64> values;
+};
+
+void Fill(Snapshot* snapshot, uint32 sequence) {
+  snapshot->sequence = sequence;
+  for (uint32 i = 0; i < snapshot->values.size(); i++) {
+    snapshot->values[i] = sequence * 31 + i;
+  }
+}
+
+bool IsConsistent(const Snapshot& snapshot) {
+  for (uint32 i = 0; i < snapshot.values.size(); i++) {
+    if (snapshot.values[i] != snapshot.sequence * 31 + i) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void TestReadsLatest() {
+  TripleBuffer<Snapshot> buffer;
+  Fill(&buffer.back(), 1);
+  buffer.Publish();
+  CHECK_EQ(1U, buffer.Read().sequence);
+  // Nothing new, so the same buffer again
+  CHECK_EQ(1U, buffer.Read().sequence);
+
+  // Only the latest of several publishes is seen
+  for (uint32 i = 2; i <= 5; i++) {
+    Fill(&buffer.back(), i);
+    buffer.Publish();
+  }
+  const Snapshot& latest = buffer.Read();
+  CHECK_EQ(5U, latest.sequence);
+  CHECK(IsConsistent(latest));
+}
+
+// The writer publishes as fast as it can while the reader keeps reading: every snapshot has to be
+// a whole publish, and they have to come in order
+void TestConcurrentReadsAreNeverTorn() {
+  const uint32 PUBLISHES = 200000;
+  TripleBuffer<Snapshot> buffer;
+  Fill(&buffer.back(), 0);
+  buffer.Publish();
+
+  std::thread writer([&]() {
+    for (uint32 i = 1; i <= PUBLISHES; i++) {
+      Fill(&buffer.back(), i);
+      buffer.Publish();
+    }
+  });
+
+  uint32 reads = 0;
+  uint32 torn = 0;
+  uint32 outOfOrder = 0;
+  uint32 last = 0;
+  while (last < PUBLISHES) {
+    const Snapshot& snapshot = buffer.Read();
+    if (!IsConsistent(snapshot)) {
+      torn++;
+    }
+    if (snapshot.sequence < last) {
+      outOfOrder++;
+    }
+    last = snapshot.sequence;
+    reads++;
+  }
+  writer.join();
+  std::printf("  %u reads\n", reads);
+  CHECK_EQ(0U, torn);
+  CHECK_EQ(0U, outOfOrder);
+}
+
+}  // namespace
+
+int main() {
+  RUN_TEST(TestReadsLatest);
+  RUN_TEST(TestConcurrentReadsAreNeverTorn);
+  return 0;
+}
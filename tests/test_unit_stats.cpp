@@ -0,0 +1,188 @@
+#include <array>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "./test_util.h"
+#include "./types.h"
+#include "./unit_stats.h"
+#include "./unit_types.h"
+
+using apm::MAX_UNIT_NODES;
+using apm::PlayerUnitStats;
+using apm::UNIT_NODE_SIZE;
+using apm::UNIT_TYPE_NONE;
+using apm::UnitRole;
+using apm::UnitTableScanner;
+
+namespace {
+
+const uint16 SCV = 7;
+const uint16 MARINE = 0;
+const uint16 COMMAND_CENTER = 106;
+
+// An in-memory copy of BW's unit table
+class UnitTable {
+public:
+  UnitTable()
+    : nodes_(MAX_UNIT_NODES * UNIT_NODE_SIZE) {
+  }
+
+  void Set(size_t index, uint16 type, uint8 player, uint16 producing = UNIT_TYPE_NONE) {
+    byte* node = &nodes_[index * UNIT_NODE_SIZE];
+    const uint32 sprite = 0x00600000 + static_cast<uint32>(index);
+    std::memcpy(node + apm::UNIT_SPRITE_OFFSET, &sprite, sizeof(sprite));
+    std::memcpy(node + apm::UNIT_TYPE_OFFSET, &type, sizeof(type));
+    node[apm::UNIT_PLAYER_OFFSET] = player;
+    std::memcpy(node + apm::UNIT_BUILD_QUEUE_OFFSET, &producing, sizeof(producing));
+  }
+
+  // Frees the node, which BW does by clearing its sprite and leaving the rest as it was
+  void Free(size_t index) {
+    std::memset(&nodes_[index * UNIT_NODE_SIZE + apm::UNIT_SPRITE_OFFSET], 0, 4);
+  }
+
+  // Counts the stats from scratch, to check the scanner's incremental ones against
+  std::array<PlayerUnitStats, 12> Recount() const {
+    std::array<PlayerUnitStats, 12> result = std::array<PlayerUnitStats, 12>();
+    for (size_t i = 0; i < MAX_UNIT_NODES; i++) {
+      const byte* node = &nodes_[i * UNIT_NODE_SIZE];
+      uint32 sprite;
+      uint16 type;
+      uint16 producing;
+      std::memcpy(&sprite, node + apm::UNIT_SPRITE_OFFSET, sizeof(sprite));
+      std::memcpy(&type, node + apm::UNIT_TYPE_OFFSET, sizeof(type));
+      std::memcpy(&producing, node + apm::UNIT_BUILD_QUEUE_OFFSET, sizeof(producing));
+      const uint8 player = node[apm::UNIT_PLAYER_OFFSET];
+      if (sprite == 0 || player >= 12) {
+        continue;
+      }
+      PlayerUnitStats& stats = result[player];
+      const apm::UnitTypeValue& value = apm::GetUnitTypeValue(type);
+      if (value.role == UnitRole::Worker) {
+        stats.workers++;
+      } else if (value.role == UnitRole::Army) {
+        stats.armyUnits++;
+        stats.armyMinerals += value.minerals;
+        stats.armyGas += value.gas;
+      }
+      if (producing != UNIT_TYPE_NONE) {
+        stats.producing++;
+      }
+    }
+    return result;
+  }
+
+  const byte* data() const { return nodes_.data(); }
+
+private:
+  std::vector<byte> nodes_;
+};
+
+void CheckMatchesRecount(const UnitTable& table, const UnitTableScanner& scanner) {
+  const std::array<PlayerUnitStats, 12> expected = table.Recount();
+  for (size_t player = 0; player < 12; player++) {
+    const PlayerUnitStats& stats = scanner.stats(player);
+    CHECK_EQ(expected[player].workers, stats.workers);
+    CHECK_EQ(expected[player].armyUnits, stats.armyUnits);
+    CHECK_EQ(expected[player].armyMinerals, stats.armyMinerals);
+    CHECK_EQ(expected[player].armyGas, stats.armyGas);
+    CHECK_EQ(expected[player].producing, stats.producing);
+  }
+}
+
+void TestUnitTypes() {
+  CHECK(apm::GetUnitTypeValue(SCV).role == UnitRole::Worker);
+  CHECK(apm::GetUnitTypeValue(MARINE).role == UnitRole::Army);
+  CHECK_EQ(50, apm::GetUnitTypeValue(MARINE).minerals);
+  CHECK(apm::GetUnitTypeValue(COMMAND_CENTER).role == UnitRole::Other);
+  CHECK(apm::GetUnitTypeValue(0xFFFF).role == UnitRole::Other);
+  CHECK_EQ(0, apm::GetUnitTypeValue(0xFFFF).minerals);
+  CHECK(apm::GetUnitTypeName(0xFFFF) == nullptr);
+}
+
+void TestCountsUnits() {
+  UnitTable table;
+  table.Set(0, COMMAND_CENTER, 0, SCV);
+  table.Set(1, SCV, 0);
+  table.Set(2, SCV, 0);
+  table.Set(3, MARINE, 1);
+  UnitTableScanner scanner;
+  CHECK(scanner.Scan(table.data()));
+  CHECK_EQ(0U, scanner.dirtyBegin());
+  CHECK_EQ(4U, scanner.dirtyEnd());
+  CHECK_EQ(2U, scanner.stats(0).workers);
+  CHECK_EQ(1U, scanner.stats(0).producing);
+  CHECK_EQ(0U, scanner.stats(0).armyUnits);
+  CHECK_EQ(1U, scanner.stats(1).armyUnits);
+  CHECK_EQ(50U, scanner.stats(1).armyMinerals);
+
+  // Nothing changed
+  CHECK(!scanner.Scan(table.data()));
+  CHECK_EQ(scanner.dirtyBegin(), scanner.dirtyEnd());
+
+  // A marine dies and an SCV changes hands
+  table.Free(3);
+  table.Set(2, SCV, 1);
+  CHECK(scanner.Scan(table.data()));
+  CHECK_EQ(2U, scanner.dirtyBegin());
+  CHECK_EQ(4U, scanner.dirtyEnd());
+  CHECK_EQ(1U, scanner.stats(0).workers);
+  CHECK_EQ(1U, scanner.stats(1).workers);
+  CHECK_EQ(0U, scanner.stats(1).armyUnits);
+  CHECK_EQ(0U, scanner.stats(1).armyMinerals);
+
+  scanner.Reset();
+  CHECK_EQ(0U, scanner.stats(0).workers);
+}
+
+void TestPartialScans() {
+  UnitTable table;
+  table.Set(10, SCV, 2);
+  table.Set(1000, SCV, 2);
+  UnitTableScanner scanner;
+  CHECK(scanner.Scan(table.data(), 500));
+  CHECK_EQ(1U, scanner.stats(2).workers);
+  CHECK(!scanner.Scan(table.data(), 500));
+  CHECK(scanner.Scan(table.data(), 500));
+  CHECK_EQ(2U, scanner.stats(2).workers);
+  // The last scan stops at the end of the table, and the next one starts over
+  CHECK(!scanner.Scan(table.data(), 500));
+  table.Set(20, SCV, 2);
+  CHECK(scanner.Scan(table.data(), 500));
+  CHECK_EQ(20U, scanner.dirtyBegin());
+  CHECK_EQ(3U, scanner.stats(2).workers);
+}
+
+void TestRandomChangesMatchRecount() {
+  const uint16 types[] = { 0, 7, 41, 64, 37, 38, 65, 66, 5, 43, 111, 142, 160, 36, 42 };
+  std::mt19937 rng(7);
+  UnitTable table;
+  UnitTableScanner scanner;
+  for (int round = 0; round < 200; round++) {
+    for (int i = 0; i < 40; i++) {
+      const size_t node = rng() % MAX_UNIT_NODES;
+      if (rng() % 4 == 0) {
+        table.Free(node);
+      } else {
+        table.Set(node, types[rng() % 15], static_cast<uint8>(rng() % 8),
+            rng() % 10 == 0 ? 0 : UNIT_TYPE_NONE);
+      }
+    }
+    scanner.Scan(table.data(), 600);
+  }
+  for (size_t i = 0; i < MAX_UNIT_NODES; i += 600) {
+    scanner.Scan(table.data(), 600);
+  }
+  CheckMatchesRecount(table, scanner);
+}
+
+}  // namespace
+
+int main() {
+  RUN_TEST(TestUnitTypes);
+  RUN_TEST(TestCountsUnits);
+  RUN_TEST(TestPartialScans);
+  RUN_TEST(TestRandomChangesMatchRecount);
+  return 0;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <dirent.h>
+#include <unistd.h>
+#endif
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Just enough to write the portable tests with: a failed check prints where it was and exits
+// non-zero, which is all ctest looks at.
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+      std::exit(1); \
+    } \
+  } while (false)
+
+#define CHECK_EQ(expected, actual) CHECK((expected) == (actual))
+
+// Runs a test function, naming it in the output so a failure can be placed
+#define RUN_TEST(test) \
+  do { \
+    std::printf("%s\n", #test); \
+    test(); \
+  } while (false)
+
+// For reading this process's memory the way a RemoteProcessMemory would read the game's
+inline unsigned int CurrentProcessId() {
+#ifdef _WIN32
+  return GetCurrentProcessId();
+#else
+  return static_cast<unsigned int>(getpid());
+#endif
+}
+
+// Returns prefix with a suffix that's different on every call, for names that live outside the
+// process (shared memory, temporary files) so that concurrent and leftover runs don't collide
+inline std::string UniqueName(const char* prefix) {
+  static int counter = 0;
+  counter++;
+  return prefix + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) +
+      "_" + std::to_string(counter);
+}
+
+// A directory that only exists for the lifetime of this object. Files the test leaves in it are
+// deleted with it (but not subdirectories, none of the tests need them).
+class TempDirectory {
+public:
+  TempDirectory()
+    : path_() {
+#ifdef _WIN32
+    char tempPath[MAX_PATH];
+    GetTempPathA(MAX_PATH, tempPath);
+    path_ = std::string(tempPath) + UniqueName("apm_test_");
+    if (!CreateDirectoryA(path_.c_str(), NULL)) {
+      path_.clear();
+    }
+#else
+    const char* tempPath = std::getenv("TMPDIR");
+    std::string pattern = std::string(tempPath != nullptr ? tempPath : "/tmp") + "/apm_test_XXXXXX";
+    std::vector<char> buffer(pattern.begin(), pattern.end());
+    buffer.push_back('\0');
+    if (mkdtemp(buffer.data()) != nullptr) {
+      path_ = buffer.data();
+    }
+#endif
+    if (path_.empty()) {
+      std::fprintf(stderr, "couldn't create a temporary directory\n");
+      std::exit(1);
+    }
+  }
+
+  ~TempDirectory() {
+#ifdef _WIN32
+    WIN32_FIND_DATAA entry;
+    HANDLE find = FindFirstFileA((path_ + "\\*").c_str(), &entry);
+    if (find != INVALID_HANDLE_VALUE) {
+      do {
+        DeleteFileA((path_ + "\\" + entry.cFileName).c_str());
+      } while (FindNextFileA(find, &entry));
+      FindClose(find);
+    }
+    RemoveDirectoryA(path_.c_str());
+#else
+    DIR* dir = opendir(path_.c_str());
+    if (dir != nullptr) {
+      while (dirent* entry = readdir(dir)) {
+        unlink((path_ + "/" + entry->d_name).c_str());
+      }
+      closedir(dir);
+    }
+    rmdir(path_.c_str());
+#endif
+  }
+
+  const std::string& path() const { return path_; }
+  std::string File(const char* name) const { return path_ + "/" + name; }
+
+private:
+  // Disable copying
+  TempDirectory(const TempDirectory&) = delete;
+  TempDirectory& operator=(const TempDirectory&) = delete;
+
+  std::string path_;
+};
@@ -0,0 +1,88 @@
+#include <vector>
+
+#include "./test_util.h"
+#include "./types.h"
+#include "./varint.h"
+
+using apm::ReadVarint;
+using apm::WriteVarint;
+using std::vector;
+
+namespace {
+
+void TestRoundTrip() {
+  const uint64 values[] = { 0, 1, 0x7F, 0x80, 0x3FFF, 0x4000, 0xFFFFFFFF, 0x100000000ULL,
+      0xFFFFFFFFFFFFFFFFULL };
+  vector<byte> encoded;
+  for (uint64 value : values) {
+    WriteVarint(value, &encoded);
+  }
+  const byte* pos = encoded.data();
+  const byte* end = encoded.data() + encoded.size();
+  for (uint64 value : values) {
+    uint64 decoded = 0;
+    CHECK(ReadVarint(&pos, end, &decoded));
+    CHECK_EQ(value, decoded);
+  }
+  CHECK(pos == end);
+}
+
+void TestEncoding() {
+  vector<byte> encoded;
+  WriteVarint(uint32(0x7F), &encoded);
+  CHECK_EQ(1U, encoded.size());
+  encoded.clear();
+  WriteVarint(uint32(300), &encoded);
+  CHECK_EQ(2U, encoded.size());
+  CHECK_EQ(0xAC, encoded[0]);
+  CHECK_EQ(0x02, encoded[1]);
+
+  // The width of the type written doesn't matter
+  vector<byte> wide;
+  WriteVarint(uint64(300), &wide);
+  CHECK(wide == encoded);
+  const byte* pos = wide.data();
+  uint16 narrow = 0;
+  CHECK(ReadVarint(&pos, wide.data() + wide.size(), &narrow));
+  CHECK_EQ(300, narrow);
+}
+
+void TestTruncated() {
+  vector<byte> encoded;
+  WriteVarint(uint32(0x12345678), &encoded);
+  const byte* pos = encoded.data();
+  uint32 value = 7;
+  CHECK(!ReadVarint(&pos, encoded.data() + encoded.size() - 1, &value));
+  CHECK_EQ(7U, value);
+}
+
+void TestTooWide() {
+  vector<byte> encoded;
+  WriteVarint(uint64(0x100000000ULL), &encoded);
+  const byte* pos = encoded.data();
+  uint32 value = 7;
+  CHECK(!ReadVarint(&pos, encoded.data() + encoded.size(), &value));
+  CHECK_EQ(7U, value);
+
+  // A single byte can only hold 7 bits before it needs a continuation
+  encoded.clear();
+  WriteVarint(uint32(0x80), &encoded);
+  pos = encoded.data();
+  uint8 small = 7;
+  CHECK(ReadVarint(&pos, encoded.data() + encoded.size(), &small));
+  CHECK_EQ(0x80, small);
+  encoded.clear();
+  WriteVarint(uint32(0x100), &encoded);
+  pos = encoded.data();
+  CHECK(!ReadVarint(&pos, encoded.data() + encoded.size(), &small));
+}
+
+}  // namespace
+
+int main() {
+  RUN_TEST(TestRoundTrip);
+  RUN_TEST(TestEncoding);
+  RUN_TEST(TestTruncated);
+  RUN_TEST(TestTooWide);
+  return 0;
+}
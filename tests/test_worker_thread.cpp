@@ -0,0 +1,153 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "./test_util.h"
+#include "./worker_thread.h"
+
+using sbat::WorkerThread;
+using std::chrono::milliseconds;
+
+namespace {
+
+// Counts its wakes, sleeping without a timeout in between so only Wake and Stop can get it going
+class CountingThread : public WorkerThread {
+public:
+  CountingThread()
+    : WorkerThread(),
+      setupCalls(0),
+      wakes(0) {
+  }
+  virtual ~CountingThread() {
+    Stop();
+  }
+
+  std::atomic<int> setupCalls;
+  std::atomic<int> wakes;
+
+protected:
+  virtual void Setup() {
+    setupCalls++;
+  }
+
+  virtual void Execute() {
+    while (WaitForWake()) {
+      wakes++;
+    }
+  }
+};
+
+// Waits up to a few seconds for condition, so a broken wake fails the test rather than hanging it
+template <typename Condition>
+bool WaitFor(Condition condition) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::yield();
+  }
+  return true;
+}
+
+void TestWakeRunsExecute() {
+  CountingThread thread;
+  CHECK(!thread.isStarted());
+  CHECK(thread.isTerminated());
+  thread.Start();
+  CHECK(thread.isStarted());
+  CHECK(!thread.isTerminated());
+  for (int i = 1; i <= 100; i++) {
+    thread.Wake();
+    CHECK(WaitFor([&]() { return thread.wakes == i; }));
+  }
+  CHECK_EQ(1, thread.setupCalls.load());
+}
+
+void TestStopInterruptsUntimedWait() {
+  CountingThread thread;
+  thread.Start();
+  auto start = std::chrono::steady_clock::now();
+  thread.Stop();
+  CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+  CHECK(!thread.isStarted());
+  CHECK(thread.isTerminated());
+  CHECK_EQ(0, thread.wakes.load());
+  // Stopping again is harmless
+  thread.Stop();
+}
+
+void TestStopWithoutStart() {
+  CountingThread thread;
+  thread.Stop();
+  CHECK(!thread.isStarted());
+  CHECK_EQ(0, thread.setupCalls.load());
+}
+
+// Waits with a timeout, recording whether each wait was cut short by a wake
+class TimedThread : public WorkerThread {
+public:
+  TimedThread()
+    : WorkerThread(),
+      timeouts(0),
+      iterations(0) {
+  }
+  virtual ~TimedThread() {
+    Stop();
+  }
+
+  std::atomic<int> timeouts;
+  std::atomic<int> iterations;
+
+protected:
+  virtual void Execute() {
+    for (;;) {
+      auto start = std::chrono::steady_clock::now();
+      if (!WaitForWake(milliseconds(20))) {
+        return;
+      }
+      if (std::chrono::steady_clock::now() - start >= milliseconds(20)) {
+        timeouts++;
+      }
+      iterations++;
+    }
+  }
+};
+
+void TestTimedWaitReturnsOnTimeout() {
+  TimedThread thread;
+  thread.Start();
+  CHECK(WaitFor([&]() { return thread.timeouts >= 2; }));
+  thread.Stop();
+}
+
+void TestPendingWakeIsNotLost() {
+  TimedThread thread;
+  // Woken before it ever waits, so its first wait returns right away
+  thread.Wake();
+  thread.Start();
+  CHECK(WaitFor([&]() { return thread.iterations >= 1; }));
+  thread.Stop();
+  CHECK(thread.iterations > thread.timeouts);
+}
+
+void TestSchedulingHintsDontBreakStart() {
+  CountingThread thread;
+  thread.SetAffinityHint(1);
+  thread.SetPriorityHint(sbat::ThreadPriority::AboveNormal);
+  thread.Start();
+  thread.Wake();
+  CHECK(WaitFor([&]() { return thread.wakes == 1; }));
+}
+
+}  // namespace
+
+int main() {
+  RUN_TEST(TestWakeRunsExecute);
+  RUN_TEST(TestStopInterruptsUntimedWait);
+  RUN_TEST(TestStopWithoutStart);
+  RUN_TEST(TestTimedWaitReturnsOnTimeout);
+  RUN_TEST(TestPendingWakeIsNotLost);
+  RUN_TEST(TestSchedulingHintsDontBreakStart);
+  return 0;
+}
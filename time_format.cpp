@@ -0,0 +1,204 @@
+#include "./time_format.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "./types.h"
+
+namespace apm {
+
+// "00" through "99", so numbers can be emitted two digits at a time without any division by 10
+const char DIGIT_PAIRS[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+TimeFormat::TimeFormat()
+  : ops_(),
+    numOps_(0),
+    text_(),
+    textSize_(0),
+    amOffset_(0),
+    amLength_(0),
+    pmOffset_(0),
+    pmLength_(0) {
+}
+
+bool TimeFormat::AddOp(OpType type, uint8 width) {
+  if (numOps_ == ops_.size()) {
+    return false;
+  }
+  Op& op = ops_[numOps_];
+  op.type = type;
+  op.width = width;
+  op.offset = 0;
+  op.length = 0;
+  numOps_++;
+  return true;
+}
+
+bool TimeFormat::AddText(const char* text, size_t length, uint8* offset) {
+  if (length > text_.size() - textSize_) {
+    return false;
+  }
+  std::copy(text, text + length, text_.begin() + textSize_);
+  *offset = static_cast<uint8>(textSize_);
+  textSize_ += length;
+  return true;
+}
+
+bool TimeFormat::AddLiteral(const char* text, size_t length) {
+  if (length == 0) {
+    return true;
+  }
+  uint8 offset;
+  if (!AddText(text, length, &offset) || !AddOp(OpType::Literal, 0)) {
+    return false;
+  }
+  ops_[numOps_ - 1].offset = offset;
+  ops_[numOps_ - 1].length = static_cast<uint8>(length);
+  return true;
+}
+
+bool IsFormatChar(char c) {
+  return c == 'h' || c == 'H' || c == 'm' || c == 's' || c == 't' || c == '\'';
+}
+
+bool TimeFormat::Compile(const char* pattern, const char* amDesignator,
+    const char* pmDesignator, bool dropSeconds) {
+  numOps_ = 0;
+  textSize_ = 0;
+  const size_t amLength = strlen(amDesignator);
+  const size_t pmLength = strlen(pmDesignator);
+  if (!AddText(amDesignator, amLength, &amOffset_) ||
+      !AddText(pmDesignator, pmLength, &pmOffset_)) {
+    return false;
+  }
+  amLength_ = static_cast<uint8>(amLength);
+  pmLength_ = static_cast<uint8>(pmLength);
+
+  const char* pos = pattern;
+  while (*pos != '\0') {
+    const char c = *pos;
+    if (c == '\'') {
+      // Quoted text, with '' being a literal quote
+      const char* start = ++pos;
+      while (*pos != '\0' && *pos != '\'') {
+        pos++;
+      }
+      if (pos == start && *pos == '\'') {
+        start--;
+      }
+      if (!AddLiteral(start, pos - start)) {
+        return false;
+      }
+      if (*pos != '\0') {
+        pos++;
+      }
+      continue;
+    } else if (!IsFormatChar(c)) {
+      const char* start = pos;
+      while (*pos != '\0' && !IsFormatChar(*pos)) {
+        pos++;
+      }
+      if (!AddLiteral(start, pos - start)) {
+        return false;
+      }
+      continue;
+    }
+
+    size_t count = 0;
+    while (*pos == c) {
+      count++;
+      pos++;
+    }
+    const uint8 width = count >= 2 ? 2 : 1;
+    bool added = true;
+    switch (c) {
+      case 'h': added = AddOp(OpType::Hour12, width); break;
+      case 'H': added = AddOp(OpType::Hour24, width); break;
+      case 'm': added = AddOp(OpType::Minute, width); break;
+      case 's':
+        if (!dropSeconds) {
+          added = AddOp(OpType::Second, width);
+        } else if (numOps_ > 0 && ops_[numOps_ - 1].type == OpType::Literal) {
+          numOps_--;
+        }
+        break;
+      case 't': added = AddOp(OpType::TimeMarker, count >= 2 ? FULL_MARKER : 1); break;
+    }
+    if (!added) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void AppendText(const char* text, size_t length, char** pos, char* end) {
+  length = std::min(length, static_cast<size_t>(end - *pos));
+  std::copy(text, text + length, *pos);
+  *pos += length;
+}
+
+void AppendNumber(uint32 value, uint8 minDigits, char** pos, char* end) {
+  // Filled in from the back, 2 digits at a time
+  char digits[10];
+  char* start = digits + sizeof(digits);
+  while (value >= 100) {
+    const char* pair = DIGIT_PAIRS + (value % 100) * 2;
+    value /= 100;
+    *--start = pair[1];
+    *--start = pair[0];
+  }
+  const char* pair = DIGIT_PAIRS + value * 2;
+  *--start = pair[1];
+  if (value >= 10 || (minDigits >= 2 && start == digits + sizeof(digits) - 1)) {
+    *--start = pair[0];
+  }
+  AppendText(start, digits + sizeof(digits) - start, pos, end);
+}
+
+size_t TimeFormat::Format(uint32 hours, uint32 minutes, uint32 seconds, char* out,
+    size_t size) const {
+  if (size == 0) {
+    return 0;
+  }
+
+  char* pos = out;
+  char* end = out + size - 1;
+  for (size_t i = 0; i < numOps_; i++) {
+    const Op& op = ops_[i];
+    switch (op.type) {
+      case OpType::Literal:
+        AppendText(text_.data() + op.offset, op.length, &pos, end);
+        break;
+      case OpType::Hour12:
+        AppendNumber(hours % 12 == 0 ? 12 : hours % 12, op.width, &pos, end);
+        break;
+      case OpType::Hour24:
+        AppendNumber(hours, op.width, &pos, end);
+        break;
+      case OpType::Minute:
+        AppendNumber(minutes, op.width, &pos, end);
+        break;
+      case OpType::Second:
+        AppendNumber(seconds, op.width, &pos, end);
+        break;
+      case OpType::TimeMarker: {
+        const bool pm = hours % 24 >= 12;
+        const uint8 length = pm ? pmLength_ : amLength_;
+        AppendText(text_.data() + (pm ? pmOffset_ : amOffset_),
+            op.width == FULL_MARKER ? length : std::min<uint8>(length, 1), &pos, end);
+        break;
+      }
+    }
+  }
+
+  *pos = '\0';
+  return pos - out;
+}
+
+}  // namespace apm
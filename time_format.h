@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "./types.h"
+
+namespace apm {
+
+// A time format picture (as used by Windows' GetTimeFormatEx, e.g. "h:mm tt" or "HH:mm:ss")
+// compiled down to a list of ops, so that formatting a time is just copying literals and emitting
+// digits, without any locale lookups or OS calls.
+//
+// Supported elements are h/hh (12 hour), H/HH (24 hour), m/mm, s/ss, t/tt (AM/PM designator, 1
+// character or in full) and text in single quotes. Anything else is copied as is.
+class TimeFormat {
+public:
+  TimeFormat();
+
+  // Compiles pattern, returning false if it's too long or complex to fit. amDesignator and
+  // pmDesignator are what t/tt expand to. If dropSeconds is set, seconds are left out along with
+  // the separator before them (like GetTimeFormatEx's TIME_NOSECONDS).
+  bool Compile(const char* pattern, const char* amDesignator, const char* pmDesignator,
+      bool dropSeconds);
+
+  // Writes the formatted time to out (NUL terminated, truncated to fit), returning its length.
+  // Hours and minutes aren't wrapped, so elapsed times (e.g. "mm:ss" with minutes > 59) work too.
+  size_t Format(uint32 hours, uint32 minutes, uint32 seconds, char* out, size_t size) const;
+
+private:
+  enum class OpType : uint8 {
+    Literal,
+    Hour12,
+    Hour24,
+    Minute,
+    Second,
+    TimeMarker,
+  };
+
+  struct Op {
+    OpType type;
+    // Minimum number of digits for numbers, length of the marker (1 or full) for TimeMarker
+    uint8 width;
+    // Location of the text in text_ for Literals
+    uint8 offset;
+    uint8 length;
+  };
+
+  static const size_t MAX_OPS = 16;
+  static const size_t MAX_TEXT = 64;
+  static const uint8 FULL_MARKER = 0xFF;
+
+  bool AddOp(OpType type, uint8 width);
+  bool AddLiteral(const char* text, size_t length);
+  bool AddText(const char* text, size_t length, uint8* offset);
+
+  std::array<Op, MAX_OPS> ops_;
+  size_t numOps_;
+  // Literals and the AM/PM designators
+  std::array<char, MAX_TEXT> text_;
+  size_t textSize_;
+  uint8 amOffset_;
+  uint8 amLength_;
+  uint8 pmOffset_;
+  uint8 pmLength_;
+};
+
+}  // namespace apm
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+#include "./types.h"
+
+namespace apm {
+
+// Lock-free handoff of the latest value of T from a single writer thread to a single reader
+// thread. Each side owns one of three buffers at all times and they trade through the third, so
+// neither side ever touches a buffer the other is using and reads never see a partially written
+// value. The reader always gets the most recently published value (older ones may be skipped).
+template <typename T>
+class TripleBuffer {
+public:
+  TripleBuffer()
+    : buffers_(),
+      back_(0),
+      middle_(1),
+      front_(2) {
+  }
+
+  // Writer side: fill in the back buffer, then Publish it. The back buffer holds stale data from an
+  // earlier publish, so it should be completely rewritten each time.
+  T& back() { return buffers_[back_]; }
+  void Publish() {
+    back_ = middle_.exchange(back_ | DIRTY, std::memory_order_acq_rel) & INDEX_MASK;
+  }
+
+  // Reader side: returns the latest published value, which stays valid until the next Read
+  const T& Read() {
+    if (middle_.load(std::memory_order_relaxed) & DIRTY) {
+      front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+    return buffers_[front_];
+  }
+
+private:
+  // Disable copying
+  TripleBuffer(const TripleBuffer&) = delete;
+  TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+  static const uint32 INDEX_MASK = 0x3;
+  static const uint32 DIRTY = 0x4;
+
+  std::array<T, 3> buffers_;
+  // Each side's index lives on its own cache line so they don't contend with each other
+  alignas(64) uint32 back_;
+  alignas(64) std::atomic<uint32> middle_;
+  alignas(64) uint32 front_;
+};
+
+}  // namespace apm
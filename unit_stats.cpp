@@ -0,0 +1,94 @@
+#include "./unit_stats.h"
+
+#include <string.h>
+#include <algorithm>
+#include <array>
+
+#include "./types.h"
+#include "./unit_types.h"
+
+namespace apm {
+
+UnitTableScanner::UnitTableScanner()
+  : types_(),
+    producing_(),
+    players_(),
+    stats_(),
+    cursor_(0),
+    dirtyBegin_(0),
+    dirtyEnd_(0) {
+  Reset();
+}
+
+void UnitTableScanner::Reset() {
+  types_.fill(UNIT_TYPE_NONE);
+  producing_.fill(UNIT_TYPE_NONE);
+  players_.fill(0);
+  stats_.fill(PlayerUnitStats());
+  cursor_ = 0;
+  dirtyBegin_ = 0;
+  dirtyEnd_ = 0;
+}
+
+template <typename T>
+inline T ReadField(const byte* node, size_t offset) {
+  T value;
+  memcpy(&value, node + offset, sizeof(value));
+  return value;
+}
+
+void UnitTableScanner::Count(size_t node, int32 sign) {
+  const uint8 player = players_[node];
+  if (types_[node] == UNIT_TYPE_NONE || player >= stats_.size()) {
+    return;
+  }
+
+  PlayerUnitStats& stats = stats_[player];
+  const UnitTypeValue& value = GetUnitTypeValue(types_[node]);
+  if (value.role == UnitRole::Worker) {
+    stats.workers += sign;
+  } else if (value.role == UnitRole::Army) {
+    stats.armyUnits += sign;
+    stats.armyMinerals += sign * value.minerals;
+    stats.armyGas += sign * value.gas;
+  }
+  if (producing_[node] != UNIT_TYPE_NONE) {
+    stats.producing += sign;
+  }
+}
+
+bool UnitTableScanner::Scan(const byte* nodes, size_t count) {
+  const size_t begin = cursor_;
+  const size_t end = std::min(begin + count, MAX_UNIT_NODES);
+  cursor_ = end == MAX_UNIT_NODES ? 0 : end;
+  dirtyBegin_ = end;
+  dirtyEnd_ = begin;
+  const byte* node = nodes + begin * UNIT_NODE_SIZE;
+  for (size_t i = begin; i < end; i++, node += UNIT_NODE_SIZE) {
+    const bool inUse = ReadField<uint32>(node, UNIT_SPRITE_OFFSET) != 0;
+    const uint16 type = inUse ? ReadField<uint16>(node, UNIT_TYPE_OFFSET) : UNIT_TYPE_NONE;
+    const uint16 producing =
+        inUse ? ReadField<uint16>(node, UNIT_BUILD_QUEUE_OFFSET) : UNIT_TYPE_NONE;
+    const uint8 player = inUse ? ReadField<uint8>(node, UNIT_PLAYER_OFFSET) : 0;
+    if (type == types_[i] && producing == producing_[i] && player == players_[i]) {
+      continue;
+    }
+
+    Count(i, -1);
+    types_[i] = type;
+    producing_[i] = producing;
+    players_[i] = player;
+    Count(i, 1);
+    dirtyBegin_ = std::min(dirtyBegin_, i);
+    dirtyEnd_ = i + 1;
+  }
+
+  if (dirtyEnd_ <= dirtyBegin_) {
+    dirtyBegin_ = 0;
+    dirtyEnd_ = 0;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace apm
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "./types.h"
+#include "./unit_types.h"
+
+namespace apm {
+
+struct PlayerUnitStats {
+  uint32 workers;
+  uint32 armyUnits;
+  // Total cost of the army units
+  uint32 armyMinerals;
+  uint32 armyGas;
+  // Units/buildings with something in their build queue (including eggs, and workers that are
+  // constructing)
+  uint32 producing;
+};
+
+// Keeps per-player unit stats up to date by scanning BW's unit table. The fields that matter are
+// gathered into a structure-of-arrays copy of the table, and only nodes whose fields differ from
+// that copy touch the aggregates (by taking out their old contribution and adding the new one),
+// so a scan is a single linear pass that mostly just compares. Scans can also cover the table a
+// range of nodes at a time, to bound the work done per call when the table isn't in cache.
+class UnitTableScanner {
+public:
+  UnitTableScanner();
+
+  void Reset();
+  // Scans up to count nodes of nodes (which must point to MAX_UNIT_NODES nodes of UNIT_NODE_SIZE
+  // bytes each), continuing from where the last scan stopped, or from the start of the table if it
+  // reached the end. Returns true if any of them changed since they were last scanned.
+  bool Scan(const byte* nodes, size_t count = MAX_UNIT_NODES);
+
+  const PlayerUnitStats& stats(size_t player) const { return stats_[player]; }
+  // Range of node indexes [begin, end) that changed in the last scan, empty if none did
+  size_t dirtyBegin() const { return dirtyBegin_; }
+  size_t dirtyEnd() const { return dirtyEnd_; }
+
+private:
+  void Count(size_t node, int32 sign);
+
+  std::array<uint16, MAX_UNIT_NODES> types_;
+  std::array<uint16, MAX_UNIT_NODES> producing_;
+  std::array<uint8, MAX_UNIT_NODES> players_;
+  std::array<PlayerUnitStats, 12> stats_;
+  // Node the next scan starts at
+  size_t cursor_;
+  size_t dirtyBegin_;
+  size_t dirtyEnd_;
+};
+
+}  // namespace apm
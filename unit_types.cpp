@@ -0,0 +1,185 @@
+#include "./unit_types.h"
+
+#include <array>
+
+#include "./types.h"
+
+namespace apm {
+
+namespace {
+
+std::array<const char*, UNIT_TYPE_NONE> CreateUnitTypeNames() {
+  std::array<const char*, UNIT_TYPE_NONE> names = std::array<const char*, UNIT_TYPE_NONE>();
+  // Terran
+  names[0] = "Marine";
+  names[1] = "Ghost";
+  names[2] = "Vulture";
+  names[3] = "Goliath";
+  names[5] = "Siege Tank";
+  names[7] = "SCV";
+  names[8] = "Wraith";
+  names[9] = "Science Vessel";
+  names[11] = "Dropship";
+  names[12] = "Battlecruiser";
+  names[14] = "Nuclear Missile";
+  names[32] = "Firebat";
+  names[34] = "Medic";
+  names[58] = "Valkyrie";
+  names[106] = "Command Center";
+  names[107] = "Comsat Station";
+  names[108] = "Nuclear Silo";
+  names[109] = "Supply Depot";
+  names[110] = "Refinery";
+  names[111] = "Barracks";
+  names[112] = "Academy";
+  names[113] = "Factory";
+  names[114] = "Starport";
+  names[115] = "Control Tower";
+  names[116] = "Science Facility";
+  names[117] = "Covert Ops";
+  names[118] = "Physics Lab";
+  names[120] = "Machine Shop";
+  names[122] = "Engineering Bay";
+  names[123] = "Armory";
+  names[124] = "Missile Turret";
+  names[125] = "Bunker";
+  // Zerg
+  names[35] = "Larva";
+  names[36] = "Egg";
+  names[37] = "Zergling";
+  names[38] = "Hydralisk";
+  names[39] = "Ultralisk";
+  names[41] = "Drone";
+  names[42] = "Overlord";
+  names[43] = "Mutalisk";
+  names[44] = "Guardian";
+  names[45] = "Queen";
+  names[46] = "Defiler";
+  names[47] = "Scourge";
+  names[50] = "Infested Terran";
+  names[62] = "Devourer";
+  names[103] = "Lurker";
+  names[131] = "Hatchery";
+  names[132] = "Lair";
+  names[133] = "Hive";
+  names[134] = "Nydus Canal";
+  names[135] = "Hydralisk Den";
+  names[136] = "Defiler Mound";
+  names[137] = "Greater Spire";
+  names[138] = "Queen's Nest";
+  names[139] = "Evolution Chamber";
+  names[140] = "Ultralisk Cavern";
+  names[141] = "Spire";
+  names[142] = "Spawning Pool";
+  names[143] = "Creep Colony";
+  names[144] = "Spore Colony";
+  names[146] = "Sunken Colony";
+  names[149] = "Extractor";
+  // Protoss
+  names[60] = "Corsair";
+  names[61] = "Dark Templar";
+  names[63] = "Dark Archon";
+  names[64] = "Probe";
+  names[65] = "Zealot";
+  names[66] = "Dragoon";
+  names[67] = "High Templar";
+  names[68] = "Archon";
+  names[69] = "Shuttle";
+  names[70] = "Scout";
+  names[71] = "Arbiter";
+  names[72] = "Carrier";
+  names[73] = "Interceptor";
+  names[83] = "Reaver";
+  names[84] = "Observer";
+  names[85] = "Scarab";
+  names[154] = "Nexus";
+  names[155] = "Robotics Facility";
+  names[156] = "Pylon";
+  names[157] = "Assimilator";
+  names[159] = "Observatory";
+  names[160] = "Gateway";
+  names[162] = "Photon Cannon";
+  names[163] = "Citadel of Adun";
+  names[164] = "Cybernetics Core";
+  names[165] = "Templar Archives";
+  names[166] = "Forge";
+  names[167] = "Stargate";
+  names[169] = "Fleet Beacon";
+  names[170] = "Arbiter Tribunal";
+  names[171] = "Robotics Support Bay";
+  names[172] = "Shield Battery";
+  return names;
+}
+
+const std::array<const char*, UNIT_TYPE_NONE> UNIT_TYPE_NAMES = CreateUnitTypeNames();
+
+std::array<UnitTypeValue, UNIT_TYPE_NONE + 1> CreateUnitTypeValues() {
+  std::array<UnitTypeValue, UNIT_TYPE_NONE + 1> values =
+      std::array<UnitTypeValue, UNIT_TYPE_NONE + 1>();
+  const UnitTypeValue worker = { UnitRole::Worker, 50, 0 };
+  values[7] = worker;  // SCV
+  values[41] = worker;  // Drone
+  values[64] = worker;  // Probe
+
+  auto army = [&values](uint16 type, uint16 minerals, uint16 gas) {
+    values[type].role = UnitRole::Army;
+    values[type].minerals = minerals;
+    values[type].gas = gas;
+  };
+  // Terran
+  army(0, 50, 0);  // Marine
+  army(1, 25, 75);  // Ghost
+  army(2, 75, 0);  // Vulture
+  army(3, 100, 50);  // Goliath
+  army(5, 150, 100);  // Siege Tank (tank mode)
+  army(8, 150, 100);  // Wraith
+  army(9, 100, 225);  // Science Vessel
+  army(11, 100, 100);  // Dropship
+  army(12, 400, 300);  // Battlecruiser
+  army(30, 150, 100);  // Siege Tank (siege mode)
+  army(32, 50, 25);  // Firebat
+  army(34, 50, 25);  // Medic
+  army(58, 250, 125);  // Valkyrie
+  // Zerg
+  army(37, 25, 0);  // Zergling
+  army(38, 75, 25);  // Hydralisk
+  army(39, 200, 200);  // Ultralisk
+  army(43, 100, 100);  // Mutalisk
+  army(44, 150, 200);  // Guardian
+  army(45, 100, 100);  // Queen
+  army(46, 50, 150);  // Defiler
+  army(47, 12, 37);  // Scourge
+  army(50, 100, 50);  // Infested Terran
+  army(62, 150, 250);  // Devourer
+  army(103, 125, 125);  // Lurker
+  // Protoss
+  army(60, 150, 100);  // Corsair
+  army(61, 125, 100);  // Dark Templar
+  army(63, 250, 200);  // Dark Archon
+  army(65, 100, 0);  // Zealot
+  army(66, 125, 50);  // Dragoon
+  army(67, 50, 150);  // High Templar
+  army(68, 100, 300);  // Archon
+  army(69, 200, 0);  // Shuttle
+  army(70, 275, 125);  // Scout
+  army(71, 100, 350);  // Arbiter
+  army(72, 250, 150);  // Carrier
+  army(83, 200, 100);  // Reaver
+  army(84, 25, 75);  // Observer
+  return values;
+}
+
+// One extra entry, so that UNIT_TYPE_NONE (which empty unit slots have) can be looked up as well
+const std::array<UnitTypeValue, UNIT_TYPE_NONE + 1> UNIT_TYPE_VALUES = CreateUnitTypeValues();
+
+}  // namespace
+
+const char* GetUnitTypeName(uint16 unitType) {
+  return unitType < UNIT_TYPE_NAMES.size() ? UNIT_TYPE_NAMES[unitType] : nullptr;
+}
+
+const UnitTypeValue& GetUnitTypeValue(uint16 unitType) {
+  return UNIT_TYPE_VALUES[unitType < UNIT_TYPE_VALUES.size() ? unitType : UNIT_TYPE_NONE];
+}
+
+}  // namespace apm
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+
+#include "./types.h"
+
+namespace apm {
+
+const uint16 UNIT_TYPE_NONE = 228;
+
+// BW's unit table is a fixed array of unit nodes (CUnit), of which only a few fields are read.
+// Nodes that aren't in use have a null sprite.
+const size_t MAX_UNIT_NODES = 1700;
+const size_t UNIT_NODE_SIZE = 336;
+const size_t UNIT_SPRITE_OFFSET = 0x0C;
+const size_t UNIT_PLAYER_OFFSET = 0x4C;
+const size_t UNIT_TYPE_OFFSET = 0x64;
+// 5 unit types (UNIT_TYPE_NONE if unused), the first of which is being built/trained/morphed
+const size_t UNIT_BUILD_QUEUE_OFFSET = 0x98;
+
+// Returns the display name of a unit type, or nullptr for types we don't have a name for (mostly
+// critters, heroes, and other unit types that don't come up in ladder games)
+const char* GetUnitTypeName(uint16 unitType);
+
+enum class UnitRole : uint8 {
+  // Buildings, critters, resources, spell effects, larvae and anything else that isn't counted
+  Other = 0,
+  Worker,
+  // Combat and support units. Overlords are left out, since they're closer to supply depots.
+  Army,
+};
+
+struct UnitTypeValue {
+  UnitRole role;
+  // Cost of the unit, including what it was morphed or merged from. Units that come in pairs
+  // (zerglings, scourge) are counted at half the pair's cost.
+  uint16 minerals;
+  uint16 gas;
+};
+
+// Returns how a unit type counts towards a player's army and workers. Out of range types are
+// Other with no cost.
+const UnitTypeValue& GetUnitTypeValue(uint16 unitType);
+
+}  // namespace apm
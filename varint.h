@@ -0,0 +1,46 @@
+#pragma once
+
+#include <type_traits>
+
+#include "./types.h"
+
+namespace apm {
+
+// LEB128 varints, as used by the game log and ApmTracker's journal: 7 bits per byte, least
+// significant group first, with the high bit set on every byte but the last. The encoding doesn't
+// depend on the width of the type written, so a value can be read back into any type it fits in.
+
+// Appends value to out, which can be any container of bytes
+template <typename T, typename Container>
+inline void WriteVarint(T value, Container* out) {
+  static_assert(std::is_unsigned<T>::value, "varints are unsigned, zigzag encode signed values");
+  while (value >= 0x80) {
+    out->push_back(static_cast<byte>(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<byte>(value));
+}
+
+// Reads a varint from [*pos, end) into value, advancing *pos past it. Returns false (leaving value
+// alone) if it runs past end or its value doesn't fit in a T.
+template <typename T>
+inline bool ReadVarint(const byte** pos, const byte* end, T* value) {
+  static_assert(std::is_unsigned<T>::value, "varints are unsigned, zigzag encode signed values");
+  const uint32 bits = sizeof(T) * 8;
+  T result = 0;
+  for (uint32 shift = 0; shift < bits && *pos < end; shift += 7) {
+    const byte b = *(*pos)++;
+    // The last group that fits may only use the bits T has left
+    if (bits - shift < 7 && ((b & 0x7F) >> (bits - shift)) != 0) {
+      return false;
+    }
+    result |= static_cast<T>(b & 0x7F) << shift;
+    if ((b & 0x80) == 0) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace apm
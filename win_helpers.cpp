@@ -3,7 +3,6 @@
 #include <Windows.h>
 #include <assert.h>
 #include <dbghelp.h>
-#include <process.h>
 #include <UserEnv.h>
 #include <algorithm>
 #include <iterator>
@@ -112,52 +111,6 @@ string WindowsError::message() const {
   }
 }
 
-WindowsThread::WindowsThread()
-  : handle_(INVALID_HANDLE_VALUE),
-    threadId_(0),
-    started_(false),
-    terminated_(true) {
-}
-
-WindowsThread::~WindowsThread() {
-}
-
-void WindowsThread::Start() {
-  if (started_ || handle_ != INVALID_HANDLE_VALUE) {
-    return;
-  }
-
-  uint32 threadId;
-  handle_ = reinterpret_cast<HANDLE>(
-    _beginthreadex(NULL, 0, WindowsThread::ThreadProc, this, 0, &threadId));
-  threadId_ = threadId;
-}
-
-void WindowsThread::Terminate() {
-  terminated_ = true;
-}
-
-void WindowsThread::Run() {
-  assert(!started_);
-  assert(terminated_);
-  Setup();
-  started_ = true;
-  terminated_ = false;
-
-  Execute();
-
-  started_ = false;
-  terminated_ = true;
-  handle_ = INVALID_HANDLE_VALUE;
-  threadId_ = 0;
-}
-
-unsigned __stdcall WindowsThread::ThreadProc(void* arg) {
-  WindowsThread* thread = reinterpret_cast<WindowsThread*>(arg);
-  thread->Run();
-  return 1;
-}
-
 struct InjectContext {
   wchar_t dllPath[MAX_PATH];
   char injectProcName[256];
@@ -0,0 +1,127 @@
+#include "./worker_thread.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include <assert.h>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "./types.h"
+
+namespace sbat {
+
+WorkerThread::WorkerThread()
+  : thread_(),
+    wakeMutex_(),
+    wakeCondition_(),
+    wakePending_(false),
+    started_(false),
+    terminated_(true),
+    affinityMask_(0),
+    priority_(ThreadPriority::Normal) {
+}
+
+WorkerThread::~WorkerThread() {
+  // Subclasses should have done this already (see the class comment), this only catches threads
+  // that were never stopped
+  Stop();
+}
+
+void WorkerThread::Start() {
+  if (started_ || thread_.joinable()) {
+    return;
+  }
+
+  terminated_ = false;
+  started_ = true;
+  thread_ = std::thread(&WorkerThread::Run, this);
+}
+
+void WorkerThread::Stop() {
+  terminated_ = true;
+  Wake();
+
+  if (thread_.joinable()) {
+    if (thread_.get_id() == std::this_thread::get_id()) {
+      // Stopping from inside Execute, it will return on its own
+      thread_.detach();
+    } else {
+      thread_.join();
+    }
+  }
+  started_ = false;
+}
+
+void WorkerThread::Wake() {
+  {
+    std::lock_guard<std::mutex> lock(wakeMutex_);
+    wakePending_ = true;
+  }
+  wakeCondition_.notify_one();
+}
+
+bool WorkerThread::WaitForWake(std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(wakeMutex_);
+  wakeCondition_.wait_for(lock, timeout, [this]() { return wakePending_ || terminated_; });
+  wakePending_ = false;
+  return !terminated_;
+}
+
+bool WorkerThread::WaitForWake() {
+  std::unique_lock<std::mutex> lock(wakeMutex_);
+  wakeCondition_.wait(lock, [this]() { return wakePending_ || terminated_; });
+  wakePending_ = false;
+  return !terminated_;
+}
+
+void WorkerThread::Run() {
+  ApplySchedulingHints();
+  Setup();
+  Execute();
+}
+
+void WorkerThread::ApplySchedulingHints() {
+#ifdef _WIN32
+  if (affinityMask_ != 0) {
+    SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(affinityMask_));
+  }
+  static const int priorities[] = {
+    THREAD_PRIORITY_LOWEST,
+    THREAD_PRIORITY_BELOW_NORMAL,
+    THREAD_PRIORITY_NORMAL,
+    THREAD_PRIORITY_ABOVE_NORMAL,
+    THREAD_PRIORITY_HIGHEST
+  };
+  if (priority_ != ThreadPriority::Normal) {
+    SetThreadPriority(GetCurrentThread(), priorities[static_cast<int>(priority_)]);
+  }
+#else
+  if (affinityMask_ != 0) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int i = 0; i < 64 && i < CPU_SETSIZE; i++) {
+      if (affinityMask_ & (1ULL << i)) {
+        CPU_SET(i, &cpus);
+      }
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+  }
+  // Linux applies nice values per thread. Raising priority generally needs privileges, in which
+  // case this silently does nothing.
+  static const int niceValues[] = { 10, 5, 0, -5, -10 };
+  if (priority_ != ThreadPriority::Normal) {
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)),
+        niceValues[static_cast<int>(priority_)]);
+  }
+#endif
+}
+
+}  // namespace sbat
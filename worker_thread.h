@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "./types.h"
+
+namespace sbat {
+
+enum class ThreadPriority {
+  Lowest = 0,
+  BelowNormal,
+  Normal,
+  AboveNormal,
+  Highest
+};
+
+// Portable base for long running worker threads. Subclasses implement Execute, sleeping between
+// units of work with WaitForWake, which returns as soon as Wake or Stop is called. Stop wakes the
+// thread and joins it, so shutdown is prompt and deterministic. Subclasses must call Stop in their
+// destructor, since Execute may otherwise still be running while their members are destroyed.
+class WorkerThread {
+public:
+  WorkerThread();
+  virtual ~WorkerThread();
+
+  bool isStarted() const { return started_; }
+  bool isTerminated() const { return terminated_; }
+
+  void Start();
+  // Requests termination and waits for Execute to return. Safe to call more than once.
+  void Stop();
+  // Wakes the thread if it is in WaitForWake, or makes its next WaitForWake return immediately
+  void Wake();
+
+  // Scheduling hints, applied by the thread itself when it starts. Failures to apply them are
+  // ignored, they're only hints.
+  void SetAffinityHint(uint64 cpuMask) { affinityMask_ = cpuMask; }
+  void SetPriorityHint(ThreadPriority priority) { priority_ = priority; }
+
+protected:
+  virtual void Setup() {}
+  virtual void Execute() = 0;
+
+  // Blocks until woken or the timeout passes. Returns false if the thread has been asked to stop.
+  bool WaitForWake(std::chrono::milliseconds timeout);
+  bool WaitForWake();
+
+private:
+  // Disable copying
+  WorkerThread(const WorkerThread&) = delete;
+  WorkerThread& operator=(const WorkerThread&) = delete;
+
+  void Run();
+  void ApplySchedulingHints();
+
+  std::thread thread_;
+  std::mutex wakeMutex_;
+  std::condition_variable wakeCondition_;
+  bool wakePending_;
+  std::atomic<bool> started_;
+  std::atomic<bool> terminated_;
+  uint64 affinityMask_;  // 0 means no preference
+  ThreadPriority priority_;
+};
+
+}  // namespace sbat